@@ -0,0 +1,583 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+/**
+ * @file alloc_bench.cpp
+ * @brief Microbenchmark and stress harness for the yumina allocator.
+ *
+ * Every workload is run once against the system malloc and once against the yumina
+ * allocator entry points, reporting ops/s, resident set size and fragmentation
+ * (resident bytes divided by live requested bytes at the workload's high-water mark).
+ *
+ * Workloads:
+ *   - size-class : single-thread alloc/free loops for each size class
+ *   - larson     : threads free and replace blocks allocated by other threads
+ *   - realloc    : std::vector-style doubling growth through realloc
+ *   - ast        : replay of a parser-shaped trace (ir_node, child vectors, identifiers), also
+ *                  into a yumina::region where frees are dropped and the tree goes in one reset
+ *
+ * Usage: yu-alloc-bench [--stress] [--only <workload>]
+ *   --stress verifies block contents on every free and exits non-zero on corruption.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/allocator.h"
+#include "common/region.hpp"
+#include "parser.h"
+
+#if defined(__APPLE__)
+    #include <mach/mach.h>
+#elif defined(__linux__)
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    namespace yumina_alloc = yumina::detail::yumina::detail::internal;
+
+    struct allocator_i
+    {
+        const char* name;
+        void* (*alloc)(size_t);
+        void (*free)(void*);
+        void* (*realloc)(void*, size_t);
+    };
+
+    const allocator_i SYSTEM_ALLOCATOR = {
+        "malloc",
+        [](const size_t size) { return std::malloc(size); },
+        [](void* ptr) { std::free(ptr); },
+        [](void* ptr, const size_t size) { return std::realloc(ptr, size); }
+    };
+
+    const allocator_i YUMINA_ALLOCATOR = {
+        "yumina",
+        [](const size_t size) { return yumina_alloc::allocate(size); },
+        [](void* ptr) { yumina_alloc::deallocate(ptr); },
+        [](void* ptr, const size_t size) { return yumina_alloc::reallocate(ptr, size); }
+    };
+
+    struct result_t
+    {
+        uint64_t ops;
+        uint64_t failures;
+        uint64_t corruptions;
+        double seconds;
+        size_t peak_live;
+        size_t peak_rss;
+    };
+
+    bool stress_mode = false;
+
+    size_t resident_bytes() noexcept
+    {
+        #if defined(__APPLE__)
+            mach_task_basic_info info{};
+            mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+            if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                          reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+                return 0;
+            return info.resident_size;
+        #elif defined(__linux__)
+            FILE* statm = std::fopen("/proc/self/statm", "r");
+            if (!statm)
+                return 0;
+            unsigned long pages = 0, resident = 0;
+            const int read = std::fscanf(statm, "%lu %lu", &pages, &resident);
+            std::fclose(statm);
+            return read == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+        #else
+            return 0;
+        #endif
+    }
+
+    /**
+     * @brief xorshift64*; deterministic so both allocators see the same request stream.
+     */
+    struct rng_t
+    {
+        uint64_t state;
+
+        explicit rng_t(const uint64_t seed) noexcept : state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+
+        uint64_t next() noexcept
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1DULL;
+        }
+
+        size_t range(const size_t lo, const size_t hi) noexcept
+        {
+            return lo + static_cast<size_t>(next() % (hi - lo + 1));
+        }
+    };
+
+    /**
+     * @brief Stamps the first and last byte of a block so stress mode can detect overlap.
+     */
+    ALWAYS_INLINE void stamp(void* ptr, const size_t size, const uint8_t tag) noexcept
+    {
+        auto* bytes = static_cast<uint8_t*>(ptr);
+        bytes[0] = tag;
+        bytes[size - 1] = tag;
+    }
+
+    ALWAYS_INLINE bool check(const void* ptr, const size_t size, const uint8_t tag) noexcept
+    {
+        const auto* bytes = static_cast<const uint8_t*>(ptr);
+        return bytes[0] == tag && bytes[size - 1] == tag;
+    }
+
+    template<typename Fn>
+    result_t timed(Fn&& fn)
+    {
+        result_t result{};
+        const size_t baseline = resident_bytes();
+        const auto start = std::chrono::steady_clock::now();
+        fn(result);
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Earlier workloads leave pages resident, so only growth during this one counts
+        result.peak_rss = std::max(result.peak_rss, resident_bytes());
+        result.peak_rss = result.peak_rss > baseline ? result.peak_rss - baseline : 0;
+        return result;
+    }
+
+    result_t run_size_class(const allocator_i& allocator, const size_t size)
+    {
+        constexpr size_t BATCH = 1024;
+        const size_t rounds = std::max<size_t>(16, (64ULL << 20) / (size * BATCH));
+
+        return timed([&](result_t& result)
+        {
+            std::vector<void*> live(BATCH);
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (size_t i = 0; i < BATCH; ++i)
+                {
+                    live[i] = allocator.alloc(size);
+                    if (!live[i])
+                    {
+                        ++result.failures;
+                        continue;
+                    }
+                    stamp(live[i], size, static_cast<uint8_t>(i));
+                }
+                if (round == 0)
+                {
+                    result.peak_live = BATCH * size;
+                    result.peak_rss = resident_bytes();
+                }
+                for (size_t i = 0; i < BATCH; ++i)
+                {
+                    if (!live[i])
+                        continue;
+                    if (stress_mode && !check(live[i], size, static_cast<uint8_t>(i)))
+                        ++result.corruptions;
+                    allocator.free(live[i]);
+                }
+                result.ops += 2 * BATCH;
+            }
+        });
+    }
+
+    /**
+     * @brief Larson-style churn: each thread owns a slot array for one round, replacing random
+     * slots, then hands the array to its neighbour so most frees happen on a foreign thread.
+     */
+    result_t run_larson(const allocator_i& allocator)
+    {
+        constexpr size_t THREADS = 4;
+        constexpr size_t SLOTS = 4096;
+        constexpr size_t ROUNDS = 32;
+        constexpr size_t REPLACEMENTS = 16384;
+
+        struct slot_t
+        {
+            void* ptr;
+            size_t size;
+            uint8_t tag;
+        };
+
+        return timed([&](result_t& result)
+        {
+            std::vector<std::vector<slot_t>> arrays(THREADS, std::vector<slot_t>(SLOTS));
+            std::atomic<uint64_t> ops{0}, failures{0}, corruptions{0};
+            std::atomic<size_t> barrier{0};
+
+            for (size_t t = 0; t < THREADS; ++t)
+            {
+                rng_t rng(t + 1);
+                for (auto& [ptr, size, tag] : arrays[t])
+                {
+                    size = rng.range(8, 512);
+                    tag = static_cast<uint8_t>(rng.next());
+                    ptr = allocator.alloc(size);
+                    if (ptr)
+                        stamp(ptr, size, tag);
+                }
+            }
+            result.peak_live = THREADS * SLOTS * 260;
+            result.peak_rss = resident_bytes();
+
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < THREADS; ++t)
+            {
+                threads.emplace_back([&, t]
+                {
+                    rng_t rng(0xC0FFEE + t);
+                    uint64_t local_ops = 0, local_failures = 0, local_corruptions = 0;
+                    for (size_t round = 0; round < ROUNDS; ++round)
+                    {
+                        auto& slots = arrays[(t + round) % THREADS];
+                        for (size_t i = 0; i < REPLACEMENTS; ++i)
+                        {
+                            auto& [ptr, size, tag] = slots[rng.next() % SLOTS];
+                            if (ptr)
+                            {
+                                if (stress_mode && !check(ptr, size, tag))
+                                    ++local_corruptions;
+                                allocator.free(ptr);
+                            }
+                            size = rng.range(8, 512);
+                            tag = static_cast<uint8_t>(rng.next());
+                            ptr = allocator.alloc(size);
+                            if (ptr)
+                                stamp(ptr, size, tag);
+                            else
+                                ++local_failures;
+                            local_ops += 2;
+                        }
+
+                        // Every thread finishes the round before arrays rotate
+                        barrier.fetch_add(1, std::memory_order_acq_rel);
+                        while (barrier.load(std::memory_order_acquire) < (round + 1) * THREADS)
+                            std::this_thread::yield();
+                    }
+                    ops += local_ops;
+                    failures += local_failures;
+                    corruptions += local_corruptions;
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+
+            for (auto& slots : arrays)
+            {
+                for (const auto& [ptr, size, tag] : slots)
+                {
+                    if (!ptr)
+                        continue;
+                    if (stress_mode && !check(ptr, size, tag))
+                        ++result.corruptions;
+                    allocator.free(ptr);
+                }
+            }
+            result.ops = ops;
+            result.failures = failures;
+            result.corruptions += corruptions;
+        });
+    }
+
+    /**
+     * @brief Grows buffers by doubling through realloc, like std::vector<T>::push_back.
+     */
+    result_t run_realloc(const allocator_i& allocator)
+    {
+        constexpr size_t BUFFERS = 256;
+        constexpr size_t MAX_SIZE = 256 * 1024;
+        constexpr size_t ROUNDS = 16;
+
+        return timed([&](result_t& result)
+        {
+            std::vector<void*> buffers(BUFFERS);
+            for (size_t round = 0; round < ROUNDS; ++round)
+            {
+                for (size_t i = 0; i < BUFFERS; ++i)
+                {
+                    void* buffer = nullptr;
+                    size_t size = 16;
+                    for (; size <= MAX_SIZE; size *= 2)
+                    {
+                        void* grown = allocator.realloc(buffer, size);
+                        ++result.ops;
+                        if (!grown)
+                        {
+                            ++result.failures;
+                            break;
+                        }
+                        if (stress_mode && buffer && !check(grown, size / 2, static_cast<uint8_t>(i)))
+                            ++result.corruptions;
+                        buffer = grown;
+                        stamp(buffer, size, static_cast<uint8_t>(i));
+                    }
+                    buffers[i] = buffer;
+                }
+                if (round == 0)
+                {
+                    result.peak_live = BUFFERS * MAX_SIZE;
+                    result.peak_rss = resident_bytes();
+                }
+                for (void*& buffer : buffers)
+                {
+                    if (buffer)
+                        allocator.free(buffer);
+                    buffer = nullptr;
+                    ++result.ops;
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Allocation event of the parser-shaped trace. A `size` of zero frees `id`.
+     */
+    struct trace_op
+    {
+        uint32_t id;
+        uint32_t size;
+    };
+
+    /**
+     * @brief Builds a trace shaped like parsing a large file: one ir_node per construct, a child
+     * vector per interior node that grows by doubling, and a copy of every identifier; the tree
+     * is torn down depth-first at the end like destroy_node.
+     */
+    std::vector<trace_op> build_ast_trace(const size_t nodes)
+    {
+        std::vector<trace_op> trace;
+        trace.reserve(nodes * 4);
+        rng_t rng(0xA57);
+
+        uint32_t next_id = 0;
+        struct open_node
+        {
+            uint32_t node;
+            uint32_t children;
+            uint32_t vector;
+            uint32_t capacity;
+            size_t teardown_slot;
+        };
+        std::vector<open_node> stack;
+        std::vector<uint32_t> teardown;
+
+        for (size_t n = 0; n < nodes; ++n)
+        {
+            const uint32_t node = next_id++;
+            trace.push_back({ node, sizeof(yu::frontend::ir_node) });
+            teardown.push_back(node);
+
+            // Identifiers and literals carry a text copy
+            if (rng.next() % 3 == 0)
+            {
+                const uint32_t text = next_id++;
+                trace.push_back({ text, static_cast<uint32_t>(rng.range(2, 24)) });
+                teardown.push_back(text);
+            }
+
+            if (!stack.empty())
+            {
+                auto& parent = stack.back();
+                if (parent.children == parent.capacity)
+                {
+                    const uint32_t capacity = parent.capacity ? parent.capacity * 2 : 1;
+                    const uint32_t vector = next_id++;
+                    trace.push_back({ vector, static_cast<uint32_t>(capacity * sizeof(void*)) });
+                    if (parent.capacity)
+                    {
+                        trace.push_back({ parent.vector, 0 });
+                        teardown[parent.teardown_slot] = vector;
+                    }
+                    else
+                    {
+                        parent.teardown_slot = teardown.size();
+                        teardown.push_back(vector);
+                    }
+                    parent.vector = vector;
+                    parent.capacity = capacity;
+                }
+                ++parent.children;
+            }
+
+            // Expression nesting is shallow and wide; blocks open and close often
+            if (stack.size() < 24 && rng.next() % 4 == 0)
+                stack.push_back({ node, 0, UINT32_MAX, 0, 0 });
+            else if (!stack.empty() && rng.next() % 5 == 0)
+                stack.pop_back();
+        }
+
+        for (auto it = teardown.rbegin(); it != teardown.rend(); ++it)
+            trace.push_back({ *it, 0 });
+        return trace;
+    }
+
+    result_t run_ast(const allocator_i& allocator, const std::vector<trace_op>& trace, const uint32_t ids)
+    {
+        return timed([&](result_t& result)
+        {
+            std::vector<void*> blocks(ids);
+            std::vector<uint32_t> sizes(ids);
+            size_t live = 0;
+            for (const auto& [id, size] : trace)
+            {
+                if (size)
+                {
+                    blocks[id] = allocator.alloc(size);
+                    sizes[id] = size;
+                    if (blocks[id])
+                    {
+                        stamp(blocks[id], size, static_cast<uint8_t>(id));
+                        live += size;
+                        if (live > result.peak_live)
+                        {
+                            result.peak_live = live;
+                            if ((id & 0xFFFF) == 0)
+                                result.peak_rss = std::max(result.peak_rss, resident_bytes());
+                        }
+                    }
+                    else
+                        ++result.failures;
+                }
+                else if (blocks[id])
+                {
+                    if (stress_mode && !check(blocks[id], sizes[id], static_cast<uint8_t>(id)))
+                        ++result.corruptions;
+                    allocator.free(blocks[id]);
+                    blocks[id] = nullptr;
+                    live -= sizes[id];
+                }
+                ++result.ops;
+            }
+        });
+    }
+
+    result_t run_ast_region(const std::vector<trace_op>& trace)
+    {
+        return timed([&](result_t& result)
+        {
+            yumina::region arena;
+            for (const auto& [id, size] : trace)
+            {
+                if (size)
+                {
+                    if (void* block = arena.allocate(size, 16))
+                        stamp(block, size, static_cast<uint8_t>(id));
+                    else
+                        ++result.failures;
+                    result.peak_live += size;
+                }
+                ++result.ops;
+            }
+            result.peak_rss = resident_bytes();
+            arena.reset();
+        });
+    }
+
+    void report(const char* workload, const allocator_i& allocator, const result_t& result)
+    {
+        const double frag = result.peak_live
+                                ? static_cast<double>(result.peak_rss) / static_cast<double>(result.peak_live)
+                                : 0.0;
+        std::printf("%-16s %-8s %14.0f %12.2f %8.2f %10llu %10llu\n", workload, allocator.name,
+                    result.seconds > 0 ? static_cast<double>(result.ops) / result.seconds : 0.0,
+                    static_cast<double>(result.peak_rss) / (1024.0 * 1024.0), frag,
+                    static_cast<unsigned long long>(result.failures),
+                    static_cast<unsigned long long>(result.corruptions));
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    std::string_view only;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--stress")
+            stress_mode = true;
+        else if (arg == "--only" && i + 1 < argc)
+            only = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--stress] [--only size-class|larson|realloc|ast]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const allocator_i* allocators[] = { &SYSTEM_ALLOCATOR, &YUMINA_ALLOCATOR };
+    uint64_t corruptions = 0;
+
+    std::printf("%-16s %-8s %14s %12s %8s %10s %10s\n",
+                "workload", "alloc", "ops/s", "rss MiB", "frag", "failed", "corrupt");
+
+    const auto wants = [&](const std::string_view name) { return only.empty() || only == name; };
+
+    if (wants("size-class"))
+    {
+        for (size_t size = 8; size <= 64 * 1024; size *= 2)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "class-%zu", size);
+            for (const auto* allocator : allocators)
+            {
+                const auto result = run_size_class(*allocator, size);
+                corruptions += result.corruptions;
+                report(name, *allocator, result);
+            }
+        }
+    }
+
+    if (wants("larson"))
+    {
+        for (const auto* allocator : allocators)
+        {
+            const auto result = run_larson(*allocator);
+            corruptions += result.corruptions;
+            report("larson", *allocator, result);
+        }
+    }
+
+    if (wants("realloc"))
+    {
+        for (const auto* allocator : allocators)
+        {
+            const auto result = run_realloc(*allocator);
+            corruptions += result.corruptions;
+            report("realloc", *allocator, result);
+        }
+    }
+
+    if (wants("ast"))
+    {
+        const auto trace = build_ast_trace(stress_mode ? 200000 : 2000000);
+        uint32_t ids = 0;
+        for (const auto& op : trace)
+            ids = std::max(ids, op.id + 1);
+        for (const auto* allocator : allocators)
+        {
+            const auto result = run_ast(*allocator, trace, ids);
+            corruptions += result.corruptions;
+            report("ast", *allocator, result);
+        }
+
+        constexpr allocator_i REGION = { "region", nullptr, nullptr, nullptr };
+        report("ast", REGION, run_ast_region(trace));
+    }
+
+    if (stress_mode && corruptions)
+    {
+        std::fprintf(stderr, "%llu corrupted blocks detected\n", static_cast<unsigned long long>(corruptions));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_CLI_COMPILE_H
+#define YU_CLI_COMPILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace yu::cli
+{
+    struct compile_options
+    {
+        std::vector<std::string> inputs;       // files, or directories searched for *.yu
+        std::vector<std::string> import_paths; // searched for imports after the importer's directory, -I
+        size_t jobs{0};                        // worker threads, 0 = one per hardware thread
+        bool quiet{false};                     // only errors and the summary
+        bool emit_ir{false};                   // print the SSA form of each method, -emit-ir
+        bool optimize{true};                   // constant propagation and dead code elimination, off with -O0
+        bool layout_report{false};             // class layouts with padding and cache-line use, -flayout-report
+        bool time_report{false};               // per-phase table with hardware counters, -ftime-report
+        std::string time_trace;                // Chrome trace JSON output path, -ftime-trace[=path]
+        std::string cache_dir;                 // token cache directory, empty to always re-lex
+    };
+
+    /**
+     * @brief Parses the arguments that follow `compile`.
+     * @param args The arguments.
+     * @param options Filled in on success.
+     * @param error Set to a message when the arguments are invalid.
+     * @return False if the arguments are invalid.
+     */
+    bool parse_compile_args(const std::vector<std::string> &args, compile_options &options, std::string &error);
+
+    /**
+     * @brief Lexes, parses, checks and lowers every input and the modules they import on a work-stealing pool,
+     * each module once and after everything it imports, printing per-file and aggregate timings.
+     * @return 0 if every file went through cleanly, 1 if any failed, 2 if no input was usable.
+     */
+    int run_compile(const compile_options &options);
+}
+
+#endif
@@ -0,0 +1,551 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/compile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include "../../common/allocator.h"
+#include "../../common/trace.h"
+#include "../../common/work_pool.hpp"
+#include "../../frontend/include/layout.h"
+#include "../../frontend/include/lexer.h"
+#include "../../frontend/include/modules.h"
+#include "../../frontend/include/parser.h"
+#include "../../frontend/include/sema.h"
+#include "../../frontend/include/token_cache.h"
+#include "../../middle/include/lower.h"
+#include "../../middle/include/optimize.h"
+
+namespace yu::cli
+{
+    namespace
+    {
+        using clock_type = std::chrono::steady_clock;
+
+        /**
+         * @brief Per-module numbers for the report; errors live on the module itself.
+         */
+        struct file_result_t
+        {
+            size_t bytes{0};
+            size_t tokens{0};
+            double lex_ms{0};
+            double parse_ms{0};
+            double check_ms{0};
+            double lower_ms{0};
+            double optimize_ms{0};
+            bool cache_hit{false};
+            std::vector<std::string> layout_errors;
+            std::vector<std::string> lower_errors; // the verifier rejecting lowered code
+            std::string layout_report;             // -flayout-report
+            std::string ir_text;                   // -emit-ir
+        };
+
+        double elapsed_ms(const clock_type::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+        }
+
+        bool read_file(const std::string &path, std::string &out)
+        {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file)
+                return false;
+            // One sized read; with the token cache warm, reading is most of the remaining work
+            const std::streamoff size = file.tellg();
+            if (size < 0)
+                return false;
+            out.resize(static_cast<size_t>(size));
+            file.seekg(0);
+            return static_cast<bool>(file.read(out.data(), size));
+        }
+
+        /**
+         * @brief Expands directories to the *.yu files below them, sorted so output and
+         * scheduling do not depend on directory order.
+         */
+        bool collect_inputs(const std::vector<std::string> &inputs, std::vector<std::string> &files)
+        {
+            namespace fs = std::filesystem;
+            bool ok = true;
+            for (const auto &input : inputs)
+            {
+                std::error_code ec;
+                if (fs::is_directory(input, ec))
+                {
+                    std::vector<std::string> found;
+                    for (fs::recursive_directory_iterator it(input, ec), end; !ec && it != end; it.increment(ec))
+                    {
+                        if (it->is_regular_file(ec) && it->path().extension() == ".yu")
+                            found.push_back(it->path().string());
+                    }
+                    if (ec)
+                    {
+                        std::fprintf(stderr, "%s: error: %s\n", input.c_str(), ec.message().c_str());
+                        ok = false;
+                    }
+                    std::sort(found.begin(), found.end());
+                    files.insert(files.end(), found.begin(), found.end());
+                }
+                else if (fs::is_regular_file(input, ec))
+                {
+                    files.push_back(input);
+                }
+                else
+                {
+                    std::fprintf(stderr, "%s: error: no such file or directory\n", input.c_str());
+                    ok = false;
+                }
+            }
+            return ok;
+        }
+
+        /**
+         * @brief Reports the first token the lexer flagged or could not classify, if any.
+         */
+        bool find_lex_error(frontend::module_t &module)
+        {
+            const auto &tokens = module.lexer.tokens;
+            for (size_t i = 0; i < tokens.size(); ++i)
+            {
+                if (tokens.flags[i] == 0 && tokens.types[i] != lang::token_i::UNKNOWN)
+                    continue;
+
+                const lang::token_t token{ tokens.starts[i], tokens.lengths[i], tokens.types[i], tokens.flags[i] };
+                std::tie(module.line, module.column) = frontend::get_line_col(module.lexer, token);
+                module.error = "invalid token '" + std::string(frontend::get_token_value(module.lexer, token)) + "'";
+                return true;
+            }
+            return false;
+        }
+
+        size_t count_nodes(const frontend::ir_node *node)
+        {
+            if (!node)
+                return 0;
+            size_t count = 1;
+            for (const auto *child : node->children)
+                count += count_nodes(child);
+            return count;
+        }
+
+        void lex_source(const std::string &source, const char *path, frontend::Lexer &lexer)
+        {
+            {
+                trace::span span("create_lexer", path);
+                lexer = frontend::create_lexer(source);
+                span.bytes = source.size();
+            }
+            trace::span span("tokenize", path);
+            frontend::tokenize(lexer);
+            span.bytes = source.size();
+            span.tokens = lexer.tokens.size();
+        }
+
+        /**
+         * @brief Reads and lexes one module as the loader discovers it, through the token
+         * cache when one is configured.
+         */
+        bool load_module(frontend::module_t &module, file_result_t &result, const compile_options &options)
+        {
+            const char *path = module.path.c_str();
+            std::string &source = module.source;
+            {
+                trace::span span("read", path);
+                if (!read_file(module.path, source))
+                {
+                    module.error = "cannot read file";
+                    return false;
+                }
+                span.bytes = source.size();
+            }
+            result.bytes = source.size();
+            if (source.size() > UINT32_MAX)
+            {
+                module.error = "file too large (over 4 GiB)";
+                return false;
+            }
+
+            const auto lex_start = clock_type::now();
+            frontend::Lexer &lexer = module.lexer;
+            {
+                yumina::detail::alloc_phase phase("lex");
+                uint64_t hash = 0;
+                if (!options.cache_dir.empty())
+                {
+                    trace::span span("cache_load", path);
+                    hash = frontend::source_hash(source);
+                    result.cache_hit = frontend::load_cached_tokens(options.cache_dir, source, hash, lexer);
+                    span.bytes = source.size();
+                    span.tokens = lexer.tokens.size();
+                }
+                if (!result.cache_hit)
+                {
+                    lex_source(source, path, lexer);
+                    if (!options.cache_dir.empty())
+                    {
+                        trace::span span("cache_store", path);
+                        frontend::store_cached_tokens(options.cache_dir, hash, lexer);
+                        span.tokens = lexer.tokens.size();
+                    }
+                }
+            }
+            result.lex_ms = elapsed_ms(lex_start);
+            result.tokens = lexer.tokens.size();
+            return !find_lex_error(module);
+        }
+
+        /**
+         * @brief Parses and checks the rest of a module once everything it imports has been
+         * checked, so their models are complete.
+         */
+        void parse_module(frontend::module_t &module, const frontend::module_graph &graph,
+                          const compile_options &options, file_result_t &result)
+        {
+            if (!module.error.empty())
+                return;
+
+            const char *path = module.path.c_str();
+            const auto parse_start = clock_type::now();
+            bool parsed;
+            uint32_t error_pos = 0;
+            {
+                yumina::detail::alloc_phase phase("parse");
+                trace::span span("parse", path);
+                parsed = frontend::parse_module_body(module.source.c_str(), &module.lexer.tokens, module.body_pos,
+                                                     module.tree, &error_pos);
+                span.stop();
+                span.tokens = module.lexer.tokens.size();
+                span.nodes = trace::enabled() ? count_nodes(module.tree) : 0;
+            }
+            result.parse_ms = elapsed_ms(parse_start);
+            if (!parsed)
+            {
+                const auto &tokens = module.lexer.tokens;
+                const lang::token_t token{ tokens.starts[error_pos], tokens.lengths[error_pos], tokens.types[error_pos],
+                                           tokens.flags[error_pos] };
+                std::tie(module.line, module.column) = frontend::get_line_col(module.lexer, token);
+                module.error = token.type == lang::token_i::END_OF_FILE
+                                   ? "syntax error at end of file"
+                                   : "syntax error at '" + std::string(frontend::get_token_value(module.lexer, token)) + "'";
+                return;
+            }
+
+            const auto check_start = clock_type::now();
+            {
+                trace::span span("check", path);
+                std::vector<const frontend::semantic_model *> imports;
+                for (const uint32_t import : module.imports)
+                {
+                    const auto &imported = *graph.modules[import];
+                    imports.push_back(imported.error.empty() ? &imported.semantics : nullptr);
+                }
+                frontend::analyze(module.tree, module.semantics, imports);
+                span.stop();
+                span.nodes = trace::enabled() ? count_nodes(module.tree) : 0;
+            }
+            if (module.semantics.errors.empty())
+            {
+                trace::span span("layout", path);
+                frontend::module_layout layout;
+                frontend::compute_layouts(module.semantics, layout);
+                result.layout_errors = std::move(layout.errors);
+                if (options.layout_report)
+                {
+                    for (const auto &class_layout : layout.classes)
+                        result.layout_report += frontend::format_layout(module.semantics, class_layout);
+                }
+            }
+            result.check_ms = elapsed_ms(check_start);
+
+            if (module.semantics.errors.empty())
+            {
+                middle::module_ir ir;
+                const auto lower_start = clock_type::now();
+                {
+                    trace::span span("lower", path);
+                    middle::lower_module(module.tree, module.semantics, ir);
+                }
+                result.lower_ms = elapsed_ms(lower_start);
+
+                middle::optimize_stats_t stats;
+                if (options.optimize)
+                {
+                    const auto optimize_start = clock_type::now();
+                    trace::span span("optimize", path);
+                    middle::optimize_module(ir, stats);
+                    span.stop();
+                    result.optimize_ms = elapsed_ms(optimize_start);
+                }
+
+                trace::span span("verify", path);
+                for (const auto &function : ir.functions)
+                {
+                    for (const auto &error : middle::verify(ir, function))
+                        result.lower_errors.push_back("internal error: " + middle::function_name(ir, function) +
+                                                      ": " + error);
+                    if (options.emit_ir)
+                        result.ir_text += middle::dump(ir, function);
+                }
+                if (options.emit_ir)
+                {
+                    for (const auto &skipped : ir.skipped)
+                        result.ir_text += "; not lowered: " + skipped + "\n";
+                    if (options.optimize)
+                    {
+                        char line[192];
+                        std::snprintf(line, sizeof(line),
+                                      "; optimized %u functions: %u folded, %u simplified, %u branches decided, "
+                                      "%u blocks and %u instructions removed\n",
+                                      stats.functions, stats.folded, stats.simplified, stats.branches,
+                                      stats.removed_blocks, stats.removed_instrs);
+                        result.ir_text += line;
+                    }
+                }
+            }
+
+            // The model keeps what importers need, and the SSA form is not consumed yet
+            trace::span span("destroy_node", path);
+            span.nodes = trace::enabled() ? count_nodes(module.tree) : 0;
+            frontend::destroy_node(module.tree);
+            module.tree = nullptr;
+        }
+    }
+
+    bool parse_compile_args(const std::vector<std::string> &args, compile_options &options, std::string &error)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string &arg = args[i];
+            std::string jobs;
+            if (arg == "-j" || arg == "--jobs")
+            {
+                if (i + 1 == args.size())
+                {
+                    error = arg + " needs a thread count";
+                    return false;
+                }
+                jobs = args[++i];
+            }
+            else if (arg.size() > 2 && arg.compare(0, 2, "-j") == 0)
+            {
+                jobs = arg.substr(2);
+            }
+            else if (arg == "-O0" || arg == "-O1")
+            {
+                options.optimize = arg == "-O1";
+                continue;
+            }
+            else if (arg == "-emit-ir")
+            {
+                options.emit_ir = true;
+                continue;
+            }
+            else if (arg == "-flayout-report")
+            {
+                options.layout_report = true;
+                continue;
+            }
+            else if (arg == "-ftime-report")
+            {
+                options.time_report = true;
+                continue;
+            }
+            else if (arg == "-ftime-trace" || arg.compare(0, 13, "-ftime-trace=") == 0)
+            {
+                options.time_trace = arg.size() > 13 ? arg.substr(13) : "yu-time-trace.json";
+                continue;
+            }
+            else if (arg == "--cache-dir" || arg.compare(0, 12, "--cache-dir=") == 0)
+            {
+                if (arg.size() > 12)
+                    options.cache_dir = arg.substr(12);
+                else if (i + 1 < args.size())
+                    options.cache_dir = args[++i];
+                if (options.cache_dir.empty())
+                {
+                    error = "--cache-dir needs a directory";
+                    return false;
+                }
+                continue;
+            }
+            else if (arg == "-I" || (arg.size() > 2 && arg.compare(0, 2, "-I") == 0))
+            {
+                if (arg.size() > 2)
+                    options.import_paths.push_back(arg.substr(2));
+                else if (i + 1 < args.size())
+                    options.import_paths.push_back(args[++i]);
+                else
+                {
+                    error = "-I needs a directory";
+                    return false;
+                }
+                continue;
+            }
+            else if (arg == "-q" || arg == "--quiet")
+            {
+                options.quiet = true;
+                continue;
+            }
+            else if (!arg.empty() && arg[0] == '-')
+            {
+                error = "unknown option '" + arg + "'";
+                return false;
+            }
+            else
+            {
+                options.inputs.push_back(arg);
+                continue;
+            }
+
+            if (jobs.empty() || jobs.find_first_not_of("0123456789") != std::string::npos || jobs.size() > 6)
+            {
+                error = "invalid thread count '" + jobs + "'";
+                return false;
+            }
+            options.jobs = std::stoul(jobs);
+        }
+
+        if (options.inputs.empty())
+        {
+            error = "no input files";
+            return false;
+        }
+        return true;
+    }
+
+    int run_compile(const compile_options &options)
+    {
+        if (options.time_report || !options.time_trace.empty())
+            trace::enable(options.time_report);
+        const auto wall_start = clock_type::now();
+
+        std::vector<std::string> files;
+        const bool inputs_ok = collect_inputs(options.inputs, files);
+        if (files.empty())
+        {
+            std::fprintf(stderr, "error: no .yu files to compile\n");
+            return 2;
+        }
+
+        // Largest roots first, so a big one picked up last does not trail the whole run
+        std::vector<std::pair<uintmax_t, std::string>> by_size;
+        by_size.reserve(files.size());
+        for (auto &file : files)
+        {
+            std::error_code ec;
+            const uintmax_t size = std::filesystem::file_size(file, ec);
+            by_size.emplace_back(ec ? 0 : size, std::move(file));
+        }
+        std::stable_sort(by_size.begin(), by_size.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+        std::vector<std::string> roots;
+        roots.reserve(by_size.size());
+        for (auto &[size, file] : by_size)
+            roots.push_back(std::move(file));
+
+        // Filled in by the loader's tasks; entries are only added during loading
+        std::unordered_map<const frontend::module_t *, file_result_t> results;
+        std::mutex results_mutex;
+
+        frontend::module_options module_options;
+        module_options.search_paths = options.import_paths;
+        module_options.load = [&](frontend::module_t &module)
+        {
+            file_result_t *result;
+            {
+                std::lock_guard lock(results_mutex);
+                result = &results[&module];
+            }
+            return load_module(module, *result, options);
+        };
+
+        frontend::module_graph graph;
+        size_t threads;
+        {
+            work_pool pool(options.jobs);
+            threads = pool.size();
+            frontend::load_modules(roots, module_options, pool, graph);
+            frontend::schedule_topological(graph, pool, [&](frontend::module_t &module)
+            {
+                parse_module(module, graph, options, results.at(&module));
+            });
+        }
+        const double wall_ms = elapsed_ms(wall_start);
+
+        size_t failed = 0, bytes = 0, tokens = 0, cache_hits = 0;
+        double lex_ms = 0, parse_ms = 0, check_ms = 0, lower_ms = 0, optimize_ms = 0;
+        for (const auto &module : graph.modules)
+        {
+            const file_result_t &result = results[module.get()];
+            bytes += result.bytes;
+            tokens += result.tokens;
+            lex_ms += result.lex_ms;
+            parse_ms += result.parse_ms;
+            check_ms += result.check_ms;
+            lower_ms += result.lower_ms;
+            optimize_ms += result.optimize_ms;
+            cache_hits += result.cache_hit;
+
+            const char *path = module->path.c_str();
+            const auto &semantic_errors = module->semantics.errors;
+            const bool ok = module->error.empty() && semantic_errors.empty() && result.layout_errors.empty() &&
+                            result.lower_errors.empty();
+            failed += !ok;
+            for (const auto &error : semantic_errors)
+                std::fprintf(stderr, "%s: error: %s\n", path, error.c_str());
+            for (const auto &error : result.layout_errors)
+                std::fprintf(stderr, "%s: error: %s\n", path, error.c_str());
+            for (const auto &error : result.lower_errors)
+                std::fprintf(stderr, "%s: error: %s\n", path, error.c_str());
+            if (!module->error.empty())
+            {
+                if (module->line)
+                    std::fprintf(stderr, "%s:%u:%u: error: %s\n", path, module->line, module->column,
+                                 module->error.c_str());
+                else
+                    std::fprintf(stderr, "%s: error: %s\n", path, module->error.c_str());
+            }
+            if (!options.quiet)
+            {
+                std::printf("%-4s %-48s %10zu B %8zu tok  %s %8.3f ms  parse %8.3f ms  check %8.3f ms  lower %8.3f ms"
+                            "  opt %8.3f ms\n",
+                            ok ? "ok" : "FAIL", path, result.bytes, result.tokens, result.cache_hit ? "hit" : "lex",
+                            result.lex_ms, result.parse_ms, result.check_ms, result.lower_ms, result.optimize_ms);
+            }
+            if (!result.layout_report.empty())
+                std::printf("%s", result.layout_report.c_str());
+            if (!result.ir_text.empty())
+                std::printf("%s", result.ir_text.c_str());
+        }
+
+        const double seconds = wall_ms / 1000.0;
+        std::printf("%zu files (%zu failed), %zu bytes, %zu tokens on %zu threads\n"
+                    "  lex %.3f ms + parse %.3f ms + check %.3f ms + lower %.3f ms + opt %.3f ms cpu, %.3f ms wall, "
+                    "%.1f MiB/s\n",
+                    graph.modules.size(), failed, bytes, tokens, threads, lex_ms, parse_ms, check_ms, lower_ms,
+                    optimize_ms, wall_ms,
+                    seconds > 0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0);
+        if (!options.cache_dir.empty())
+            std::printf("  token cache: %zu hits, %zu misses\n", cache_hits, graph.modules.size() - cache_hits);
+        std::fflush(stdout);
+
+        if (options.time_report)
+            trace::write_report(stdout);
+        if (!options.time_trace.empty() && !trace::write_chrome_trace(options.time_trace))
+        {
+            std::fprintf(stderr, "%s: error: cannot write trace\n", options.time_trace.c_str());
+            return 1;
+        }
+
+        return failed || !inputs_ok ? 1 : 0;
+    }
+}
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include "../include/compile.h"
 
 /**
  * @file yu-cli.cpp
@@ -7,8 +10,8 @@
  *      This file is a part of the Yu Programming Language.
  *      Licensed under the MIT License (MIT). See LICENSE file for more details.
  *
- * A basic CLI that accepts default commands, displays help, and provides
- * a "compile --help" command with colored output. Type "exit" to quit.
+ * Run without arguments for an interactive prompt (type "exit" to quit), or as
+ * "yu-cli compile <files|dirs...> [-j N]" to push sources through the frontend in batch.
  */
 
 const std::string RESET_COLOR = "\033[0m";
@@ -26,6 +29,7 @@ void print_help()
     std::cout << COLOR_HELP << "Help:\n";
     std::cout << "  (default)       : Default command output.\n";
     std::cout << "  --help          : Displays this help message.\n";
+    std::cout << "  compile ...     : Lexes, parses and type-checks source files, see 'compile --help'.\n";
     std::cout << "  compile --help  : Shows help for the 'compile' command.\n";
     std::cout << "  exit            : Exits the Yu CLI." << RESET_COLOR << "\n";
 }
@@ -34,21 +38,75 @@ void print_compile_help()
 {
     std::cout << COLOR_HELP << "Compile Help:\n";
     std::cout << "  Usage:\n";
-    std::cout << "    compile [options]\n";
+    std::cout << "    compile [options] <files|directories...>\n";
+    std::cout << "  Directories are searched recursively for *.yu files. Imported modules are compiled\n";
+    std::cout << "  once each, after the modules they import.\n";
     std::cout << "  Options:\n";
-    std::cout << "    --help  : Show this help message for the compile command."
+    std::cout << "    -j, --jobs N          : Worker threads (default: one per hardware thread).\n";
+    std::cout << "    -I DIR                : Also look for imported modules in DIR.\n";
+    std::cout << "    -q, --quiet           : Print only errors and the summary.\n";
+    std::cout << "    --cache-dir DIR       : Reuse tokens of unchanged files from DIR, keyed by content hash.\n";
+    std::cout << "    -O0, -O1              : Skip or run (default) constant propagation and dead code elimination.\n";
+    std::cout << "    -emit-ir              : Print the SSA form of every method.\n";
+    std::cout << "    -flayout-report       : Print each class's field offsets, padding and cache-line use.\n";
+    std::cout << "    -ftime-report         : Print time, throughput, allocations and hardware counters per phase.\n";
+    std::cout << "    -ftime-trace[=file]   : Write phase spans as Chrome trace JSON (default: yu-time-trace.json).\n";
+    std::cout << "    --help                : Show this help message for the compile command.\n";
+    std::cout << "  Exits with 1 if any file fails to lex, parse or type-check."
               << RESET_COLOR << "\n";
 }
 
 /**
- * @brief Main CLI loop for the Yu Programming Language.
+ * @brief Runs the compile command on its arguments (everything after "compile").
  *
- * Runs an interactive command prompt where the user can type commands.
+ * @return The process exit code.
+ */
+int compile_command(const std::vector<std::string>& args)
+{
+    for (const auto& arg : args)
+    {
+        if (arg == "--help")
+        {
+            print_compile_help();
+            return 0;
+        }
+    }
+
+    yu::cli::compile_options options;
+    if (std::string error; !yu::cli::parse_compile_args(args, options, error))
+    {
+        std::cerr << COLOR_WARNING << "compile: " << error << ". Type 'compile --help' for usage."
+                  << RESET_COLOR << "\n";
+        return 2;
+    }
+    return yu::cli::run_compile(options);
+}
+
+/**
+ * @brief Entry point of the Yu CLI.
+ *
+ * With arguments the given command runs once and its status is returned; without, an
+ * interactive command prompt is started.
  *
  * @return Returns 0 upon successful completion.
  */
-int main()
+int main(int argc, char** argv)
 {
+    if (argc > 1)
+    {
+        const std::string command = argv[1];
+        if (command == "compile")
+            return compile_command(std::vector<std::string>(argv + 2, argv + argc));
+        if (command == "--help")
+        {
+            print_help();
+            return 0;
+        }
+        std::cerr << COLOR_WARNING << "Unknown command '" << command << "'. Try 'yu-cli --help'."
+                  << RESET_COLOR << "\n";
+        return 2;
+    }
+
     std::string input;
 
     while (true)
@@ -63,6 +121,11 @@ int main()
         input.erase(0, input.find_first_not_of(" \t\n\r\f\v"));
         input.erase(input.find_last_not_of(" \t\n\r\f\v") + 1);
 
+        std::istringstream words(input);
+        std::vector<std::string> args;
+        for (std::string word; words >> word;)
+            args.push_back(word);
+
         if (input.empty())
         {
             print_default();
@@ -71,9 +134,9 @@ int main()
         {
             print_help();
         }
-        else if (input == "compile --help")
+        else if (args[0] == "compile")
         {
-            print_compile_help();
+            compile_command(std::vector<std::string>(args.begin() + 1, args.end()));
         }
         else if (input == "exit" || input == "quit")
         {
@@ -87,4 +150,4 @@ int main()
     }
 
     return 0;
-}
\ No newline at end of file
+}
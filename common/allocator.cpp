@@ -4,676 +4,1791 @@
     // Windows virtual memory management
     #define MAP_MEMORY(size) VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)
     #define UNMAP_MEMORY(ptr, size) VirtualFree(ptr, 0, MEM_RELEASE)
+    #define DECOMMIT_MEMORY(ptr, size) VirtualAlloc(ptr, size, MEM_RESET, PAGE_READWRITE)
     #ifndef MAP_FAILED
         #define MAP_FAILED nullptr
     #endif
     #define ALIGNED_ALLOC(alignment, size) _aligned_malloc(size, alignment)
     #define ALIGNED_FREE(ptr) _aligned_free(ptr)
 #elif defined(__APPLE__)
+    #include <cxxabi.h>
+    #include <dlfcn.h>
     #include <mach/mach.h>
     #include <sys/mman.h>
 
     #define MAP_MEMORY(size) mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
     #define UNMAP_MEMORY(ptr, size) munmap(ptr, size)
+    #define DECOMMIT_MEMORY(ptr, size) madvise(ptr, size, MADV_FREE)
+    #define MAP_MEMORY_AT(hint, size) mmap(hint, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
     #define ALIGNED_ALLOC(alignment, size) aligned_alloc(alignment, size)
     #define ALIGNED_FREE(ptr) free(ptr)
 
 #else
     // POSIX-compliant systems (Linux, BSD, etc.)
+    #include <cxxabi.h>
+    #include <dlfcn.h>
     #include <sched.h>
     #include <unistd.h>
     #include <sys/mman.h>
+    #include <sys/syscall.h>
     #include <thread>
 
     #define MAP_MEMORY(size) \
     mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
     #define UNMAP_MEMORY(ptr, size) munmap(ptr, size)
+    #define DECOMMIT_MEMORY(ptr, size) madvise(ptr, size, MADV_DONTNEED)
+    #if defined(__linux__)
+        #define REMAP_MEMORY(ptr, old_size, new_size) mremap(ptr, old_size, new_size, MREMAP_MAYMOVE)
+    #else
+        #define MAP_MEMORY_AT(hint, size) \
+        mmap(hint, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+    #endif
     #define ALIGNED_ALLOC(alignment, size) aligned_alloc(alignment, size)
     #define ALIGNED_FREE(ptr) free(ptr)
 #endif
 
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
 #include "allocator.h"
 #include "arch.hpp"
 
 namespace yumina::detail
 {
     thread_local thread_cache_t thread_cache_{};
-    thread_local auto pool_manager_ = new pool_manager();
-    thread_local auto large_block_cache_ = new large_block_cache_t();
-    thread_local std::array<tiny_block_manager*, TINY_CLASSES> tiny_pools_{};
+    thread_local span_region_t span_region_{};
+    thread_local pool_manager* pool_manager_ = nullptr;
+    thread_local large_block_cache_t* large_block_cache_ = nullptr;
+
+    // Set once the exit hook has torn the thread's heap down. Later allocations, say from another
+    // thread_local destructor, must not build a new heap that nothing would release again
+    thread_local bool thread_torn_down_ = false;
+
+    ALWAYS_INLINE static void* alloc_large(size_t size, bool* zeroed = nullptr) noexcept;
+    ALWAYS_INLINE static void* map_pages(size_t size, size_t alignment, bool huge, bool populate,
+                                         int node = -1) noexcept;
+    static void cleanup() noexcept;
+
+    static constexpr uint8_t PAGE_HUGE = 1 << 0;
+    static constexpr uint8_t PAGE_POPULATE = 1 << 1;
+    static constexpr uint8_t PAGE_UNSET = 0xFF;
+
+    #ifdef YUMINA_ALLOC_DEBUG
+        static constexpr bool DEBUG_ALLOC = true;
+    #else
+        static constexpr bool DEBUG_ALLOC = false;
+    #endif
+
+    // Debug builds map an inaccessible page behind every large block so overruns fault on the spot
+    static constexpr size_t GUARD_SIZE = DEBUG_ALLOC ? PG_SIZE : 0;
+    static constexpr uint8_t POISON_BYTE = 0xDF;
+    static constexpr uint8_t CANARY_BYTE = 0xFB;
+
+    // Constant-initialized so allocations made during static initialization see a valid mode
+    static std::atomic<uint8_t> page_mode_{PAGE_UNSET};
+
+    static constexpr uint64_t NS_PER_MS = 1000 * 1000;
+    static std::atomic<uint32_t> purge_idle_ms_{1000};
+    static std::atomic<uint32_t> purge_interval_ms_{250};
+    static std::atomic<size_t> purge_budget_{MAX_CACHE_SIZE};
+    thread_local uint64_t last_purge_ = 0;
+
+    // Every thread's large block cache, so the background purger can reach idle threads
+    static std::atomic<bool> registry_lock_{false};
+    static large_block_cache_t* cache_registry_ = nullptr;
+
+    struct purger_state
+    {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread thread;
+        bool running = false;
+    };
 
-    static constexpr size_t get_alignment_for_size(const size_t size) noexcept
+    static purger_state& purger() noexcept
     {
-        return size <= CACHE_LINE_SIZE
-                   ? CACHE_LINE_SIZE
-                   : size >= PG_SIZE
-                         ? PG_SIZE
-                         : 1ULL << (64 - __builtin_clzll(size - 1));
+        static purger_state state;
+        return state;
     }
 
-    constexpr std::array<size_class, 32> size_classes = []
+    static constexpr size_t TRACE_CAPACITY = 4096;
+    static constexpr size_t TRACE_DEPTH = 8;
+
+    thread_local thread_stats_t* thread_stats_ = nullptr;
+    static std::atomic<bool> stats_lock_{false};
+    static thread_stats_t* stats_registry_ = nullptr;
+    static thread_stats_t retired_stats_{};
+    static std::atomic<size_t> mapped_bytes_{0};
+    static std::atomic<size_t> peak_mapped_bytes_{0};
+    static std::atomic<uint32_t> trace_every_{0};
+    /**
+     * @brief One trace ring entry behind a sequence lock. Allocating threads write entries while
+     * get_trace copies them out: `sequence` is odd while a writer fills the fields and
+     * 2 * ticket + 2 once entry `ticket` is complete, so a reader keeps a copy only when the
+     * sequence it saw before and after is the one that entry should have.
+     */
+    struct trace_slot
     {
-        std::array<size_class, 32> classes{};
-        for (size_t i = 0; i < 32; ++i)
-        {
-            const size_t size = 1ULL << (i + 3);
-            const size_t alignment = get_alignment_for_size(size);
-            const size_t slot = size + alignment - 1 & ~(alignment - 1);
-            classes[i] = {
-                static_cast<uint16_t>(size),
-                static_cast<uint16_t>(slot),
-                static_cast<uint16_t>(PG_SIZE / slot),
-                static_cast<uint16_t>(slot - size)
-            };
-        }
-        return classes;
-    }();
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<uint64_t> timestamp{0};
+        std::atomic<uint64_t> stack_hash{0};
+        std::atomic<size_t> size{0};
+        std::atomic<uint8_t> size_class{0};
+    };
+
+    static std::atomic<uint64_t> trace_head_{0};
+    static trace_slot trace_ring_[TRACE_CAPACITY];
+
+    /**
+     * @brief Single-writer counter bump; readers on other threads only ever see whole values,
+     * so the owner avoids a locked read-modify-write on every allocation.
+     */
+    ALWAYS_INLINE static void stat_add(std::atomic<uint64_t>& counter, const uint64_t n = 1) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
 
-    ALWAYS_INLINE
-    void *thread_cache_t::get(const uint8_t size_class) noexcept
+    static void fold_stats(thread_stats_t& into, const thread_stats_t& from) noexcept
     {
-        auto &[blocks, count] = caches[size_class];
-        if (LIKELY(count > 0))
+        for (size_t i = 0; i <= SIZE_CLASSES; ++i)
         {
-            PREFETCH_L1(&blocks[count - 2]);
-            return blocks[--count].ptr;
+            stat_add(into.allocs[i], from.allocs[i].load(std::memory_order_relaxed));
+            stat_add(into.frees[i], from.frees[i].load(std::memory_order_relaxed));
         }
-        return nullptr;
+        stat_add(into.cache_hits, from.cache_hits.load(std::memory_order_relaxed));
+        stat_add(into.cache_misses, from.cache_misses.load(std::memory_order_relaxed));
+        stat_add(into.pools, from.pools.load(std::memory_order_relaxed));
+        stat_add(into.large_hits, from.large_hits.load(std::memory_order_relaxed));
+        stat_add(into.large_misses, from.large_misses.load(std::memory_order_relaxed));
+        stat_add(into.allocated_bytes, from.allocated_bytes.load(std::memory_order_relaxed));
     }
 
-    bool thread_cache_t::put(void *ptr, const uint8_t size_class) noexcept
+    ALWAYS_INLINE static void note_mapped(const size_t size) noexcept
     {
-        if (auto &[blocks, count] = caches[size_class]; LIKELY(count < CACHE_SIZE))
+        const size_t mapped = mapped_bytes_.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = peak_mapped_bytes_.load(std::memory_order_relaxed);
+        while (mapped > peak && !peak_mapped_bytes_.compare_exchange_weak(peak, mapped, std::memory_order_relaxed))
         {
-            blocks[count].ptr = ptr;
-            blocks[count].size_class = size_class;
-            ++count;
-            return true;
         }
-        return false;
     }
 
-    void thread_cache_t::clear() noexcept
+    ALWAYS_INLINE static void unmap_pages(void* ptr, const size_t size) noexcept
     {
-        for (auto &[blocks, count] : caches)
-            count = 0;
+        UNMAP_MEMORY(ptr, size);
+        mapped_bytes_.fetch_sub(size, std::memory_order_relaxed);
     }
 
-    ALWAYS_INLINE static size_t count_trailing_zeros(uint64_t x)
+    /**
+     * @brief Start of the mapping behind a large block. The header sits at the start of the page for
+     * ordinary blocks and at the end of the page before the payload for over-aligned ones, so both
+     * are found from the header's page.
+     */
+    ALWAYS_INLINE static char* large_base(const void* ptr) noexcept
     {
-        #if defined(YUMINA_ARCH_X64)
-        #ifdef YUMINA_COMPILER_MSVC
-            uint64_t index;
-            _BitScanForward64(&index, x);
-            return static_cast<size_t>(index);
-        #else
-            return __builtin_ctzll(x);
-        #endif
-        #elif defined(YUMINA_ARCH_ARM64)
-            return __builtin_ctzll(x);
-        #else
-            if (x == 0)
-                return 64;
-            size_t n = 0;
-            if ((x & 0x00000000FFFFFFFF) == 0)
-            {
-                n += 32;
-                x >>= 32;
-            }
-            if ((x & 0x000000000000FFFF) == 0)
-            {
-                n += 16;
-                x >>= 16;
-            }
-            if ((x & 0x00000000000000FF) == 0)
-            {
-                n += 8;
-                x >>= 8;
-            }
-            if ((x & 0x000000000000000F) == 0)
-            {
-                n += 4;
-                x >>= 4;
-            }
-            if ((x & 0x0000000000000003) == 0)
-            {
-                n += 2;
-                x >>= 2;
-            }
-            if ((x & 0x0000000000000001) == 0)
-                n += 1;
-            return n;
-        #endif
+        return reinterpret_cast<char*>(
+            (reinterpret_cast<uintptr_t>(ptr) - sizeof(block_header)) & ~(PG_SIZE - 1));
     }
 
-    bitmap::bitmap() noexcept
+    ALWAYS_INLINE static size_t large_extent(const void* ptr, const size_t size) noexcept
     {
-        for (auto& word : words)
-            word.store(~0ULL, std::memory_order_relaxed);
+        return (static_cast<size_t>(static_cast<const char*>(ptr) - large_base(ptr)) + size + PG_SIZE - 1) &
+               ~(PG_SIZE - 1);
     }
 
-    size_t bitmap::find_free_block(size_t size) noexcept
+    /**
+     * @brief Walks the frame pointer chain of the caller.
+     * Only meaningful with frame pointers (always present on arm64 Apple targets, otherwise
+     * -fno-omit-frame-pointer); every hop is bounds-checked so a broken chain ends the walk.
+     */
+    NEVER_INLINE static size_t capture_stack(void** frames, const size_t max_frames) noexcept
     {
-        const size_t alignment = get_alignment_for_size(size);
-        const size_t align_mask = alignment / BITS_PER_WORD - 1;
-
-        PREFETCH_L1(&words[0]);
-
-        #if defined(YUMINA_ARCH_X64)
-            #ifdef __AVX512F__
-                // AVX-512 optimized scan
-                for (size_t i = 0; i < WORDS_PER_BITMAP; i += 8)
-                {
-                    if ((i & align_mask) != 0) continue;
-                    __m512i v = _mm512_loadu_si512((__m512i*)(words + i));
-                    __mmask8 mask = _mm512_movepi64_mask(v);
-                    if (mask)
-                    {
-                        const int lane = __builtin_ctz(mask);
-                        const uint64_t word = words[i + lane].load(std::memory_order_relaxed);
-                        const size_t bit = count_trailing_zeros(word);
-                        const size_t block_offset = (i + lane) * 64 + bit;
-                        if (words[i + lane].compare_exchange_weak(
-                            const_cast<uint64_t&>(word),
-                            word & ~(1ULL << bit),
-                            std::memory_order_acquire,
-                            std::memory_order_relaxed))
-                        {
-                            MEMORY_FENCE();
-                            return block_offset;
-                        }
-                    }
-                }
-            #elif defined(__AVX2__)
-                // AVX2 optimized scan
-                for (size_t i = 0; i < WORDS_PER_BITMAP; i += 4)
-                {
-                    if ((i & align_mask) != 0) continue;
-                    __m256i v = _mm256_loadu_si256((__m256i*)(words + i));
-                    __m256i zero = _mm256_setzero_si256();
-                    __m256i cmp = _mm256_cmpeq_epi64(v, zero);
-                    uint32_t mask = ~_mm256_movemask_epi8(cmp);
-                    if (mask)
-                    {
-                        const size_t lane = __builtin_ctz(mask) >> 3;
-                        const uint64_t word = words[i + lane].load(std::memory_order_relaxed);
-                        const size_t bit = count_trailing_zeros(word);
-                        const size_t block_offset = (i + lane) * 64 + bit;
-                        if (words[i + lane].compare_exchange_weak(
-                            const_cast<uint64_t&>(word),
-                            word & ~(1ULL << bit),
-                            std::memory_order_acquire,
-                            std::memory_order_relaxed))
-                        {
-                            MEMORY_FENCE();
-                            return block_offset;
-                        }
-                    }
-                }
-            #endif
-        #elif defined(YUMINA_ARCH_ARM64)
-            // NEON optimized scan
-            for (size_t i = 0; i < WORDS_PER_BITMAP; i += 2)
+        size_t depth = 0;
+        #if defined(__GNUC__) || defined(__clang__)
+            auto** fp = static_cast<void**>(__builtin_frame_address(0));
+            while (fp && depth < max_frames)
             {
-                if ((i & align_mask) != 0) continue;
-                uint64x2_t v = vld1q_u64(reinterpret_cast<const uint64_t*>(words + i));
-                uint64x2_t zero = vdupq_n_u64(0);
-                if (uint64x2_t mask = vceqq_u64(v, zero); vgetq_lane_u64(mask, 0) != -1ULL)
-                {
-                    const uint64_t word = words[i].load(std::memory_order_relaxed);
-                    const size_t bit = count_trailing_zeros(word);
-                    const size_t block_offset = i * 64 + bit;
-                    if (words[i].compare_exchange_weak(
-                        const_cast<uint64_t&>(word),
-                        word & ~(1ULL << bit),
-                        std::memory_order_acquire,
-                        std::memory_order_relaxed))
-                    {
-                        MEMORY_FENCE();
-                        return block_offset;
-                    }
-                }
+                if (!fp[1])
+                    break;
+                frames[depth++] = fp[1];
+
+                auto** next = static_cast<void**>(*fp);
+                if (next <= fp ||
+                    reinterpret_cast<uintptr_t>(next) - reinterpret_cast<uintptr_t>(fp) > 64 * 1024 ||
+                    (reinterpret_cast<uintptr_t>(next) & (sizeof(void*) - 1)) != 0)
+                    break;
+                fp = next;
             }
+        #else
+            (void) frames;
+            (void) max_frames;
         #endif
+        return depth;
+    }
 
-        VECTORIZE_LOOP
-        for (size_t i = 0; i < WORDS_PER_BITMAP; ++i)
+    static uint64_t hash_stack(void* const* frames, const size_t depth) noexcept
+    {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (size_t i = 0; i < depth; ++i)
+            hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) * 0x100000001B3ULL;
+        return hash;
+    }
+
+    /**
+     * @brief Returns the active page mode, reading YUMINA_HUGE_PAGES / YUMINA_POPULATE on first use.
+     */
+    ALWAYS_INLINE static uint8_t page_mode() noexcept
+    {
+        uint8_t mode = page_mode_.load(std::memory_order_relaxed);
+        if (UNLIKELY(mode == PAGE_UNSET))
         {
-            if ((i & align_mask) != 0)
-                continue;
-            uint64_t expected = words[i].load(std::memory_order_relaxed);
-            while (expected != 0)
-            {
-                const size_t bit = count_trailing_zeros(expected);
-                const size_t block_offset = i * BITS_PER_WORD + bit;
-                if (const uint64_t desired = expected & ~(1ULL << bit);
-                    words[i].compare_exchange_weak(
-                        expected,
-                        desired,
-                        std::memory_order_acquire,
-                        std::memory_order_relaxed))
-                {
-                    MEMORY_FENCE();
-                    return block_offset;
-                }
-            }
+            const char* huge = std::getenv("YUMINA_HUGE_PAGES");
+            const char* populate = std::getenv("YUMINA_POPULATE");
+            mode = static_cast<uint8_t>((huge && huge[0] == '1' ? PAGE_HUGE : 0) |
+                                        (populate && populate[0] == '1' ? PAGE_POPULATE : 0));
+            if (uint8_t expected = PAGE_UNSET;
+                !page_mode_.compare_exchange_strong(expected, mode, std::memory_order_relaxed))
+                mode = expected;
         }
-        return ~static_cast<size_t>(0);
+        return mode;
     }
 
-    void bitmap::mark_free(size_t index) noexcept
+    struct numa_topology
     {
-        const size_t word_idx = index / BITS_PER_WORD;
-        const size_t bit_idx = index % BITS_PER_WORD;
-        PREFETCH_L1(&words[word_idx]);
-        words[word_idx].fetch_or(1ULL << bit_idx, std::memory_order_release);
-    }
+        uint32_t nodes;
+        uint8_t cpu_node[MAX_NUMA_CPUS];
+    };
+
+    /**
+     * @brief Regions given back by exited threads, kept per node so a new thread on that node
+     * reuses memory that is already bound there instead of mapping fresh pages.
+     */
+    struct node_reserve_t
+    {
+        std::atomic<bool> lock{false};
+        span_region_t::region_link* regions{nullptr};
+        size_t count{0};
+    };
 
-    bool bitmap::is_completely_free() const noexcept
+    static node_reserve_t node_reserves_[MAX_NUMA_NODES];
+
+    /**
+     * @brief Parses a sysfs cpulist such as "0-15,32-47" into the cpu to node table.
+     */
+    [[maybe_unused]]
+    static void parse_cpulist(const char* list, const uint8_t node, uint8_t* cpu_node) noexcept
     {
-        VECTORIZE_LOOP
-        for (auto& word : words)
+        while (*list)
         {
-            if (word.load(std::memory_order_relaxed) != ~0ULL)
-                return false;
+            char* end = nullptr;
+            const unsigned long first = std::strtoul(list, &end, 10);
+            if (end == list)
+                break;
+            unsigned long last = first;
+            if (*end == '-')
+            {
+                list = end + 1;
+                last = std::strtoul(list, &end, 10);
+            }
+            for (unsigned long cpu = first; cpu <= last && cpu < MAX_NUMA_CPUS; ++cpu)
+                cpu_node[cpu] = node;
+            list = *end == ',' ? end + 1 : end;
+            if (*list == '\n')
+                break;
         }
-        return true;
     }
 
-    void block_header::init(const size_t sz, const uint8_t size_class, const bool is_free) noexcept
+    /**
+     * @brief Reads the NUMA topology from /sys/devices/system/node once; machines without it
+     * (and every non-Linux target) report a single node.
+     */
+    static const numa_topology& topology() noexcept
     {
-        if (UNLIKELY(sz > 1ULL << 47))
-            return;
-        data = (sz & SIZE_MASK) |
-               static_cast<uint64_t>(size_class) << 48 |
-               static_cast<uint64_t>(is_free) << 63;
-        magic = HEADER_MAGIC;
+        static const numa_topology topo = []
+        {
+            numa_topology result{};
+            result.nodes = 1;
+            #if defined(YUMINA_OS_LINUX)
+                uint32_t highest = 0;
+                for (uint32_t node = 0; node < MAX_NUMA_NODES; ++node)
+                {
+                    char path[64];
+                    std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+                    FILE* file = std::fopen(path, "r");
+                    if (!file)
+                        continue;
+
+                    char list[4096];
+                    if (std::fgets(list, sizeof(list), file))
+                        parse_cpulist(list, static_cast<uint8_t>(node), result.cpu_node);
+                    std::fclose(file);
+                    highest = node;
+                }
+                result.nodes = highest + 1;
+            #endif
+            return result;
+        }();
+        return topo;
     }
 
-    void block_header::encode(const size_t size, const uint8_t size_class) noexcept
+    ALWAYS_INLINE static bool numa_multi_node() noexcept
     {
-        data = (size & SIZE_MASK) |
-               static_cast<uint64_t>(size_class) << 48;
+        return topology().nodes > 1;
     }
 
-    bool block_header::set_free(const bool is_free) noexcept
+    ALWAYS_INLINE static uint32_t current_node() noexcept
     {
-        data = (data & ~(1ULL << 63)) | static_cast<uint64_t>(is_free) << 63;
-        return true;
+        #if defined(YUMINA_OS_LINUX)
+            if (const auto& topo = topology(); topo.nodes > 1)
+            {
+                if (const int cpu = sched_getcpu(); cpu >= 0 && static_cast<size_t>(cpu) < MAX_NUMA_CPUS)
+                    return topo.cpu_node[cpu];
+            }
+        #endif
+        return 0;
     }
 
-    bool block_header::is_valid() const noexcept
+    /**
+     * @brief Sets a preferred-node policy on a fresh mapping before it is first touched.
+     * Uses the raw syscall so there is no libnuma dependency; where mbind is unavailable the
+     * pages fall back to first-touch placement, which the caller's node also gets.
+     */
+    ALWAYS_INLINE static void bind_to_node(void* ptr, const size_t size, const uint32_t node) noexcept
     {
-        return magic == HEADER_MAGIC && (data & MAGIC_MASK) == MAGIC_VALUE;
+        #if defined(YUMINA_OS_LINUX) && defined(SYS_mbind)
+            constexpr int MPOL_PREFERRED_MODE = 1;
+            const unsigned long mask = 1UL << node;
+            syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_MODE, &mask, sizeof(mask) * 8 + 1, 0);
+        #else
+            (void) ptr;
+            (void) size;
+            (void) node;
+        #endif
     }
 
-    void* pool::alloc(const size_class& sc) noexcept
+    static span_region_t::region_link* take_node_region(const uint32_t node) noexcept
     {
-        const size_t size = sc.size;
-
-        if (const size_t index = bitmap.find_free_block(size);
-            index != ~static_cast<size_t>(0))
+        auto& reserve = node_reserves_[node];
+        while (reserve.lock.exchange(true, std::memory_order_acquire))
+            CPU_PAUSE();
+        span_region_t::region_link* region = reserve.regions;
+        if (region)
         {
-            void* block = memory + index * sc.slot_size;
-            auto* header = new(block) block_header();
-            header->init(size, SIZE_CLASSES - 1, false);
-            return static_cast<char*>(block) + sizeof(block_header);
+            reserve.regions = region->next;
+            --reserve.count;
         }
-        return nullptr;
+        reserve.lock.store(false, std::memory_order_release);
+        return region;
     }
 
-    void pool::free(const void* ptr, const size_class& sc) noexcept
+    static bool give_node_region(span_region_t::region_link* region) noexcept
     {
-        const size_t offset = static_cast<const char*>(ptr) - reinterpret_cast<const char*>(memory);
-        if (const size_t index = offset / sc.slot_size; index < (PG_SIZE - sizeof(bitmap)) / sc.slot_size)
-            bitmap.mark_free(index);
+        auto& reserve = node_reserves_[region->node];
+        while (reserve.lock.exchange(true, std::memory_order_acquire))
+            CPU_PAUSE();
+        const bool kept = reserve.count < NODE_RESERVE_REGIONS;
+        if (kept)
+        {
+            region->next = reserve.regions;
+            reserve.regions = region;
+            ++reserve.count;
+        }
+        reserve.lock.store(false, std::memory_order_release);
+        return kept;
     }
 
-    bool pool::is_completely_free() const noexcept
+    /**
+     * @brief Maps anonymous memory aligned to `alignment`.
+     * The mapping is over-reserved and trimmed so that 2 MiB alignment can be honoured, then advised
+     * with MADV_HUGEPAGE and optionally pre-faulted. Returns nullptr on failure.
+     */
+    ALWAYS_INLINE static void* map_pages(const size_t size, const size_t alignment,
+                                         const bool huge, const bool populate, const int node) noexcept
     {
-        return bitmap.is_completely_free();
-    }
+        #if defined(YUMINA_OS_WINDOWS)
+            (void) alignment;
+            (void) huge;
+            (void) populate;
+            (void) node;
+            void* ptr = MAP_MEMORY(size);
+            if (ptr)
+                note_mapped(size);
+            return ptr;
+        #else
+            const size_t reserve = alignment > PG_SIZE ? size + alignment - PG_SIZE : size;
+            void* raw = MAP_MEMORY(reserve);
+            if (UNLIKELY(raw == MAP_FAILED))
+                return nullptr;
 
-    void pool::return_mem() noexcept
-    {
-        #ifdef YUMINA_OS_LINUX
-            if (auto* current = reinterpret_cast<block_header*>(memory))
-            {
-                PREFETCH_L1(current);
-                size_t free_space = 0;
-            #if defined(YUMINA_ARCH_X64) && defined(__AVX512F__)
-                __m512i sum = _mm512_setzero_si512();
-                while (current)
-                {
-                    if (current->is_free())
-                        sum = _mm512_add_epi64(sum, _mm512_set1_epi64(current->size()));
-                    current = current->next_physical;
-                }
-                free_space = _mm512_reduce_add_epi64(sum);
-            #elif defined(YUMINA_ARCH_X64) && defined(__AVX2__)
-                __m256i sum1 = _mm256_setzero_si256();
-                __m256i sum2 = _mm256_setzero_si256();
-                while (current)
-                {
-                    if (current->is_free())
-                    {
-                        sum1 = _mm256_add_epi64(sum1, _mm256_set1_epi64x(current->size()));
-                        sum2 = _mm256_add_epi64(sum2, _mm256_set1_epi64x(current->size() >> 32));
-                    }
-                    current = current->next_physical;
-                }
-                free_space = _mm256_extract_epi64(sum1, 0) + (_mm256_extract_epi64(sum2, 0) << 32);
-            #elif defined(YUMINA_ARCH_ARM64)
-                uint64x2_t sum = vdupq_n_u64(0);
-                while (current)
-                {
-                    if (current->is_free())
-                        sum = vaddq_u64(sum, vdupq_n_u64(current->size()));
-                    current = current->next_physical;
-                }
-                free_space = vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+            const auto base = reinterpret_cast<uintptr_t>(raw);
+            const uintptr_t aligned = (base + alignment - 1) & ~(alignment - 1);
+            if (const size_t head = aligned - base)
+                UNMAP_MEMORY(raw, head);
+            if (const size_t tail = reserve - (aligned - base) - size)
+                UNMAP_MEMORY(reinterpret_cast<void*>(aligned + size), tail);
+
+            void* ptr = reinterpret_cast<void*>(aligned);
+            note_mapped(size);
+            #if defined(YUMINA_OS_LINUX) && defined(MADV_HUGEPAGE)
+                if (huge)
+                    madvise(ptr, size, MADV_HUGEPAGE);
             #else
-                while (current)
-                {
-                    if (current->is_free())
-                        free_space += current->size();
-                    current = current->next_physical;
-                }
+                (void) huge;
             #endif
+            if (node >= 0)
+                bind_to_node(ptr, size, static_cast<uint32_t>(node));
 
-                if (free_space >= MIN_RETURN_SIZE &&
-                    static_cast<double>(free_space) / PG_SIZE >= (1.0 - MEM_USAGE_THRESHOLD))
-                {
-                    void* page_start = reinterpret_cast<void*>(
-                        (reinterpret_cast<uintptr_t>(memory) + PG_SIZE - 1) & ~(PG_SIZE - 1));
-                    void* page_end = memory + (PG_SIZE - sizeof(bitmap));
-
-                    if (page_end > page_start)
-                    {
-                        madvise(page_start,
-                               static_cast<char*>(page_end) - static_cast<char*>(page_start),
-                               MADV_DONTNEED);
-                    }
-                }
+            if (populate)
+            {
+                #if defined(YUMINA_OS_LINUX) && defined(MADV_POPULATE_WRITE)
+                    if (madvise(ptr, size, MADV_POPULATE_WRITE) == 0)
+                        return ptr;
+                #endif
+                // Touch after advising so the faults are served with huge pages where possible
+                for (size_t offset = 0; offset < size; offset += PG_SIZE)
+                    static_cast<volatile uint8_t*>(ptr)[offset] = 0;
             }
-            #endif
+            return ptr;
+        #endif
     }
 
-    pool_manager::pool_manager()
+    /**
+     * @brief Tears the thread's heap down when the thread exits.
+     */
+    struct thread_exit_t
     {
-        for (auto& count : pool_count)
-            count = 0;
+        ~thread_exit_t()
+        {
+            cleanup();
+            thread_torn_down_ = true;
+        }
+    };
+
+    /**
+     * @brief Registers the calling thread's exit hook. Everything cleanup() releases is carved
+     * from the thread's regions, so reserving the first one arms it.
+     */
+    ALWAYS_INLINE static void arm_thread_exit() noexcept
+    {
+        static thread_local thread_exit_t hook;
+        (void) hook;
     }
 
-    pool_manager::~pool_manager()
+    bool span_region_t::reserve(const size_t pages) noexcept
     {
-        for (size_t sc = 0; sc < SIZE_CLASSES; ++sc)
+        if (!regions)
+            arm_thread_exit();
+
+        const uint8_t mode = page_mode();
+        const bool huge = mode & PAGE_HUGE;
+
+        // The first page of every region holds its link so release() can walk them
+        const size_t wanted = (pages + 1) * PG_SIZE;
+        const size_t size = (wanted + REGION_SIZE - 1) & ~(REGION_SIZE - 1);
+
+        // New regions follow the thread to whichever node it runs on now
+        node = current_node();
+        uint8_t* base = nullptr;
+        if (size == REGION_SIZE)
+            base = reinterpret_cast<uint8_t*>(take_node_region(node));
+        if (!base)
         {
-            for (size_t i = 0; i < pool_count[sc]; ++i)
-                delete pools[sc][i].p;
+            base = static_cast<uint8_t*>(map_pages(size, huge ? HUGE_PG_SIZE : PG_SIZE, huge, mode & PAGE_POPULATE,
+                                                   numa_multi_node() ? static_cast<int>(node) : -1));
+            if (UNLIKELY(!base))
+                return false;
         }
+
+        if (cursor < end)
+            free_span(cursor, end - cursor);
+
+        auto* link = reinterpret_cast<region_link*>(base);
+        link->next = regions;
+        link->size = size;
+        link->node = node;
+        link->pinned = false;
+        regions = link;
+        cursor = base + PG_SIZE;
+        end = base + size;
+        return true;
     }
 
-    pool* pool_manager::alloc_pool(const size_t size_class) noexcept
+    void* span_region_t::alloc_span(const size_t size) noexcept
     {
-        if (pool_count[size_class] >= MAX_POOLS)
-            return nullptr;
+        const size_t pages = (size + PG_SIZE - 1) / PG_SIZE;
 
-        try
+        // First fit over recycled spans, splitting off the remainder
+        for (span_link** link = &free_spans; *link; link = &(*link)->next)
         {
-            auto* new_pool = new(std::align_val_t{PG_SIZE}) pool();
-            pools[size_class][pool_count[size_class]].p = new_pool;
-            pools[size_class][pool_count[size_class]].used_blocks = 0;
-            ++pool_count[size_class];
-            return new_pool;
+            span_link* span = *link;
+            if (span->pages < pages)
+                continue;
+
+            if (span->pages == pages)
+            {
+                *link = span->next;
+            }
+            else
+            {
+                auto* rest = reinterpret_cast<span_link*>(reinterpret_cast<uint8_t*>(span) + pages * PG_SIZE);
+                rest->next = span->next;
+                rest->pages = span->pages - pages;
+                rest->freed_at = span->freed_at;
+                rest->decommitted = span->decommitted;
+                *link = rest;
+            }
+            return span;
         }
-        catch (...)
-        {
+
+        if (UNLIKELY(static_cast<size_t>(end - cursor) < pages * PG_SIZE) && !reserve(pages))
             return nullptr;
+
+        void* span = cursor;
+        cursor += pages * PG_SIZE;
+        return span;
+    }
+
+    void span_region_t::free_span(void* span, const size_t size) noexcept
+    {
+        if (UNLIKELY(!span))
+            return;
+
+        auto* link = static_cast<span_link*>(span);
+        link->next = free_spans;
+        link->pages = (size + PG_SIZE - 1) / PG_SIZE;
+        link->freed_at = large_block_cache_t::get_time();
+        link->decommitted = false;
+        free_spans = link;
+    }
+
+    /**
+     * @brief In-place merge sort of the free span list by address, so neighbours can be coalesced.
+     */
+    static span_region_t::span_link* sort_spans(span_region_t::span_link* head) noexcept
+    {
+        if (!head || !head->next)
+            return head;
+
+        span_region_t::span_link* slow = head;
+        for (const span_region_t::span_link* fast = head->next; fast && fast->next; fast = fast->next->next)
+            slow = slow->next;
+
+        span_region_t::span_link* right = sort_spans(slow->next);
+        slow->next = nullptr;
+        span_region_t::span_link* left = sort_spans(head);
+
+        span_region_t::span_link merged{};
+        span_region_t::span_link* tail = &merged;
+        while (left && right)
+        {
+            span_region_t::span_link*& smaller = left < right ? left : right;
+            tail->next = smaller;
+            tail = smaller;
+            smaller = smaller->next;
         }
+        tail->next = left ? left : right;
+        return merged.next;
     }
 
-    void pool_manager::free_pool(const pool* p, const size_t size_class) noexcept
+    size_t span_region_t::purge(const uint64_t now, const uint64_t idle, size_t budget) noexcept
     {
-        for (size_t i = 0; i < pool_count[size_class]; ++i)
+        free_spans = sort_spans(free_spans);
+
+        size_t released = 0;
+        for (span_link* span = free_spans; span; span = span->next)
         {
-            if (pools[size_class][i].p == p)
+            // Absorb every physically adjacent successor
+            while (span->next &&
+                   reinterpret_cast<uint8_t*>(span) + span->pages * PG_SIZE == reinterpret_cast<uint8_t*>(span->next))
             {
-                if (--pools[size_class][i].used_blocks == 0)
-                {
-                    delete p;
-                    --pool_count[size_class];
-                    pools[size_class][i] = pools[size_class][pool_count[size_class]];
-                }
-                break;
+                const span_link* next = span->next;
+                span->pages += next->pages;
+                span->freed_at = std::max(span->freed_at, next->freed_at);
+                span->decommitted = span->decommitted && next->decommitted;
+                span->next = next->next;
             }
+
+            // The first page keeps the link resident, everything behind it goes back to the kernel
+            if (span->decommitted || span->pages < 2 || now - span->freed_at < idle)
+                continue;
+
+            const size_t bytes = (span->pages - 1) * PG_SIZE;
+            if (bytes > budget)
+                break;
+
+            DECOMMIT_MEMORY(reinterpret_cast<uint8_t*>(span) + PG_SIZE, bytes);
+            span->decommitted = true;
+            released += bytes;
+            budget -= bytes;
         }
+        return released;
     }
 
-    void* tiny_block_manager::tiny_pool::alloc_tiny(const uint8_t size_class) noexcept
+    /**
+     * @brief Keeps the region holding `ptr` mapped past release(). Memory outside this thread's
+     * regions, such as a pool adopted from an exited thread, is already pinned.
+     */
+    void span_region_t::pin(const void* ptr) noexcept
     {
-        const size_t size = (size_class + 1) << 3;
-        const size_t slot_size = size + sizeof(block_header) + ALIGNMENT - 1 & ~(ALIGNMENT - 1);
-        const size_t max_blocks = (PG_SIZE - sizeof(bitmap)) / slot_size;
-
-        if (const size_t index = bitmap.find_free_block(size);
-            index != ~static_cast<size_t>(0) && index < max_blocks)
+        const auto* address = static_cast<const uint8_t*>(ptr);
+        for (region_link* region = regions; region; region = region->next)
         {
-            if (uint8_t* block = memory + index * slot_size; block + slot_size <= memory + (PG_SIZE - sizeof(bitmap)))
+            const auto* base = reinterpret_cast<const uint8_t*>(region);
+            if (address >= base && address < base + region->size)
             {
-                auto* header = new(block) block_header();
-                header->init(size, size_class, false);
-                return block;
+                region->pinned = true;
+                return;
             }
         }
-        return nullptr;
     }
 
-    void tiny_block_manager::tiny_pool::free_tiny(void *ptr, const uint8_t size_class) noexcept
+    void span_region_t::release() noexcept
     {
-        const size_t size = (size_class + 1) << 3;
-        const size_t slot_size = size + sizeof(block_header) + ALIGNMENT - 1 & ~(ALIGNMENT - 1);
-        const size_t offset = static_cast<uint8_t*>(ptr) - memory;
-
-        if (const size_t index = offset / slot_size; index * slot_size < PG_SIZE - sizeof(bitmap))
+        while (regions)
         {
-            if (auto* header = static_cast<block_header*>(ptr); header->is_valid() && header->size_class() == size_class)
+            region_link* next = regions->next;
+
+            // Pinned regions stay mapped for the rest of the process; other threads still free
+            // into the blocks inside, and whoever adopts their pools recycles the pages
+            if (regions->pinned)
             {
-                header->set_free(true);
-                bitmap.mark_free(index);
+                regions = next;
+                continue;
+            }
+
+            // Standard-sized regions go to their node's reserve with everything but the link page
+            // decommitted; the binding survives, the memory does not
+            if (regions->size == REGION_SIZE)
+            {
+                DECOMMIT_MEMORY(reinterpret_cast<uint8_t*>(regions) + PG_SIZE, REGION_SIZE - PG_SIZE);
+                if (!give_node_region(regions))
+                    unmap_pages(regions, regions->size);
             }
+            else
+                unmap_pages(regions, regions->size);
+            regions = next;
         }
+        cursor = nullptr;
+        end = nullptr;
+        free_spans = nullptr;
     }
 
-    void* tiny_block_manager::alloc_tiny(uint8_t size_class) noexcept
+    /**
+     * @brief Constructs a per-thread heap structure inside a span of the thread's region.
+     */
+    template<typename T>
+    ALWAYS_INLINE static T* make_heap_object() noexcept
     {
-        return pool.alloc_tiny(size_class);
+        void* span = span_region_.alloc_span(sizeof(T));
+        return span ? new(span) T() : nullptr;
     }
 
-    void tiny_block_manager::free_tiny(void* ptr, uint8_t size_class) noexcept
+    template<typename T>
+    ALWAYS_INLINE static void destroy_heap_object(T* object) noexcept
     {
-        pool.free_tiny(ptr, size_class);
+        object->~T();
+        span_region_.free_span(object, sizeof(T));
     }
 
-    uint64_t large_block_cache_t::get_time() noexcept
+    /**
+     * @brief Heap profile samples aggregated per (phase, call stack).
+     * Each sample stands for 1 / P(sampled) allocations of its size, so the sums estimate the
+     * real totals regardless of the sampling interval.
+     */
+    struct profile_site
     {
-        #if defined(__x86_64__)
-            return __rdtscp(&aux);
-        #elif defined(YUMINA_ARCH_ARM64)
-            // Use CNTVCT_EL0 (Virtual Count Register) for ARM64
-            uint64_t timestamp;
-            asm volatile("mrs %0, cntvct_el0" : "=r"(timestamp));
-            return timestamp;
-        #else
-            // Fallback for other architectures
-            return std::chrono::steady_clock::now().time_since_epoch().count();
-        #endif
+        uint64_t key;
+        const char* phase;
+        void* frames[PROFILE_DEPTH];
+        size_t depth;
+        double alloc_bytes;
+        double alloc_count;
+        double live_bytes;
+        double live_count;
+    };
+
+    /**
+     * @brief A sampled block that has not been freed yet, so its share can leave the live view.
+     */
+    struct profile_live
+    {
+        const void* ptr;
+        uint32_t site;
+        double bytes;
+        double count;
+    };
+
+    static const auto* const PROFILE_TOMBSTONE = reinterpret_cast<const void*>(1);
+
+    static std::atomic<size_t> profile_interval_{0};
+    static std::atomic<bool> profile_lock_{false};
+    static profile_site profile_sites_[PROFILE_SITES];
+    static profile_live profile_live_[PROFILE_LIVE];
+    static size_t profile_dropped_ = 0;
+    static const char* profile_path_ = nullptr;
+    thread_local const char* alloc_phase_ = nullptr;
+    thread_local bool profile_busy_ = false;
+
+    ALWAYS_INLINE static void lock_profile() noexcept
+    {
+        while (profile_lock_.exchange(true, std::memory_order_acquire))
+            CPU_PAUSE();
     }
 
-    size_t large_block_cache_t::get_bucket_index(size_t size) noexcept
+    ALWAYS_INLINE static void unlock_profile() noexcept
     {
-        #if defined(__x86_64__)
-            return (63 - __builtin_clzll(size > MIN_CACHE_BLOCK ? size - 1 : MIN_CACHE_BLOCK)) - 11;
-        #elif defined(__aarch64__)
-            return (63 - __builtin_clzll(size > MIN_CACHE_BLOCK ? size - 1 : MIN_CACHE_BLOCK)) - 11;
-        #else
-            size_t index = 0;
-            size_t threshold = MIN_CACHE_BLOCK;
-            while (threshold < size && index < NUM_BUCKETS - 1)
-            {
-                threshold <<= 1;
-                ++index;
-            }
-            return index;
-        #endif
+        profile_lock_.store(false, std::memory_order_release);
     }
 
-    void* large_block_cache_t::get_cached_block(size_t size) noexcept
+    ALWAYS_INLINE static size_t live_slot(const void* ptr) noexcept
     {
-        if (UNLIKELY(size < MIN_CACHE_BLOCK || size > MAX_CACHE_BLOCK))
-            return nullptr;
-
-        const size_t bucket_idx = get_bucket_index(size);
-        if (UNLIKELY(bucket_idx >= NUM_BUCKETS))
-            return nullptr;
-
-        auto& [count2, entries] = buckets[bucket_idx];
-        const size_t count = count2.load(std::memory_order_acquire);
+        return static_cast<size_t>((reinterpret_cast<uintptr_t>(ptr) >> 6) * 0x9E3779B97F4A7C15ULL >> 40) %
+               PROFILE_LIVE;
+    }
 
-        #if defined(YUMINA_ARCH_X64) || defined(YUMINA_ARCH_ARM64)
-            PREFETCH_L1(&entries[0]);
-            if (count > 1)
-                PREFETCH_L1(&entries[1]);
-        #endif
+    /**
+     * @brief Bytes until the next sample, drawn from an exponential distribution so sample points
+     * form a Poisson process over the allocated byte stream.
+     */
+    static size_t next_sample_gap(thread_stats_t& stats, const size_t interval) noexcept
+    {
+        uint64_t x = stats.profile_rng;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        stats.profile_rng = x;
+        const double uniform = static_cast<double>(((x * 0x2545F4914F6CDD1DULL) >> 11) + 1) * 0x1.0p-53;
+        return static_cast<size_t>(-std::log(uniform) * static_cast<double>(interval)) + 1;
+    }
 
-        for (size_t i = 0; i < count; ++i)
+    NEVER_INLINE static void profile_sample(void* ptr, const size_t size, const size_t interval,
+                                            thread_stats_t& stats) noexcept
+    {
+        if (UNLIKELY(!stats.profile_rng))
         {
-            auto& entry = entries[i];
-
-            if (void* expected = entry.ptr.load(std::memory_order_relaxed); expected && entry.size >= size && static_cast<double>(entry.size) <= static_cast<double>(size) * MAX_SIZE_RATIO)
+            // First allocation on this thread only arms the countdown
+            stats.profile_rng = (reinterpret_cast<uintptr_t>(&stats) ^ large_block_cache_t::get_time()) | 1;
+            stats.profile_countdown = next_sample_gap(stats, interval);
+            return;
+        }
+        stats.profile_countdown = next_sample_gap(stats, interval);
+        if (profile_busy_)
+            return;
+
+        void* frames[PROFILE_DEPTH];
+        const size_t depth = capture_stack(frames, PROFILE_DEPTH);
+        const char* phase = alloc_phase_;
+        const uint64_t key = (hash_stack(frames, depth) ^ reinterpret_cast<uintptr_t>(phase) * 0x9E3779B97F4A7C15ULL) | 1;
+
+        // A block of `size` bytes contains at least one sample point with this probability
+        const double count = 1.0 / -std::expm1(-static_cast<double>(size) / static_cast<double>(interval));
+        const double bytes = count * static_cast<double>(size);
+
+        lock_profile();
+        size_t index = key % PROFILE_SITES;
+        for (size_t probe = 0; probe < PROFILE_SITES; ++probe, index = (index + 1) % PROFILE_SITES)
+        {
+            if (profile_sites_[index].key == key || !profile_sites_[index].key)
+                break;
+        }
+
+        // A sample that finds no room in either table is counted, not half recorded: site totals
+        // without a live entry could never be taken back out
+        auto& site = profile_sites_[index];
+        size_t slot = live_slot(ptr);
+        size_t probe = 0;
+        for (; probe < PROFILE_LIVE; ++probe, slot = (slot + 1) % PROFILE_LIVE)
+        {
+            if (profile_live_[slot].ptr == nullptr || profile_live_[slot].ptr == PROFILE_TOMBSTONE)
+                break;
+        }
+        if (UNLIKELY((site.key != key && site.key) || probe == PROFILE_LIVE))
+        {
+            ++profile_dropped_;
+            unlock_profile();
+            return;
+        }
+
+        if (site.key != key)
+        {
+            site.key = key;
+            site.phase = phase;
+            site.depth = depth;
+            std::memcpy(site.frames, frames, depth * sizeof(void*));
+        }
+        site.alloc_bytes += bytes;
+        site.alloc_count += count;
+        site.live_bytes += bytes;
+        site.live_count += count;
+
+        profile_live_[slot] = { ptr, static_cast<uint32_t>(index), bytes, count };
+        reinterpret_cast<block_header*>(static_cast<char*>(ptr) - sizeof(block_header))->set_sampled(true);
+        unlock_profile();
+    }
+
+    /**
+     * @brief Takes a sampled block out of the live view; called before the block is released.
+     */
+    NEVER_INLINE static void profile_free(const void* ptr, block_header* header) noexcept
+    {
+        header->set_sampled(false);
+        lock_profile();
+        size_t slot = live_slot(ptr);
+        for (size_t probe = 0; probe < PROFILE_LIVE && profile_live_[slot].ptr; ++probe, slot = (slot + 1) % PROFILE_LIVE)
+        {
+            if (auto& live = profile_live_[slot]; live.ptr == ptr)
             {
-                if (entry.ptr.compare_exchange_strong(expected, nullptr,
-                    std::memory_order_acquire, std::memory_order_relaxed))
+                profile_sites_[live.site].live_bytes -= live.bytes;
+                profile_sites_[live.site].live_count -= live.count;
+                live.ptr = PROFILE_TOMBSTONE;
+                break;
+            }
+        }
+        unlock_profile();
+    }
+
+    static void dump_at_exit() noexcept
+    {
+        yumina::detail::internal::dump_stats(stderr);
+    }
+
+    /**
+     * @brief Writes one frame of a collapsed stack: the demangled symbol when the dynamic symbol
+     * table has it, otherwise module+offset for addr2line.
+     */
+    static void print_frame(FILE* out, void* frame) noexcept
+    {
+        #if !defined(YUMINA_OS_WINDOWS)
+            if (Dl_info info; dladdr(frame, &info))
+            {
+                if (info.dli_sname)
                 {
-                    count2.fetch_sub(1, std::memory_order_release);
-                    total_cached.fetch_sub(entry.size, std::memory_order_relaxed);
-                    MEMORY_FENCE();
-                    return expected;
+                    int status = 0;
+                    char* name = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                    std::fputs(status == 0 && name ? name : info.dli_sname, out);
+                    std::free(name);
+                    return;
+                }
+                if (info.dli_fname)
+                {
+                    const char* module = std::strrchr(info.dli_fname, '/');
+                    std::fprintf(out, "%s+0x%zx", module ? module + 1 : info.dli_fname,
+                                 static_cast<size_t>(static_cast<char*>(frame) - static_cast<char*>(info.dli_fbase)));
+                    return;
                 }
             }
+        #endif
+        std::fprintf(out, "%p", frame);
+    }
+
+    static void dump_profile_at_exit() noexcept
+    {
+        if (FILE* out = std::fopen(profile_path_, "w"))
+        {
+            yumina::detail::internal::dump_heap_profile(out, profile_view::allocated);
+            std::fclose(out);
         }
-        return nullptr;
     }
 
-    bool large_block_cache_t::cache_block(void* ptr, const size_t size) noexcept
+    /**
+     * @brief Creates and registers the calling thread's counters. Reads YUMINA_ALLOC_STATS,
+     * YUMINA_ALLOC_TRACE and YUMINA_HEAP_PROFILE (output path, with the mean sampling interval in
+     * YUMINA_HEAP_PROFILE_INTERVAL) once per process.
+     */
+    NEVER_INLINE static thread_stats_t* register_thread_stats() noexcept
     {
-        if (UNLIKELY(size < MIN_CACHE_BLOCK || size > MAX_CACHE_BLOCK))
-            return false;
+        static const bool configured = []
+        {
+            if (const char* env = std::getenv("YUMINA_ALLOC_STATS"); env && env[0] == '1')
+                std::atexit(dump_at_exit);
+            if (const char* env = std::getenv("YUMINA_ALLOC_TRACE"))
+                trace_every_.store(static_cast<uint32_t>(std::strtoul(env, nullptr, 10)), std::memory_order_relaxed);
+            if (const char* env = std::getenv("YUMINA_HEAP_PROFILE"); env && *env)
+            {
+                const char* interval = std::getenv("YUMINA_HEAP_PROFILE_INTERVAL");
+                const size_t bytes = interval ? std::strtoull(interval, nullptr, 10) : 0;
+                profile_path_ = env;
+                profile_interval_.store(bytes ? bytes : DEFAULT_PROFILE_INTERVAL, std::memory_order_relaxed);
+                std::atexit(dump_profile_at_exit);
+            }
+            return true;
+        }();
+        (void) configured;
 
-        const size_t bucket_idx = get_bucket_index(size);
-        if (UNLIKELY(bucket_idx >= NUM_BUCKETS))
-            return false;
+        // Guard against re-entry while the span for the counters itself is being mapped; a torn
+        // down thread goes uncounted
+        static thread_local bool registering = false;
+        if (registering || thread_torn_down_)
+            return nullptr;
+        registering = true;
+        auto* stats = make_heap_object<thread_stats_t>();
+        registering = false;
+        if (UNLIKELY(!stats))
+            return nullptr;
 
-        if (const size_t current_total = total_cached.load(std::memory_order_relaxed);
-            current_total + size > MAX_CACHE_SIZE)
-            return false;
+        while (stats_lock_.exchange(true, std::memory_order_acquire))
+            CPU_PAUSE();
+        stats->next_registered = stats_registry_;
+        stats_registry_ = stats;
+        stats_lock_.store(false, std::memory_order_release);
 
-        auto&[count1, entries] = buckets[bucket_idx];
+        thread_stats_ = stats;
+        return stats;
+    }
+
+    ALWAYS_INLINE static thread_stats_t* thread_stats() noexcept
+    {
+        return LIKELY(thread_stats_) ? thread_stats_ : register_thread_stats();
+    }
+
+    /**
+     * @brief Counts a successful allocation and records every Nth one in the trace ring.
+     */
+    #ifdef YUMINA_ALLOC_DEBUG
+        static void debug_arm(void* ptr) noexcept;
+    #endif
+
+    ALWAYS_INLINE static void* record_alloc(void* ptr, const size_t size, const size_t stat_class) noexcept
+    {
+        if (UNLIKELY(!ptr))
+            return ptr;
+
+        #ifdef YUMINA_ALLOC_DEBUG
+            debug_arm(ptr);
+        #endif
+
+        auto* stats = thread_stats();
+        if (UNLIKELY(!stats))
+            return ptr;
+        stat_add(stats->allocs[stat_class]);
+        stat_add(stats->allocated_bytes, size);
+
+        if (const size_t interval = profile_interval_.load(std::memory_order_relaxed); UNLIKELY(interval != 0))
+        {
+            if (stats->profile_countdown > size)
+                stats->profile_countdown -= size;
+            else
+                profile_sample(ptr, size, interval, *stats);
+        }
 
-        if (const size_t count = count1.load(std::memory_order_acquire); count < size_bucket::BUCKET_SIZE)
+        if (const uint32_t every = trace_every_.load(std::memory_order_relaxed); UNLIKELY(every != 0))
         {
-            auto&[ptr, size2, last_use] = entries[count];
-            if (void* expected = nullptr;
-                ptr.compare_exchange_strong(expected, ptr,
-                    std::memory_order_release, std::memory_order_relaxed))
+            if (++stats->trace_countdown >= every)
             {
-                size2 = size;
-                last_use = get_time();
-                count1.fetch_add(1, std::memory_order_release);
-                total_cached.fetch_add(size, std::memory_order_relaxed);
-                return true;
+                stats->trace_countdown = 0;
+                void* frames[TRACE_DEPTH];
+                const size_t depth = capture_stack(frames, TRACE_DEPTH);
+                const uint64_t ticket = trace_head_.fetch_add(1, std::memory_order_relaxed);
+                auto& slot = trace_ring_[ticket % TRACE_CAPACITY];
+
+                // A writer a whole lap apart may still hold the slot; then this sample is skipped
+                if (uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+                    !(sequence & 1) && sequence < 2 * ticket + 1 &&
+                    slot.sequence.compare_exchange_strong(sequence, 2 * ticket + 1, std::memory_order_relaxed))
+                {
+                    std::atomic_thread_fence(std::memory_order_release);
+                    slot.timestamp.store(large_block_cache_t::get_time(), std::memory_order_relaxed);
+                    slot.stack_hash.store(hash_stack(frames, depth), std::memory_order_relaxed);
+                    slot.size.store(size, std::memory_order_relaxed);
+                    slot.size_class.store(static_cast<uint8_t>(stat_class), std::memory_order_relaxed);
+                    slot.sequence.store(2 * ticket + 2, std::memory_order_release);
+                }
             }
         }
+        return ptr;
+    }
+
+    /**
+     * @brief Tiny classes step by 8 bytes up to TINY_LARGE_THRESHOLD, pool classes follow as
+     * powers of two up to SMALL_LARGE_THRESHOLD and medium classes up to LARGE_THRESHOLD. Every
+     * slot carries its header and stays ALIGNMENT aligned. Small classes share one page per pool;
+     * a medium pool takes about MEDIUM_POOL_SIZE bytes, but at least 4 slots and no more than a
+     * header can index, and moves half of them at a time through the thread cache.
+     */
+    constexpr std::array<size_class, SIZE_CLASSES> size_classes = []
+    {
+        constexpr size_t pool_header = sizeof(pool) - sizeof(pool::memory);
+        constexpr size_t max_medium_blocks = (NODE_MASK >> NODE_SHIFT) + 1;
+
+        std::array<size_class, SIZE_CLASSES> classes{};
+        for (size_t i = 0; i < SIZE_CLASSES; ++i)
+        {
+            const size_t size = i < TINY_CLASSES
+                                    ? (i + 1) << 3
+                                    : TINY_LARGE_THRESHOLD * 2 << (i - TINY_CLASSES);
+            const size_t slot = (size + sizeof(block_header) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            size_t blocks = sizeof(pool::memory) / slot;
+            size_t pages = 1;
+            size_t batch = CACHE_SIZE / 2;
+            if (i >= TINY_CLASSES + POOL_CLASSES)
+            {
+                blocks = std::min(std::max<size_t>(MEDIUM_POOL_SIZE / slot, 4), max_medium_blocks);
+                pages = (pool_header + blocks * slot + PG_SIZE - 1) / PG_SIZE;
+                blocks = std::min((pages * PG_SIZE - pool_header) / slot, max_medium_blocks);
+                batch = std::min<size_t>(blocks / 2, CACHE_SIZE / 2);
+            }
+            classes[i] = {
+                static_cast<uint32_t>(size),
+                static_cast<uint32_t>(slot),
+                static_cast<uint16_t>(blocks),
+                static_cast<uint16_t>(pages),
+                static_cast<uint16_t>(batch),
+                static_cast<uint16_t>(slot - size)
+            };
+        }
+        return classes;
+    }();
+
+    static_assert(sizeof(pool) == PG_SIZE, "pool must fill exactly one page");
+    static_assert(sizeof(block_header) == ALIGNMENT, "debug call sites must fit in the header padding");
+    static_assert(TINY_LARGE_THRESHOLD * 2 << (POOL_CLASSES - 1) == SMALL_LARGE_THRESHOLD,
+                  "pool classes must end at SMALL_LARGE_THRESHOLD");
+    static_assert(SMALL_LARGE_THRESHOLD * 2 << (MEDIUM_CLASSES - 1) == LARGE_THRESHOLD,
+                  "medium classes must end at LARGE_THRESHOLD");
+    static_assert(sizeof(pool::memory) / (ALIGNMENT + sizeof(block_header)) <= bitmap::BITS_PER_WORD,
+                  "pool slots must fit in the first bitmap word");
+    static_assert(TINY_CLASSES << 3 == TINY_LARGE_THRESHOLD, "tiny classes must end at TINY_LARGE_THRESHOLD");
+
+    ALWAYS_INLINE static uint8_t small_class(const size_t size) noexcept
+    {
+        return size <= TINY_LARGE_THRESHOLD
+                   ? static_cast<uint8_t>((size - 1) >> 3)
+                   : static_cast<uint8_t>(TINY_CLASSES + (64 - __builtin_clzll(size - 1)) - 7);
+    }
+
+    ALWAYS_INLINE
+    void *thread_cache_t::get(const uint8_t size_class) noexcept
+    {
+        auto &[blocks, count] = caches[size_class];
+        if (LIKELY(count > 0))
+        {
+            PREFETCH_L1(&blocks[count - 2]);
+            return blocks[--count].ptr;
+        }
+        return nullptr;
+    }
 
-        size_t oldest_idx = 0;
-        #if defined(YUMINA_ARCH_X64) && defined(__AVX2__)
-            __m256i min_time = _mm256_set1_epi64x(UINT64_MAX);
-            __m256i indices = _mm256_setr_epi64x(0, 1, 2, 3);
+    bool thread_cache_t::put(void *ptr, const uint8_t size_class) noexcept
+    {
+        if (auto &[blocks, count] = caches[size_class]; LIKELY(count < 2 * size_classes[size_class].batch))
+        {
+            blocks[count].ptr = ptr;
+            blocks[count].size_class = size_class;
+            ++count;
+            return true;
+        }
+        return false;
+    }
+
+    void thread_cache_t::clear() noexcept
+    {
+        for (auto &[blocks, count] : caches)
+            count = 0;
+    }
 
-            for (size_t i = 0; i < BUCKET_SIZE; i += 4)
+    ALWAYS_INLINE static size_t count_trailing_zeros(uint64_t x)
+    {
+        #if defined(YUMINA_ARCH_X64)
+        #ifdef YUMINA_COMPILER_MSVC
+            uint64_t index;
+            _BitScanForward64(&index, x);
+            return static_cast<size_t>(index);
+        #else
+            return __builtin_ctzll(x);
+        #endif
+        #elif defined(YUMINA_ARCH_ARM64)
+            return __builtin_ctzll(x);
+        #else
+            if (x == 0)
+                return 64;
+            size_t n = 0;
+            if ((x & 0x00000000FFFFFFFF) == 0)
             {
-                __m256i times = _mm256_setr_epi64x(
-                    bucket.entries[i].last_use,
-                    bucket.entries[i+1].last_use,
-                    bucket.entries[i+2].last_use,
-                    bucket.entries[i+3].last_use
-                );
-                __m256i mask = _mm256_cmpgt_epi64(min_time, times);
-                min_time = _mm256_blendv_epi8(min_time, times, mask);
-                indices = _mm256_blendv_epi8(indices,
-                         _mm256_setr_epi64x(i, i+1, i+2, i+3), mask);
+                n += 32;
+                x >>= 32;
             }
+            if ((x & 0x000000000000FFFF) == 0)
+            {
+                n += 16;
+                x >>= 16;
+            }
+            if ((x & 0x00000000000000FF) == 0)
+            {
+                n += 8;
+                x >>= 8;
+            }
+            if ((x & 0x000000000000000F) == 0)
+            {
+                n += 4;
+                x >>= 4;
+            }
+            if ((x & 0x0000000000000003) == 0)
+            {
+                n += 2;
+                x >>= 2;
+            }
+            if ((x & 0x0000000000000001) == 0)
+                n += 1;
+            return n;
+        #endif
+    }
+
+    bitmap::bitmap() noexcept
+    {
+        for (auto& word : words)
+            word.store(~0ULL, std::memory_order_relaxed);
+    }
+
+    void bitmap::mark_free(size_t index) noexcept
+    {
+        const size_t word_idx = index / BITS_PER_WORD;
+        const size_t bit_idx = index % BITS_PER_WORD;
+        PREFETCH_L1(&words[word_idx]);
+        words[word_idx].fetch_or(1ULL << bit_idx, std::memory_order_release);
+    }
+
+    bool bitmap::is_completely_free() const noexcept
+    {
+        VECTORIZE_LOOP
+        for (auto& word : words)
+        {
+            if (word.load(std::memory_order_relaxed) != ~0ULL)
+                return false;
+        }
+        return true;
+    }
+
+    void block_header::init(const size_t sz, const uint8_t size_class, const bool is_free) noexcept
+    {
+        if (UNLIKELY(sz > SIZE_MASK))
+            return;
+        // Keeps the slot index a medium pool stamped into the header when it handed the slot out
+        data = (data & NODE_MASK) |
+               (sz & SIZE_MASK) |
+               static_cast<uint64_t>(size_class) << 48 |
+               static_cast<uint64_t>(is_free) << 63;
+        magic = HEADER_MAGIC;
+    }
+
+    void block_header::encode(const size_t size, const uint8_t size_class) noexcept
+    {
+        data = (size & SIZE_MASK) |
+               static_cast<uint64_t>(size_class) << 48;
+    }
+
+    bool block_header::set_free(const bool is_free) noexcept
+    {
+        data = (data & ~(1ULL << 63)) | static_cast<uint64_t>(is_free) << 63;
+        return true;
+    }
+
+    bool block_header::is_valid() const noexcept
+    {
+        return magic == HEADER_MAGIC;
+    }
+
+    void pool::init(pool_manager* manager, const uint8_t size_class) noexcept
+    {
+        // Only slots that exist in this class start out free
+        const size_t blocks = size_classes[size_class].blocks;
+        free_slots.words[0].store(blocks >= bitmap::BITS_PER_WORD ? ~0ULL : (1ULL << blocks) - 1,
+                              std::memory_order_relaxed);
+        for (size_t i = 1; i < bitmap::WORDS_PER_BITMAP; ++i)
+            free_slots.words[i].store(0, std::memory_order_relaxed);
+        next = nullptr;
+        prev = nullptr;
+        owner = manager;
+        remote_frees.store(0, std::memory_order_relaxed);
+        used = 0;
+        class_index = size_class;
+        on_full = false;
+    }
 
-            alignas(32) uint64_t results[4];
-            _mm256_store_si256(reinterpret_cast<__m256i*>(results), min_time);
+    size_t pool::span_slots(const size_t size, const size_class& sc) noexcept
+    {
+        return (size + sizeof(block_header) + sc.slot_size - 1) / sc.slot_size;
+    }
+
+    pool* pool::of(const void* ptr, const uint8_t size_class) noexcept
+    {
+        if (LIKELY(size_class < TINY_CLASSES + POOL_CLASSES))
+            return reinterpret_cast<pool*>(reinterpret_cast<uintptr_t>(ptr) & ~(PG_SIZE - 1));
+
+        // Medium pools span several pages, so the block's header says which slot it starts at
+        const auto* header = reinterpret_cast<const block_header*>(static_cast<const char*>(ptr) - sizeof(block_header));
+        return reinterpret_cast<pool*>(reinterpret_cast<uintptr_t>(header) -
+                                       header->slot() * size_classes[size_class].slot_size -
+                                       (sizeof(pool) - sizeof(pool::memory)));
+    }
 
-            for (int i = 0; i < 4; ++i)
+    /**
+     * @brief Claims up to `max` free slots with one fetch_and on the bitmap word.
+     * Only the owner clears bits and other threads only set them, so every bit picked from the
+     * snapshot is still free when the mask lands. Writes the user pointers to `out`, lowest
+     * address first, and returns how many were taken.
+     */
+    size_t pool::take(void** out, const size_t max, const size_class& sc) noexcept
+    {
+        uint64_t free_bits = free_slots.words[0].load(std::memory_order_acquire);
+        uint64_t mask = 0;
+        size_t taken = 0;
+        for (; free_bits && taken < max; ++taken)
+        {
+            const uint64_t lowest = free_bits & (~free_bits + 1);
+            mask |= lowest;
+            free_bits ^= lowest;
+        }
+        if (UNLIKELY(!taken))
+            return 0;
+
+        free_slots.words[0].fetch_and(~mask, std::memory_order_acquire);
+        for (; mask; mask &= mask - 1)
+        {
+            const size_t index = count_trailing_zeros(mask);
+            uint8_t* slot = memory + index * sc.slot_size;
+            if (class_index >= TINY_CLASSES + POOL_CLASSES)
+                reinterpret_cast<block_header*>(slot)->set_slot(index);
+            *out++ = slot + sizeof(block_header);
+        }
+        return taken;
+    }
+
+    /**
+     * @brief Marks a block free and returns the bitmap mask of every slot it spans.
+     * The bitmap itself is left alone so callers can batch several blocks into one update.
+     */
+    uint64_t pool::release(const void* ptr, const size_class& sc, size_t& slots) noexcept
+    {
+        auto* header = reinterpret_cast<block_header*>(
+            const_cast<char*>(static_cast<const char*>(ptr)) - sizeof(block_header));
+        const size_t index = (reinterpret_cast<const uint8_t*>(header) - memory) / sc.slot_size;
+        slots = span_slots(header->size(), sc);
+        header->set_free(true);
+        return (slots >= bitmap::BITS_PER_WORD ? ~0ULL : (1ULL << slots) - 1) << index;
+    }
+
+    /**
+     * @brief Hands slots back to a pool owned by another thread.
+     * Once `remote_frees` is bumped the owner may fold it, find the pool empty and destroy it,
+     * so everything read from the pool is loaded first; afterwards only the manager is touched.
+     */
+    void pool::free_remote(const uint64_t mask, const size_t slots) noexcept
+    {
+        pool_manager* manager = owner;
+        const uint8_t size_class = class_index;
+        free_slots.words[0].fetch_or(mask, std::memory_order_release);
+        remote_frees.fetch_add(static_cast<uint32_t>(slots), std::memory_order_release);
+        manager->remote_pending[size_class].store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Extends a block over the free slots that follow it.
+     * Claims all of them with one CAS on the bitmap word, so either the whole span is taken or
+     * nothing is. Returns the number of slots added, 0 if the neighbours are not free.
+     */
+    size_t pool::grow(void* ptr, const size_class& sc, const size_t new_size) noexcept
+    {
+        auto* header = reinterpret_cast<block_header*>(static_cast<char*>(ptr) - sizeof(block_header));
+        const size_t index = (reinterpret_cast<uint8_t*>(header) - memory) / sc.slot_size;
+        const size_t have = span_slots(header->size(), sc);
+        const size_t need = span_slots(new_size, sc);
+        if (need <= have || index + need > sc.blocks)
+            return 0;
+
+        const uint64_t mask = ((1ULL << (need - have)) - 1) << (index + have);
+        uint64_t expected = free_slots.words[0].load(std::memory_order_relaxed);
+        do
+        {
+            if ((expected & mask) != mask)
+                return 0;
+        } while (!free_slots.words[0].compare_exchange_weak(expected, expected & ~mask,
+                                                        std::memory_order_acquire,
+                                                        std::memory_order_relaxed));
+
+        header->init(new_size, class_index, false);
+        return need - have;
+    }
+
+    /**
+     * @brief Returns a pool's pages to the span region, one page or a medium pool's whole span.
+     */
+    ALWAYS_INLINE static void destroy_pool(pool* p) noexcept
+    {
+        const size_t pages = size_classes[p->class_index].pages;
+        p->~pool();
+        span_region_.free_span(p, pages * PG_SIZE);
+    }
+
+    ALWAYS_INLINE static void push_pool(pool*& head, pool* p) noexcept
+    {
+        p->prev = nullptr;
+        p->next = head;
+        if (head)
+            head->prev = p;
+        head = p;
+    }
+
+    ALWAYS_INLINE static void unlink_pool(pool*& head, pool* p) noexcept
+    {
+        if (p->prev)
+            p->prev->next = p->next;
+        else
+            head = p->next;
+        if (p->next)
+            p->next->prev = p->prev;
+        p->next = nullptr;
+        p->prev = nullptr;
+    }
+
+    /**
+     * @brief Gives up the pools of an exiting thread. Empty pools go back to the span region;
+     * a pool with blocks still live elsewhere is kept, and its region pinned, for whichever
+     * thread adopts the manager next.
+     */
+    void pool_manager::abandon() noexcept
+    {
+        for (size_t sc = 0; sc < SIZE_CLASSES; ++sc)
+        {
+            pool* kept = nullptr;
+            for (pool* list : { partial[sc], full[sc] })
             {
-                if (results[i] < UINT64_MAX)
+                while (list)
                 {
-                    oldest_idx = i;
+                    pool* p = list;
+                    list = p->next;
+
+                    // A remote free reads everything it needs from the pool before bumping
+                    // `remote_frees` and afterwards only flags the manager, so an empty pool can
+                    // go right away
+                    p->used = static_cast<uint16_t>(p->used - p->remote_frees.exchange(0, std::memory_order_acquire));
+                    if (p->used == 0)
+                    {
+                        --pool_count[sc];
+                        destroy_pool(p);
+                        if (auto* stats = thread_stats())
+                            stat_add(stats->pools, ~0ULL);
+                        continue;
+                    }
+
+                    p->on_full = false;
+                    push_pool(kept, p);
+                    span_region_.pin(p);
                 }
             }
-        #elif defined(YUMINA_ARCH_ARM64)
-            uint64x2_t min_time = vdupq_n_u64(UINT64_MAX);
-            uint64x2_t curr_idx = vdupq_n_u64(0);
+            partial[sc] = kept;
+            full[sc] = nullptr;
+        }
+    }
+
+    pool* pool_manager::alloc_pool(const uint8_t size_class) noexcept
+    {
+        void* span = span_region_.alloc_span(size_classes[size_class].pages * PG_SIZE);
+        if (UNLIKELY(!span))
+            return nullptr;
+
+        auto* new_pool = new(span) pool();
+        new_pool->init(this, size_class);
+        push_pool(partial[size_class], new_pool);
+        ++pool_count[size_class];
+        if (auto* stats = thread_stats())
+            stat_add(stats->pools);
+        return new_pool;
+    }
+
+    void pool_manager::free_pool(pool* p) noexcept
+    {
+        const uint8_t size_class = p->class_index;
+        unlink_pool(partial[size_class], p);
+        --pool_count[size_class];
+        destroy_pool(p);
+        if (auto* stats = thread_stats())
+            stat_add(stats->pools, ~0ULL);
+    }
+
+    /**
+     * @brief Folds remote frees into `used` for every pool of a class.
+     * Full pools that got slots back move to the partial list, and pools left empty go back to
+     * the span region. One partial pool is always kept, since the caller is about to allocate.
+     */
+    void pool_manager::reclaim_remote(const uint8_t size_class) noexcept
+    {
+        if (!remote_pending[size_class].load(std::memory_order_relaxed) ||
+            !remote_pending[size_class].exchange(false, std::memory_order_acquire))
+            return;
+
+        for (pool* p = full[size_class]; p;)
+        {
+            pool* next = p->next;
+            if (const uint32_t freed = p->remote_frees.exchange(0, std::memory_order_acquire))
+            {
+                p->used = static_cast<uint16_t>(p->used - freed);
+                p->on_full = false;
+                unlink_pool(full[size_class], p);
+                push_pool(partial[size_class], p);
+            }
+            p = next;
+        }
+
+        for (pool* p = partial[size_class]; p;)
+        {
+            pool* next = p->next;
+            p->used = static_cast<uint16_t>(p->used - p->remote_frees.exchange(0, std::memory_order_acquire));
+            if (p->used == 0 && pool_count[size_class] > 1 && (p != partial[size_class] || next))
+                free_pool(p);
+            p = next;
+        }
+    }
+
+    /**
+     * @brief Takes up to `max` free slots of a class, draining partial pools before opening a
+     * new one. Returns fewer only when no pool can be had.
+     */
+    size_t pool_manager::refill(const uint8_t size_class, void** out, const size_t max) noexcept
+    {
+        const auto& sc = size_classes[size_class];
+        reclaim_remote(size_class);
+        size_t filled = 0;
+        while (filled < max)
+        {
+            pool* p = partial[size_class];
+            if (!p && !(p = alloc_pool(size_class)))
+                break;
+
+            // `used` only overcounts (remote frees are folded in late), so a partial pool has at
+            // least blocks - used free bits and a short take means the page is exhausted
+            const size_t want = p->used < sc.blocks ? std::min<size_t>(max - filled, sc.blocks - p->used) : 0;
+            const size_t taken = p->take(out + filled, want, sc);
+            filled += taken;
+
+            if ((p->used = static_cast<uint16_t>(p->used + taken)) >= sc.blocks || taken < want)
+            {
+                p->on_full = true;
+                unlink_pool(partial[size_class], p);
+                push_pool(full[size_class], p);
+            }
+        }
+        return filled;
+    }
+
+    void pool_manager::free_block(pool* p, const void* ptr) noexcept
+    {
+        size_t slots;
+        const uint64_t mask = p->release(ptr, size_classes[p->class_index], slots);
+        release_slots(p, mask, slots);
+    }
+
+    /**
+     * @brief Returns the slots in `mask` to an owned pool with one bitmap update.
+     */
+    void pool_manager::release_slots(pool* p, const uint64_t mask, const size_t slots) noexcept
+    {
+        const uint8_t size_class = p->class_index;
+        p->free_slots.words[0].fetch_or(mask, std::memory_order_release);
+        p->used = static_cast<uint16_t>(p->used - slots);
+
+        if (p->on_full)
+        {
+            p->on_full = false;
+            unlink_pool(full[size_class], p);
+            push_pool(partial[size_class], p);
+        }
+
+        // Keep the last pool of a class around so alternating alloc/free does not churn spans
+        if (p->used == 0 && pool_count[size_class] > 1)
+            free_pool(p);
+    }
+
+    bool pool_manager::grow_block(pool* p, void* ptr, const size_t new_size) noexcept
+    {
+        const auto& sc = size_classes[p->class_index];
+        const size_t added = p->grow(ptr, sc, new_size);
+        if (!added)
+            return false;
+
+        if ((p->used = static_cast<uint16_t>(p->used + added)) >= sc.blocks && !p->on_full)
+        {
+            p->on_full = true;
+            unlink_pool(partial[p->class_index], p);
+            push_pool(full[p->class_index], p);
+        }
+        return true;
+    }
+
+    // Managers of exited threads, with any pools they kept, waiting for a new thread
+    static std::atomic<bool> orphan_lock_{false};
+    static pool_manager* orphan_managers_ = nullptr;
+
+    /**
+     * @brief Adopts an exited thread's manager, or maps a new one. Managers get their own pages
+     * rather than a span, since they outlive the region of the thread that created them; there
+     * are never more of them than threads alive at once.
+     */
+    NEVER_INLINE static pool_manager* acquire_pool_manager() noexcept
+    {
+        while (orphan_lock_.exchange(true, std::memory_order_acquire))
+            CPU_PAUSE();
+        pool_manager* manager = orphan_managers_;
+        if (manager)
+            orphan_managers_ = manager->next_orphan;
+        orphan_lock_.store(false, std::memory_order_release);
+        if (manager)
+        {
+            manager->next_orphan = nullptr;
+            return manager;
+        }
+
+        void* pages = map_pages((sizeof(pool_manager) + PG_SIZE - 1) & ~(PG_SIZE - 1), PG_SIZE, false, false);
+        return pages ? new(pages) pool_manager() : nullptr;
+    }
+
+    static void orphan_pool_manager(pool_manager* manager) noexcept
+    {
+        manager->abandon();
+        while (orphan_lock_.exchange(true, std::memory_order_acquire))
+            CPU_PAUSE();
+        manager->next_orphan = orphan_managers_;
+        orphan_managers_ = manager;
+        orphan_lock_.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief Fills an empty class cache with one batch, half its capacity, in one pass over the
+     * pools and hands out the first block.
+     */
+    void* thread_cache_t::refill(const uint8_t size_class) noexcept
+    {
+        if (UNLIKELY(!pool_manager_) && !(pool_manager_ = acquire_pool_manager()))
+            return nullptr;
+
+        void* batch[CACHE_SIZE / 2];
+        const size_t taken = pool_manager_->refill(size_class, batch, size_classes[size_class].batch);
+
+        // Pushed in reverse so the lowest addresses are handed out first
+        auto& [blocks, count] = caches[size_class];
+        for (size_t i = taken; i > 0; --i)
+            blocks[count++] = { batch[i - 1], size_class };
+        return get(size_class);
+    }
+
+    /**
+     * @brief Returns the oldest `n` cached blocks of a class to their pools.
+     * Neighbouring entries from the same pool are merged into one bitmap mask, so a batch that
+     * came from one refill goes back with a single atomic update.
+     */
+    void thread_cache_t::flush(const uint8_t size_class, const size_t n) noexcept
+    {
+        auto& [blocks, count] = caches[size_class];
+        const auto& sc = size_classes[size_class];
+        for (size_t i = 0; i < n;)
+        {
+            pool* p = pool::of(blocks[i].ptr, size_class);
+            uint64_t mask = 0;
+            size_t slots = 0;
+            for (; i < n && pool::of(blocks[i].ptr, size_class) == p; ++i, ++slots)
+            {
+                const auto* block = static_cast<const uint8_t*>(blocks[i].ptr) - sizeof(block_header);
+                mask |= 1ULL << (block - p->memory) / sc.slot_size;
+            }
+
+            if (p->owner == pool_manager_)
+                pool_manager_->release_slots(p, mask, slots);
+            else
+                p->free_remote(mask, slots);
+        }
+
+        std::memmove(blocks, blocks + n, (count - n) * sizeof(cached_block));
+        count -= n;
+    }
+
+    uint64_t large_block_cache_t::get_time() noexcept
+    {
+        #if defined(YUMINA_ARCH_ARM64)
+            // CNTVCT_EL0 (Virtual Count Register) scaled by its fixed frequency
+            uint64_t timestamp, frequency;
+            asm volatile("mrs %0, cntvct_el0" : "=r"(timestamp));
+            asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+            return static_cast<uint64_t>(static_cast<unsigned __int128>(timestamp) * 1000000000ULL / frequency);
+        #else
+            // Nanoseconds, so idle thresholds can be expressed in wall time
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        #endif
+    }
+
+    void large_block_cache_t::lock() noexcept
+    {
+        while (locked.exchange(true, std::memory_order_acquire))
+        {
+            while (locked.load(std::memory_order_relaxed))
+                CPU_PAUSE();
+        }
+    }
+
+    bool large_block_cache_t::try_lock() noexcept
+    {
+        return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void large_block_cache_t::unlock() noexcept
+    {
+        locked.store(false, std::memory_order_release);
+    }
+
+    large_block_cache_t::large_block_cache_t() noexcept
+    {
+        for (auto& extent : extents)
+            extent = SIZE_MAX;
+    }
+
+    /**
+     * @brief Drops entry `index`, shifting the larger extents down to keep the order.
+     * Returns the mapping to the caller, who either reuses or unmaps it.
+     */
+    ALWAYS_INLINE static void erase_entry(large_block_cache_t& cache, const size_t index) noexcept
+    {
+        const size_t tail = cache.count - index - 1;
+        std::memmove(&cache.extents[index], &cache.extents[index + 1], tail * sizeof(size_t));
+        std::memmove(&cache.last_use[index], &cache.last_use[index + 1], tail * sizeof(uint64_t));
+        std::memmove(&cache.bases[index], &cache.bases[index + 1], tail * sizeof(char*));
+        std::memmove(&cache.origins[index], &cache.origins[index + 1], tail * sizeof(char*));
+        std::memmove(&cache.nodes[index], &cache.nodes[index + 1], tail * sizeof(uint32_t));
+        cache.extents[--cache.count] = SIZE_MAX;
+    }
+
+    ALWAYS_INLINE static void insert_entry(large_block_cache_t& cache, char* base, const size_t extent,
+                                           const uint32_t node, char* origin, const uint64_t now) noexcept
+    {
+        size_t index = 0;
+        for (size_t i = 0; i < MAX_CACHED_BLOCKS; ++i)
+            index += cache.extents[i] < extent;
+
+        const size_t tail = cache.count - index;
+        std::memmove(&cache.extents[index + 1], &cache.extents[index], tail * sizeof(size_t));
+        std::memmove(&cache.last_use[index + 1], &cache.last_use[index], tail * sizeof(uint64_t));
+        std::memmove(&cache.bases[index + 1], &cache.bases[index], tail * sizeof(char*));
+        std::memmove(&cache.origins[index + 1], &cache.origins[index], tail * sizeof(char*));
+        std::memmove(&cache.nodes[index + 1], &cache.nodes[index], tail * sizeof(uint32_t));
+        cache.extents[index] = extent;
+        cache.last_use[index] = now;
+        cache.bases[index] = base;
+        cache.origins[index] = origin;
+        cache.nodes[index] = node;
+        ++cache.count;
+    }
+
+    /**
+     * @brief Unmaps the least recently used entry.
+     */
+    ALWAYS_INLINE static void evict_oldest(large_block_cache_t& cache) noexcept
+    {
+        size_t oldest = 0;
+        for (size_t i = 1; i < cache.count; ++i)
+            oldest = cache.last_use[i] < cache.last_use[oldest] ? i : oldest;
+
+        char* base = cache.bases[oldest];
+        const size_t extent = cache.extents[oldest];
+        erase_entry(cache, oldest);
+        cache.total_cached -= extent;
+        unmap_pages(base, extent);
+    }
+
+    size_t large_block_cache_t::purge(const uint64_t now, const uint64_t idle, size_t budget) noexcept
+    {
+        size_t released = 0;
+        for (size_t i = 0; i < count;)
+        {
+            if (now - last_use[i] < idle || extents[i] > budget)
+            {
+                ++i;
+                continue;
+            }
+
+            char* base = bases[i];
+            const size_t extent = extents[i];
+            erase_entry(*this, i);
+            total_cached -= extent;
+            unmap_pages(base, extent);
+            released += extent;
+            budget -= extent;
+        }
+        return released;
+    }
 
-            for (size_t i = 0; i < size_bucket::BUCKET_SIZE; i += 2)
-            {
-                uint64x2_t times = vld1q_u64(&entries[i].last_use);
-                uint64x2_t mask = vcltq_u64(times, min_time);
-                min_time = vbslq_u64(mask, times, min_time);
-                curr_idx = vbslq_u64(mask, vdupq_n_u64(i), curr_idx);
-            }
+    /**
+     * @brief Best fit: the smallest cached mapping of at least `extent` bytes on `node`. A larger
+     * one is split and its tail cached again, so the result is exactly `extent` bytes long.
+     * `origin` receives the start of the mapping the result was carved from.
+     */
+    char* large_block_cache_t::get_cached_block(const size_t extent, const uint32_t node, char*& origin) noexcept
+    {
+        if (UNLIKELY(extent < MIN_CACHE_BLOCK || extent > MAX_CACHE_BLOCK))
+            return nullptr;
 
-            uint64_t times[2], indices[2];
-            vst1q_u64(times, min_time);
-            vst1q_u64(indices, curr_idx);
+        lock();
+        size_t index = 0;
+        for (size_t i = 0; i < MAX_CACHED_BLOCKS; ++i)
+            index += extents[i] < extent;
+        while (index < count && nodes[index] != node)
+            ++index;
 
-            if (times[0] < times[1])
-            {
-                oldest_idx = indices[0];
-            }
-            else
-            {
-                oldest_idx = indices[1];
-            }
-            #else
-            for (size_t i = 0; i < BUCKET_SIZE; ++i)
-            {
-                if (bucket.entries[i].last_use < UINT64_MAX)
-                {
-                    oldest_idx = i;
-                }
-            }
-            #endif
+        if (index == count)
+        {
+            unlock();
+            return nullptr;
+        }
+
+        char* base = bases[index];
+        origin = origins[index];
+        const size_t found = extents[index];
+        const uint64_t used = last_use[index];
+        erase_entry(*this, index);
+        total_cached -= found;
+        if (found > extent)
+        {
+            insert_entry(*this, base + extent, found - extent, node, origin, used);
+            total_cached += found - extent;
+        }
+        unlock();
+        return base;
+    }
 
-        auto& oldest = entries[oldest_idx];
+    /**
+     * @brief Caches a released mapping, first merging it with cached neighbours split from the
+     * same mapping, so a run of freed blocks becomes one entry that later requests split again.
+     * Separate mappings that merely touch stay separate entries.
+     */
+    bool large_block_cache_t::cache_block(char* base, size_t extent, const uint32_t node, char* origin) noexcept
+    {
+        if (UNLIKELY(extent < MIN_CACHE_BLOCK || extent > MAX_CACHE_BLOCK))
+            return false;
 
-        if (void* expected = oldest.ptr.load(std::memory_order_relaxed); expected && static_cast<double>(size) <= static_cast<double>(oldest.size) * MAX_SIZE_RATIO)
+        lock();
+        for (size_t i = 0; i < count;)
         {
-            if (oldest.ptr.compare_exchange_strong(expected, ptr,
-                std::memory_order_release, std::memory_order_relaxed))
+            if (origins[i] != origin || extents[i] + extent > MAX_CACHE_BLOCK ||
+                (bases[i] + extents[i] != base && base + extent != bases[i]))
             {
-                total_cached.fetch_sub(oldest.size, std::memory_order_relaxed);
-                oldest.size = size;
-                oldest.last_use = get_time();
-                total_cached.fetch_add(size, std::memory_order_relaxed);
-                return true;
+                ++i;
+                continue;
             }
+            base = std::min(base, bases[i]);
+            extent += extents[i];
+            total_cached -= extents[i];
+            erase_entry(*this, i);
         }
 
-        return false;
+        while (count && (count == MAX_CACHED_BLOCKS || total_cached + extent > MAX_CACHE_SIZE))
+            evict_oldest(*this);
+        insert_entry(*this, base, extent, node, origin, get_time());
+        total_cached += extent;
+        unlock();
+        return true;
     }
 
     void block_header::set_mmapped(const bool is_mmap) noexcept
@@ -751,218 +1866,914 @@ namespace yumina::detail
         return data & COALESCED_FLAG;
     }
 
-    void large_block_cache_t::clear() noexcept
-    {
-        for (auto& bucket : buckets)
+    void block_header::set_node(const uint32_t node) noexcept
+    {
+        data = (data & ~NODE_MASK) | ((static_cast<uint64_t>(node) << NODE_SHIFT) & NODE_MASK);
+    }
+
+    uint32_t block_header::node() const noexcept
+    {
+        return static_cast<uint32_t>((data & NODE_MASK) >> NODE_SHIFT);
+    }
+
+    void block_header::set_slot(const size_t slot) noexcept
+    {
+        data = (data & ~NODE_MASK) | ((static_cast<uint64_t>(slot) << NODE_SHIFT) & NODE_MASK);
+    }
+
+    size_t block_header::slot() const noexcept
+    {
+        return static_cast<size_t>((data & NODE_MASK) >> NODE_SHIFT);
+    }
+
+    void block_header::set_sampled(const bool sampled) noexcept
+    {
+        data = (data & ~SAMPLED_FLAG) | static_cast<uint64_t>(sampled) << 47;
+    }
+
+    bool block_header::is_sampled() const noexcept
+    {
+        return data & SAMPLED_FLAG;
+    }
+
+    void large_block_cache_t::clear() noexcept
+    {
+        lock();
+        while (count)
+        {
+            unmap_pages(bases[count - 1], extents[count - 1]);
+            extents[--count] = SIZE_MAX;
+        }
+        total_cached = 0;
+        unlock();
+    }
+
+    /**
+     * @brief Returns the calling thread's large block cache, creating and registering it on first use.
+     */
+    ALWAYS_INLINE static large_block_cache_t* thread_large_cache() noexcept
+    {
+        if (LIKELY(large_block_cache_))
+            return large_block_cache_;
+        if (UNLIKELY(thread_torn_down_))
+            return nullptr;
+
+        auto* cache = make_heap_object<large_block_cache_t>();
+        if (UNLIKELY(!cache))
+            return nullptr;
+
+        while (registry_lock_.exchange(true, std::memory_order_acquire))
+            CPU_PAUSE();
+        cache->next_registered = cache_registry_;
+        cache_registry_ = cache;
+        registry_lock_.store(false, std::memory_order_release);
+
+        large_block_cache_ = cache;
+        return cache;
+    }
+
+    static void unregister_large_cache(const large_block_cache_t* cache) noexcept
+    {
+        while (registry_lock_.exchange(true, std::memory_order_acquire))
+            CPU_PAUSE();
+        for (large_block_cache_t** link = &cache_registry_; *link; link = &(*link)->next_registered)
+        {
+            if (*link == cache)
+            {
+                *link = cache->next_registered;
+                break;
+            }
+        }
+        registry_lock_.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief Lazily releases idle memory of the calling thread, at most once per purge interval.
+     * Called from the large block slow paths, so bursts of mmap traffic give memory back
+     * without a background thread.
+     */
+    ALWAYS_INLINE static void maybe_purge() noexcept
+    {
+        const uint64_t now = large_block_cache_t::get_time();
+        if (LIKELY(now - last_purge_ < purge_interval_ms_.load(std::memory_order_relaxed) * NS_PER_MS))
+            return;
+        last_purge_ = now;
+
+        const uint64_t idle = purge_idle_ms_.load(std::memory_order_relaxed) * NS_PER_MS;
+        size_t budget = purge_budget_.load(std::memory_order_relaxed);
+        if (large_block_cache_)
+        {
+            large_block_cache_->lock();
+            budget -= large_block_cache_->purge(now, idle, budget);
+            large_block_cache_->unlock();
+        }
+        span_region_.purge(now, idle, budget);
+    }
+
+    #ifdef YUMINA_ALLOC_DEBUG
+        /**
+         * @brief Prints a heap error with the block's allocating call site and the detecting stack,
+         * then aborts. Addresses resolve with addr2line or atos.
+         */
+        [[noreturn]] NEVER_INLINE static void debug_report(const char* what, const void* ptr, const size_t size,
+                                                          void* const* site) noexcept
+        {
+            std::fprintf(stderr, "yumina: %s on %p\n", what, ptr);
+            if (site)
+            {
+                std::fprintf(stderr, "  %zu byte block allocated at:\n", size);
+                for (size_t i = 0; i < DEBUG_SITE_DEPTH && site[i]; ++i)
+                    std::fprintf(stderr, "    #%zu %p\n", i, site[i]);
+            }
+
+            void* frames[TRACE_DEPTH];
+            const size_t depth = capture_stack(frames, TRACE_DEPTH);
+            std::fprintf(stderr, "  detected at:\n");
+            for (size_t i = 0; i < depth; ++i)
+                std::fprintf(stderr, "    #%zu %p\n", i, frames[i]);
+            std::abort();
+        }
+
+        /**
+         * @brief Offset of the first byte in [ptr, ptr + size) that differs from `pattern`, or size.
+         */
+        static size_t find_mismatch(const void* ptr, const size_t size, const uint8_t pattern) noexcept
+        {
+            const auto* bytes = static_cast<const uint8_t*>(ptr);
+            const uint64_t expected = pattern * 0x0101010101010101ULL;
+            size_t i = 0;
+            for (uint64_t word; i + sizeof(word) <= size; i += sizeof(word))
+            {
+                std::memcpy(&word, bytes + i, sizeof(word));
+                if (word != expected)
+                    break;
+            }
+            for (; i < size; ++i)
+            {
+                if (bytes[i] != pattern)
+                    return i;
+            }
+            return size;
+        }
+
+        static bool guard_pages(void* ptr, const size_t size) noexcept
+        {
+            #if defined(YUMINA_OS_WINDOWS)
+                DWORD previous;
+                return VirtualProtect(ptr, size, PAGE_NOACCESS, &previous);
+            #else
+                return mprotect(ptr, size, PROT_NONE) == 0;
+            #endif
+        }
+
+        /**
+         * @brief End of the memory a block owns: the end of its slot span, or of its mapping.
+         */
+        static char* block_end(void* ptr, const block_header* header) noexcept
+        {
+            if (const uint8_t size_class = header->size_class(); size_class != 255)
+            {
+                const auto& sc = size_classes[size_class];
+                return reinterpret_cast<char*>(const_cast<block_header*>(header)) +
+                       pool::span_slots(header->size(), sc) * sc.slot_size;
+            }
+            return large_base(ptr) + large_extent(ptr, header->size());
+        }
+
+        /**
+         * @brief Records the allocating call site and fills the slack behind the block with a
+         * canary that deallocate checks.
+         */
+        NEVER_INLINE static void debug_arm(void* ptr) noexcept
+        {
+            auto* header = reinterpret_cast<block_header*>(static_cast<char*>(ptr) - sizeof(block_header));
+            void* frames[DEBUG_SITE_DEPTH + 1]{};
+            const size_t depth = capture_stack(frames, DEBUG_SITE_DEPTH + 1);
+
+            // Frame 0 is this function
+            for (size_t i = 0; i < DEBUG_SITE_DEPTH; ++i)
+                header->alloc_site[i] = i + 1 < depth ? frames[i + 1] : nullptr;
+
+            char* tail = static_cast<char*>(ptr) + header->size();
+            std::memset(tail, CANARY_BYTE, static_cast<size_t>(block_end(ptr, header) - tail));
+        }
+
+        /**
+         * @brief A recycled slot must still carry the poison written when it was freed, otherwise
+         * something wrote to it after the free. A block that had grown over its neighbours is only
+         * checked up to the end of its first slot, since the others may be handed out already.
+         */
+        ALWAYS_INLINE static void debug_check_reuse(void* ptr, const block_header* header) noexcept
+        {
+            if (!header->is_valid() || !header->is_free() || header->size_class() >= SIZE_CLASSES)
+                return;
+
+            const size_t size = std::min<size_t>(header->size(),
+                                                 size_classes[header->size_class()].slot_size - sizeof(block_header));
+            if (find_mismatch(ptr, size, POISON_BYTE) != size)
+                debug_report("write after free", ptr, header->size(), header->alloc_site);
+        }
+    #endif
+
+    ALWAYS_INLINE static void* alloc_small(const size_t size, const uint8_t size_class) noexcept
+    {
+        auto* stats = thread_stats();
+        void* ptr = thread_cache_.get(size_class);
+        if (LIKELY(ptr))
+        {
+            if (stats)
+                stat_add(stats->cache_hits);
+        }
+        else
+        {
+            if (stats)
+                stat_add(stats->cache_misses);
+
+            // Without pools of its own anymore, a torn down thread maps the block directly
+            if (UNLIKELY(thread_torn_down_))
+                return alloc_large(size);
+            if (UNLIKELY(!(ptr = thread_cache_.refill(size_class))))
+                return nullptr;
+        }
+
+        auto* header = reinterpret_cast<block_header*>(static_cast<char*>(ptr) - sizeof(block_header));
+        PREFETCH_L1(header);
+        #ifdef YUMINA_ALLOC_DEBUG
+            debug_check_reuse(ptr, header);
+        #endif
+        header->init(size, size_class, false);
+        return ptr;
+    }
+
+    ALWAYS_INLINE static void free_small(void* ptr, const uint8_t size_class) noexcept
+    {
+        auto* p = pool::of(ptr, size_class);
+        size_t slots;
+        const uint64_t mask = p->release(ptr, size_classes[p->class_index], slots);
+        if (p->owner == pool_manager_)
+            pool_manager_->release_slots(p, mask, slots);
+        else
+            p->free_remote(mask, slots);
+    }
+
+    /**
+     * @brief Parks a single-slot block in the thread cache; a full cache first hands its older
+     * half back to the pools in one batch.
+     */
+    ALWAYS_INLINE static void cache_small(void* ptr, block_header* header, const uint8_t size_class) noexcept
+    {
+        if (UNLIKELY(!thread_cache_.put(ptr, size_class)))
+        {
+            thread_cache_.flush(size_class, size_classes[size_class].batch);
+            thread_cache_.put(ptr, size_class);
+        }
+        header->set_free(true);
+    }
+
+    #if defined(YUMINA_ARCH_X64)
+        using copy_kernel_t = void (*)(void* dst, const void* src, size_t size) noexcept;
+        using zero_kernel_t = void (*)(void* dst, size_t size) noexcept;
+
+        /**
+         * @brief Streaming copy and clear, one variant per vector width. The destination is first
+         * brought to the vector alignment with a plain copy, never longer than `size` itself.
+         */
+        template<size_t WIDTH>
+        ALWAYS_INLINE static size_t stream_head(void* dst, const void* src, const size_t size) noexcept
+        {
+            const size_t misalign = reinterpret_cast<uintptr_t>(dst) & (WIDTH - 1);
+            const size_t head = misalign ? std::min(WIDTH - misalign, size) : 0;
+            if (src)
+                std::memcpy(dst, src, head);
+            else
+                std::memset(dst, 0, head);
+            return head;
+        }
+
+        static void copy_stream_sse2(void* dst, const void* src, const size_t size) noexcept
+        {
+            auto* out = static_cast<char*>(dst);
+            const auto* in = static_cast<const char*>(src);
+            size_t offset = stream_head<16>(dst, src, size);
+            for (; offset + 64 <= size; offset += 64)
+            {
+                PREFETCH_L1(in + offset + 256);
+                for (size_t lane = 0; lane < 64; lane += 16)
+                    _mm_stream_si128(reinterpret_cast<__m128i*>(out + offset + lane),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + offset + lane)));
+            }
+            _mm_sfence();
+            std::memcpy(out + offset, in + offset, size - offset);
+        }
+
+        TARGET_AVX2
+        static void copy_stream_avx2(void* dst, const void* src, const size_t size) noexcept
+        {
+            auto* out = static_cast<char*>(dst);
+            const auto* in = static_cast<const char*>(src);
+            size_t offset = stream_head<32>(dst, src, size);
+            for (; offset + 64 <= size; offset += 64)
+            {
+                PREFETCH_L1(in + offset + 256);
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(out + offset),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + offset)));
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(out + offset + 32),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + offset + 32)));
+            }
+            _mm_sfence();
+            std::memcpy(out + offset, in + offset, size - offset);
+        }
+
+        TARGET_AVX512
+        static void copy_stream_avx512(void* dst, const void* src, const size_t size) noexcept
+        {
+            auto* out = static_cast<char*>(dst);
+            const auto* in = static_cast<const char*>(src);
+            size_t offset = stream_head<64>(dst, src, size);
+            for (; offset + 64 <= size; offset += 64)
+            {
+                PREFETCH_L1(in + offset + 256);
+                _mm512_stream_si512(reinterpret_cast<__m512i*>(out + offset),
+                                    _mm512_loadu_si512(in + offset));
+            }
+            _mm_sfence();
+            std::memcpy(out + offset, in + offset, size - offset);
+        }
+
+        static void zero_stream_sse2(void* dst, const size_t size) noexcept
+        {
+            auto* out = static_cast<char*>(dst);
+            const __m128i zero = _mm_setzero_si128();
+            size_t offset = stream_head<16>(dst, nullptr, size);
+            for (; offset + 64 <= size; offset += 64)
+            {
+                for (size_t lane = 0; lane < 64; lane += 16)
+                    _mm_stream_si128(reinterpret_cast<__m128i*>(out + offset + lane), zero);
+            }
+            _mm_sfence();
+            std::memset(out + offset, 0, size - offset);
+        }
+
+        TARGET_AVX2
+        static void zero_stream_avx2(void* dst, const size_t size) noexcept
+        {
+            auto* out = static_cast<char*>(dst);
+            const __m256i zero = _mm256_setzero_si256();
+            size_t offset = stream_head<32>(dst, nullptr, size);
+            for (; offset + 64 <= size; offset += 64)
+            {
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(out + offset), zero);
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(out + offset + 32), zero);
+            }
+            _mm_sfence();
+            std::memset(out + offset, 0, size - offset);
+        }
+
+        TARGET_AVX512
+        static void zero_stream_avx512(void* dst, const size_t size) noexcept
+        {
+            auto* out = static_cast<char*>(dst);
+            const __m512i zero = _mm512_setzero_si512();
+            size_t offset = stream_head<64>(dst, nullptr, size);
+            for (; offset + 64 <= size; offset += 64)
+                _mm512_stream_si512(reinterpret_cast<__m512i*>(out + offset), zero);
+            _mm_sfence();
+            std::memset(out + offset, 0, size - offset);
+        }
+
+        static void copy_stream_resolve(void* dst, const void* src, size_t size) noexcept;
+        static void zero_stream_resolve(void* dst, size_t size) noexcept;
+
+        // Constant-initialized to the resolvers, so the table works before static constructors
+        // run; the first call through either entry picks both kernels for the running CPU
+        static std::atomic<copy_kernel_t> copy_stream_{copy_stream_resolve};
+        static std::atomic<zero_kernel_t> zero_stream_{zero_stream_resolve};
+
+        static void resolve_stream_kernels() noexcept
+        {
+            if (cpu_has_avx512f())
+            {
+                copy_stream_.store(copy_stream_avx512, std::memory_order_relaxed);
+                zero_stream_.store(zero_stream_avx512, std::memory_order_relaxed);
+            }
+            else if (cpu_has_avx2())
+            {
+                copy_stream_.store(copy_stream_avx2, std::memory_order_relaxed);
+                zero_stream_.store(zero_stream_avx2, std::memory_order_relaxed);
+            }
+            else
+            {
+                copy_stream_.store(copy_stream_sse2, std::memory_order_relaxed);
+                zero_stream_.store(zero_stream_sse2, std::memory_order_relaxed);
+            }
+        }
+
+        static void copy_stream_resolve(void* dst, const void* src, const size_t size) noexcept
+        {
+            resolve_stream_kernels();
+            copy_stream_.load(std::memory_order_relaxed)(dst, src, size);
+        }
+
+        static void zero_stream_resolve(void* dst, const size_t size) noexcept
+        {
+            resolve_stream_kernels();
+            zero_stream_.load(std::memory_order_relaxed)(dst, size);
+        }
+    #endif
+
+    /**
+     * @brief Clears recycled memory. From NT_STORE_THRESHOLD up the stores bypass the cache: a
+     * buffer that large would only push the working set out long before it is all read back.
+     */
+    ALWAYS_INLINE static void zero_memory(void* ptr, const size_t size) noexcept
+    {
+        #if defined(YUMINA_ARCH_X64)
+            if (size >= NT_STORE_THRESHOLD)
+            {
+                zero_stream_.load(std::memory_order_relaxed)(ptr, size);
+                return;
+            }
+        #endif
+        std::memset(ptr, 0, size);
+    }
+
+    /**
+     * @brief Moves a block's payload on reallocation. Below NT_STORE_THRESHOLD memcpy is already
+     * the best choice (and dispatched by the C library); above it the copy streams past the cache.
+     */
+    ALWAYS_INLINE static void copy_memory(void* dst, const void* src, const size_t size) noexcept
+    {
+        #if defined(YUMINA_ARCH_X64)
+            if (size >= NT_STORE_THRESHOLD)
+            {
+                copy_stream_.load(std::memory_order_relaxed)(dst, src, size);
+                return;
+            }
+        #endif
+        std::memcpy(dst, src, size);
+    }
+
+    /**
+     * @brief Maps or reuses a large block. `zeroed`, when given, reports whether the payload came
+     * straight from the kernel and is still all zero.
+     */
+    ALWAYS_INLINE static void* alloc_large(const size_t size, bool* zeroed) noexcept
+    {
+        const size_t total_size = size + sizeof(block_header);
+        const size_t alloc_size = (total_size + PG_SIZE - 1) & ~(PG_SIZE - 1);
+        const uint32_t node = current_node();
+
+        auto* stats = thread_stats();
+        if (auto* cache = DEBUG_ALLOC ? nullptr : thread_large_cache())
+        {
+            char* origin;
+            if (char* base = cache->get_cached_block(alloc_size, node, origin))
+            {
+                if (stats)
+                    stat_add(stats->large_hits);
+                auto* header = new (base) block_header();
+                header->init(size, 255, false);
+                header->set_node(node);
+                header->origin = origin;
+                return base + sizeof(block_header);
+            }
+        }
+        if (stats)
+            stat_add(stats->large_misses);
+        maybe_purge();
+
+        // Blocks spanning at least one huge page start on a 2 MiB boundary so THP can back them
+        const bool huge = page_mode() & PAGE_HUGE && alloc_size >= HUGE_PG_SIZE;
+        void* ptr = map_pages(alloc_size + GUARD_SIZE, huge ? HUGE_PG_SIZE : PG_SIZE, huge, false,
+                              numa_multi_node() ? static_cast<int>(node) : -1);
+        if (UNLIKELY(!ptr))
+            return nullptr;
+        #ifdef YUMINA_ALLOC_DEBUG
+            guard_pages(static_cast<char*>(ptr) + alloc_size, GUARD_SIZE);
+        #endif
+
+        auto* header = new (ptr) block_header();
+        header->init(size, 255, false);
+        header->set_node(node);
+        header->origin = static_cast<char*>(ptr);
+        if (zeroed)
+            *zeroed = true;
+        return static_cast<char*>(ptr) + sizeof(block_header);
+    }
+
+    /**
+     * @brief Maps a block whose payload is aligned to `alignment` (a power of two above ALIGNMENT).
+     * The payload starts `alignment` bytes into the mapping, or one page in when the alignment exceeds
+     * a page, in which case the pages in front of the header page are given back.
+     */
+    ALWAYS_INLINE static void* alloc_large_aligned(const size_t size, const size_t alignment) noexcept
+    {
+        const size_t offset = alignment <= PG_SIZE ? alignment : PG_SIZE;
+        const size_t lead = alignment - offset;
+        const size_t extent = (offset + size + PG_SIZE - 1) & ~(PG_SIZE - 1);
+
+        const uint32_t node = current_node();
+        auto* raw = static_cast<char*>(map_pages(lead + extent + GUARD_SIZE, alignment > PG_SIZE ? alignment : PG_SIZE,
+                                                 false, false, numa_multi_node() ? static_cast<int>(node) : -1));
+        if (UNLIKELY(!raw))
+            return nullptr;
+        if (lead)
+            unmap_pages(raw, lead);
+        #ifdef YUMINA_ALLOC_DEBUG
+            guard_pages(raw + lead + extent, GUARD_SIZE);
+        #endif
+
+        char* ptr = raw + alignment;
+        auto* header = new (ptr - sizeof(block_header)) block_header();
+        header->init(size, 255, false);
+        header->set_node(node);
+        header->origin = raw + lead;
+        return ptr;
+    }
+
+    /**
+     * @brief Resizes a mapped block without copying.
+     * Shrinking unmaps the tail pages. Growing uses mremap on Linux, which may move the block but
+     * never copies it, and elsewhere tries to map the pages directly behind the block.
+     * Returns nullptr when the caller has to fall back to allocate-copy-free.
+     */
+    ALWAYS_INLINE static void* resize_large(void* ptr, const size_t new_size) noexcept
+    {
+        auto* header = reinterpret_cast<block_header*>(static_cast<char*>(ptr) - sizeof(block_header));
+        char* base = large_base(ptr);
+        const size_t old_map = large_extent(ptr, header->size());
+        const size_t new_map = large_extent(ptr, new_size);
+
+        if (new_map <= old_map)
+        {
+            #if defined(YUMINA_OS_WINDOWS)
+                // VirtualFree cannot release part of a reservation; keep the recorded size
+                return ptr;
+            #else
+                if (new_map < old_map)
+                    unmap_pages(base + new_map, old_map - new_map);
+                const uint32_t node = header->node();
+                header->init(new_size, 255, false);
+                header->set_node(node);
+                return ptr;
+            #endif
+        }
+
+        #if defined(REMAP_MEMORY)
+            void* moved = REMAP_MEMORY(base, old_map, new_map);
+            if (moved == MAP_FAILED)
+                return nullptr;
+            const size_t offset = static_cast<char*>(ptr) - base;
+            note_mapped(new_map - old_map);
+            header = reinterpret_cast<block_header*>(static_cast<char*>(moved) + offset - sizeof(block_header));
+            const uint32_t node = header->node();
+            header->init(new_size, 255, false);
+            header->set_node(node);
+            header->origin = static_cast<char*>(moved);
+            return static_cast<char*>(moved) + offset;
+        #elif defined(MAP_MEMORY_AT)
+            void* want = base + old_map;
+            void* tail = MAP_MEMORY_AT(want, new_map - old_map);
+            if (tail == MAP_FAILED)
+                return nullptr;
+            if (tail != want)
+            {
+                UNMAP_MEMORY(tail, new_map - old_map);
+                return nullptr;
+            }
+            note_mapped(new_map - old_map);
+            const uint32_t node = header->node();
+            header->init(new_size, 255, false);
+            header->set_node(node);
+            return ptr;
+        #else
+            return nullptr;
+        #endif
+    }
+
+    /**
+     * @brief Returns a validated block to its pool, the thread cache, the large cache or the OS.
+     */
+    ALWAYS_INLINE static void release_block(void* ptr, block_header* header) noexcept
+    {
+        const auto size_class = header->size_class();
+        if (size_class == 255)
+        {
+            maybe_purge();
+
+            // Blocks from another node are released rather than recycled on this one
+            auto* cache = !DEBUG_ALLOC && header->node() == current_node() ? thread_large_cache() : nullptr;
+            if (cache && cache->cache_block(large_base(ptr), large_extent(ptr, header->size()), header->node(),
+                                           header->origin))
+                return;
+
+            unmap_pages(large_base(ptr), large_extent(ptr, header->size()) + GUARD_SIZE);
+            return;
+        }
+
+        if (UNLIKELY(size_class >= SIZE_CLASSES))
+            return;
+
+        // Blocks grown over several slots go straight back to their pool, and on NUMA hosts so
+        // does anything owned by another thread, which may sit on another node. A torn down thread
+        // owns no pools and never flushes its cache again, so it frees everything directly
+        if (UNLIKELY(numa_multi_node() || thread_torn_down_) && pool::of(ptr, size_class)->owner != pool_manager_)
+        {
+            free_small(ptr, size_class);
+            return;
+        }
+        if (header->size() <= size_classes[size_class].size)
+        {
+            cache_small(ptr, header, size_class);
+            return;
+        }
+
+        free_small(ptr, size_class);
+    }
+
+    #ifdef YUMINA_ALLOC_DEBUG
+        /**
+         * @brief FIFO of freed blocks that are held back from reuse.
+         * Pool blocks sit poisoned and stay allocated in their pool, in a per-thread quarantine.
+         * Large blocks have their pages made inaccessible until they are unmapped on eviction; they
+         * share one locked quarantine, so a second free from any thread finds the block there
+         * before touching its protected header.
+         */
+        struct quarantine_t
         {
-            const size_t count = bucket.count.load(std::memory_order_acquire);
-            for (size_t i = 0; i < count; ++i)
+            struct entry
             {
-                auto& entry = bucket.entries[i];
-                if (void* ptr = entry.ptr.exchange(nullptr, std::memory_order_release))
-                {
-                    const size_t total_size = entry.size + sizeof(block_header);
-                    const size_t alloc_size = total_size + PG_SIZE - 1 & ~(PG_SIZE - 1);
-                    UNMAP_MEMORY(static_cast<char*>(ptr) - sizeof(block_header), alloc_size);
-                }
-            }
-            bucket.count.store(0, std::memory_order_release);
-        }
-        total_cached.store(0, std::memory_order_release);
-    }
+                void* ptr;
+                size_t size;
+                void* site[DEBUG_SITE_DEPTH];
+                bool large;
+            };
 
-    ALWAYS_INLINE static void* alloc_tiny(const size_t size) noexcept
-    {
-        if (UNLIKELY(size == 0))
-            return nullptr;
+            entry entries[QUARANTINE_BLOCKS];
+            size_t head;
+            size_t count;
+            size_t bytes;
+        };
 
-        const uint8_t size_class = (size - 1) >> 3;
-        if (UNLIKELY(size_class >= TINY_CLASSES))
-            return nullptr;
+        thread_local quarantine_t quarantine_{};
+        static quarantine_t large_quarantine_{};
+        static std::atomic<bool> large_quarantine_lock_{false};
 
-        auto& tiny_pool = tiny_pools_[size_class];
-        if (!tiny_pool)
+        static void quarantine_evict(quarantine_t& quarantine) noexcept
         {
-            try
-            {
-                tiny_pool = new tiny_block_manager();
-            }
-            catch (...)
+            auto& [ptr, size, site, large] = quarantine.entries[quarantine.head];
+            quarantine.head = (quarantine.head + 1) % QUARANTINE_BLOCKS;
+            --quarantine.count;
+
+            if (large)
             {
-                return nullptr;
+                quarantine.bytes -= large_extent(ptr, size);
+                unmap_pages(large_base(ptr), large_extent(ptr, size) + GUARD_SIZE);
+                return;
             }
+
+            quarantine.bytes -= size;
+            auto* header = reinterpret_cast<block_header*>(static_cast<char*>(ptr) - sizeof(block_header));
+            if (find_mismatch(ptr, size, POISON_BYTE) != size)
+                debug_report("write after free", ptr, size, site);
+            release_block(ptr, header);
         }
 
-        if (void* ptr = tiny_pool->alloc_tiny(size_class))
+        static void quarantine_push(quarantine_t& quarantine, void* ptr, block_header* header) noexcept
         {
-            auto* header = new(ptr) block_header();
-            header->init(size, size_class, false);
-            return static_cast<char*>(ptr) + sizeof(block_header);
-        }
+            if (quarantine.count == QUARANTINE_BLOCKS)
+                quarantine_evict(quarantine);
 
-        return nullptr;
-    }
+            const size_t size = header->size();
+            auto& e = quarantine.entries[(quarantine.head + quarantine.count++) % QUARANTINE_BLOCKS];
+            e.ptr = ptr;
+            e.size = size;
+            std::memcpy(e.site, header->alloc_site, sizeof(e.site));
+            e.large = header->size_class() == 255;
 
-    ALWAYS_INLINE static void* alloc_small(const size_t size) noexcept
-    {
-        const uint8_t size_class = (size - 1) >> 3;
+            if (e.large)
+            {
+                const size_t extent = large_extent(ptr, size);
+                quarantine.bytes += extent;
+                guard_pages(large_base(ptr), extent);
+            }
+            else
+            {
+                quarantine.bytes += size;
+                std::memset(ptr, POISON_BYTE, size);
+                header->set_free(true);
+            }
 
-        if (void* ptr = thread_cache_.get(size_class))
-        {
-            auto* header = reinterpret_cast<block_header*>(
-                static_cast<char*>(ptr) - sizeof(block_header));
-            header->set_free(false);
-            return ptr;
+            while (quarantine.bytes > QUARANTINE_BYTES && quarantine.count > 1)
+                quarantine_evict(quarantine);
         }
 
-        if (!pool_manager_)
-            pool_manager_ = new pool_manager();
-
-        if (void* ptr = pool_manager_->alloc_pool(size_class))
+        ALWAYS_INLINE static void unlock_large_quarantine() noexcept
         {
-            auto* header = new (static_cast<char*>(ptr)) block_header();
-            header->init(size, size_class, false);
-            return static_cast<char*>(ptr) + sizeof(block_header);
+            large_quarantine_lock_.store(false, std::memory_order_release);
         }
 
-        return nullptr;
-    }
-
-    ALWAYS_INLINE static void* alloc_medium(const size_t size, const uint8_t size_class) noexcept
-    {
-        if (void* ptr = thread_cache_.get(size_class))
+        /**
+         * @brief Locks the large quarantine and reports `what` if `ptr` is in it; otherwise returns
+         * with the lock still held.
+         */
+        static void lock_large_quarantine(const void* ptr, const char* what) noexcept
         {
-            auto* header = reinterpret_cast<block_header*>(
-                static_cast<char*>(ptr) - sizeof(block_header));
-            PREFETCH_L1(header);
-            header->set_free(false);
-            return ptr;
-        }
+            while (large_quarantine_lock_.exchange(true, std::memory_order_acquire))
+                CPU_PAUSE();
 
-        if (!pool_manager_)
-            pool_manager_ = new pool_manager();
-
-        if (void* ptr = pool_manager_->alloc_pool(size_class))
-        {
-            auto* header = new (static_cast<char*>(ptr)) block_header();
-            header->init(size, size_class, false);
-            return static_cast<char*>(ptr) + sizeof(block_header);
+            for (size_t i = 0; i < large_quarantine_.count; ++i)
+            {
+                if (const auto& e = large_quarantine_.entries[(large_quarantine_.head + i) % QUARANTINE_BLOCKS];
+                    e.ptr == ptr)
+                {
+                    void* site[DEBUG_SITE_DEPTH];
+                    std::memcpy(site, e.site, sizeof(site));
+                    const size_t size = e.size;
+                    unlock_large_quarantine();
+                    debug_report(what, ptr, size, site);
+                }
+            }
         }
 
-        return nullptr;
-    }
-
-    ALWAYS_INLINE static void* alloc_large(const size_t size) noexcept
-    {
-        if (!large_block_cache_)
-            large_block_cache_ = new large_block_cache_t();
-
-        if (void* ptr = large_block_cache_->get_cached_block(size))
-            return ptr;
-
-        const size_t total_size = size + sizeof(block_header);
-        const size_t alloc_size = total_size + PG_SIZE - 1 & ~(PG_SIZE - 1);
+        /**
+         * @brief Debug deallocate: reports invalid and double frees and overruns into the block's
+         * slack, then quarantines the block.
+         * The shared large quarantine is searched, and stays locked until a large block is in it,
+         * before the header is read: a large block freed before has an inaccessible header.
+         */
+        NEVER_INLINE static void debug_free(void* ptr) noexcept
+        {
+            lock_large_quarantine(ptr, "double free");
+            auto* header = reinterpret_cast<block_header*>(static_cast<char*>(ptr) - sizeof(block_header));
+            const bool large = header->is_valid() && header->size_class() == 255;
+            if (!large)
+                unlock_large_quarantine();
 
-        void* ptr = MAP_MEMORY(alloc_size);
-        if (UNLIKELY(ptr == MAP_FAILED))
-            return nullptr;
+            if (UNLIKELY(!header->is_valid()))
+                debug_report("free of unknown pointer", ptr, 0, nullptr);
+            if (UNLIKELY(header->is_free()))
+                debug_report("double free", ptr, header->size(), header->alloc_site);
+
+            const size_t size = header->size();
+            const char* tail = static_cast<char*>(ptr) + size;
+            const auto slack = static_cast<size_t>(block_end(ptr, header) - tail);
+            if (UNLIKELY(find_mismatch(tail, slack, CANARY_BYTE) != slack))
+                debug_report("heap buffer overflow", ptr, size, header->alloc_site);
+
+            if (auto* stats = thread_stats())
+                stat_add(stats->frees[std::min<size_t>(header->size_class(), SIZE_CLASSES)]);
+            if (UNLIKELY(header->is_sampled()))
+                profile_free(ptr, header);
+
+            if (large)
+            {
+                quarantine_push(large_quarantine_, ptr, header);
+                unlock_large_quarantine();
+                return;
+            }
+            quarantine_push(quarantine_, ptr, header);
 
-        auto* header = new (ptr) block_header();
-        header->init(size, 255, false);
-        return static_cast<char*>(ptr) + sizeof(block_header);
-    }
+            // Nothing would drain a torn down thread's quarantine later
+            if (UNLIKELY(thread_torn_down_))
+            {
+                while (quarantine_.count)
+                    quarantine_evict(quarantine_);
+            }
+        }
+    #endif
 
-    [[maybe_unused]]
-    ALWAYS_INLINE static void cleanup()
+    /**
+     * @brief Releases the calling thread's heap: caches, empty pools, counters and regions.
+     * Runs from the thread's exit hook; safe to call again, and the thread may keep allocating.
+     */
+    static void cleanup() noexcept
     {
         if (large_block_cache_)
         {
+            unregister_large_cache(large_block_cache_);
             large_block_cache_->clear();
-            delete large_block_cache_;
+            destroy_heap_object(large_block_cache_);
             large_block_cache_ = nullptr;
         }
 
+        #ifdef YUMINA_ALLOC_DEBUG
+            while (quarantine_.count)
+                quarantine_evict(quarantine_);
+        #endif
+
+        // Cached blocks may belong to other threads' pools, so they go back before ours are torn down
+        for (size_t size_class = 0; size_class < SIZE_CLASSES; ++size_class)
+        {
+            if (const size_t count = thread_cache_.caches[size_class].count)
+                thread_cache_.flush(static_cast<uint8_t>(size_class), count);
+        }
+
         if (pool_manager_)
         {
-            delete pool_manager_;
+            orphan_pool_manager(pool_manager_);
             pool_manager_ = nullptr;
         }
 
-        thread_cache_.clear();
-        for (auto& pool : tiny_pools_)
+        if (thread_stats_)
         {
-            delete pool;
-            pool = nullptr;
+            while (stats_lock_.exchange(true, std::memory_order_acquire))
+                CPU_PAUSE();
+            for (thread_stats_t** link = &stats_registry_; *link; link = &(*link)->next_registered)
+            {
+                if (*link == thread_stats_)
+                {
+                    *link = thread_stats_->next_registered;
+                    break;
+                }
+            }
+            fold_stats(retired_stats_, *thread_stats_);
+            stats_lock_.store(false, std::memory_order_release);
+            thread_stats_ = nullptr;
         }
+
+        span_region_.release();
     }
 
     namespace yumina::detail::internal
     {
         void* allocate(const size_t size) noexcept
         {
-            if (UNLIKELY(size == 0 || size > 1ULL << 47))
+            if (UNLIKELY(size == 0 || size > SIZE_MASK))
                 return nullptr;
 
-            if (LIKELY(size <= TINY_LARGE_THRESHOLD))
-                return alloc_tiny(size);
-
-            if (size <= SMALL_LARGE_THRESHOLD)
-                return alloc_small(size);
-
-            if (size < LARGE_THRESHOLD)
+            if (LIKELY(size <= LARGE_THRESHOLD))
             {
-                const uint8_t size_class = 31 - __builtin_clz(size - 1);
-                return alloc_medium(size, size_class);
+                const uint8_t size_class = small_class(size);
+                return record_alloc(alloc_small(size, size_class), size, size_class);
             }
 
-            return alloc_large(size);
+            return record_alloc(alloc_large(size), size, SIZE_CLASSES);
         }
 
-        void deallocate(void* ptr) noexcept
+        void* allocate_aligned(const size_t size, const size_t alignment) noexcept
         {
-            if (UNLIKELY(!ptr))
-                return;
-
-            auto* header = reinterpret_cast<block_header*>(
-                static_cast<char*>(ptr) - sizeof(block_header));
-
-            if (UNLIKELY(!header->is_valid()))
-                return;
+            // Every block is already ALIGNMENT aligned
+            if (LIKELY(alignment <= ALIGNMENT))
+                return allocate(size);
 
-            const auto size_class = header->size_class();
+            if (UNLIKELY(size == 0 || size > SIZE_MASK || (alignment & (alignment - 1)) != 0))
+                return nullptr;
+            return record_alloc(alloc_large_aligned(size, alignment), size, SIZE_CLASSES);
+        }
 
-            if (size_class < TINY_CLASSES)
+        void deallocate_sized(void* ptr, const size_t size) noexcept
+        {
+            // The class follows from the size, so the header only has to confirm it; debug builds
+            // always take the checked path
+            if (UNLIKELY(DEBUG_ALLOC || !ptr || size == 0 || size > LARGE_THRESHOLD))
             {
-                if (auto* pool = tiny_pools_[size_class])
-                    pool->free_tiny(static_cast<char*>(ptr) - sizeof(block_header), size_class);
+                deallocate(ptr);
                 return;
             }
 
-            if (size_class == 255)
+            // A wrong size, or a block grown past its slot, leaves the header disagreeing; sampled
+            // blocks still have to leave the heap profile
+            const uint8_t size_class = small_class(size);
+            auto* header = reinterpret_cast<block_header*>(static_cast<char*>(ptr) - sizeof(block_header));
+            if (UNLIKELY(!header->is_valid() || header->size_class() != size_class ||
+                         header->size() > size_classes[size_class].size || header->is_sampled()))
             {
-                if (!large_block_cache_)
-                    large_block_cache_ = new large_block_cache_t();
-
-                if (large_block_cache_->cache_block(ptr, header->size()))
-                    return;
-
-                const size_t total_size = header->size() + sizeof(block_header);
-                const size_t alloc_size = total_size + PG_SIZE - 1 & ~(PG_SIZE - 1);
-                UNMAP_MEMORY(static_cast<char*>(ptr) - sizeof(block_header), alloc_size);
+                deallocate(ptr);
                 return;
             }
 
-            if (thread_cache_.put(ptr, size_class))
+            if (auto* stats = thread_stats())
+                stat_add(stats->frees[size_class]);
+
+            if (LIKELY(!numa_multi_node() && !thread_torn_down_) || pool::of(ptr, size_class)->owner == pool_manager_)
             {
-                header->set_free(true);
+                cache_small(ptr, header, size_class);
                 return;
             }
+            free_small(ptr, size_class);
+        }
+
+        void deallocate(void* ptr) noexcept
+        {
+            if (UNLIKELY(!ptr))
+                return;
+
+            #ifdef YUMINA_ALLOC_DEBUG
+                debug_free(ptr);
+            #else
+                auto* header = reinterpret_cast<block_header*>(
+                    static_cast<char*>(ptr) - sizeof(block_header));
+
+                if (UNLIKELY(!header->is_valid()))
+                    return;
 
-            if (pool_manager_)
-                pool_manager_->free_pool(
-                    reinterpret_cast<pool*>(
-                        reinterpret_cast<uintptr_t>(ptr) & ~(PG_SIZE - 1)),
-                    size_class);
+                if (auto* stats = thread_stats())
+                    stat_add(stats->frees[std::min<size_t>(header->size_class(), SIZE_CLASSES)]);
+                if (UNLIKELY(header->is_sampled()))
+                    profile_free(ptr, header);
+                release_block(ptr, header);
+            #endif
         }
 
         void* reallocate(void* ptr, const size_t new_size) noexcept
@@ -976,247 +2787,361 @@ namespace yumina::detail
                 return nullptr;
             }
 
-            const auto* header = reinterpret_cast<block_header*>(
+            auto* header = reinterpret_cast<block_header*>(
                 static_cast<char*>(ptr) - sizeof(block_header));
 
+            #ifdef YUMINA_ALLOC_DEBUG
+                lock_large_quarantine(ptr, "realloc after free");
+                unlock_large_quarantine();
+
+                if (UNLIKELY(!header->is_valid()))
+                    debug_report("realloc of unknown pointer", ptr, 0, nullptr);
+                if (UNLIKELY(header->is_free()))
+                    debug_report("realloc after free", ptr, header->size(), header->alloc_site);
+            #endif
             if (UNLIKELY(!header->is_valid()))
                 return nullptr;
 
+            // Resized blocks leave the profile; a moved one may be sampled again as a new block
+            if (UNLIKELY(header->is_sampled()))
+                profile_free(ptr, header);
+
             const size_t old_size = header->size();
 
-            if (const uint8_t old_class = header->size_class(); old_class < TINY_CLASSES)
+            if (const uint8_t old_class = header->size_class(); old_class < SIZE_CLASSES)
             {
-                if (new_size <= static_cast<size_t>((old_class + 1) << 3))
+                const auto& sc = size_classes[old_class];
+                const size_t have = pool::span_slots(old_size, sc);
+                if (const size_t need = pool::span_slots(new_size, sc); need <= have)
+                {
+                    // Shrinking below the span keeps the recorded size so no slot is orphaned
+                    if (need == have)
+                        header->init(new_size, old_class, false);
+                    #ifdef YUMINA_ALLOC_DEBUG
+                        debug_arm(ptr);
+                    #endif
+                    return ptr;
+                }
+
+                if (auto* p = pool::of(ptr, old_class); p->owner == pool_manager_ && pool_manager_->grow_block(p, ptr, new_size))
+                {
+                    #ifdef YUMINA_ALLOC_DEBUG
+                        debug_arm(ptr);
+                    #endif
                     return ptr;
+                }
             }
-            else if (old_class < SIZE_CLASSES)
+            else if (old_class == 255 && !DEBUG_ALLOC)
             {
-                if (new_size <= size_classes[old_class].size)
-                    return ptr;
+                if (void* resized = resize_large(ptr, new_size))
+                    return resized;
             }
 
             void* new_ptr = allocate(new_size);
             if (!new_ptr)
                 return nullptr;
 
-            const size_t copy_size = std::min(old_size, new_size);
-            #if defined(YUMINA_ARCH_X64)
-                if (copy_size >= 32)
-                {
-                    auto src = static_cast<const char*>(ptr);
-                    auto dst = static_cast<char*>(new_ptr);
+            copy_memory(new_ptr, ptr, std::min(old_size, new_size));
+
+            deallocate(ptr);
+            return new_ptr;
+        }
 
-                    #ifdef __AVX512F__
-                        // Prefetch for write to improve destination cache line handling
-                        PREFETCH_L1(dst);
-                        PREFETCH_L1(dst + 64);
+        void* callocate(const size_t num, const size_t size) noexcept
+        {
+            if (UNLIKELY(num == 0 || size == 0))
+                return nullptr;
 
-                        // Align to 64-byte boundary for optimal AVX-512 performance
-                        size_t offset = 0;
-                        size_t remaining = copy_size;
+            if (UNLIKELY(num > SIZE_MAX / size))
+                return nullptr;
 
-                        // Handle unaligned portion
-                        size_t dst_align = reinterpret_cast<uintptr_t>(dst) & 63;
-                        if (dst_align != 0)
-                        {
-                            size_t align_fix = 64 - dst_align;
-                            std::memcpy(dst, src, align_fix);
-                            offset += align_fix;
-                            remaining -= align_fix;
-                        }
+            const size_t total = num * size;
+            if (total <= LARGE_THRESHOLD)
+            {
+                void* ptr = allocate(total);
+                if (LIKELY(ptr))
+                    std::memset(ptr, 0, total);
+                return ptr;
+            }
+            if (UNLIKELY(total > SIZE_MASK))
+                return nullptr;
 
-                        for (; remaining >= 64; remaining -= 64, offset += 64)
-                        {
-                            // Prefetch next iterations
-                            PREFETCH_L1(src + offset + 128);
-                            PREFETCH_L1(dst + offset + 128);
+            // Freshly mapped pages are already zero; only blocks from the large cache need clearing
+            bool zeroed = false;
+            void* ptr = record_alloc(alloc_large(total, &zeroed), total, SIZE_CLASSES);
+            if (ptr && !zeroed)
+                zero_memory(ptr, total);
+            return ptr;
+        }
 
-                            __m512i v = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(src + offset));
-                            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + offset), v);
-                        }
+        void set_page_options(const page_options& options) noexcept
+        {
+            page_mode_.store(static_cast<uint8_t>((options.huge_pages ? PAGE_HUGE : 0) |
+                                                  (options.populate ? PAGE_POPULATE : 0)),
+                             std::memory_order_relaxed);
+        }
+
+        page_options get_page_options() noexcept
+        {
+            const uint8_t mode = page_mode();
+            return { (mode & PAGE_HUGE) != 0, (mode & PAGE_POPULATE) != 0 };
+        }
 
-                        if (remaining > 0)
-                            std::memcpy(dst + offset, src + offset, remaining);
+        void set_purge_options(const purge_options& options) noexcept
+        {
+            purge_idle_ms_.store(options.idle_ms, std::memory_order_relaxed);
+            purge_interval_ms_.store(options.interval_ms, std::memory_order_relaxed);
+            purge_budget_.store(options.budget_bytes ? options.budget_bytes : SIZE_MAX, std::memory_order_relaxed);
+        }
 
-                        MEMORY_FENCE();
+        size_t purge() noexcept
+        {
+            const uint64_t now = large_block_cache_t::get_time();
+            const uint64_t idle = purge_idle_ms_.load(std::memory_order_relaxed) * NS_PER_MS;
+            size_t budget = purge_budget_.load(std::memory_order_relaxed);
+            last_purge_ = now;
 
-                    #elif defined(__AVX2__)
-                        PREFETCH_L1(dst);
-                        PREFETCH_L1(dst + 32);
+            size_t released = 0;
+            if (large_block_cache_)
+            {
+                large_block_cache_->lock();
+                released += large_block_cache_->purge(now, idle, budget);
+                large_block_cache_->unlock();
+            }
+            released += span_region_.purge(now, idle, budget - released);
+            return released;
+        }
 
-                        size_t offset = 0;
-                        size_t remaining = copy_size;
+        void start_purge_thread() noexcept
+        {
+            auto& state = purger();
+            std::lock_guard guard(state.mutex);
+            if (state.running)
+                return;
 
-                        // Align to 32-byte boundary
-                        size_t dst_align = reinterpret_cast<uintptr_t>(dst) & 31;
-                        if (dst_align != 0)
+            state.running = true;
+            try
+            {
+                state.thread = std::thread([&state]
+                {
+                    std::unique_lock lock(state.mutex);
+                    while (state.running)
+                    {
+                        state.wake.wait_for(lock, std::chrono::milliseconds(
+                            purge_interval_ms_.load(std::memory_order_relaxed)));
+                        if (!state.running)
+                            break;
+
+                        const uint64_t now = large_block_cache_t::get_time();
+                        const uint64_t idle = purge_idle_ms_.load(std::memory_order_relaxed) * NS_PER_MS;
+                        size_t budget = purge_budget_.load(std::memory_order_relaxed);
+
+                        // Only the large caches are shared state; span lists are purged by their owners
+                        while (registry_lock_.exchange(true, std::memory_order_acquire))
+                            CPU_PAUSE();
+                        for (auto* cache = cache_registry_; cache && budget; cache = cache->next_registered)
                         {
-                            size_t align_fix = 32 - dst_align;
-                            std::memcpy(dst, src, align_fix);
-                            offset += align_fix;
-                            remaining -= align_fix;
+                            if (!cache->try_lock())
+                                continue;
+                            budget -= cache->purge(now, idle, budget);
+                            cache->unlock();
                         }
+                        registry_lock_.store(false, std::memory_order_release);
+                    }
+                });
+            }
+            catch (...)
+            {
+                state.running = false;
+            }
+        }
 
-                        // Main AVX2 copy loop
-                        for (; remaining >= 32; remaining -= 32, offset += 32)
-                        {
-                            PREFETCH_L1(src + offset + 64);
-                            PREFETCH_L1(dst + offset + 64);
+        void stop_purge_thread() noexcept
+        {
+            auto& state = purger();
+            {
+                std::lock_guard guard(state.mutex);
+                if (!state.running)
+                    return;
+                state.running = false;
+            }
+            state.wake.notify_all();
+            if (state.thread.joinable())
+                state.thread.join();
+        }
 
-                            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + offset));
-                            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + offset), v);
-                        }
+        void get_stats(alloc_stats& out) noexcept
+        {
+            thread_stats_t total{};
+            uint64_t threads = 0;
+            while (stats_lock_.exchange(true, std::memory_order_acquire))
+                CPU_PAUSE();
+            fold_stats(total, retired_stats_);
+            for (const auto* stats = stats_registry_; stats; stats = stats->next_registered, ++threads)
+                fold_stats(total, *stats);
+            stats_lock_.store(false, std::memory_order_release);
+
+            for (size_t i = 0; i <= SIZE_CLASSES; ++i)
+            {
+                out.allocs[i] = total.allocs[i].load(std::memory_order_relaxed);
+                out.frees[i] = total.frees[i].load(std::memory_order_relaxed);
+            }
+            out.cache_hits = total.cache_hits.load(std::memory_order_relaxed);
+            out.cache_misses = total.cache_misses.load(std::memory_order_relaxed);
+            out.pools = total.pools.load(std::memory_order_relaxed);
+            out.large_hits = total.large_hits.load(std::memory_order_relaxed);
+            out.large_misses = total.large_misses.load(std::memory_order_relaxed);
+            out.allocated_bytes = total.allocated_bytes.load(std::memory_order_relaxed);
+            out.mapped_bytes = mapped_bytes_.load(std::memory_order_relaxed);
+            out.peak_mapped_bytes = peak_mapped_bytes_.load(std::memory_order_relaxed);
+            out.threads = threads;
+        }
 
-                        // Handle remaining bytes
-                        if (remaining > 0)
-                            std::memcpy(dst + offset, src + offset, remaining);
+        uint64_t thread_allocated_bytes() noexcept
+        {
+            const auto* stats = thread_stats();
+            return stats ? stats->allocated_bytes.load(std::memory_order_relaxed) : 0;
+        }
 
-                        MEMORY_FENCE();
-                    #endif
-                }
-                else
-                {
-                    std::memcpy(new_ptr, ptr, copy_size);
-                }
-            #elif defined(YUMINA_ARCH_ARM64)
-                if (copy_size >= 16)
-                {
-                    auto src = static_cast<const char*>(ptr);
-                    auto dst = static_cast<char*>(new_ptr);
+        void set_trace_sampling(const uint32_t every) noexcept
+        {
+            trace_every_.store(every, std::memory_order_relaxed);
+        }
 
-                    // Prefetch destination cache lines
-                    PREFETCH_L1(dst);
-                    PREFETCH_L1(dst + 64);
+        size_t get_trace(trace_entry* out, const size_t max_entries) noexcept
+        {
+            const uint64_t head = trace_head_.load(std::memory_order_relaxed);
+            const size_t available = static_cast<size_t>(std::min<uint64_t>(head, TRACE_CAPACITY));
+            const size_t count = std::min(available, max_entries);
 
-                    size_t offset = 0;
-                    size_t remaining = copy_size;
+            // Entries still being written, skipped or already overwritten are left out
+            size_t copied = 0;
+            for (uint64_t ticket = head - count; ticket < head; ++ticket)
+            {
+                const auto& slot = trace_ring_[ticket % TRACE_CAPACITY];
+                const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+                if (sequence != 2 * ticket + 2)
+                    continue;
+
+                const trace_entry entry = {
+                    slot.timestamp.load(std::memory_order_relaxed),
+                    slot.stack_hash.load(std::memory_order_relaxed),
+                    slot.size.load(std::memory_order_relaxed),
+                    slot.size_class.load(std::memory_order_relaxed)
+                };
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+                    out[copied++] = entry;
+            }
+            return copied;
+        }
 
-                    if (size_t dst_align = reinterpret_cast<uintptr_t>(dst) & 15; dst_align != 0)
-                    {
-                        size_t align_fix = 16 - dst_align;
-                        std::memcpy(dst, src, align_fix);
-                        offset += align_fix;
-                        remaining -= align_fix;
-                    }
+        void set_heap_profile(const size_t mean_interval) noexcept
+        {
+            profile_interval_.store(mean_interval, std::memory_order_relaxed);
+        }
 
-                    // Main NEON copy loop
-                    for (; remaining >= 32; remaining -= 32, offset += 32)
-                    {
-                        // Prefetch next chunks
-                        PREFETCH_L1(src + offset + 64);
-                        PREFETCH_L1(dst + offset + 64);
-
-                        // Load and store using NEON intrinsics
-                        uint8x16_t v1 = vld1q_u8(reinterpret_cast<const uint8_t*>(src + offset));
-                        uint8x16_t v2 = vld1q_u8(reinterpret_cast<const uint8_t*>(src + offset + 16));
-                        vst1q_u8(reinterpret_cast<uint8_t*>(dst + offset), v1);
-                        vst1q_u8(reinterpret_cast<uint8_t*>(dst + offset + 16), v2);
-                    }
+        const char* set_alloc_phase(const char* phase) noexcept
+        {
+            return std::exchange(alloc_phase_, phase);
+        }
 
-                    // Handle 16-byte chunks
-                    for (; remaining >= 16; remaining -= 16, offset += 16)
-                    {
-                        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src + offset));
-                        vst1q_u8(reinterpret_cast<uint8_t*>(dst + offset), v);
-                    }
+        /**
+         * @brief Writes the heap profile as collapsed stacks ("phase;outer;...;inner bytes"), the
+         * input format of flamegraph.pl and speedscope.
+         */
+        void dump_heap_profile(FILE* out, const profile_view view) noexcept
+        {
+            // Symbolization may allocate; keep this thread's samples out of the table meanwhile
+            profile_busy_ = true;
+            lock_profile();
+            for (const auto& site : profile_sites_)
+            {
+                const double bytes = view == profile_view::live ? site.live_bytes : site.alloc_bytes;
+                if (!site.key || bytes < 1.0)
+                    continue;
 
-                    if (remaining > 0)
-                        std::memcpy(dst + offset, src + offset, remaining);
-                    MEMORY_FENCE();
-                }
-                else
+                std::fputs(site.phase ? site.phase : "untagged", out);
+                for (size_t i = site.depth; i > 0; --i)
                 {
-                    std::memcpy(new_ptr, ptr, copy_size);
+                    std::fputc(';', out);
+                    print_frame(out, site.frames[i - 1]);
                 }
-            #else
-                std::memcpy(new_ptr, ptr, copy_size);
-            #endif
-
-            deallocate(ptr);
-            return new_ptr;
+                std::fprintf(out, " %llu\n", static_cast<unsigned long long>(bytes));
+            }
+            if (profile_dropped_)
+                std::fprintf(out, "# %zu samples dropped, profile tables full\n", profile_dropped_);
+            unlock_profile();
+            profile_busy_ = false;
         }
 
-        void* callocate(const size_t num, const size_t size) noexcept
+        void dump_stats(FILE* out) noexcept
         {
-            if (UNLIKELY(num == 0 || size == 0))
-                return nullptr;
-
-            if (UNLIKELY(num > SIZE_MAX / size))
-                return nullptr;
+            alloc_stats stats{};
+            get_stats(stats);
 
-            const size_t total = num * size;
-            void* ptr = allocate(total);
+            std::fprintf(out, "yumina allocator statistics\n");
+            std::fprintf(out, "  %-8s %16s %16s\n", "class", "allocs", "frees");
+            for (size_t i = 0; i <= SIZE_CLASSES; ++i)
+            {
+                if (!stats.allocs[i] && !stats.frees[i])
+                    continue;
+                if (i == SIZE_CLASSES)
+                    std::fprintf(out, "  %-8s", "large");
+                else
+                    std::fprintf(out, "  %-8zu", i);
+                std::fprintf(out, " %16llu %16llu\n",
+                             static_cast<unsigned long long>(stats.allocs[i]),
+                             static_cast<unsigned long long>(stats.frees[i]));
+            }
 
-            if (LIKELY(ptr))
+            const uint64_t lookups = stats.cache_hits + stats.cache_misses;
+            std::fprintf(out, "  thread cache  : %llu hits, %llu misses (%.1f%% hit rate)\n",
+                         static_cast<unsigned long long>(stats.cache_hits),
+                         static_cast<unsigned long long>(stats.cache_misses),
+                         lookups ? 100.0 * static_cast<double>(stats.cache_hits) / static_cast<double>(lookups) : 0.0);
+            std::fprintf(out, "  allocated     : %llu bytes\n", static_cast<unsigned long long>(stats.allocated_bytes));
+            std::fprintf(out, "  pools         : %llu\n", static_cast<unsigned long long>(stats.pools));
+            std::fprintf(out, "  threads       : %llu\n", static_cast<unsigned long long>(stats.threads));
+            std::fprintf(out, "  large cache   : %llu hits, %llu misses\n",
+                         static_cast<unsigned long long>(stats.large_hits),
+                         static_cast<unsigned long long>(stats.large_misses));
+            std::fprintf(out, "  mapped        : %zu bytes (peak %zu bytes)\n",
+                         stats.mapped_bytes, stats.peak_mapped_bytes);
+
+            trace_entry trace[16];
+            if (const size_t count = get_trace(trace, 16))
             {
-                #if defined(YUMINA_ARCH_X64)
-                    if (total >= 32)
-                    {
-                        auto dst = static_cast<char*>(ptr);
-                        #ifdef __AVX512F__
-                            __m512i zero = _mm512_setzero_si512();
-                            for (size_t i = 0; i < total - 63; i += 64)
-                                _mm512_storeu_si512(reinterpret_cast<__m512i*>(dst + i), zero);
-                        #elif defined(__AVX2__)
-                            __m256i zero = _mm256_setzero_si256();
-                            for (size_t i = 0; i < total - 31; i += 32)
-                                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), zero);
-                        #endif
-                        std::memset(dst + (total & ~31), 0, total & 31);
-                    }
-                    else
-                    {
-                        std::memset(ptr, 0, total);
-                    }
-                #elif defined(YUMINA_ARCH_ARM64)
-                    if (total >= 16)
-                    {
-                        auto dst = static_cast<char*>(ptr);
-                        uint8x16_t zero = vdupq_n_u8(0);
-                        for (size_t i = 0; i < total - 15; i += 16)
-                            vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), zero);
-                        std::memset(dst + (total & ~15), 0, total & 15);
-                    }
-                    else
-                    {
-                        std::memset(ptr, 0, total);
-                    }
-                #else
-                    std::memset(ptr, 0, total);
-                #endif
+                std::fprintf(out, "  last sampled allocations:\n");
+                for (size_t i = 0; i < count; ++i)
+                    std::fprintf(out, "    %12zu bytes  class %3u  stack %016llx\n", trace[i].size,
+                                 trace[i].size_class, static_cast<unsigned long long>(trace[i].stack_hash));
             }
-            return ptr;
         }
 
+        size_t numa_nodes() noexcept
+        {
+            return topology().nodes;
+        }
+
+        uint32_t numa_current_node() noexcept
+        {
+            return current_node();
+        }
+
+        /**
+         * @brief Process teardown: stops the background purger and releases the calling
+         * thread's heap. Other threads release theirs from their own exit hooks.
+         */
         void cleanup() noexcept
         {
+            stop_purge_thread();
+            ::yumina::detail::cleanup();
         }
 
         void thread_cleanup() noexcept
         {
-            cleanup();
+            ::yumina::detail::cleanup();
         }
     }
 }
-
-[[nodiscard]]
-void* operator new(const size_t __sz) // NOLINT(*-reserved-identifier)
-{
-    return yumina::detail::yumina::detail::internal::allocate(__sz);
-}
-
-[[nodiscard]]
-void* operator new[](const size_t __sz) // NOLINT(*-reserved-identifier)
-{
-    return yumina::detail::yumina::detail::internal::allocate(__sz);
-}
-
-void operator delete(void* __p) noexcept // NOLINT(*-reserved-identifier)
-{
-    yumina::detail::yumina::detail::internal::deallocate(__p);
-}
-
-void operator delete[](void* __p) noexcept // NOLINT(*-reserved-identifier)
-{
-    yumina::detail::yumina::detail::internal::deallocate(__p);
-}
@@ -2,43 +2,154 @@
 #define YUMINA_INTERNAL_ALLOCATOR_H
 
 #include <array>
+#include <atomic>
 #include <cstdint>
+#include <cstdio>
 #include "arch.hpp"
 
 namespace yumina::detail
 {
     static constexpr size_t PG_SIZE = 4096;
+    static constexpr size_t HUGE_PG_SIZE = 2 * 1024 * 1024;
+    static constexpr size_t REGION_SIZE = HUGE_PG_SIZE;
     static constexpr size_t ALIGNMENT = CACHE_LINE_SIZE;
 
     static constexpr size_t TINY_LARGE_THRESHOLD = 64;
-    static constexpr size_t SMALL_LARGE_THRESHOLD = 256;
+    static constexpr size_t SMALL_LARGE_THRESHOLD = 1024;
     static constexpr size_t LARGE_THRESHOLD = 1024 * 1024;
+    static constexpr size_t MEDIUM_POOL_SIZE = 256 * 1024;
 
     static constexpr size_t MAX_CACHED_BLOCKS = 32;
     static constexpr size_t MAX_CACHE_SIZE = 64 * 1024 * 1024;
     static constexpr size_t MIN_CACHE_BLOCK = 4 * 1024;
     static constexpr size_t MAX_CACHE_BLOCK = 16 * 1024 * 1024;
-    static constexpr auto MAX_SIZE_RATIO = 1.25;
+    static constexpr size_t NT_STORE_THRESHOLD = 256 * 1024;
 
     static constexpr size_t CACHE_SIZE = 32;
-    static constexpr size_t SIZE_CLASSES = 32;
     static constexpr size_t TINY_CLASSES = 8;
-    static constexpr size_t MAX_POOLS = 8;
+    static constexpr size_t POOL_CLASSES = 4;
+    static constexpr size_t MEDIUM_CLASSES = 10;
+    static constexpr size_t SIZE_CLASSES = TINY_CLASSES + POOL_CLASSES + MEDIUM_CLASSES;
 
-    static constexpr uint64_t SIZE_MASK = 0x0000FFFFFFFFFFFF;
+    static constexpr uint64_t SIZE_MASK = 0x00007FFFFFFFFFFF;
+    static constexpr uint64_t SAMPLED_FLAG = 1ULL << 47;
     static constexpr uint64_t CLASS_MASK = 0x00FF000000000000;
     static constexpr uint64_t MMAP_FLAG = 1ULL << 62;
     static constexpr uint64_t COALESCED_FLAG = 1ULL << 61;
     static constexpr uint64_t HEADER_MAGIC = 0xDEADBEEF12345678;
-    static constexpr uint64_t MAGIC_MASK = 0xF000000000000000;
-    static constexpr uint64_t MAGIC_VALUE = 0xA000000000000000;
     static constexpr uint64_t THREAD_OWNER_MASK = 0xFFFF000000000000;
+    static constexpr uint64_t NODE_SHIFT = 56;
+    static constexpr uint64_t NODE_MASK = 0x1FULL << NODE_SHIFT;
 
+    static constexpr size_t MAX_NUMA_NODES = 32;
+    static constexpr size_t MAX_NUMA_CPUS = 1024;
+    static constexpr size_t NODE_RESERVE_REGIONS = 4;
+
+    // Debug builds (YUMINA_ALLOC_DEBUG) only
+    static constexpr size_t DEBUG_SITE_DEPTH = 4;
+    static constexpr size_t QUARANTINE_BLOCKS = 256;
+    static constexpr size_t QUARANTINE_BYTES = 16 * 1024 * 1024;
+
+    static constexpr size_t PROFILE_DEPTH = 16;
+    static constexpr size_t PROFILE_SITES = 2048;
+    static constexpr size_t PROFILE_LIVE = 16384;
+    static constexpr size_t DEFAULT_PROFILE_INTERVAL = 512 * 1024;
+
+    /**
+     * @brief Page backing policy for span regions and large blocks.
+     * huge_pages: reserve 2 MiB aligned regions and advise the kernel to back them with transparent huge pages.
+     * populate: pre-fault span regions on reservation, for arenas known to be hot.
+     */
+    struct page_options
+    {
+        bool huge_pages;
+        bool populate;
+    };
+
+    /**
+     * @brief Time-decayed release policy for cached large blocks and free spans.
+     * idle_ms: memory unused for longer than this is unmapped or decommitted.
+     * interval_ms: minimum time between two purge passes of the same thread.
+     * budget_bytes: upper bound of bytes released per pass, 0 for unlimited.
+     */
+    struct purge_options
+    {
+        uint32_t idle_ms;
+        uint32_t interval_ms;
+        size_t budget_bytes;
+    };
+
+    /**
+     * @brief Process-wide allocator counters, summed over all threads.
+     * Index SIZE_CLASSES of allocs/frees counts large (mmapped) blocks.
+     */
+    struct alloc_stats
+    {
+        uint64_t allocs[SIZE_CLASSES + 1];
+        uint64_t frees[SIZE_CLASSES + 1];
+        uint64_t cache_hits;
+        uint64_t cache_misses;
+        uint64_t pools;
+        uint64_t large_hits;
+        uint64_t large_misses;
+        uint64_t allocated_bytes;
+        size_t mapped_bytes;
+        size_t peak_mapped_bytes;
+        uint64_t threads; // threads whose counters are still registered, i.e. not yet exited
+    };
+
+    /**
+     * @brief One sampled allocation, identified by a hash of its frame pointer chain.
+     */
+    struct trace_entry
+    {
+        uint64_t timestamp;
+        uint64_t stack_hash;
+        size_t size;
+        uint8_t size_class;
+    };
+
+    /**
+     * @brief Per-thread counters. Only the owning thread writes them; readers aggregate
+     * through the registry without locking the allocation path.
+     */
+    struct alignas(CACHE_LINE_SIZE) thread_stats_t
+    {
+        std::atomic<uint64_t> allocs[SIZE_CLASSES + 1]{};
+        std::atomic<uint64_t> frees[SIZE_CLASSES + 1]{};
+        std::atomic<uint64_t> cache_hits{0};
+        std::atomic<uint64_t> cache_misses{0};
+        std::atomic<uint64_t> pools{0};
+        std::atomic<uint64_t> large_hits{0};
+        std::atomic<uint64_t> large_misses{0};
+        std::atomic<uint64_t> allocated_bytes{0};
+        uint32_t trace_countdown{0};
+        size_t profile_countdown{0};
+        uint64_t profile_rng{0};
+        thread_stats_t* next_registered{nullptr};
+    };
+
+    /**
+     * @brief What dump_heap_profile reports: everything allocated since profiling started, or
+     * what is still live.
+     */
+    enum class profile_view : uint8_t
+    {
+        allocated,
+        live
+    };
+
+    /**
+     * @brief Layout of one size class: `blocks` slots of `slot_size` bytes in a pool of `pages`
+     * pages, moved between the pools and the thread cache `batch` blocks at a time.
+     */
     struct size_class
     {
-        uint16_t size;
-        uint16_t slot_size;
+        uint32_t size;
+        uint32_t slot_size;
         uint16_t blocks;
+        uint16_t pages;
+        uint16_t batch;
         uint16_t slack;
     };
 
@@ -59,6 +170,8 @@ namespace yumina::detail
         size_class_cache caches[SIZE_CLASSES]{};
         ALWAYS_INLINE void* get(uint8_t size_class) noexcept;
         ALWAYS_INLINE bool put(void *ptr, uint8_t size_class) noexcept;
+        ALWAYS_INLINE void* refill(uint8_t size_class) noexcept;
+        ALWAYS_INLINE void flush(uint8_t size_class, size_t count) noexcept;
         ALWAYS_INLINE void clear() noexcept;
     };
 
@@ -69,7 +182,6 @@ namespace yumina::detail
         alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> words[WORDS_PER_BITMAP]{};
 
         bitmap() noexcept;
-        ALWAYS_INLINE size_t find_free_block(size_t size) noexcept;
         ALWAYS_INLINE void mark_free(size_t index) noexcept;
         ALWAYS_INLINE bool is_completely_free() const noexcept;
     };
@@ -80,12 +192,22 @@ namespace yumina::detail
         // [63]    - Free flag
         // [62]    - Memory mapped flag
         // [61]    - Coalesced flag
-        // [56-48] - Size class
-        // [47-0]  - Block size
+        // [60-56] - NUMA node (large blocks), slot index (medium blocks)
+        // [55-48] - Size class
+        // [47]    - Sampled by the heap profiler
+        // [46-0]  - Block size
         uint64_t data;
         uint64_t magic;
-        block_header* prev_physical;
+        union
+        {
+            block_header* prev_physical;
+            char* origin; // Large blocks: start of the mapping they were carved from
+        };
         block_header* next_physical;
+        #ifdef YUMINA_ALLOC_DEBUG
+            // Return addresses of the allocating call, kept in what is otherwise alignment padding
+            void* alloc_site[DEBUG_SITE_DEPTH];
+        #endif
 
         ALWAYS_INLINE void init(size_t sz, uint8_t size_class, bool is_free) noexcept;
         ALWAYS_INLINE void encode(size_t size, uint8_t size_class) noexcept;
@@ -100,101 +222,196 @@ namespace yumina::detail
         ALWAYS_INLINE bool coalesce() noexcept;
         ALWAYS_INLINE void set_coalesced(bool is_coalesced) noexcept;
         [[nodiscard]] ALWAYS_INLINE bool is_coalesced() const noexcept;
+        ALWAYS_INLINE void set_node(uint32_t node) noexcept;
+        [[nodiscard]] ALWAYS_INLINE uint32_t node() const noexcept;
+        ALWAYS_INLINE void set_slot(size_t slot) noexcept;
+        [[nodiscard]] ALWAYS_INLINE size_t slot() const noexcept;
+        ALWAYS_INLINE void set_sampled(bool sampled) noexcept;
+        [[nodiscard]] ALWAYS_INLINE bool is_sampled() const noexcept;
     };
 
+    struct pool_manager;
+
+    /**
+     * @brief Equally sized slots for one size class. Small classes fill a single page; medium
+     * classes run `memory` on over the following pages of their span.
+     * A block normally occupies one slot; reallocate() may grow it over free neighbouring slots,
+     * in which case the header size records the whole span.
+     * Only the owning thread touches the list links and `used`; other threads free through the
+     * bitmap and `remote_frees`.
+     */
     struct alignas(PG_SIZE) pool
     {
-        static constexpr size_t MIN_RETURN_SIZE = 64 * 1024;
-        static constexpr auto MEM_USAGE_THRESHOLD = 0.2;
-        bitmap bitmap;
-        uint8_t memory[PG_SIZE - sizeof(bitmap)]{};
-        ALWAYS_INLINE void* alloc(const size_class& sc) noexcept;
-        ALWAYS_INLINE void free(const void* ptr, const size_class& sc) noexcept;
-        ALWAYS_INLINE bool is_completely_free() const noexcept;
-        ALWAYS_INLINE static void return_mem() noexcept;
+        bitmap free_slots;
+        pool* next;
+        pool* prev;
+        pool_manager* owner;
+        std::atomic<uint32_t> remote_frees;
+        uint16_t used;
+        uint8_t class_index;
+        bool on_full;
+        alignas(ALIGNMENT) uint8_t memory[PG_SIZE - 2 * ALIGNMENT]{};
+
+        ALWAYS_INLINE void init(pool_manager* manager, uint8_t size_class) noexcept;
+        ALWAYS_INLINE size_t take(void** out, size_t max, const size_class& sc) noexcept;
+        ALWAYS_INLINE uint64_t release(const void* ptr, const size_class& sc, size_t& slots) noexcept;
+        ALWAYS_INLINE void free_remote(uint64_t mask, size_t slots) noexcept;
+        ALWAYS_INLINE size_t grow(void* ptr, const size_class& sc, size_t new_size) noexcept;
+        [[nodiscard]] ALWAYS_INLINE static size_t span_slots(size_t size, const size_class& sc) noexcept;
+        [[nodiscard]] ALWAYS_INLINE static pool* of(const void* ptr, uint8_t size_class) noexcept;
     };
 
-    struct tiny_block_manager
+    /**
+     * @brief Per-thread owner of the small and medium class pools.
+     * Pools with a free slot sit on `partial`, the rest on `full`; a remote free flags
+     * `remote_pending` so the owner rescans its pools only when something came back.
+     * Managers are never freed: a remote free may still be setting that flag when the owner
+     * exits, so an exited thread's manager is handed to the next new thread instead, together
+     * with the pools that still hold live blocks.
+     */
+    struct pool_manager
     {
-        struct alignas(PG_SIZE) tiny_pool
-        {
-            bitmap bitmap;
-            alignas(ALIGNMENT) uint8_t memory[PG_SIZE - sizeof(bitmap)]{};
-
-            ALWAYS_INLINE void* alloc_tiny(uint8_t size_class) noexcept;
-            ALWAYS_INLINE void free_tiny(void* ptr, uint8_t size_class) noexcept;
-        };
-        tiny_pool pool;
+        alignas(CACHE_LINE_SIZE) pool* partial[SIZE_CLASSES]{};
+        pool* full[SIZE_CLASSES]{};
+        size_t pool_count[SIZE_CLASSES]{};
+        std::atomic<bool> remote_pending[SIZE_CLASSES]{};
+        pool_manager* next_orphan{nullptr};
 
-        ALWAYS_INLINE void* alloc_tiny(uint8_t size_class) noexcept;
-        ALWAYS_INLINE void free_tiny(void* ptr, uint8_t size_class) noexcept;
+        ALWAYS_INLINE pool* alloc_pool(uint8_t size_class) noexcept;
+        ALWAYS_INLINE void free_pool(pool* p) noexcept;
+        ALWAYS_INLINE size_t refill(uint8_t size_class, void** out, size_t max) noexcept;
+        ALWAYS_INLINE void free_block(pool* p, const void* ptr) noexcept;
+        ALWAYS_INLINE void release_slots(pool* p, uint64_t mask, size_t slots) noexcept;
+        ALWAYS_INLINE bool grow_block(pool* p, void* ptr, size_t new_size) noexcept;
+        ALWAYS_INLINE void reclaim_remote(uint8_t size_class) noexcept;
+        ALWAYS_INLINE void abandon() noexcept;
     };
 
-    struct pool_manager
+    /**
+     * @brief Per-thread cache of released large block mappings, from MIN_CACHE_BLOCK up to
+     * MAX_CACHE_BLOCK bytes.
+     * Entries are kept sorted by extent in parallel arrays, with unused slots at SIZE_MAX, so the
+     * best fit is the count of smaller extents: a fixed-length compare loop that vectorizes.
+     * A larger mapping is split and its tail stays cached; the least recently used entries are
+     * unmapped to stay within MAX_CACHED_BLOCKS and MAX_CACHE_SIZE bytes.
+     */
+    struct alignas(CACHE_LINE_SIZE) large_block_cache_t
     {
-        struct pool_entry
-        {
-            pool* p;
-            size_t used_blocks;
-        };
+        alignas(CACHE_LINE_SIZE) size_t extents[MAX_CACHED_BLOCKS];
+        alignas(CACHE_LINE_SIZE) uint64_t last_use[MAX_CACHED_BLOCKS]{};
+        char* bases[MAX_CACHED_BLOCKS]{};
+        char* origins[MAX_CACHED_BLOCKS]{};
+        uint32_t nodes[MAX_CACHED_BLOCKS]{};
+        size_t count{0};
+        size_t total_cached{0};
 
-        alignas(CACHE_LINE_SIZE) pool_entry pools[SIZE_CLASSES][MAX_POOLS]{};
-        size_t pool_count[SIZE_CLASSES]{};
-        ALWAYS_INLINE pool* alloc_pool(size_t size_class) noexcept;
-        ALWAYS_INLINE void free_pool(const pool* p, size_t size_class) noexcept;
+        // Held by the owning thread and the background purger, never contended on the hot path
+        std::atomic<bool> locked{false};
+        large_block_cache_t* next_registered{nullptr};
 
-        pool_manager();
+        large_block_cache_t() noexcept;
 
-        ~pool_manager();
+        ALWAYS_INLINE static uint64_t get_time() noexcept;
+        ALWAYS_INLINE char* get_cached_block(size_t extent, uint32_t node, char*& origin) noexcept;
+        ALWAYS_INLINE bool cache_block(char* base, size_t extent, uint32_t node, char* origin) noexcept;
+        ALWAYS_INLINE size_t purge(uint64_t now, uint64_t idle, size_t budget) noexcept;
+        ALWAYS_INLINE void clear() noexcept;
+        ALWAYS_INLINE void lock() noexcept;
+        ALWAYS_INLINE bool try_lock() noexcept;
+        ALWAYS_INLINE void unlock() noexcept;
     };
 
-    struct alignas(CACHE_LINE_SIZE) large_block_cache_t
+    /**
+     * @brief Per-thread bump region that hands out page-granular spans.
+     * Pools and the per-thread heap structures are carved from REGION_SIZE reservations
+     * instead of being mapped one by one, so in huge page mode they share 2 MiB TLB entries.
+     */
+    struct alignas(CACHE_LINE_SIZE) span_region_t
     {
-        struct alignas(CACHE_LINE_SIZE) cache_entry
+        struct span_link
         {
-            std::atomic<void*> ptr{nullptr};
-            size_t size{0};
-            uint64_t last_use{0};
+            span_link* next;
+            size_t pages;
+            uint64_t freed_at;
+            bool decommitted;
         };
 
-        struct alignas(CACHE_LINE_SIZE) size_bucket
+        struct region_link
         {
-            static constexpr size_t BUCKET_SIZE = 4;
-            std::atomic<size_t> count{0};
-            cache_entry entries[BUCKET_SIZE];
+            region_link* next;
+            size_t size;
+            uint32_t node;
+            bool pinned; // holds a pool with live blocks, so release() leaves it mapped
         };
 
-        static constexpr size_t NUM_BUCKETS = 8; // 4KB to 512KB
-        alignas(CACHE_LINE_SIZE) size_bucket buckets[NUM_BUCKETS];
-        alignas(CACHE_LINE_SIZE) std::atomic<size_t> total_cached{0};
+        uint8_t* cursor;
+        uint8_t* end;
+        span_link* free_spans;
+        region_link* regions;
+        uint32_t node;
 
-        ALWAYS_INLINE static uint64_t get_time() noexcept;
-        ALWAYS_INLINE static size_t get_bucket_index(size_t size) noexcept;
-        ALWAYS_INLINE void *get_cached_block(size_t size) noexcept;
-        ALWAYS_INLINE bool cache_block(void *ptr, size_t size) noexcept;
-        ALWAYS_INLINE void clear() noexcept;
+        ALWAYS_INLINE void* alloc_span(size_t size) noexcept;
+        ALWAYS_INLINE void free_span(void* span, size_t size) noexcept;
+        ALWAYS_INLINE bool reserve(size_t pages) noexcept;
+        ALWAYS_INLINE size_t purge(uint64_t now, uint64_t idle, size_t budget) noexcept;
+        ALWAYS_INLINE void pin(const void* ptr) noexcept;
+        ALWAYS_INLINE void release() noexcept;
     };
 
     extern thread_local thread_cache_t thread_cache_;
+    extern thread_local span_region_t span_region_;
     extern thread_local pool_manager* pool_manager_;
     extern thread_local large_block_cache_t* large_block_cache_;
-    extern thread_local std::array<tiny_block_manager*, TINY_CLASSES> tiny_pools_;
-
-    ALWAYS_INLINE static void* alloc_tiny(size_t size) noexcept;
-    ALWAYS_INLINE static void* alloc_small(size_t size) noexcept;
-    ALWAYS_INLINE static void* alloc_medium(size_t size, uint8_t size_class) noexcept;
-    ALWAYS_INLINE static void* alloc_large(size_t size) noexcept;
-    ALWAYS_INLINE static void cleanup();
 
     namespace yumina::detail::internal
     {
         void* allocate(size_t size) noexcept;
+        void* allocate_aligned(size_t size, size_t alignment) noexcept;
         void deallocate(void* ptr) noexcept;
+        void deallocate_sized(void* ptr, size_t size) noexcept;
         void* reallocate(void* ptr, size_t new_size) noexcept;
         void* callocate(size_t num, size_t size) noexcept;
+        void set_page_options(const page_options& options) noexcept;
+        page_options get_page_options() noexcept;
+        void set_purge_options(const purge_options& options) noexcept;
+        size_t purge() noexcept;
+        void start_purge_thread() noexcept;
+        void stop_purge_thread() noexcept;
+        void get_stats(alloc_stats& out) noexcept;
+        uint64_t thread_allocated_bytes() noexcept;
+        void dump_stats(FILE* out) noexcept;
+        void set_trace_sampling(uint32_t every) noexcept;
+        size_t get_trace(trace_entry* out, size_t max_entries) noexcept;
+        void set_heap_profile(size_t mean_interval) noexcept;
+        const char* set_alloc_phase(const char* phase) noexcept;
+        void dump_heap_profile(FILE* out, profile_view view) noexcept;
+        size_t numa_nodes() noexcept;
+        uint32_t numa_current_node() noexcept;
         void thread_cleanup() noexcept;
         void cleanup() noexcept;
     }
+
+    /**
+     * @brief Tags the calling thread's allocations with a phase name for the heap profiler
+     * until the scope ends. `phase` must outlive the profile, e.g. a string literal.
+     */
+    struct alloc_phase
+    {
+        explicit alloc_phase(const char* phase) noexcept
+            : previous(yumina::detail::internal::set_alloc_phase(phase))
+        {
+        }
+
+        alloc_phase(const alloc_phase&) = delete;
+        alloc_phase& operator=(const alloc_phase&) = delete;
+
+        ~alloc_phase()
+        {
+            yumina::detail::internal::set_alloc_phase(previous);
+        }
+
+        const char* previous;
+    };
 }
 
 #endif
\ No newline at end of file
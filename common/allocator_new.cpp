@@ -0,0 +1,148 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <cstddef>
+#include <new>
+#include "allocator.h"
+#include "arch.hpp"
+
+// Global operator new/delete replacement. The throwing forms report failure with std::bad_alloc,
+// zero-sized requests get a distinct minimal block, and every sized or aligned form is routed here
+// so memory never mixes with the C++ runtime's allocator.
+
+namespace
+{
+    namespace alloc_api = yumina::detail::yumina::detail::internal;
+
+    ALWAYS_INLINE void* new_or_throw(const size_t size)
+    {
+        void* ptr = alloc_api::allocate(size ? size : 1);
+        if (UNLIKELY(!ptr))
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+    ALWAYS_INLINE void* new_aligned_or_throw(const size_t size, const std::align_val_t alignment)
+    {
+        void* ptr = alloc_api::allocate_aligned(size ? size : 1, static_cast<size_t>(alignment));
+        if (UNLIKELY(!ptr))
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+    ALWAYS_INLINE void delete_sized_aligned(void* ptr, const size_t size, const std::align_val_t alignment) noexcept
+    {
+        if (static_cast<size_t>(alignment) <= yumina::detail::ALIGNMENT)
+            alloc_api::deallocate_sized(ptr, size);
+        else
+            alloc_api::deallocate(ptr);
+    }
+}
+
+[[nodiscard]]
+void* operator new(const size_t __sz) // NOLINT(*-reserved-identifier)
+{
+    return new_or_throw(__sz);
+}
+
+[[nodiscard]]
+void* operator new[](const size_t __sz) // NOLINT(*-reserved-identifier)
+{
+    return new_or_throw(__sz);
+}
+
+[[nodiscard]]
+void* operator new(const size_t __sz, const std::nothrow_t&) noexcept // NOLINT(*-reserved-identifier)
+{
+    return alloc_api::allocate(__sz ? __sz : 1);
+}
+
+[[nodiscard]]
+void* operator new[](const size_t __sz, const std::nothrow_t&) noexcept // NOLINT(*-reserved-identifier)
+{
+    return alloc_api::allocate(__sz ? __sz : 1);
+}
+
+[[nodiscard]]
+void* operator new(const size_t __sz, const std::align_val_t __al) // NOLINT(*-reserved-identifier)
+{
+    return new_aligned_or_throw(__sz, __al);
+}
+
+[[nodiscard]]
+void* operator new[](const size_t __sz, const std::align_val_t __al) // NOLINT(*-reserved-identifier)
+{
+    return new_aligned_or_throw(__sz, __al);
+}
+
+[[nodiscard]]
+void* operator new(const size_t __sz, const std::align_val_t __al, const std::nothrow_t&) noexcept // NOLINT(*-reserved-identifier)
+{
+    return alloc_api::allocate_aligned(__sz ? __sz : 1, static_cast<size_t>(__al));
+}
+
+[[nodiscard]]
+void* operator new[](const size_t __sz, const std::align_val_t __al, const std::nothrow_t&) noexcept // NOLINT(*-reserved-identifier)
+{
+    return alloc_api::allocate_aligned(__sz ? __sz : 1, static_cast<size_t>(__al));
+}
+
+void operator delete(void* __p) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate(__p);
+}
+
+void operator delete[](void* __p) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate(__p);
+}
+
+void operator delete(void* __p, const size_t __sz) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate_sized(__p, __sz);
+}
+
+void operator delete[](void* __p, const size_t __sz) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate_sized(__p, __sz);
+}
+
+void operator delete(void* __p, const std::nothrow_t&) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate(__p);
+}
+
+void operator delete[](void* __p, const std::nothrow_t&) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate(__p);
+}
+
+void operator delete(void* __p, std::align_val_t) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate(__p);
+}
+
+void operator delete[](void* __p, std::align_val_t) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate(__p);
+}
+
+void operator delete(void* __p, const size_t __sz, const std::align_val_t __al) noexcept // NOLINT(*-reserved-identifier)
+{
+    delete_sized_aligned(__p, __sz, __al);
+}
+
+void operator delete[](void* __p, const size_t __sz, const std::align_val_t __al) noexcept // NOLINT(*-reserved-identifier)
+{
+    delete_sized_aligned(__p, __sz, __al);
+}
+
+void operator delete(void* __p, std::align_val_t, const std::nothrow_t&) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate(__p);
+}
+
+void operator delete[](void* __p, std::align_val_t, const std::nothrow_t&) noexcept // NOLINT(*-reserved-identifier)
+{
+    alloc_api::deallocate(__p);
+}
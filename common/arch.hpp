@@ -101,28 +101,27 @@
 
     /**
      * @brief Checks if AVX2 instructions are supported on the current CPU.
+     * Both the CPU and the OS (YMM state saved on context switch) have to agree.
      *
      * @return True if AVX2 is supported, false otherwise.
      */
     #ifdef __GNUC__
-        #include <cpuid.h>
         [[gnu::always_inline]] inline static bool cpu_has_avx2()
         {
-            unsigned int eax, ebx, ecx, edx;
-            __get_cpuid(7, &eax, &ebx, &ecx, &edx);
-            return (ebx & bit_AVX2) != 0;
+            // Callers may run before static constructors, so the feature table is filled here
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
         }
 
         /**
-         * @brief Checks if AVX512F instructions are supported on the current CPU.
+         * @brief Checks if AVX512F instructions are supported on the current CPU and enabled by the OS.
          *
          * @return True if AVX512F is supported, false otherwise.
          */
         [[gnu::always_inline]] inline static bool cpu_has_avx512f()
         {
-            unsigned int eax, ebx, ecx, edx;
-            __get_cpuid(7, &eax, &ebx, &ecx, &edx);
-            return (ebx & bit_AVX512F) != 0;
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f");
         }
     #elif defined(_MSC_VER)
         /**
@@ -133,7 +132,11 @@
         [[gnu::always_inline]] inline static bool cpu_has_avx2()
         {
             int cpuInfo[4];
-            __cpuid(cpuInfo, 7);
+            __cpuid(cpuInfo, 1);
+            // OSXSAVE, then XCR0 must enable the SSE and AVX state
+            if (!(cpuInfo[2] & (1 << 27)) || (_xgetbv(0) & 0x6) != 0x6)
+                return false;
+            __cpuidex(cpuInfo, 7, 0);
             return (cpuInfo[1] & (1 << 5)) != 0;
         }
 
@@ -145,11 +148,29 @@
         [[gnu::always_inline]] inline static bool cpu_has_avx512f()
         {
             int cpuInfo[4];
-            __cpuid(cpuInfo, 7);
+            __cpuid(cpuInfo, 1);
+            // Opmask and both halves of the ZMM state have to be enabled as well
+            if (!(cpuInfo[2] & (1 << 27)) || (_xgetbv(0) & 0xE6) != 0xE6)
+                return false;
+            __cpuidex(cpuInfo, 7, 0);
             return (cpuInfo[1] & (1 << 16)) != 0;
         }
     #endif
 
+    /**
+     * @def TARGET_AVX2
+     * @def TARGET_AVX512
+     * Compile a single function for a newer ISA than the rest of the build. Such functions may
+     * only be reached after the matching cpu_has_* check, usually through a dispatch pointer.
+     */
+    #if defined(__GNUC__) || defined(__clang__)
+        #define TARGET_AVX2 __attribute__((target("avx2")))
+        #define TARGET_AVX512 __attribute__((target("avx512f")))
+    #else
+        #define TARGET_AVX2
+        #define TARGET_AVX512
+    #endif
+
     // SIMD Operation Definitions for x64
     #ifdef __AVX512F__
         #define SIMD_WIDTH 64
@@ -0,0 +1,296 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "binary.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include "arch.hpp"
+#include "hash.hpp"
+
+#if defined(YUMINA_OS_LINUX) || defined(YUMINA_OS_MACOS)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define YU_BINARY_MMAP
+#endif
+
+namespace yu::binary
+{
+    namespace
+    {
+        constexpr bool little_endian_host()
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return false;
+#else
+            return true;
+#endif
+        }
+
+        constexpr uint64_t align_section(const uint64_t offset)
+        {
+            return (offset + SECTION_ALIGNMENT - 1) & ~static_cast<uint64_t>(SECTION_ALIGNMENT - 1);
+        }
+
+        uint64_t table_checksum(file_header_t header, const section_entry_t* table)
+        {
+            header.table_checksum = 0;
+            const uint64_t seed = hash64(&header, sizeof(header));
+            return hash64(table, header.section_count * sizeof(section_entry_t), seed);
+        }
+    }
+
+    void writer::add(const uint32_t tag, const void* data, const size_t size, const uint32_t element_size)
+    {
+        pending_t section{tag, element_size, {}};
+        section.bytes.resize(size);
+        if (size)
+            std::memcpy(section.bytes.data(), data, size);
+        sections.push_back(std::move(section));
+    }
+
+    std::vector<unsigned char> writer::image() const
+    {
+        const uint64_t table_end = sizeof(file_header_t) + sections.size() * sizeof(section_entry_t);
+
+        std::vector<section_entry_t> table(sections.size());
+        uint64_t offset = align_section(table_end);
+        for (size_t i = 0; i < sections.size(); ++i)
+        {
+            const auto& section = sections[i];
+            table[i].tag = section.tag;
+            table[i].element_size = section.element_size;
+            table[i].offset = offset;
+            table[i].size = section.bytes.size();
+            table[i].checksum = hash64(section.bytes.data(), section.bytes.size());
+            offset = align_section(offset + section.bytes.size());
+        }
+
+        file_header_t header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version_major = VERSION_MAJOR;
+        header.version_minor = VERSION_MINOR;
+        header.header_size = sizeof(file_header_t);
+        header.section_count = static_cast<uint32_t>(sections.size());
+        header.file_size = sections.empty() ? table_end : table.back().offset + table.back().size;
+        header.table_checksum = table_checksum(header, table.data());
+
+        std::vector<unsigned char> out(header.file_size, 0);
+        std::memcpy(out.data(), &header, sizeof(header));
+        if (!table.empty())
+            std::memcpy(out.data() + sizeof(header), table.data(), table.size() * sizeof(section_entry_t));
+        for (size_t i = 0; i < sections.size(); ++i)
+        {
+            if (!sections[i].bytes.empty())
+                std::memcpy(out.data() + table[i].offset, sections[i].bytes.data(), sections[i].bytes.size());
+        }
+        return out;
+    }
+
+    bool writer::write(const std::string& path) const
+    {
+        namespace fs = std::filesystem;
+
+        const std::vector<unsigned char> out = image();
+        const fs::path target(path);
+        std::error_code ec;
+        if (target.has_parent_path())
+        {
+            fs::create_directories(target.parent_path(), ec);
+            if (ec)
+                return false;
+        }
+
+        // Unique per writer, so two processes storing the same container never share a temporary
+        static std::atomic<uint64_t> sequence{std::random_device{}()};
+        fs::path temporary = target;
+        temporary += "." + std::to_string(sequence.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+            if (!file.flush())
+            {
+                file.close();
+                fs::remove(temporary, ec);
+                return false;
+            }
+        }
+
+        fs::rename(temporary, target, ec);
+        if (ec)
+        {
+            fs::remove(temporary, ec);
+            return false;
+        }
+        return true;
+    }
+
+    reader::~reader()
+    {
+        close();
+    }
+
+    void reader::close()
+    {
+#ifdef YU_BINARY_MMAP
+        if (mapped && bytes)
+            munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+        bytes = nullptr;
+        length = 0;
+        mapped = false;
+        heap_copy.clear();
+        table = nullptr;
+        table_size = 0;
+    }
+
+    bool reader::open(const std::string& path, const bool verify)
+    {
+        close();
+        last_error = "cannot read file";
+
+#ifdef YU_BINARY_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info{};
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED)
+            {
+                bytes = static_cast<const unsigned char*>(view);
+                length = static_cast<size_t>(info.st_size);
+                mapped = true;
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        // operator new only guarantees 16-byte alignment, so over-allocate and align the view
+        const auto size = static_cast<size_t>(file.tellg());
+        heap_copy.resize(size + SECTION_ALIGNMENT);
+        auto* aligned = reinterpret_cast<unsigned char*>(
+            align_section(reinterpret_cast<uintptr_t>(heap_copy.data())));
+        file.seekg(0);
+        if (file.read(reinterpret_cast<char*>(aligned), static_cast<std::streamsize>(size)))
+        {
+            bytes = aligned;
+            length = size;
+        }
+#endif
+        if (!bytes)
+            return false;
+        if (!validate(verify))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool reader::open_memory(const void* data, const size_t size, const bool verify)
+    {
+        close();
+        if (reinterpret_cast<uintptr_t>(data) % SECTION_ALIGNMENT != 0)
+        {
+            last_error = "buffer is not section aligned";
+            return false;
+        }
+        bytes = static_cast<const unsigned char*>(data);
+        length = size;
+        if (!validate(verify))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool reader::validate(const bool verify)
+    {
+        if (!little_endian_host())
+        {
+            last_error = "containers are little-endian and this host is not";
+            return false;
+        }
+        if (length < sizeof(file_header_t))
+        {
+            last_error = "truncated header";
+            return false;
+        }
+
+        file_header_t header{};
+        std::memcpy(&header, bytes, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            last_error = "not a yu binary container";
+            return false;
+        }
+        if (header.version_major != VERSION_MAJOR || header.header_size != sizeof(file_header_t))
+        {
+            last_error = "unsupported container version";
+            return false;
+        }
+        if (header.file_size != length)
+        {
+            last_error = "file size does not match the header";
+            return false;
+        }
+        if (header.section_count > (length - sizeof(file_header_t)) / sizeof(section_entry_t))
+        {
+            last_error = "section table exceeds the file";
+            return false;
+        }
+
+        const auto* entries = reinterpret_cast<const section_entry_t*>(bytes + sizeof(file_header_t));
+        if (table_checksum(header, entries) != header.table_checksum)
+        {
+            last_error = "header checksum mismatch";
+            return false;
+        }
+
+        for (uint32_t i = 0; i < header.section_count; ++i)
+        {
+            const section_entry_t& entry = entries[i];
+            if (entry.offset % SECTION_ALIGNMENT != 0 || entry.offset > length || entry.size > length - entry.offset)
+            {
+                last_error = "section outside the file";
+                return false;
+            }
+            if (entry.element_size == 0)
+            {
+                last_error = "section with zero element size";
+                return false;
+            }
+            if (verify && hash64(bytes + entry.offset, entry.size) != entry.checksum)
+            {
+                last_error = "section checksum mismatch";
+                return false;
+            }
+        }
+
+        table = entries;
+        table_size = header.section_count;
+        last_error = nullptr;
+        return true;
+    }
+
+    const section_entry_t* reader::find(const uint32_t tag) const
+    {
+        for (uint32_t i = 0; i < table_size; ++i)
+        {
+            if (table[i].tag == tag)
+                return &table[i];
+        }
+        return nullptr;
+    }
+}
@@ -0,0 +1,162 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_BINARY_H
+#define YU_BINARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace yu::binary
+{
+    /**
+     * Container layout, all integers little-endian:
+     *
+     *   file_header_t                  64 bytes
+     *   section_entry_t[section_count] 32 bytes each
+     *   payloads                       each at a SECTION_ALIGNMENT aligned offset
+     *
+     * A reader maps the file and hands out pointers into the payloads, so arrays of
+     * trivially copyable elements are used in place. Readers accept any minor version of
+     * the major version they know; a new major version means an incompatible layout.
+     */
+    static constexpr char MAGIC[8] = { 'Y', 'U', 'B', 'I', 'N', 0, 0, 0 };
+    static constexpr uint16_t VERSION_MAJOR = 1;
+    static constexpr uint16_t VERSION_MINOR = 0;
+    static constexpr size_t SECTION_ALIGNMENT = 64;
+
+    struct file_header_t
+    {
+        char magic[8];
+        uint16_t version_major;
+        uint16_t version_minor;
+        uint32_t header_size;      // sizeof(file_header_t)
+        uint32_t section_count;
+        uint32_t reserved;
+        uint64_t file_size;
+        uint64_t table_checksum;   // hash64 of the header with this field zeroed, then the section table
+        uint8_t padding[24];
+    };
+
+    struct section_entry_t
+    {
+        uint32_t tag;              // make_tag() four-character code
+        uint32_t element_size;     // size of one array element, 1 for raw bytes
+        uint64_t offset;           // from the start of the file
+        uint64_t size;             // in bytes
+        uint64_t checksum;         // hash64 of the payload
+    };
+
+    static_assert(sizeof(file_header_t) == 64);
+    static_assert(sizeof(section_entry_t) == 32);
+
+    constexpr uint32_t make_tag(const char a, const char b, const char c, const char d)
+    {
+        return static_cast<uint32_t>(static_cast<uint8_t>(a)) |
+               static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8 |
+               static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16 |
+               static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24;
+    }
+
+    /**
+     * @brief Collects sections and writes them out as one container.
+     */
+    class writer
+    {
+    public:
+        /**
+         * @brief Copies `size` bytes as the section `tag`. A tag may appear only once.
+         */
+        void add(uint32_t tag, const void* data, size_t size, uint32_t element_size = 1);
+
+        template<typename T>
+        void add_array(const uint32_t tag, const std::vector<T>& values)
+        {
+            add(tag, values.data(), values.size() * sizeof(T), sizeof(T));
+        }
+
+        /**
+         * @brief The complete container as it would be written.
+         */
+        [[nodiscard]] std::vector<unsigned char> image() const;
+
+        /**
+         * @brief Writes to a temporary file next to `path` and renames it into place, so readers
+         * never observe a partial container. Creates missing parent directories.
+         */
+        bool write(const std::string& path) const;
+
+    private:
+        struct pending_t
+        {
+            uint32_t tag;
+            uint32_t element_size;
+            std::vector<unsigned char> bytes;
+        };
+
+        std::vector<pending_t> sections;
+    };
+
+    /**
+     * @brief Read-only view of a container. Memory-mapped on Linux and macOS, read into the
+     * heap elsewhere; pointers it returns stay valid for its lifetime.
+     */
+    class reader
+    {
+    public:
+        reader() = default;
+        ~reader();
+
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        /**
+         * @brief Maps `path` and validates the header and section table.
+         * @param verify Also checksum every payload (one pass over the file).
+         * @return False with error() describing why.
+         */
+        bool open(const std::string& path, bool verify = true);
+
+        /**
+         * @brief Validates an in-memory container instead of a file. The bytes must stay alive
+         * and SECTION_ALIGNMENT aligned while the reader is used.
+         */
+        bool open_memory(const void* data, size_t size, bool verify = true);
+
+        [[nodiscard]] const char* error() const { return last_error; }
+
+        [[nodiscard]] const section_entry_t* find(uint32_t tag) const;
+
+        /**
+         * @brief The payload of `tag` as an array of T.
+         * @param count Set to the element count, 0 if missing.
+         * @return nullptr if the section is missing or was not written as an array of T.
+         */
+        template<typename T>
+        const T* array(const uint32_t tag, size_t& count) const
+        {
+            count = 0;
+            const section_entry_t* entry = find(tag);
+            if (!entry || entry->element_size != sizeof(T) || entry->size % sizeof(T) != 0)
+                return nullptr;
+            count = entry->size / sizeof(T);
+            return reinterpret_cast<const T*>(bytes + entry->offset);
+        }
+
+    private:
+        bool validate(bool verify);
+        void close();
+
+        const unsigned char* bytes{nullptr};
+        size_t length{0};
+        bool mapped{false};
+        std::vector<unsigned char> heap_copy;
+        const section_entry_t* table{nullptr};
+        uint32_t table_size{0};
+        const char* last_error{"not opened"};
+    };
+}
+
+#endif
@@ -0,0 +1,114 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#ifndef YU_HASH_HPP
+#define YU_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "arch.hpp"
+
+namespace yu
+{
+    namespace hash_detail
+    {
+        static constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+        static constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+        static constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+        static constexpr uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+        static constexpr uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+        ALWAYS_INLINE
+        uint64_t rotl(const uint64_t x, const int r) noexcept
+        {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        ALWAYS_INLINE
+        uint64_t read64(const unsigned char* p) noexcept
+        {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        ALWAYS_INLINE
+        uint32_t read32(const unsigned char* p) noexcept
+        {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        ALWAYS_INLINE
+        uint64_t round(uint64_t acc, const uint64_t input) noexcept
+        {
+            acc += input * PRIME_2;
+            return rotl(acc, 31) * PRIME_1;
+        }
+
+        ALWAYS_INLINE
+        uint64_t merge(const uint64_t acc, const uint64_t lane) noexcept
+        {
+            return (acc ^ round(0, lane)) * PRIME_1 + PRIME_4;
+        }
+    }
+
+    /**
+     * @brief 64-bit content hash, bit-compatible with XXH64 (little-endian hosts).
+     * The body runs four independent multiply-rotate lanes over 32-byte stripes, so the loop
+     * keeps four multipliers busy and vectorizes where 64-bit lane multiplies exist (AVX-512).
+     * Not cryptographic; meant for cache keys and change detection.
+     */
+    inline uint64_t hash64(const void* data, const size_t length, const uint64_t seed = 0) noexcept
+    {
+        using namespace hash_detail;
+
+        const auto* p = static_cast<const unsigned char*>(data);
+        const unsigned char* const end = p + length;
+        uint64_t h;
+
+        if (length >= 32)
+        {
+            uint64_t lanes[4] = { seed + PRIME_1 + PRIME_2, seed + PRIME_2, seed, seed - PRIME_1 };
+            const unsigned char* const limit = end - 32;
+            do
+            {
+                for (size_t i = 0; i < 4; ++i)
+                    lanes[i] = round(lanes[i], read64(p + i * 8));
+                p += 32;
+            } while (p <= limit);
+
+            h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+            for (const uint64_t lane : lanes)
+                h = merge(h, lane);
+        }
+        else
+        {
+            h = seed + PRIME_5;
+        }
+
+        h += static_cast<uint64_t>(length);
+        for (; p + 8 <= end; p += 8)
+            h = rotl(h ^ round(0, read64(p)), 27) * PRIME_1 + PRIME_4;
+        if (p + 4 <= end)
+        {
+            h = rotl(h ^ static_cast<uint64_t>(read32(p)) * PRIME_1, 23) * PRIME_2 + PRIME_3;
+            p += 4;
+        }
+        for (; p < end; ++p)
+            h = rotl(h ^ *p * PRIME_5, 11) * PRIME_1;
+
+        h ^= h >> 33;
+        h *= PRIME_2;
+        h ^= h >> 29;
+        h *= PRIME_3;
+        h ^= h >> 32;
+        return h;
+    }
+}
+
+#endif
@@ -0,0 +1,234 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#ifndef YUMINA_REGION_HPP
+#define YUMINA_REGION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include "allocator.h"
+#include "arch.hpp"
+
+namespace yumina
+{
+    /**
+     * @brief Phase-scoped bump allocator.
+     * Memory comes in chunks from the yumina heap (chunks start at 64 KiB and double up to 4 MiB,
+     * so they are mapped blocks served from the large block cache) and is handed out by bumping a
+     * cursor. Nothing is freed individually: rewind() drops everything allocated after a mark and
+     * reset() drops everything, both in time proportional to the number of chunks, not objects.
+     *
+     * A region is not thread-safe. Destructors of objects placed in it are never run.
+     */
+    class region
+    {
+    public:
+        static constexpr size_t MIN_CHUNK = 64 * 1024;
+        static constexpr size_t MAX_CHUNK = 4 * 1024 * 1024;
+
+        struct mark_t
+        {
+            void* chunk;
+            uint8_t* cursor;
+        };
+
+        explicit region(const size_t first_chunk = MIN_CHUNK) noexcept
+            : next_chunk(first_chunk < MIN_CHUNK ? MIN_CHUNK : first_chunk)
+        {
+        }
+
+        region(const region&) = delete;
+        region& operator=(const region&) = delete;
+
+        region(region&& other) noexcept
+            : head(std::exchange(other.head, nullptr)),
+              cursor(std::exchange(other.cursor, nullptr)),
+              limit(std::exchange(other.limit, nullptr)),
+              next_chunk(other.next_chunk),
+              reserved(std::exchange(other.reserved, 0))
+        {
+        }
+
+        ~region()
+        {
+            release_until(nullptr);
+        }
+
+        ALWAYS_INLINE HOT_FUNCTION
+        void* allocate(const size_t size, const size_t alignment = alignof(std::max_align_t)) noexcept
+        {
+            auto* aligned = reinterpret_cast<uint8_t*>(
+                (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(alignment - 1));
+            // Compared as a remaining length, since aligned + size may wrap for huge sizes
+            if (LIKELY(cursor && aligned <= limit && size <= static_cast<size_t>(limit - aligned)))
+            {
+                cursor = aligned + size;
+                return aligned;
+            }
+            return allocate_slow(size, alignment);
+        }
+
+        /**
+         * @brief Gives back the most recent allocation; anything else is left for rewind/reset.
+         * Lets a growing region_allocator vector reuse its old buffer's space.
+         */
+        ALWAYS_INLINE void deallocate(void* ptr, const size_t size) noexcept
+        {
+            if (static_cast<uint8_t*>(ptr) + size == cursor)
+                cursor = static_cast<uint8_t*>(ptr);
+        }
+
+        template<typename T, typename... Args>
+        ALWAYS_INLINE T* create(Args&&... args)
+        {
+            void* memory = allocate(sizeof(T), alignof(T));
+            if (UNLIKELY(!memory))
+                throw std::bad_alloc();
+            return new(memory) T(std::forward<Args>(args)...);
+        }
+
+        [[nodiscard]] ALWAYS_INLINE mark_t mark() const noexcept
+        {
+            return { head, cursor };
+        }
+
+        /**
+         * @brief Frees every chunk opened after `m` and moves the cursor back to it.
+         */
+        void rewind(const mark_t m) noexcept
+        {
+            release_until(static_cast<chunk*>(m.chunk));
+            cursor = m.cursor;
+            limit = head ? head->end() : nullptr;
+        }
+
+        /**
+         * @brief Drops all allocations, keeping only the newest (largest) chunk for reuse.
+         */
+        void reset() noexcept
+        {
+            if (!head)
+                return;
+            chunk* keep = head;
+            head = head->prev;
+            release_until(nullptr);
+            keep->prev = nullptr;
+            head = keep;
+            reserved = keep->size;
+            cursor = keep->begin();
+            limit = keep->end();
+        }
+
+        [[nodiscard]] size_t bytes_reserved() const noexcept
+        {
+            return reserved;
+        }
+
+    private:
+        struct chunk
+        {
+            chunk* prev;
+            size_t size;
+
+            uint8_t* begin() noexcept
+            {
+                return reinterpret_cast<uint8_t*>(this + 1);
+            }
+
+            uint8_t* end() noexcept
+            {
+                return reinterpret_cast<uint8_t*>(this) + size;
+            }
+        };
+
+        NEVER_INLINE void* allocate_slow(const size_t size, const size_t alignment) noexcept
+        {
+            if (UNLIKELY(size > SIZE_MAX - sizeof(chunk) - alignment))
+                return nullptr;
+
+            // Oversized requests get a chunk of their own; the doubling schedule is unaffected
+            const size_t needed = sizeof(chunk) + size + alignment;
+            const size_t chunk_size = needed > next_chunk ? needed : next_chunk;
+            if (next_chunk < MAX_CHUNK)
+                next_chunk *= 2;
+
+            auto* fresh = static_cast<chunk*>(detail::yumina::detail::internal::allocate(chunk_size));
+            if (UNLIKELY(!fresh))
+                return nullptr;
+            fresh->prev = head;
+            fresh->size = chunk_size;
+            head = fresh;
+            reserved += chunk_size;
+            cursor = fresh->begin();
+            limit = fresh->end();
+            return allocate(size, alignment);
+        }
+
+        void release_until(const chunk* stop) noexcept
+        {
+            while (head && head != stop)
+            {
+                chunk* prev = head->prev;
+                reserved -= head->size;
+                detail::yumina::detail::internal::deallocate(head);
+                head = prev;
+            }
+        }
+
+        chunk* head{nullptr};
+        uint8_t* cursor{nullptr};
+        uint8_t* limit{nullptr};
+        size_t next_chunk;
+        size_t reserved{0};
+    };
+
+    /**
+     * @brief STL allocator over a region, e.g. std::vector<T, region_allocator<T>>.
+     * deallocate only reclaims the region's most recent allocation.
+     */
+    template<typename T>
+    struct region_allocator
+    {
+        using value_type = T;
+
+        region* arena;
+
+        explicit region_allocator(region& r) noexcept : arena(&r) {}
+
+        template<typename U>
+        region_allocator(const region_allocator<U>& other) noexcept : arena(other.arena) {}
+
+        T* allocate(const size_t n)
+        {
+            if (UNLIKELY(n > SIZE_MAX / sizeof(T)))
+                throw std::bad_alloc();
+            void* memory = arena->allocate(n * sizeof(T), alignof(T));
+            if (UNLIKELY(!memory))
+                throw std::bad_alloc();
+            return static_cast<T*>(memory);
+        }
+
+        void deallocate(T* ptr, const size_t n) noexcept
+        {
+            arena->deallocate(ptr, n * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const region_allocator<U>& other) const noexcept
+        {
+            return arena == other.arena;
+        }
+
+        template<typename U>
+        bool operator!=(const region_allocator<U>& other) const noexcept
+        {
+            return arena != other.arena;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,401 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include "allocator.h"
+#include "arch.hpp"
+
+#ifdef YUMINA_OS_LINUX
+    #include <cerrno>
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace yu::trace
+{
+    namespace
+    {
+        std::atomic<bool> enabled_{false};
+        std::atomic<bool> hardware_{false};
+        std::atomic<int64_t> epoch_ns_{0};
+        std::atomic<uint32_t> next_thread_{0};
+        std::atomic<const char*> hw_error_{"hardware counters were not requested"};
+
+        std::mutex records_mutex_;
+        std::vector<span_record_t> records_;
+
+        thread_local uint32_t thread_id_ = UINT32_MAX;
+        thread_local uint32_t open_spans_ = 0;
+
+        int64_t steady_ns() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        uint64_t now_ns() noexcept
+        {
+            return static_cast<uint64_t>(steady_ns() - epoch_ns_.load(std::memory_order_relaxed));
+        }
+
+        uint32_t thread_id() noexcept
+        {
+            if (UNLIKELY(thread_id_ == UINT32_MAX))
+                thread_id_ = next_thread_.fetch_add(1, std::memory_order_relaxed);
+            return thread_id_;
+        }
+
+#ifdef YUMINA_OS_LINUX
+        /**
+         * @brief The calling thread's counter group: cycles leads, instructions and cache misses
+         * follow and are optional, since virtual machines often lack the latter.
+         */
+        struct perf_group_t
+        {
+            int fds[3]{-1, -1, -1};
+            bool opened{false};
+
+            ~perf_group_t()
+            {
+                for (const int fd : fds)
+                {
+                    if (fd >= 0)
+                        close(fd);
+                }
+            }
+
+            static int open_counter(const uint64_t config, const int group) noexcept
+            {
+                perf_event_attr attr{};
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = config;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP;
+                return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+            }
+
+            bool open() noexcept
+            {
+                if (opened)
+                    return fds[0] >= 0;
+                opened = true;
+
+                fds[0] = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+                if (fds[0] < 0)
+                {
+                    hw_error_.store(errno == EACCES || errno == EPERM
+                                        ? "perf_event_open denied, see /proc/sys/kernel/perf_event_paranoid"
+                                        : "perf_event_open has no hardware cycle counter here",
+                                    std::memory_order_relaxed);
+                    return false;
+                }
+                fds[1] = open_counter(PERF_COUNT_HW_INSTRUCTIONS, fds[0]);
+                fds[2] = open_counter(PERF_COUNT_HW_CACHE_MISSES, fds[0]);
+                hw_error_.store(nullptr, std::memory_order_relaxed);
+                return true;
+            }
+
+            bool read_counters(hw_counters_t& out) noexcept
+            {
+                if (!open())
+                    return false;
+
+                // PERF_FORMAT_GROUP: the member count, then one value per member in open order
+                uint64_t values[4]{};
+                if (::read(fds[0], values, sizeof(values)) < static_cast<ssize_t>(2 * sizeof(uint64_t)))
+                    return false;
+
+                uint64_t* next = values + 1;
+                out.cycles = *next++;
+                out.instructions = fds[1] >= 0 ? *next++ : 0;
+                out.cache_misses = fds[2] >= 0 ? *next : 0;
+                return true;
+            }
+        };
+
+        thread_local perf_group_t perf_group_;
+
+        bool read_hw(hw_counters_t& out) noexcept
+        {
+            return perf_group_.read_counters(out);
+        }
+#else
+        bool read_hw(hw_counters_t&) noexcept
+        {
+            hw_error_.store("hardware counters are only read on Linux", std::memory_order_relaxed);
+            return false;
+        }
+#endif
+
+        // With the C++ runtime's heap behind operator new the yumina counter never moves, and a
+        // zero would read as "no allocations"
+#ifdef YUMINA_GLOBAL_ALLOC
+        constexpr bool COUNTS_ALLOCS = true;
+#else
+        constexpr bool COUNTS_ALLOCS = false;
+#endif
+
+        uint64_t alloc_bytes() noexcept
+        {
+            return yumina::detail::yumina::detail::internal::thread_allocated_bytes();
+        }
+
+        void write_json_string(FILE* out, const char* text)
+        {
+            std::fputc('"', out);
+            for (const char* c = text; *c; ++c)
+            {
+                const auto ch = static_cast<unsigned char>(*c);
+                if (ch == '"' || ch == '\\')
+                    std::fprintf(out, "\\%c", ch);
+                else if (ch < 0x20)
+                    std::fprintf(out, "\\u%04x", ch);
+                else
+                    std::fputc(ch, out);
+            }
+            std::fputc('"', out);
+        }
+    }
+
+    void enable(const bool hardware_counters) noexcept
+    {
+        {
+            std::lock_guard lock(records_mutex_);
+            records_.clear();
+        }
+        epoch_ns_.store(steady_ns(), std::memory_order_relaxed);
+        hardware_.store(hardware_counters, std::memory_order_relaxed);
+        if (hardware_counters)
+            hw_error_.store("no span has read the hardware counters yet", std::memory_order_relaxed);
+        enabled_.store(true, std::memory_order_release);
+    }
+
+    bool enabled() noexcept
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    const char* hardware_counters_error() noexcept
+    {
+        return hw_error_.load(std::memory_order_relaxed);
+    }
+
+    span::span(const char* name, const char* detail) noexcept
+        : name(name), detail(detail), active(enabled())
+    {
+        if (!active)
+            return;
+
+        depth = open_spans_++;
+        alloc_start = alloc_bytes();
+        if (hardware_.load(std::memory_order_relaxed))
+            has_hw = read_hw(hw_start);
+        start_ns = now_ns();
+    }
+
+    void span::stop() noexcept
+    {
+        if (!active || stopped)
+            return;
+        stopped = true;
+
+        end_ns = now_ns();
+        if (has_hw)
+            has_hw = read_hw(hw_end);
+        alloc_end = alloc_bytes();
+    }
+
+    span::~span()
+    {
+        if (!active)
+            return;
+        stop();
+        --open_spans_;
+
+        span_record_t record{};
+        record.name = name;
+        record.thread = thread_id();
+        record.depth = depth;
+        record.start_ns = start_ns;
+        record.duration_ns = end_ns - start_ns;
+        record.bytes = bytes;
+        record.tokens = tokens;
+        record.nodes = nodes;
+        record.alloc_bytes = alloc_end - alloc_start;
+        record.has_alloc = COUNTS_ALLOCS;
+        record.has_hw = has_hw;
+        if (has_hw)
+        {
+            record.hw.cycles = hw_end.cycles - hw_start.cycles;
+            record.hw.instructions = hw_end.instructions - hw_start.instructions;
+            record.hw.cache_misses = hw_end.cache_misses - hw_start.cache_misses;
+        }
+
+        std::lock_guard lock(records_mutex_);
+        records_.push_back(std::move(record));
+        if (detail)
+            records_.back().detail = detail;
+    }
+
+    std::vector<span_record_t> records()
+    {
+        std::lock_guard lock(records_mutex_);
+        return records_;
+    }
+
+    void write_report(FILE* out)
+    {
+        struct phase_t
+        {
+            const char* name;
+            uint64_t first_start;
+            uint64_t calls;
+            uint64_t ns;
+            uint64_t bytes;
+            uint64_t tokens;
+            uint64_t nodes;
+            uint64_t alloc_bytes;
+            hw_counters_t hw;
+            bool has_hw;
+            bool has_alloc;
+        };
+
+        const std::vector<span_record_t> spans = records();
+        std::vector<phase_t> phases;
+        uint64_t top_level_ns = 0, first = UINT64_MAX, last = 0;
+        uint32_t threads = 0;
+        for (const auto& record : spans)
+        {
+            auto it = std::find_if(phases.begin(), phases.end(),
+                                   [&](const phase_t& phase) { return std::strcmp(phase.name, record.name) == 0; });
+            if (it == phases.end())
+                it = phases.insert(phases.end(), phase_t{record.name, record.start_ns, 0, 0, 0, 0, 0, 0, {}, false, false});
+
+            it->first_start = std::min(it->first_start, record.start_ns);
+            ++it->calls;
+            it->ns += record.duration_ns;
+            it->bytes += record.bytes;
+            it->tokens += record.tokens;
+            it->nodes += record.nodes;
+            it->alloc_bytes += record.alloc_bytes;
+            it->has_alloc |= record.has_alloc;
+            if (record.has_hw)
+            {
+                it->has_hw = true;
+                it->hw.cycles += record.hw.cycles;
+                it->hw.instructions += record.hw.instructions;
+                it->hw.cache_misses += record.hw.cache_misses;
+            }
+
+            if (record.depth == 0)
+                top_level_ns += record.duration_ns;
+            first = std::min(first, record.start_ns);
+            last = std::max(last, record.start_ns + record.duration_ns);
+            threads = std::max(threads, record.thread + 1);
+        }
+        std::stable_sort(phases.begin(), phases.end(),
+                         [](const phase_t& a, const phase_t& b) { return a.first_start < b.first_start; });
+
+        std::fprintf(out, "===%s===\n", std::string(108, '-').c_str());
+        std::fprintf(out, "  Phase timing: %zu spans on %u threads, %.3f ms wall\n", spans.size(), threads,
+                     spans.empty() ? 0.0 : static_cast<double>(last - first) / 1e6);
+        std::fprintf(out, "===%s===\n", std::string(108, '-').c_str());
+        std::fprintf(out, "  %-16s %8s %12s %7s %10s %12s %10s %12s %12s %6s %12s\n", "phase", "calls", "time ms",
+                     "%", "MiB/s", "tokens", "nodes", "alloc KiB", "Mcycles", "IPC", "cache miss");
+
+        for (const auto& phase : phases)
+        {
+            const double ms = static_cast<double>(phase.ns) / 1e6;
+            std::fprintf(out, "  %-16s %8llu %12.3f %6.1f%%", phase.name,
+                         static_cast<unsigned long long>(phase.calls), ms,
+                         top_level_ns ? 100.0 * static_cast<double>(phase.ns) / static_cast<double>(top_level_ns) : 0.0);
+            if (phase.bytes && phase.ns)
+                std::fprintf(out, " %10.1f", static_cast<double>(phase.bytes) / (1024.0 * 1024.0) / (ms / 1000.0));
+            else
+                std::fprintf(out, " %10s", "-");
+            std::fprintf(out, " %12llu %10llu", static_cast<unsigned long long>(phase.tokens),
+                         static_cast<unsigned long long>(phase.nodes));
+            if (phase.has_alloc)
+                std::fprintf(out, " %12.1f", static_cast<double>(phase.alloc_bytes) / 1024.0);
+            else
+                std::fprintf(out, " %12s", "-");
+            if (phase.has_hw)
+                std::fprintf(out, " %12.3f %6.2f %12llu\n", static_cast<double>(phase.hw.cycles) / 1e6,
+                             phase.hw.cycles
+                                 ? static_cast<double>(phase.hw.instructions) / static_cast<double>(phase.hw.cycles)
+                                 : 0.0,
+                             static_cast<unsigned long long>(phase.hw.cache_misses));
+            else
+                std::fprintf(out, " %12s %6s %12s\n", "-", "-", "-");
+        }
+
+        if (hardware_.load(std::memory_order_relaxed))
+        {
+            if (const char* error = hardware_counters_error())
+                std::fprintf(out, "  hardware counters unavailable: %s\n", error);
+        }
+        std::fflush(out);
+    }
+
+    bool write_chrome_trace(const std::string& path)
+    {
+        FILE* out = std::fopen(path.c_str(), "w");
+        if (!out)
+            return false;
+
+        const std::vector<span_record_t> spans = records();
+        uint32_t threads = 0;
+        for (const auto& record : spans)
+            threads = std::max(threads, record.thread + 1);
+
+        std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        for (uint32_t thread = 0; thread < threads; ++thread)
+        {
+            std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                         "\"args\":{\"name\":\"thread %u\"}}", first ? "" : ",\n", thread, thread);
+            first = false;
+        }
+        for (const auto& record : spans)
+        {
+            std::fprintf(out, "%s{\"name\":", first ? "" : ",\n");
+            first = false;
+            write_json_string(out, record.name);
+            std::fprintf(out, ",\"cat\":\"yu\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                         record.thread, static_cast<double>(record.start_ns) / 1e3,
+                         static_cast<double>(record.duration_ns) / 1e3);
+            if (!record.detail.empty())
+            {
+                std::fprintf(out, "\"detail\":");
+                write_json_string(out, record.detail.c_str());
+                std::fputc(',', out);
+            }
+            std::fprintf(out, "\"bytes\":%llu,\"tokens\":%llu,\"nodes\":%llu",
+                         static_cast<unsigned long long>(record.bytes), static_cast<unsigned long long>(record.tokens),
+                         static_cast<unsigned long long>(record.nodes));
+            if (record.has_alloc)
+                std::fprintf(out, ",\"alloc_bytes\":%llu", static_cast<unsigned long long>(record.alloc_bytes));
+            if (record.has_hw)
+            {
+                std::fprintf(out, ",\"cycles\":%llu,\"instructions\":%llu,\"cache_misses\":%llu",
+                             static_cast<unsigned long long>(record.hw.cycles),
+                             static_cast<unsigned long long>(record.hw.instructions),
+                             static_cast<unsigned long long>(record.hw.cache_misses));
+            }
+            std::fprintf(out, "}}");
+        }
+        std::fprintf(out, "\n]}\n");
+
+        const bool ok = !std::ferror(out);
+        return std::fclose(out) == 0 && ok;
+    }
+}
@@ -0,0 +1,118 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_TRACE_H
+#define YU_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace yu::trace
+{
+    /**
+     * @brief Hardware counters read through perf_event_open, user space only.
+     * Zero when the counters are unavailable (not Linux, or denied by perf_event_paranoid).
+     */
+    struct hw_counters_t
+    {
+        uint64_t cycles;
+        uint64_t instructions;
+        uint64_t cache_misses;
+    };
+
+    /**
+     * @brief One finished span. Times are nanoseconds since enable().
+     */
+    struct span_record_t
+    {
+        const char* name;
+        std::string detail;    // e.g. the file being processed, may be empty
+        uint32_t thread;       // dense id in order of each thread's first span
+        uint32_t depth;        // spans open on the same thread when this one began
+        uint64_t start_ns;
+        uint64_t duration_ns;
+        uint64_t bytes;        // input bytes consumed
+        uint64_t tokens;
+        uint64_t nodes;
+        uint64_t alloc_bytes;  // bytes requested from the yumina allocator on this thread
+        hw_counters_t hw;
+        bool has_hw;
+        bool has_alloc;        // alloc_bytes is only counted when yumina is the global allocator
+    };
+
+    /**
+     * @brief Starts collecting spans and resets the clock. Spans created while disabled
+     * cost one relaxed load.
+     * @param hardware_counters Also read cycles, instructions and cache misses per span.
+     */
+    void enable(bool hardware_counters) noexcept;
+    [[nodiscard]] bool enabled() noexcept;
+
+    /**
+     * @brief Why hardware counters are missing from the records, or nullptr if they were read.
+     */
+    [[nodiscard]] const char* hardware_counters_error() noexcept;
+
+    /**
+     * @brief Times a scope on the calling thread. The counters may be filled in at any point
+     * before the span is destroyed, including after stop().
+     */
+    class span
+    {
+    public:
+        /**
+         * @param name Phase name. Must outlive the trace, e.g. a string literal.
+         * @param detail Copied when the span is recorded, so it only has to outlive the span.
+         */
+        explicit span(const char* name, const char* detail = nullptr) noexcept;
+        ~span();
+
+        span(const span&) = delete;
+        span& operator=(const span&) = delete;
+
+        /**
+         * @brief Ends the timed region early, so work done only to fill in the counters
+         * is not charged to the phase.
+         */
+        void stop() noexcept;
+
+        uint64_t bytes{0};
+        uint64_t tokens{0};
+        uint64_t nodes{0};
+
+    private:
+        const char* name;
+        const char* detail;
+        bool active;
+        bool stopped{false};
+        uint32_t depth{0};
+        uint64_t start_ns{0};
+        uint64_t end_ns{0};
+        uint64_t alloc_start{0};
+        uint64_t alloc_end{0};
+        hw_counters_t hw_start{};
+        hw_counters_t hw_end{};
+        bool has_hw{false};
+    };
+
+    /**
+     * @brief Copy of every span recorded since enable(), in completion order.
+     */
+    [[nodiscard]] std::vector<span_record_t> records();
+
+    /**
+     * @brief Prints one row per phase name, in order of first appearance, with totals and
+     * derived rates (MiB/s, IPC).
+     */
+    void write_report(FILE* out);
+
+    /**
+     * @brief Writes the spans as Chrome trace event JSON, loadable in chrome://tracing or Perfetto.
+     * @return False if the file could not be written.
+     */
+    bool write_chrome_trace(const std::string& path);
+}
+
+#endif
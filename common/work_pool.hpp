@@ -0,0 +1,180 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#ifndef YU_WORK_POOL_HPP
+#define YU_WORK_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "arch.hpp"
+
+namespace yu
+{
+    /**
+     * @brief Fixed set of worker threads with one task deque each.
+     * A worker pops its own deque from the back (newest first, still warm in cache) and, once it
+     * runs dry, steals from the front of the others (oldest first, usually the largest pieces
+     * of remaining work). Tasks submitted from outside are dealt round-robin; tasks submitted
+     * from inside a task go to the submitting worker's own deque.
+     *
+     * Tasks must not throw.
+     */
+    class work_pool
+    {
+    public:
+        using task_t = std::function<void()>;
+
+        explicit work_pool(size_t threads = 0)
+        {
+            if (threads == 0)
+                threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+            queues.reserve(threads);
+            for (size_t i = 0; i < threads; ++i)
+                queues.push_back(std::make_unique<queue_t>());
+            workers.reserve(threads);
+            for (size_t i = 0; i < threads; ++i)
+                workers.emplace_back([this, i] { run(i); });
+        }
+
+        work_pool(const work_pool&) = delete;
+        work_pool& operator=(const work_pool&) = delete;
+
+        ~work_pool()
+        {
+            wait();
+            {
+                std::lock_guard lock(sleep_mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        [[nodiscard]] size_t size() const noexcept
+        {
+            return workers.size();
+        }
+
+        void submit(task_t task)
+        {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            const size_t target = current_pool == this
+                                      ? current_index
+                                      : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+            {
+                std::lock_guard lock(queues[target]->mutex);
+                queues[target]->tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard lock(sleep_mutex);
+                ++queued;
+            }
+            wake.notify_one();
+        }
+
+        /**
+         * @brief Blocks until every submitted task, including ones submitted by tasks, has run.
+         * Must not be called from a worker.
+         */
+        void wait()
+        {
+            std::unique_lock lock(sleep_mutex);
+            done.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+        }
+
+    private:
+        struct queue_t
+        {
+            std::mutex mutex;
+            std::deque<task_t> tasks;
+        };
+
+        bool pop_local(const size_t index, task_t& task)
+        {
+            auto& queue = *queues[index];
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty())
+                return false;
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+
+        bool steal(const size_t thief, task_t& task)
+        {
+            for (size_t offset = 1; offset < queues.size(); ++offset)
+            {
+                auto& queue = *queues[(thief + offset) % queues.size()];
+                std::lock_guard lock(queue.mutex);
+                if (queue.tasks.empty())
+                    continue;
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+            return false;
+        }
+
+        void run(const size_t index)
+        {
+            current_pool = this;
+            current_index = index;
+
+            task_t task;
+            while (true)
+            {
+                if (pop_local(index, task) || steal(index, task))
+                {
+                    {
+                        std::lock_guard lock(sleep_mutex);
+                        --queued;
+                    }
+                    task();
+                    task = nullptr;
+                    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        std::lock_guard lock(sleep_mutex);
+                        done.notify_all();
+                    }
+                    continue;
+                }
+
+                // `queued` only changes under the sleep mutex, so a submit cannot slip in
+                // between the check and the wait
+                std::unique_lock lock(sleep_mutex);
+                wake.wait(lock, [this] { return stopping || queued > 0; });
+                if (stopping && queued == 0)
+                    return;
+            }
+        }
+
+        std::vector<std::unique_ptr<queue_t>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> pending{0};
+        std::atomic<size_t> next_queue{0};
+
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        size_t queued{0};
+        bool stopping{false};
+
+        static inline thread_local const work_pool* current_pool = nullptr;
+        static inline thread_local size_t current_index = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,77 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_LAYOUT_H
+#define YU_LAYOUT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sema.h"
+
+namespace yu::frontend
+{
+    struct field_layout_t
+    {
+        uint32_t member;  // index into semantic_model::members
+        uint32_t offset;
+        uint32_t size;
+        uint32_t align;
+        uint32_t padding; // bytes inserted before the field
+    };
+
+    /**
+     * @brief One array of a struct-of-arrays class: a scalar field, or a scalar inside a field
+     * of class type, which is flattened into its own columns.
+     */
+    struct soa_column_t
+    {
+        std::string path; // "position.x"
+        uint32_t type;    // a builtin
+        uint32_t offset;  // of the value within an array-of-structs element
+        uint32_t size;
+    };
+
+    struct class_layout_t
+    {
+        uint32_t type;
+        uint32_t size{0};
+        uint32_t align{1};
+        uint32_t padding{0};      // all padding, including the tail
+        uint32_t tail_padding{0}; // bytes after the last field, up to the size
+        std::vector<field_layout_t> fields;
+        std::vector<soa_column_t> columns; // @soa classes, in field order
+        std::string incomplete;   // why there is no layout, empty when there is one
+    };
+
+    struct module_layout
+    {
+        std::vector<class_layout_t> classes; // in declaration order
+        std::vector<std::string> errors;
+    };
+
+    /**
+     * @brief Lays out the fields of every non-generic class a module declares, in declaration
+     * order: each field goes at the next offset that is a multiple of its alignment, and the
+     * size is rounded up to the class alignment. Classes held by value are laid out first.
+     * `@packed` drops the natural alignment of a class's fields to 1; `@alignas(N)` raises that
+     * of a field or a class to N. `@soa` classes also get the columns a collection of them is
+     * split into; the layout of a single object stays as it is.
+     *
+     * Classes with a field of generic type are left without a layout and say why.
+     * @param model A model that analyze() filled in without errors.
+     * @param layout Reset, then filled in.
+     * @return False if a class contains itself by value.
+     */
+    bool compute_layouts(const semantic_model &model, module_layout &layout);
+
+    /**
+     * @brief A report of one class layout: its fields with their offsets and the padding
+     * between them, how much of the object is padding, and which 64-byte cache lines each
+     * field lands on, taking the object to start on a cache line boundary. For `@soa` classes,
+     * it compares the cache lines a loop reading one column touches in either form.
+     */
+    std::string format_layout(const semantic_model &model, const class_layout_t &layout);
+}
+
+#endif
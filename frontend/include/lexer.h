@@ -20,6 +20,12 @@ namespace yu::frontend
         DONE        // Finished template, back to normal
     };
 
+    /**
+     * @brief Version of what tokenize() produces: the token_i numbering, token flags and line
+     * starts. Bump it with any change to these so token caches written by an older lexer miss.
+     */
+    static constexpr uint32_t LEXER_VERSION = 1;
+
     /**
      * @brief The lexer class.
      */
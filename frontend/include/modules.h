@@ -0,0 +1,86 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_MODULES_H
+#define YU_MODULES_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../../common/work_pool.hpp"
+#include "lexer.h"
+#include "parser.h"
+#include "sema.h"
+
+namespace yu::frontend
+{
+    /**
+     * @brief One source file of a program.
+     */
+    struct module_t
+    {
+        std::string path;               // canonical, the identity of the module
+        std::string source;
+        Lexer lexer;
+        ir_node *tree{nullptr};         // NODE_MODULE: its imports, then its classes once parsed
+        uint32_t body_pos{0};           // first token after the imports
+        std::vector<uint32_t> imports;  // modules this one imports, in statement order
+        std::vector<uint32_t> importers;
+        semantic_model semantics;       // filled in once the module is checked; its errors are not in `error`
+        std::string error;              // empty while the module is usable
+        uint32_t line{0};               // position of the error, 0 when unknown
+        uint32_t column{0};
+
+        module_t() = default;
+        module_t(const module_t &) = delete;
+        module_t &operator=(const module_t &) = delete;
+        ~module_t() { destroy_node(tree); }
+    };
+
+    /**
+     * @brief The modules reachable from a set of roots and the imports between them.
+     * Indices are stable once load_modules() returns; modules are sorted by path.
+     */
+    struct module_graph
+    {
+        std::vector<std::unique_ptr<module_t>> modules;
+        std::vector<uint32_t> roots;
+        std::vector<uint32_t> order; // imports before importers; modules on or behind a cycle are left out
+    };
+
+    struct module_options
+    {
+        std::vector<std::string> search_paths; // tried after the importing module's directory
+
+        /**
+         * @brief Reads module.path into module.source and tokenizes it into module.lexer.
+         * Returns false with module.error set on failure. Runs on pool workers. When empty, the
+         * file is read and lexed without a cache.
+         */
+        std::function<bool(module_t &)> load;
+    };
+
+    /**
+     * @brief Discovers every module reachable from `roots`, loading and parsing the imports of
+     * each exactly once on `pool`; newly found imports are scheduled as soon as they are seen.
+     * Import paths are resolved against the importing module's directory, then the search
+     * paths, with ".yu" appended when they have no extension.
+     * @param roots Files to start from.
+     * @param pool Must be idle and must not be the calling thread's pool.
+     * @param graph Filled in; modules that failed to load or sit on an import cycle carry an error.
+     * @return False if any module carries an error.
+     */
+    bool load_modules(const std::vector<std::string> &roots, const module_options &options, work_pool &pool,
+                      module_graph &graph);
+
+    /**
+     * @brief Runs `task` once for each module in graph.order, each only after it has run for
+     * every module the module imports. Independent modules run in parallel, and the longest
+     * chains of importers are started first.
+     */
+    void schedule_topological(module_graph &graph, work_pool &pool, const std::function<void(module_t &)> &task);
+}
+
+#endif
@@ -24,9 +24,15 @@ namespace yu::frontend
         {
             uint32_t pos: 24;
             uint32_t in_error: 1;
-            uint32_t depth: 7;
+            uint32_t had_error: 1; // set with in_error, but kept after recovery
+            uint32_t depth: 6;
         } state{};
 
+        // Syntax error positions: the furthest token matched up to, which backtracking leaves in
+        // place, and where the first error was found
+        uint32_t furthest{};
+        uint32_t error_pos{};
+
         std::vector<ir_node *> scope_stack;
     };
 
@@ -45,12 +51,32 @@ namespace yu::frontend
         NODE_BINARY_OP,
         NODE_UNARY_OP,
         NODE_LITERAL,
-        NODE_IDENTIFIER
+        NODE_IDENTIFIER,
+        NODE_IMPORT,     // value: module path, children: imported names
+        NODE_MODULE,     // children: imports, then classes
+        NODE_ASSIGN,     // children: target, value; `==` is a NODE_BINARY_OP on EQUAL
+        NODE_MEMBER,     // value: member name, children: object
+        NODE_CALL,       // children: callee, then arguments
+        NODE_ANNOTATION  // value: name without the `@`, children: arguments; first children of classes and members
+    };
+
+    /**
+     * @brief Which member of ir_node::value is set.
+     */
+    enum class value_i : uint8_t
+    {
+        NONE,
+        STRING, // str_val, owned by the node
+        NUMBER, // num_val
+        BOOL,   // bool_val
+        OP      // op_val, a lang::token_i
     };
 
     struct ir_node
     {
         ir_t type;
+        value_i value_kind{value_i::NONE};
+        uint32_t resolved_type{0}; // type id from semantic analysis, 0 (the error type) until then
         std::vector<ir_node *> children;
 
         union
@@ -94,6 +120,9 @@ namespace yu::frontend
     HOT_FUNCTION
     bt::status_i parse_unary(parse_context *ctx);
 
+    HOT_FUNCTION
+    bt::status_i parse_postfix(parse_context *ctx);
+
     HOT_FUNCTION
     bt::status_i parse_primary(parse_context *ctx);
 
@@ -107,6 +136,9 @@ namespace yu::frontend
     HOT_FUNCTION
     bt::status_i parse_variable(parse_context *ctx);
 
+    HOT_FUNCTION
+    bt::status_i parse_parameter(parse_context *ctx);
+
     HOT_FUNCTION
     bt::status_i parse_if_statement(parse_context *ctx);
 
@@ -139,6 +171,13 @@ namespace yu::frontend
     HOT_FUNCTION
     bt::status_i parse_class_member(parse_context *ctx);
 
+    HOT_FUNCTION
+    bt::status_i parse_annotation(parse_context *ctx);
+
+    // Module parsing functions
+    HOT_FUNCTION
+    bt::status_i parse_import(parse_context *ctx);
+
     // Core parsing functions
     HOT_FUNCTION
     bt::status_i match_token(parse_context *ctx, lang::token_i type);
@@ -158,16 +197,38 @@ namespace yu::frontend
 
     std::unique_ptr<ir_node> parse(const char *src, const lang::TokenList *tokens);
 
+    /**
+     * @brief Parses the import statements at the top of a module, so its dependencies are
+     * known before the rest of it is parsed.
+     * @param src The source the tokens were lexed from.
+     * @param tokens The tokens of the whole module.
+     * @param body_pos Set to the first token after the imports.
+     * @return A NODE_MODULE holding one NODE_IMPORT per statement, nullptr on a malformed import.
+     * Release with destroy_node().
+    */
+    ir_node *parse_imports(const char *src, const lang::TokenList *tokens, uint32_t &body_pos);
+
+    /**
+     * @brief Parses the classes that follow the imports, appending them to `module`.
+     * @param body_pos The position parse_imports() stopped at.
+     * @param module The node parse_imports() returned.
+     * @param error_pos If not null, set on a syntax error to the index of the token it was found at.
+     * @return False on a syntax error; classes parsed before it stay in `module`.
+    */
+    bool parse_module_body(const char *src, const lang::TokenList *tokens, uint32_t body_pos, ir_node *module,
+                           uint32_t *error_pos = nullptr);
+
     HOT_FUNCTION
     parse_context *create_parse_context(const lang::TokenList *tokens);
 
     HOT_FUNCTION
     void destroy_parse_context(parse_context *ctx);
 
-#if defined(YUMINA_ARCH_X64)
-    ALWAYS_INLINE HOT_FUNCTION
-        bool token_compare(lang::token_i current, const lang::token_i* types, size_t count);
-#elif defined(YUMINA_ARCH_ARM64)
+#if defined(YUMINA_ARCH_X64) || defined(YUMINA_ARCH_ARM64)
+    /**
+     * @brief Whether `current` is one of `types`. On x64 the kernel is chosen on first use
+     * from the CPU's features (SSE2 or AVX2).
+     */
     HOT_FUNCTION
     bool token_compare(lang::token_i current, const lang::token_i *types, size_t count);
 #endif
@@ -0,0 +1,189 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_SEMA_H
+#define YU_SEMA_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "parser.h"
+
+namespace yu::frontend
+{
+    /**
+     * @brief Gives each distinct name a dense id. The table holds only (hash, id) pairs, so a
+     * probe stays within a cache line or two; the text itself lives in one arena.
+     */
+    class interner
+    {
+    public:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        uint32_t intern(std::string_view text);
+
+        /**
+         * @brief The id of `text`, or NONE if it was never interned.
+         */
+        [[nodiscard]] uint32_t find(std::string_view text) const;
+
+        [[nodiscard]] std::string_view view(uint32_t id) const;
+
+        [[nodiscard]] uint32_t size() const { return static_cast<uint32_t>(offsets.size() - 1); }
+
+    private:
+        struct slot_t
+        {
+            uint32_t hash;
+            uint32_t id; // NONE while the slot is empty
+        };
+
+        std::vector<slot_t> slots;
+        std::vector<char> text;
+        std::vector<uint32_t> offsets{0};
+
+        [[nodiscard]] size_t probe(std::string_view name, uint32_t hash) const;
+        void grow();
+    };
+
+    /**
+     * @brief Open-addressing map from 64-bit keys to 32-bit values with linear probing.
+     * Entries are never removed; storing NONE retires one.
+     */
+    class flat_map
+    {
+    public:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        [[nodiscard]] uint32_t find(uint64_t key) const;
+        void set(uint64_t key, uint32_t value);
+
+    private:
+        static constexpr uint64_t EMPTY = UINT64_MAX;
+
+        struct slot_t
+        {
+            uint64_t key; // EMPTY while the slot is unused
+            uint32_t value;
+        };
+
+        std::vector<slot_t> slots;
+        size_t used{0};
+
+        void grow();
+    };
+
+    enum class type_kind_i : uint8_t
+    {
+        ERROR,   // stands in for anything already reported, so it is not reported again
+        VOID,
+        BOOL,
+        INT,
+        FLOAT,
+        STRING,
+        POINTER,
+        LITERAL, // a numeric literal that has not met a concrete type yet
+        CLASS,
+        GENERIC  // a type parameter of a class
+    };
+
+    /**
+     * @brief Ids of the builtin types. Every model starts with these; imported classes follow,
+     * then the module's own, each class directly followed by its type parameters.
+     */
+    namespace types
+    {
+        enum : uint32_t
+        {
+            ERROR,
+            VOID,
+            BOOL,
+            I8,
+            U8,
+            I16,
+            U16,
+            I32,
+            U32,
+            I64,
+            U64,
+            F32,
+            F64,
+            STRING,
+            PTR,           // Ptr<T>; the pointee is not tracked
+            INT_LITERAL,   // converts to any numeric type
+            FLOAT_LITERAL, // converts to f32 and f64
+            BUILTIN_COUNT
+        };
+    }
+
+    struct semantic_model;
+
+    struct type_info_t
+    {
+        type_kind_i kind;
+        uint8_t bits{0};                      // width of numeric types
+        bool is_signed{false};
+        uint32_t name{interner::NONE};        // classes and type parameters
+        uint32_t first_member{0};             // classes: their range of semantic_model::members
+        uint32_t member_count{0};
+        uint32_t generic_count{0};            // classes: parameters at the ids right after the class
+        uint32_t alignment{0};                // classes: from @alignas, 0 for the natural alignment
+        bool packed{false};                   // classes: @packed
+        bool soa{false};                      // classes: @soa, collections of them are stored by column
+        const semantic_model *origin{nullptr}; // classes: the model of the module that declares them
+        uint32_t origin_type{0};              // and their id there
+    };
+
+    struct member_t
+    {
+        uint32_t name;
+        uint32_t type;           // field type, or method return type
+        uint32_t first_param{0}; // methods: their range of semantic_model::params
+        uint32_t param_count{0};
+        uint32_t alignment{0};   // fields: from @alignas, 0 for the natural alignment
+        bool is_method{false};
+    };
+
+    /**
+     * @brief What analyze() learned about one module. It holds no pointers into the tree, so
+     * it outlives the tree and is what the module's importers are checked against.
+     */
+    struct semantic_model
+    {
+        interner names;
+        std::vector<type_info_t> types;
+        std::vector<member_t> members;  // grouped by class
+        std::vector<uint32_t> params;   // parameter types, grouped by method
+        flat_map classes;               // name -> type of every class visible in the module
+        flat_map member_index;          // class type << 32 | name -> member
+        std::vector<std::string> errors;
+
+        /**
+         * @brief The class named `name`, types::ERROR for a failed import, or interner::NONE.
+         */
+        [[nodiscard]] uint32_t find_class(std::string_view name) const;
+
+        [[nodiscard]] const member_t *find_member(uint32_t type, std::string_view name) const;
+
+        [[nodiscard]] std::string type_name(uint32_t type) const;
+    };
+
+    /**
+     * @brief Resolves names and checks types over a parsed module: classes, their fields and
+     * methods, and the statements and expressions in method bodies. Every expression and type
+     * node gets its ir_node::resolved_type. Layout annotations are validated and recorded on
+     * the types and members they apply to.
+     *
+     * Scopes are a stack of binding counts over one flat binding array, with a flat_map from
+     * name id to the innermost binding, so entering and leaving a scope never allocates.
+     * @param module A NODE_MODULE after parse_module_body().
+     * @param model Reset, then filled in; errors are collected rather than stopping the pass.
+     * @param imports The models of the modules named by the module's NODE_IMPORT children, in
+     * the same order; a null entry is an import that failed and is not reported again.
+     * @return False if any error was found.
+     */
+    bool analyze(ir_node *module, semantic_model &model, const std::vector<const semantic_model *> &imports = {});
+}
+
+#endif
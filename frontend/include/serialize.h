@@ -0,0 +1,130 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_SERIALIZE_H
+#define YU_SERIALIZE_H
+
+#include <cstdint>
+#include <string_view>
+#include "../../common/binary.h"
+#include "lexer.h"
+#include "parser.h"
+
+namespace yu::frontend
+{
+    /**
+     * @brief Section tags of token and parse tree containers.
+     */
+    namespace section
+    {
+        static constexpr uint32_t SOURCE = binary::make_tag('S', 'R', 'C', ' ');
+        static constexpr uint32_t TOKEN_STARTS = binary::make_tag('T', 'S', 'T', 'A');
+        static constexpr uint32_t TOKEN_LENGTHS = binary::make_tag('T', 'L', 'E', 'N');
+        static constexpr uint32_t TOKEN_TYPES = binary::make_tag('T', 'T', 'Y', 'P');
+        static constexpr uint32_t TOKEN_FLAGS = binary::make_tag('T', 'F', 'L', 'G');
+        static constexpr uint32_t LINE_STARTS = binary::make_tag('L', 'I', 'N', 'E');
+        static constexpr uint32_t AST_TYPES = binary::make_tag('A', 'T', 'Y', 'P');
+        static constexpr uint32_t AST_KINDS = binary::make_tag('A', 'K', 'N', 'D');
+        static constexpr uint32_t AST_ENDS = binary::make_tag('A', 'E', 'N', 'D');
+        static constexpr uint32_t AST_VALUES = binary::make_tag('A', 'V', 'A', 'L');
+        static constexpr uint32_t AST_STRING_OFFSETS = binary::make_tag('A', 'S', 'T', 'O');
+        static constexpr uint32_t AST_STRINGS = binary::make_tag('A', 'S', 'T', 'R');
+    }
+
+    /**
+     * @brief Identifies the source a container was produced from.
+     */
+    struct source_info_t
+    {
+        uint64_t hash; // source_hash() of the text
+        uint64_t size;
+        uint64_t lexer_version; // LEXER_VERSION of the lexer the tokens came from
+    };
+
+    /**
+     * @brief A TokenList and its line starts, pointing into a container.
+     */
+    struct token_view_t
+    {
+        const uint32_t *starts;
+        const uint16_t *lengths;
+        const lang::token_i *types;
+        const uint8_t *flags;
+        size_t size;
+        const uint32_t *line_starts;
+        size_t line_count;
+    };
+
+    /**
+     * @brief Type of a null child slot in a flattened tree.
+     */
+    static constexpr uint8_t NULL_NODE = 0xFF;
+
+    /**
+     * @brief A parse tree flattened in pre-order, pointing into a container.
+     * The first child of node i is i + 1, and each child's next sibling is ends[child];
+     * ends[i] is one past the last node of i's subtree.
+     */
+    struct ast_view_t
+    {
+        const uint8_t *types;           // ir_t, or NULL_NODE
+        const value_i *kinds;
+        const uint32_t *ends;
+        const uint64_t *values;         // by kind: string index, double bits, bool or op
+        const uint32_t *string_offsets; // string_count + 1 ascending offsets into strings
+        const char *strings;
+        size_t size;
+        size_t string_count;
+
+        [[nodiscard]] std::string_view string(size_t node) const;
+        [[nodiscard]] double number(size_t node) const;
+    };
+
+    /**
+     * @brief Appends the SOURCE section.
+     * @param out The container being built.
+     * @param info The source the following sections describe.
+    */
+    void add_source_info(binary::writer &out, const source_info_t &info);
+
+    /**
+     * @brief Appends the token and line start sections of a tokenized lexer.
+     * @param out The container being built.
+     * @param lexer A lexer after tokenize().
+    */
+    void add_tokens(binary::writer &out, const Lexer &lexer);
+
+    /**
+     * @brief Appends the flattened form of a parse tree.
+     * @param out The container being built.
+     * @param root The tree; nullptr writes an empty tree.
+    */
+    void add_ast(binary::writer &out, const ir_node *root);
+
+    /**
+     * @return False if the container has no SOURCE section.
+    */
+    bool read_source_info(const binary::reader &in, source_info_t &info);
+
+    /**
+     * @brief Views the token sections in place.
+     * @return False if a section is missing or the arrays disagree in length.
+    */
+    bool read_tokens(const binary::reader &in, token_view_t &view);
+
+    /**
+     * @brief Views the tree sections in place after checking that every subtree nests inside
+     * its parent and every string reference is in range, so walks need no bounds checks.
+     * @return False if a section is missing or the tree is malformed.
+    */
+    bool read_ast(const binary::reader &in, ast_view_t &view);
+
+    /**
+     * @brief Rebuilds an owning ir_node tree, for consumers of the pointer form.
+     * @param view A view accepted by read_ast().
+     * @return The root, to be released with destroy_node(); nullptr for an empty tree.
+    */
+    ir_node *build_tree(const ast_view_t &view);
+}
+
+#endif
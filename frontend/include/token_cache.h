@@ -0,0 +1,46 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_TOKEN_CACHE_H
+#define YU_TOKEN_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "lexer.h"
+
+namespace yu::frontend
+{
+    /**
+     * @brief Content hash used as the cache key (XXH64 of the source bytes).
+     * @param src The source code.
+     * @return The 64-bit hash.
+    */
+    uint64_t source_hash(std::string_view src);
+
+    /**
+     * @brief Restores the lexer state for `src` from the cache entry of `hash`, if one exists.
+     * The entry is memory-mapped and its token and line arrays are copied into the lexer
+     * in bulk, so a hit costs a read of the entry instead of a full tokenize().
+     * @param directory The cache directory.
+     * @param src The source code; must be what the entry was stored from.
+     * @param hash source_hash(src).
+     * @param lexer Set up as create_lexer(src) followed by tokenize() on a hit.
+     * @return False on a miss, or if the entry is stale, truncated, or from another container
+     * or lexer version.
+    */
+    bool load_cached_tokens(const std::string &directory, std::string_view src, uint64_t hash, Lexer &lexer);
+
+    /**
+     * @brief Writes the tokens and line starts of a tokenized lexer as the cache entry of `hash`.
+     * The entry is written to a temporary file and renamed into place, so concurrent
+     * compiles never observe a partial entry.
+     * @param directory The cache directory, created if missing.
+     * @param hash source_hash() of the lexed source.
+     * @param lexer A lexer after tokenize().
+     * @return False if the entry could not be written.
+    */
+    bool store_cached_tokens(const std::string &directory, uint64_t hash, const Lexer &lexer);
+}
+
+#endif
@@ -0,0 +1,276 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/layout.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace yu::frontend
+{
+    namespace
+    {
+        // Elements of the loop the @soa report compares the two forms on
+        constexpr uint32_t SOA_REPORT_ELEMENTS = 1024;
+
+        uint32_t round_up(const uint32_t value, const uint32_t align)
+        {
+            return (value + align - 1) / align * align;
+        }
+
+        /**
+         * @brief Cache lines touched reading `size` bytes at `offset` of each of `count`
+         * elements `stride` bytes apart, starting on a line boundary.
+         */
+        uint32_t lines_touched(const uint32_t stride, const uint32_t offset, const uint32_t size, const uint32_t count)
+        {
+            uint32_t lines = 0;
+            uint64_t next = 0; // first line not counted yet
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                const uint64_t first = (i * stride + offset) / CACHE_LINE_SIZE;
+                const uint64_t last = (i * stride + offset + size - 1) / CACHE_LINE_SIZE;
+                lines += static_cast<uint32_t>(last + 1 - std::max(first, next));
+                next = last + 1;
+            }
+            return lines;
+        }
+
+        /**
+         * @brief Size and alignment of a builtin type. Strings are a pointer and a length.
+         */
+        bool builtin_layout(const type_info_t &info, uint32_t &size, uint32_t &align)
+        {
+            switch (info.kind)
+            {
+                case type_kind_i::BOOL:
+                    size = align = 1;
+                    return true;
+                case type_kind_i::INT:
+                case type_kind_i::FLOAT:
+                    size = align = info.bits / 8;
+                    return true;
+                case type_kind_i::POINTER:
+                    size = align = 8;
+                    return true;
+                case type_kind_i::STRING:
+                    size = 16;
+                    align = 8;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        struct layout_pass_t
+        {
+            enum : uint8_t { UNSEEN, IN_PROGRESS, DONE };
+
+            const semantic_model &model;
+            module_layout &layout;
+            std::vector<uint8_t> state;
+            std::vector<class_layout_t> layouts; // by type id; classes held by value are shared
+
+            layout_pass_t(const semantic_model &model, module_layout &layout)
+                : model(model), layout(layout), state(model.types.size(), UNSEEN), layouts(model.types.size())
+            {
+            }
+
+            const class_layout_t &lay_out(uint32_t type); // NOLINT(*-no-recursion)
+            void add_columns(const class_layout_t &from, const std::string &prefix, uint32_t offset, // NOLINT(*-no-recursion)
+                             std::vector<soa_column_t> &columns) const;
+        };
+
+        const class_layout_t &layout_pass_t::lay_out(const uint32_t type) // NOLINT(*-no-recursion)
+        {
+            // No resizing happens during the pass, so this stays valid across the recursion
+            auto &result = layouts[type];
+            if (state[type] != UNSEEN)
+                return result;
+            state[type] = IN_PROGRESS;
+
+            const type_info_t &info = model.types[type];
+            result.type = type;
+            if (info.generic_count)
+            {
+                result.incomplete = "generic class";
+                state[type] = DONE;
+                return result;
+            }
+
+            for (uint32_t m = info.first_member; m < info.first_member + info.member_count; ++m)
+            {
+                const member_t &member = model.members[m];
+                if (member.is_method)
+                    continue;
+
+                const std::string field(model.names.view(member.name));
+                uint32_t size = 0, align = 1;
+                if (model.types[member.type].kind != type_kind_i::CLASS)
+                {
+                    if (!builtin_layout(model.types[member.type], size, align))
+                        result.incomplete = "field '" + field + "' has a generic type";
+                }
+                else if (state[member.type] == IN_PROGRESS)
+                {
+                    // Only the module declaring the class reports it
+                    result.incomplete = "contains itself by value";
+                    if (info.origin == &model)
+                    {
+                        layout.errors.push_back(model.type_name(type) + ": field '" + field + "' of type '" +
+                                                model.type_name(member.type) + "' contains '" +
+                                                model.type_name(type) + "' by value");
+                    }
+                }
+                else
+                {
+                    const class_layout_t &inner = lay_out(member.type);
+                    if (!inner.incomplete.empty())
+                        result.incomplete = "field '" + field + "': '" + model.type_name(member.type) + "' has no layout";
+                    size = inner.size;
+                    align = inner.align;
+                }
+                if (!result.incomplete.empty())
+                    break;
+
+                if (info.packed)
+                    align = 1;
+                align = std::max(align, member.alignment);
+
+                const uint32_t offset = round_up(result.size, align);
+                result.fields.push_back({ m, offset, size, align, offset - result.size });
+                result.padding += offset - result.size;
+                result.size = offset + size;
+                result.align = std::max(result.align, align);
+            }
+
+            if (!result.incomplete.empty())
+            {
+                result.fields.clear();
+                result.size = result.padding = 0;
+                result.align = 1;
+            }
+            else
+            {
+                result.align = std::max(result.align, info.alignment);
+                const uint32_t end = result.size;
+                result.size = round_up(end, result.align);
+                result.tail_padding = result.size - end;
+                result.padding += result.tail_padding;
+                if (info.soa)
+                    add_columns(result, "", 0, result.columns);
+            }
+            state[type] = DONE;
+            return result;
+        }
+
+        void layout_pass_t::add_columns(const class_layout_t &from, const std::string &prefix, // NOLINT(*-no-recursion)
+                                        const uint32_t offset, std::vector<soa_column_t> &columns) const
+        {
+            for (const auto &field : from.fields)
+            {
+                const member_t &member = model.members[field.member];
+                const std::string path = prefix + std::string(model.names.view(member.name));
+                if (model.types[member.type].kind == type_kind_i::CLASS)
+                    add_columns(layouts[member.type], path + ".", offset + field.offset, columns);
+                else
+                    columns.push_back({ path, member.type, offset + field.offset, field.size });
+            }
+        }
+    }
+
+    bool compute_layouts(const semantic_model &model, module_layout &layout)
+    {
+        layout = module_layout{};
+        layout_pass_t pass(model, layout);
+        for (uint32_t type = types::BUILTIN_COUNT; type < model.types.size(); ++type)
+        {
+            const type_info_t &info = model.types[type];
+            if (info.kind == type_kind_i::CLASS && info.origin == &model)
+                layout.classes.push_back(pass.lay_out(type));
+        }
+        return layout.errors.empty();
+    }
+
+    std::string format_layout(const semantic_model &model, const class_layout_t &layout)
+    {
+        const std::string name = model.type_name(layout.type);
+        if (!layout.incomplete.empty())
+            return "class " + name + ": no layout (" + layout.incomplete + ")\n";
+        if (layout.fields.empty())
+            return "class " + name + ": no fields\n";
+
+        char line[512];
+        const uint32_t lines = (layout.size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+        std::snprintf(line, sizeof(line), "class %s: %u bytes, align %u, %u bytes padding (%.1f%%), %u cache line%s\n",
+                      name.c_str(), layout.size, layout.align, layout.padding,
+                      layout.size ? 100.0 * layout.padding / layout.size : 0.0, lines, lines == 1 ? "" : "s");
+        std::string report = line;
+        report += "  offset  size  align  field\n";
+
+        std::vector<uint32_t> used(lines, 0);
+        std::string notes;
+        for (const auto &field : layout.fields)
+        {
+            const member_t &member = model.members[field.member];
+            const std::string field_name(model.names.view(member.name));
+            if (field.padding)
+            {
+                std::snprintf(line, sizeof(line), "  %6u  %4u         (padding)\n", field.offset - field.padding,
+                              field.padding);
+                report += line;
+            }
+            std::snprintf(line, sizeof(line), "  %6u  %4u  %5u  %s: %s\n", field.offset, field.size, field.align,
+                          field_name.c_str(), model.type_name(member.type).c_str());
+            report += line;
+
+            if (!field.size)
+                continue;
+            const uint32_t first = field.offset / CACHE_LINE_SIZE;
+            const uint32_t last = (field.offset + field.size - 1) / CACHE_LINE_SIZE;
+            for (uint32_t i = first; i <= last; ++i)
+            {
+                const uint32_t begin = std::max(field.offset, i * CACHE_LINE_SIZE);
+                const uint32_t end = std::min(field.offset + field.size, (i + 1) * CACHE_LINE_SIZE);
+                used[i] += end - begin;
+            }
+            if (first != last)
+            {
+                std::snprintf(line, sizeof(line), "  note: '%s' splits cache lines %u-%u\n", field_name.c_str(),
+                              first, last);
+                notes += line;
+            }
+        }
+        if (layout.tail_padding)
+        {
+            std::snprintf(line, sizeof(line), "  %6u  %4u         (padding)\n", layout.size - layout.tail_padding,
+                          layout.tail_padding);
+            report += line;
+        }
+
+        for (uint32_t i = 0; i < lines; ++i)
+        {
+            const uint32_t end = std::min(layout.size, (i + 1) * CACHE_LINE_SIZE);
+            std::snprintf(line, sizeof(line), "  cache line %u: bytes %u-%u, %u of %u used by fields\n", i,
+                          i * CACHE_LINE_SIZE, end - 1, used[i], end - i * CACHE_LINE_SIZE);
+            report += line;
+        }
+        report += notes;
+
+        if (layout.columns.empty())
+            return report;
+        std::snprintf(line, sizeof(line),
+                      "  @soa: %zu columns; cache lines read by a loop over one column of %u elements:\n"
+                      "    %-24s  size   aos   soa\n",
+                      layout.columns.size(), SOA_REPORT_ELEMENTS, "column");
+        report += line;
+        for (const auto &column : layout.columns)
+        {
+            std::snprintf(line, sizeof(line), "    %-24s  %4u  %4u  %4u\n", column.path.c_str(), column.size,
+                          lines_touched(layout.size, column.offset, column.size, SOA_REPORT_ELEMENTS),
+                          lines_touched(column.size, 0, column.size, SOA_REPORT_ELEMENTS));
+            report += line;
+        }
+        return report;
+    }
+}
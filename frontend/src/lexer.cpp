@@ -84,7 +84,7 @@ namespace yu::frontend
                        (i == '/') * 2 +
                        (i == '*') * 3 +
                        (std::isalpha(i) || i == '_' || i == '@') * 4 +
-                       std::isdigit(i) * 5 +
+                       (std::isdigit(i) != 0) * 5 +
                        (i == '"') * 6;
         }
         return types;
@@ -259,7 +259,8 @@ namespace yu::frontend
             const char current_char = src[current_pos];
             const uint8_t type = char_type[static_cast<uint8_t>(current_char)];
             const uint32_t is_newline = current_char == '\n';
-            lexer.line_starts.emplace_back(current_pos + 1 * is_newline);
+            if (is_newline)
+                lexer.line_starts.emplace_back(current_pos + 1);
             const bool has_next = current_pos + 1 < src_length;
             const char next_char = has_next ? src[current_pos + 1] : '\0';
 
@@ -276,7 +277,8 @@ namespace yu::frontend
             while (in_comment && current_pos + 1 < src_length)
             {
                 const uint32_t end_of_comment = src[current_pos] == '*' & src[current_pos + 1] == '/';
-                lexer.line_starts.emplace_back(current_pos + 1 * (src[current_pos] == '\n'));
+                if (src[current_pos] == '\n')
+                    lexer.line_starts.emplace_back(current_pos + 1);
 
                 current_pos += 1 + end_of_comment;
                 in_comment &= !end_of_comment;
@@ -450,7 +452,7 @@ namespace yu::frontend
         uint8_t flags = 0;
 
         const uint32_t is_valid_start = (*current == '_' || *current == '@' ||
-                                         std::isalpha(*current));
+                                         std::isalpha(static_cast<unsigned char>(*current)) != 0);
         flags |= make_flag(!is_valid_start, lang::token_flags::INVALID_IDENTIFIER_START);
 
         current += (*current == '@');
@@ -458,10 +460,11 @@ namespace yu::frontend
         while (current < lexer.src + lexer.src_length)
         {
             const char c = *current;
-            const uint32_t is_alnum = std::isalnum(c);
+            // <cctype> only promises nonzero, not 1, and these feed arithmetic below
+            const uint32_t is_alnum = std::isalnum(static_cast<unsigned char>(c)) != 0;
             const uint32_t is_underscore = c == '_';
-            const uint32_t is_space = std::isspace(c);
-            const uint32_t is_punct = std::ispunct(c);
+            const uint32_t is_space = std::isspace(static_cast<unsigned char>(c)) != 0;
+            const uint32_t is_punct = std::ispunct(static_cast<unsigned char>(c)) != 0;
 
             const uint32_t is_valid = is_alnum | is_underscore;
             const uint32_t is_terminator = (!is_valid) & (is_space | is_punct);
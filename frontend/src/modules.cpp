@@ -0,0 +1,324 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/modules.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
+namespace yu::frontend
+{
+    namespace
+    {
+        namespace fs = std::filesystem;
+
+        bool default_load(module_t &module)
+        {
+            std::ifstream file(module.path, std::ios::binary | std::ios::ate);
+            const std::streamoff size = file ? static_cast<std::streamoff>(file.tellg()) : -1;
+            if (size < 0)
+            {
+                module.error = "cannot read file";
+                return false;
+            }
+            if (static_cast<uint64_t>(size) > UINT32_MAX)
+            {
+                module.error = "file too large (over 4 GiB)";
+                return false;
+            }
+            module.source.resize(static_cast<size_t>(size));
+            file.seekg(0);
+            if (!file.read(module.source.data(), size))
+            {
+                module.error = "cannot read file";
+                return false;
+            }
+
+            module.lexer = create_lexer(module.source);
+            tokenize(module.lexer);
+            return true;
+        }
+
+        std::string canonical_path(const fs::path &path)
+        {
+            std::error_code ec;
+            const fs::path canonical = fs::weakly_canonical(path, ec);
+            return (ec ? path.lexically_normal() : canonical).string();
+        }
+
+        bool resolve(const std::string_view name, const fs::path &directory,
+                     const std::vector<std::string> &search_paths, std::string &resolved)
+        {
+            fs::path file{std::string(name)};
+            if (!file.has_extension())
+                file += ".yu";
+
+            std::error_code ec;
+            if (file.is_absolute())
+            {
+                if (!fs::is_regular_file(file, ec))
+                    return false;
+                resolved = canonical_path(file);
+                return true;
+            }
+
+            if (fs::is_regular_file(directory / file, ec))
+            {
+                resolved = canonical_path(directory / file);
+                return true;
+            }
+            for (const auto &search_path : search_paths)
+            {
+                if (fs::is_regular_file(fs::path(search_path) / file, ec))
+                {
+                    resolved = canonical_path(fs::path(search_path) / file);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Shared state of one load_modules() call. Modules are created under the mutex
+         * and from then on only touched by the task that loads them.
+        */
+        struct loader_t
+        {
+            const module_options &options;
+            work_pool &pool;
+            std::mutex mutex;
+            std::unordered_map<std::string, uint32_t> ids;
+            std::vector<std::unique_ptr<module_t>> modules;
+
+            /**
+             * @brief The id of the module at `path`, scheduling its load the first time it is seen.
+            */
+            uint32_t request(const std::string &path)
+            {
+                module_t *module;
+                uint32_t id;
+                {
+                    std::lock_guard lock(mutex);
+                    const auto [it, inserted] = ids.try_emplace(path, static_cast<uint32_t>(modules.size()));
+                    if (!inserted)
+                        return it->second;
+                    modules.push_back(std::make_unique<module_t>());
+                    module = modules.back().get();
+                    module->path = path;
+                    id = it->second;
+                }
+                pool.submit([this, module] { discover(*module); });
+                return id;
+            }
+
+            void fail_at(module_t &module, const uint32_t token, std::string error) const
+            {
+                module.error = std::move(error);
+                const auto &tokens = module.lexer.tokens;
+                if (token < tokens.size())
+                {
+                    const lang::token_t at{ tokens.starts[token], tokens.lengths[token], tokens.types[token],
+                                            tokens.flags[token] };
+                    std::tie(module.line, module.column) = get_line_col(module.lexer, at);
+                }
+            }
+
+            void discover(module_t &module)
+            {
+                if (!(options.load ? options.load(module) : default_load(module)))
+                {
+                    if (module.error.empty())
+                        module.error = "cannot load module";
+                    return;
+                }
+
+                const auto &tokens = module.lexer.tokens;
+                module.tree = parse_imports(module.source.c_str(), &tokens, module.body_pos);
+                if (!module.tree)
+                {
+                    fail_at(module, module.body_pos, "malformed import");
+                    return;
+                }
+
+                const fs::path directory = fs::path(module.path).parent_path();
+                uint32_t statement = 0;
+                for (const auto *import : module.tree->children)
+                {
+                    while (tokens.types[statement] != lang::token_i::IMPORT)
+                        ++statement;
+
+                    const std::string_view name(import->value.str_val.text, import->value.str_val.length);
+                    std::string resolved;
+                    if (!resolve(name, directory, options.search_paths, resolved))
+                    {
+                        fail_at(module, statement, "cannot find module '" + std::string(name) + "'");
+                        return;
+                    }
+                    module.imports.push_back(request(resolved));
+                    ++statement;
+                }
+            }
+        };
+
+        /**
+         * @brief Names the cycles among the modules left out of the topological order. Each of
+         * them imports at least one other left-out module, so following those imports from any
+         * of them ends on a cycle.
+        */
+        void report_cycles(module_graph &graph, const std::vector<uint32_t> &pending)
+        {
+            auto &modules = graph.modules;
+            enum : uint8_t { UNSEEN, ON_PATH, DONE };
+            std::vector<uint8_t> state(modules.size(), UNSEEN);
+
+            for (uint32_t start = 0; start < modules.size(); ++start)
+            {
+                if (!pending[start] || state[start] != UNSEEN)
+                    continue;
+
+                std::vector<uint32_t> path;
+                uint32_t current = start;
+                while (state[current] == UNSEEN)
+                {
+                    state[current] = ON_PATH;
+                    path.push_back(current);
+                    const auto &imports = modules[current]->imports;
+                    current = *std::find_if(imports.begin(), imports.end(),
+                                            [&](const uint32_t import) { return pending[import] != 0; });
+                }
+
+                auto cycle_begin = path.end();
+                if (state[current] == ON_PATH)
+                {
+                    cycle_begin = std::find(path.begin(), path.end(), current);
+                    std::string message = "import cycle: ";
+                    for (auto it = cycle_begin; it != path.end(); ++it)
+                        message += modules[*it]->path + " -> ";
+                    message += modules[current]->path;
+                    for (auto it = cycle_begin; it != path.end(); ++it)
+                        modules[*it]->error = message;
+                }
+                for (auto it = path.begin(); it != cycle_begin; ++it)
+                    modules[*it]->error = "imports a module on an import cycle";
+                for (const uint32_t id : path)
+                    state[id] = DONE;
+            }
+
+            // Importers of a cycle the walks above never passed through
+            for (uint32_t id = 0; id < modules.size(); ++id)
+            {
+                if (pending[id] && modules[id]->error.empty())
+                    modules[id]->error = "imports a module on an import cycle";
+            }
+        }
+    }
+
+    bool load_modules(const std::vector<std::string> &roots, const module_options &options, work_pool &pool,
+                      module_graph &graph)
+    {
+        graph = module_graph{};
+        loader_t loader{ options, pool, {}, {}, {} };
+
+        std::vector<uint32_t> root_ids;
+        for (const auto &root : roots)
+            root_ids.push_back(loader.request(canonical_path(root)));
+        pool.wait();
+
+        // Discovery order depends on thread timing; sort so ids and output do not
+        auto &modules = loader.modules;
+        std::vector<uint32_t> by_path(modules.size());
+        for (uint32_t i = 0; i < by_path.size(); ++i)
+            by_path[i] = i;
+        std::sort(by_path.begin(), by_path.end(),
+                  [&](const uint32_t a, const uint32_t b) { return modules[a]->path < modules[b]->path; });
+        std::vector<uint32_t> renamed(modules.size());
+        for (uint32_t i = 0; i < by_path.size(); ++i)
+            renamed[by_path[i]] = i;
+
+        graph.modules.reserve(modules.size());
+        for (const uint32_t old_id : by_path)
+            graph.modules.push_back(std::move(modules[old_id]));
+        for (const uint32_t old_id : root_ids)
+        {
+            if (std::find(graph.roots.begin(), graph.roots.end(), renamed[old_id]) == graph.roots.end())
+                graph.roots.push_back(renamed[old_id]);
+        }
+
+        for (uint32_t id = 0; id < graph.modules.size(); ++id)
+        {
+            for (auto &import : graph.modules[id]->imports)
+            {
+                import = renamed[import];
+                graph.modules[import]->importers.push_back(id);
+            }
+        }
+
+        // Kahn's algorithm, using the order itself as the queue
+        std::vector<uint32_t> pending(graph.modules.size());
+        for (uint32_t id = 0; id < graph.modules.size(); ++id)
+        {
+            pending[id] = static_cast<uint32_t>(graph.modules[id]->imports.size());
+            if (!pending[id])
+                graph.order.push_back(id);
+        }
+        for (size_t next = 0; next < graph.order.size(); ++next)
+        {
+            for (const uint32_t importer : graph.modules[graph.order[next]]->importers)
+            {
+                if (--pending[importer] == 0)
+                    graph.order.push_back(importer);
+            }
+        }
+        if (graph.order.size() != graph.modules.size())
+            report_cycles(graph, pending);
+
+        return std::all_of(graph.modules.begin(), graph.modules.end(),
+                           [](const auto &module) { return module->error.empty(); });
+    }
+
+    void schedule_topological(module_graph &graph, work_pool &pool, const std::function<void(module_t &)> &task)
+    {
+        const auto &modules = graph.modules;
+
+        // Longest chain of importers above each module; the reversed order visits importers first
+        std::vector<uint32_t> height(modules.size(), 0);
+        for (auto it = graph.order.rbegin(); it != graph.order.rend(); ++it)
+        {
+            for (const uint32_t importer : modules[*it]->importers)
+                height[*it] = std::max(height[*it], height[importer] + 1);
+        }
+
+        // Modules left out of the order never run, so their importers never reach zero either
+        const auto remaining = std::make_unique<std::atomic<uint32_t>[]>(modules.size());
+        for (uint32_t id = 0; id < modules.size(); ++id)
+            remaining[id].store(static_cast<uint32_t>(modules[id]->imports.size()), std::memory_order_relaxed);
+        std::vector<uint32_t> ready;
+        for (const uint32_t id : graph.order)
+        {
+            if (modules[id]->imports.empty())
+                ready.push_back(id);
+        }
+
+        std::function<void(uint32_t)> run = [&](const uint32_t id)
+        {
+            task(*modules[id]);
+            for (const uint32_t importer : modules[id]->importers)
+            {
+                if (remaining[importer].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    pool.submit([&run, importer] { run(importer); });
+            }
+        };
+
+        // Workers pop their own deque newest first, so submit the tallest chains last
+        std::stable_sort(ready.begin(), ready.end(),
+                         [&](const uint32_t a, const uint32_t b) { return height[a] < height[b]; });
+        for (const uint32_t id : ready)
+            pool.submit([&run, id] { run(id); });
+        pool.wait();
+    }
+}
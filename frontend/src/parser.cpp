@@ -2,6 +2,7 @@
 // See LICENSE.txt for details
 
 #include "../include/parser.h"
+#include <algorithm>
 #include <stack>
 #include "lexer.h"
 
@@ -15,7 +16,8 @@ namespace yu::frontend
         return node;
     }
 
-    ALWAYS_INLINE HOT_FUNCTION
+    // Not forced inline: the CLI and the serializer call it from other translation units
+    HOT_FUNCTION
     void destroy_node(ir_node *node)
     {
         if (!node)
@@ -36,17 +38,54 @@ namespace yu::frontend
                     nodes.emplace(child);
             }
 
-            if (current->type == ir_t::NODE_IDENTIFIER ||
-                current->type == ir_t::NODE_LITERAL)
-            {
+            // Literals also carry numbers and bools in the same union, so only free actual text
+            if (current->value_kind == value_i::STRING)
                 delete[] current->value.str_val.text;
-            }
 
             current->children.clear();
             delete current;
         }
     }
 
+    namespace
+    {
+        /**
+         * @brief Whether the next token starts an annotation. Known annotations lex as their
+         * own tokens, any other `@name` as an identifier.
+        */
+        bool at_annotation(const parse_context *ctx)
+        {
+            if (ctx->state.pos >= ctx->tokens->size())
+                return false;
+            const auto type = ctx->tokens->types[ctx->state.pos];
+            return (type >= lang::token_i::ALIGN_ANNOT && type <= lang::token_i::TAIL_REC_ANNOT) ||
+                   (type == lang::token_i::IDENTIFIER && ctx->src[ctx->tokens->starts[ctx->state.pos]] == '@');
+        }
+
+        /**
+         * @brief Parses the annotations in front of a class or member into `annotations`.
+         * On failure the position is restored and nothing is left in `annotations`.
+        */
+        bt::status_i parse_annotations(parse_context *ctx, std::vector<ir_node *> &annotations)
+        {
+            const auto pos_backup = ctx->state.pos;
+            while (at_annotation(ctx))
+            {
+                if (parse_annotation(ctx) == bt::status_i::FAILURE)
+                {
+                    for (auto *annotation : annotations)
+                        destroy_node(annotation);
+                    annotations.clear();
+                    ctx->state.pos = pos_backup;
+                    return bt::status_i::FAILURE;
+                }
+                annotations.push_back(ctx->current);
+                ctx->current = nullptr;
+            }
+            return bt::status_i::SUCCESS;
+        }
+    }
+
     ALWAYS_INLINE HOT_FUNCTION
     parse_context *create_parse_context(const lang::TokenList *tokens)
     {
@@ -56,7 +95,10 @@ namespace yu::frontend
         ctx->current = nullptr;
         ctx->state.pos = 0;
         ctx->state.in_error = 0;
+        ctx->state.had_error = 0;
         ctx->state.depth = 0;
+        ctx->furthest = 0;
+        ctx->error_pos = 0;
         ctx->scope_stack.reserve(16);
         return ctx;
     }
@@ -96,23 +138,98 @@ namespace yu::frontend
         const auto status = parse_class(ctx);
         std::unique_ptr<ir_node> result;
 
-        if (status == bt::status_i::SUCCESS && !ctx->state.in_error)
+        if (status == bt::status_i::SUCCESS && !ctx->state.had_error)
         {
             result.reset(ctx->current);
             ctx->current = nullptr;
         }
+        // Failed constructs free their own nodes
+        else if (status == bt::status_i::FAILURE)
+            ctx->current = nullptr;
 
         destroy_parse_context(ctx);
         return result;
     }
 
+    ir_node *parse_imports(const char *src, const lang::TokenList *tokens, uint32_t &body_pos)
+    {
+        body_pos = 0;
+        if (!tokens || !src)
+            return nullptr;
+
+        auto *ctx = create_parse_context(tokens);
+        ctx->src = src;
+        auto *module_node = create_node(ir_t::NODE_MODULE);
+
+        while (ctx->state.pos < tokens->size() && tokens->types[ctx->state.pos] == lang::token_i::IMPORT)
+        {
+            if (parse_import(ctx) == bt::status_i::FAILURE)
+            {
+                destroy_node(module_node);
+                module_node = nullptr;
+                break;
+            }
+            module_node->children.push_back(ctx->current);
+            ctx->current = nullptr;
+        }
+
+        body_pos = ctx->state.pos;
+        destroy_parse_context(ctx);
+        return module_node;
+    }
+
+    bool parse_module_body(const char *src, const lang::TokenList *tokens, const uint32_t body_pos, ir_node *module,
+                           uint32_t *error_pos)
+    {
+        if (!tokens || !src || !module)
+            return false;
+
+        auto *ctx = create_parse_context(tokens);
+        ctx->src = src;
+        ctx->state.pos = body_pos;
+
+        bool ok = true;
+        while (ctx->state.pos < tokens->size() && tokens->types[ctx->state.pos] != lang::token_i::END_OF_FILE)
+        {
+            if (parse_class(ctx) == bt::status_i::FAILURE)
+            {
+                ctx->current = nullptr;
+                ok = false;
+                break;
+            }
+            if (ctx->state.had_error)
+            {
+                // Recovered, but the class is missing whatever was skipped
+                ok = false;
+                break;
+            }
+            module->children.push_back(ctx->current);
+            ctx->current = nullptr;
+
+            // `class A { ... };` as in the README
+            match_token(ctx, lang::token_i::SEMICOLON);
+        }
+
+        if (!ok && error_pos)
+        {
+            // A recovered error is reported where it was found, a failed class where matching stopped
+            const uint32_t pos = ctx->state.had_error ? ctx->error_pos : std::max<uint32_t>(ctx->furthest, ctx->state.pos);
+            *error_pos = std::min<uint32_t>(pos, static_cast<uint32_t>(tokens->size() - 1));
+        }
+        destroy_parse_context(ctx);
+        return ok;
+    }
+
     ALWAYS_INLINE HOT_FUNCTION
     bt::status_i sync_error(parse_context *ctx, const lang::token_i sync_token)
     {
         if (!ctx)
             return bt::status_i::FAILURE;
 
+        if (!ctx->state.had_error)
+            ctx->error_pos = std::max<uint32_t>(ctx->furthest, ctx->state.pos);
         ctx->state.in_error = 1;
+        ctx->state.had_error = 1;
 
         while (ctx->state.pos < ctx->tokens->size())
         {
@@ -136,34 +253,30 @@ namespace yu::frontend
     bt::status_i parse_assignment(parse_context *ctx)
     {
         const auto pos_backup = ctx->state.pos;
-        auto *left = create_node(ir_t::NODE_EXPRESSION);
-        ctx->current = left;
 
         if (parse_logical_or(ctx) == bt::status_i::FAILURE)
         {
-            destroy_node(left);
             ctx->state.pos = pos_backup;
             return bt::status_i::FAILURE;
         }
 
-        if (match_token(ctx, lang::token_i::EQUAL) == bt::status_i::SUCCESS)
+        // `=` alone; `==` is left to parse_equality
+        if (static_cast<size_t>(ctx->state.pos) + 1 < ctx->tokens->size() &&
+            ctx->tokens->types[ctx->state.pos + 1] != lang::token_i::EQUAL &&
+            match_token(ctx, lang::token_i::EQUAL) == bt::status_i::SUCCESS)
         {
-            auto *assign = create_node(ir_t::NODE_BINARY_OP);
-            assign->value.op_val = static_cast<uint8_t>(lang::token_i::EQUAL);
-            assign->children.push_back(left);
-
-            auto *right = create_node(ir_t::NODE_EXPRESSION);
-            ctx->current = right;
+            auto *assign = create_node(ir_t::NODE_ASSIGN);
+            assign->children.push_back(ctx->current);
 
             if (parse_assignment(ctx) == bt::status_i::FAILURE)
             {
                 destroy_node(assign);
-                destroy_node(right);
+                ctx->current = nullptr;
                 ctx->state.pos = pos_backup;
                 return bt::status_i::FAILURE;
             }
 
-            assign->children.push_back(right);
+            assign->children.push_back(ctx->current);
             ctx->current = assign;
         }
 
@@ -184,6 +297,7 @@ namespace yu::frontend
         {
             auto *op = create_node(ir_t::NODE_BINARY_OP);
             op->value.op_val = static_cast<uint8_t>(lang::token_i::OR);
+            op->value_kind = value_i::OP;
             op->children.push_back(ctx->current);
 
             if (parse_logical_and(ctx) == bt::status_i::FAILURE)
@@ -205,18 +319,30 @@ namespace yu::frontend
     {
         const auto pos_backup = ctx->state.pos;
 
+        std::vector<ir_node *> annotations;
+        if (parse_annotations(ctx, annotations) == bt::status_i::FAILURE)
+        {
+            return bt::status_i::FAILURE;
+        }
+
         if (match_token(ctx, lang::token_i::CLASS) == bt::status_i::FAILURE)
         {
+            for (auto *annotation : annotations)
+                destroy_node(annotation);
+            ctx->state.pos = pos_backup;
             return bt::status_i::FAILURE;
         }
 
+        // Annotations come first, ahead of the name
         auto *class_node = create_node(ir_t::NODE_CLASS);
+        class_node->children = std::move(annotations);
         ctx->current = class_node;
 
         // Parse class name (identifier)
         if (match_token(ctx, lang::token_i::IDENTIFIER) == bt::status_i::FAILURE)
         {
             destroy_node(class_node);
+            ctx->current = nullptr;
             ctx->state.pos = pos_backup;
             return bt::status_i::FAILURE;
         }
@@ -229,6 +355,7 @@ namespace yu::frontend
         auto *name_node = create_node(ir_t::NODE_IDENTIFIER);
         name_node->value.str_val.text = new char[length];
         name_node->value.str_val.length = length;
+        name_node->value_kind = value_i::STRING;
         const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
         memcpy(name_node->value.str_val.text, value.data(), value.length());
         class_node->children.push_back(name_node);
@@ -240,19 +367,25 @@ namespace yu::frontend
                 match_token(ctx, lang::token_i::GREATER) == bt::status_i::FAILURE)
             {
                 destroy_node(class_node);
+                ctx->current = nullptr;
                 ctx->state.pos = pos_backup;
                 return bt::status_i::FAILURE;
             }
+            class_node->children.push_back(ctx->current);
+            ctx->current = class_node;
         }
 
         // Parse class body
         if (parse_class_body(ctx) == bt::status_i::FAILURE)
         {
             destroy_node(class_node);
+            ctx->current = nullptr;
             ctx->state.pos = pos_backup;
             return bt::status_i::FAILURE;
         }
 
+        // Members replace ctx->current while the body is parsed
+        ctx->current = class_node;
         return bt::status_i::SUCCESS;
     }
 
@@ -311,6 +444,7 @@ namespace yu::frontend
         auto *name_node = create_node(ir_t::NODE_IDENTIFIER);
         name_node->value.str_val.text = new char[name_length];
         name_node->value.str_val.length = name_length;
+        name_node->value_kind = value_i::STRING;
         const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
         memcpy(name_node->value.str_val.text, value.data(), value.length());
         method_node->children.push_back(name_node);
@@ -325,7 +459,7 @@ namespace yu::frontend
 
         while (match_token(ctx, lang::token_i::RIGHT_PAREN) == bt::status_i::FAILURE)
         {
-            if (parse_variable(ctx) == bt::status_i::FAILURE)
+            if (parse_parameter(ctx) == bt::status_i::FAILURE)
             {
                 destroy_node(method_node);
                 ctx->state.pos = pos_backup;
@@ -333,8 +467,10 @@ namespace yu::frontend
             }
             method_node->children.push_back(ctx->current);
 
+            // A comma continues the list; the closing parenthesis is left for the loop condition
             if (match_token(ctx, lang::token_i::COMMA) == bt::status_i::FAILURE &&
-                match_token(ctx, lang::token_i::RIGHT_PAREN) == bt::status_i::FAILURE)
+                (ctx->state.pos >= ctx->tokens->size() ||
+                 ctx->tokens->types[ctx->state.pos] != lang::token_i::RIGHT_PAREN))
             {
                 destroy_node(method_node);
                 ctx->state.pos = pos_backup;
@@ -369,6 +505,8 @@ namespace yu::frontend
             return bt::status_i::FAILURE;
         }
 
+        method_node->children.push_back(ctx->current);
+        ctx->current = method_node;
         return bt::status_i::SUCCESS;
     }
 
@@ -404,6 +542,7 @@ namespace yu::frontend
         auto *name_node = create_node(ir_t::NODE_IDENTIFIER);
         name_node->value.str_val.text = new char[name_length];
         name_node->value.str_val.length = name_length;
+        name_node->value_kind = value_i::STRING;
         const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
         memcpy(name_node->value.str_val.text, value.data(), value.length());
         field_node->children.push_back(name_node);
@@ -444,12 +583,21 @@ namespace yu::frontend
             return bt::status_i::FAILURE;
         }
 
+        ctx->current = field_node;
         return bt::status_i::SUCCESS;
     }
 
     ALWAYS_INLINE HOT_FUNCTION
     bt::status_i parse_class_member(parse_context *ctx)
     {
+        const auto pos_backup = ctx->state.pos;
+
+        std::vector<ir_node *> annotations;
+        if (parse_annotations(ctx, annotations) == bt::status_i::FAILURE)
+        {
+            return bt::status_i::FAILURE;
+        }
+
         // Parse member visibility
         auto has_visibility = false;
         auto visibility = ir_t::NODE_IDENTIFIER;
@@ -463,16 +611,138 @@ namespace yu::frontend
         }
 
         // Parse member type (method or field)
+        auto status = bt::status_i::FAILURE;
         if (match_token(ctx, lang::token_i::FUNCTION) == bt::status_i::SUCCESS)
         {
-            return parse_method(ctx, has_visibility, visibility);
+            status = parse_method(ctx, has_visibility, visibility);
         }
-        if (match_token(ctx, lang::token_i::VAR) == bt::status_i::SUCCESS)
+        else if (match_token(ctx, lang::token_i::VAR) == bt::status_i::SUCCESS)
         {
-            return parse_field(ctx, has_visibility, visibility);
+            status = parse_field(ctx, has_visibility, visibility);
         }
 
-        return bt::status_i::FAILURE;
+        if (status == bt::status_i::FAILURE)
+        {
+            for (auto *annotation : annotations)
+                destroy_node(annotation);
+            ctx->state.pos = pos_backup;
+            return bt::status_i::FAILURE;
+        }
+
+        // Annotations come first, ahead of the visibility
+        auto &children = ctx->current->children;
+        children.insert(children.begin(), annotations.begin(), annotations.end());
+        return bt::status_i::SUCCESS;
+    }
+
+    ALWAYS_INLINE HOT_FUNCTION
+    bt::status_i parse_annotation(parse_context *ctx)
+    {
+        const auto pos_backup = ctx->state.pos;
+
+        if (!at_annotation(ctx))
+        {
+            return bt::status_i::FAILURE;
+        }
+        ctx->state.pos++;
+
+        // The name without its `@`
+        const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
+        auto *annotation = create_node(ir_t::NODE_ANNOTATION);
+        annotation->value.str_val.text = new char[value.length() - 1];
+        annotation->value.str_val.length = value.length() - 1;
+        annotation->value_kind = value_i::STRING;
+        memcpy(annotation->value.str_val.text, value.data() + 1, value.length() - 1);
+
+        // Optional arguments: @name(expression, ...)
+        if (match_token(ctx, lang::token_i::LEFT_PAREN) == bt::status_i::SUCCESS &&
+            match_token(ctx, lang::token_i::RIGHT_PAREN) == bt::status_i::FAILURE)
+        {
+            do
+            {
+                if (parse_expression(ctx) == bt::status_i::FAILURE)
+                {
+                    destroy_node(annotation);
+                    ctx->current = nullptr;
+                    ctx->state.pos = pos_backup;
+                    return bt::status_i::FAILURE;
+                }
+                annotation->children.push_back(ctx->current);
+            }
+            while (match_token(ctx, lang::token_i::COMMA) == bt::status_i::SUCCESS);
+
+            if (match_token(ctx, lang::token_i::RIGHT_PAREN) == bt::status_i::FAILURE)
+            {
+                destroy_node(annotation);
+                ctx->current = nullptr;
+                ctx->state.pos = pos_backup;
+                return bt::status_i::FAILURE;
+            }
+        }
+
+        ctx->current = annotation;
+        return bt::status_i::SUCCESS;
+    }
+
+    ALWAYS_INLINE HOT_FUNCTION
+    bt::status_i parse_import(parse_context *ctx)
+    {
+        const auto pos_backup = ctx->state.pos;
+
+        // import { name, ... } from "path";
+        if (match_token(ctx, lang::token_i::IMPORT) == bt::status_i::FAILURE ||
+            match_token(ctx, lang::token_i::LEFT_BRACE) == bt::status_i::FAILURE)
+        {
+            ctx->state.pos = pos_backup;
+            return bt::status_i::FAILURE;
+        }
+
+        auto *import_node = create_node(ir_t::NODE_IMPORT);
+        do
+        {
+            if (match_token(ctx, lang::token_i::IDENTIFIER) == bt::status_i::FAILURE)
+            {
+                destroy_node(import_node);
+                ctx->state.pos = pos_backup;
+                return bt::status_i::FAILURE;
+            }
+
+            const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
+            auto *name_node = create_node(ir_t::NODE_IDENTIFIER);
+            name_node->value.str_val.text = new char[value.length()];
+            name_node->value.str_val.length = value.length();
+            name_node->value_kind = value_i::STRING;
+            memcpy(name_node->value.str_val.text, value.data(), value.length());
+            import_node->children.push_back(name_node);
+        }
+        while (match_token(ctx, lang::token_i::COMMA) == bt::status_i::SUCCESS);
+
+        if (match_token(ctx, lang::token_i::RIGHT_BRACE) == bt::status_i::FAILURE ||
+            match_token(ctx, lang::token_i::FROM) == bt::status_i::FAILURE ||
+            match_token(ctx, lang::token_i::STR_LITERAL) == bt::status_i::FAILURE ||
+            ctx->tokens->lengths[ctx->state.pos - 1] < 3 || ctx->tokens->flags[ctx->state.pos - 1] != 0)
+        {
+            destroy_node(import_node);
+            ctx->state.pos = pos_backup;
+            return bt::status_i::FAILURE;
+        }
+
+        // The path without its quotes
+        const auto path = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
+        import_node->value.str_val.text = new char[path.length() - 2];
+        import_node->value.str_val.length = path.length() - 2;
+        import_node->value_kind = value_i::STRING;
+        memcpy(import_node->value.str_val.text, path.data() + 1, path.length() - 2);
+
+        if (match_token(ctx, lang::token_i::SEMICOLON) == bt::status_i::FAILURE)
+        {
+            destroy_node(import_node);
+            ctx->state.pos = pos_backup;
+            return bt::status_i::FAILURE;
+        }
+
+        ctx->current = import_node;
+        return bt::status_i::SUCCESS;
     }
 
     ALWAYS_INLINE HOT_FUNCTION
@@ -491,17 +761,28 @@ namespace yu::frontend
         {
             if (parse_statement(ctx) == bt::status_i::FAILURE)
             {
-                return sync_error(ctx, lang::token_i::RIGHT_BRACE);
+                if (sync_error(ctx, lang::token_i::RIGHT_BRACE) == bt::status_i::FAILURE)
+                {
+                    destroy_node(block_node);
+                    ctx->current = nullptr;
+                    return bt::status_i::FAILURE;
+                }
+                break;
             }
             block_node->children.push_back(ctx->current);
         }
 
+        ctx->current = block_node;
         return bt::status_i::SUCCESS;
     }
 
     ALWAYS_INLINE HOT_FUNCTION
     bt::status_i parse_statement(parse_context *ctx)
     {
+        if (ctx->state.pos < ctx->tokens->size() && ctx->tokens->types[ctx->state.pos] == lang::token_i::LEFT_BRACE)
+        {
+            return parse_block(ctx);
+        }
         if (match_token(ctx, lang::token_i::IF) == bt::status_i::SUCCESS)
         {
             return parse_if_statement(ctx);
@@ -524,7 +805,18 @@ namespace yu::frontend
             return parse_variable(ctx);
         }
 
-        return parse_expression(ctx);
+        // Expression statement
+        const auto pos_backup = ctx->state.pos;
+        if (parse_expression(ctx) == bt::status_i::FAILURE)
+            return bt::status_i::FAILURE;
+        if (match_token(ctx, lang::token_i::SEMICOLON) == bt::status_i::FAILURE)
+        {
+            destroy_node(ctx->current);
+            ctx->current = nullptr;
+            ctx->state.pos = pos_backup;
+            return bt::status_i::FAILURE;
+        }
+        return bt::status_i::SUCCESS;
     }
 
     ALWAYS_INLINE HOT_FUNCTION
@@ -568,6 +860,7 @@ namespace yu::frontend
             if_node->children.push_back(ctx->current);
         }
 
+        ctx->current = if_node;
         return bt::status_i::SUCCESS;
     }
 
@@ -585,6 +878,7 @@ namespace yu::frontend
         {
             auto *op = create_node(ir_t::NODE_BINARY_OP);
             op->value.op_val = static_cast<uint8_t>(lang::token_i::AND);
+            op->value_kind = value_i::OP;
             op->children.push_back(ctx->current);
 
             if (parse_equality(ctx) == bt::status_i::FAILURE)
@@ -611,16 +905,18 @@ namespace yu::frontend
             return bt::status_i::FAILURE;
         }
 
-        // Handle == and !=
-        while ((match_token(ctx, lang::token_i::EQUAL) == bt::status_i::SUCCESS &&
-                match_token(ctx, lang::token_i::EQUAL) == bt::status_i::SUCCESS) ||
-               (match_token(ctx, lang::token_i::BANG) == bt::status_i::SUCCESS &&
-                match_token(ctx, lang::token_i::EQUAL) == bt::status_i::SUCCESS))
+        // Handle == and !=, looking at both tokens first so a lone `=` is left for parse_assignment
+        const auto &types = ctx->tokens->types;
+        while (static_cast<size_t>(ctx->state.pos) + 1 < ctx->tokens->size() &&
+               (types[ctx->state.pos] == lang::token_i::EQUAL || types[ctx->state.pos] == lang::token_i::BANG) &&
+               types[ctx->state.pos + 1] == lang::token_i::EQUAL)
         {
+            ctx->state.pos += 2;
             auto *op = create_node(ir_t::NODE_BINARY_OP);
             // The first token of the pair determines if it's == or !=
             op->value.op_val = static_cast<uint8_t>(ctx->tokens->types[static_cast<std::vector<unsigned>::size_type>(
                 ctx->state.pos - 2)]);
+            op->value_kind = value_i::OP;
             op->children.push_back(ctx->current);
 
             if (parse_comparison(ctx) == bt::status_i::FAILURE)
@@ -653,6 +949,7 @@ namespace yu::frontend
             auto *op = create_node(ir_t::NODE_BINARY_OP);
             op->value.op_val = static_cast<uint8_t>(ctx->tokens->types[static_cast<std::vector<unsigned>::size_type>(
                 ctx->state.pos - 1)]);
+            op->value_kind = value_i::OP;
             op->children.push_back(ctx->current);
 
             if (parse_term(ctx) == bt::status_i::FAILURE)
@@ -685,6 +982,7 @@ namespace yu::frontend
             auto *op = create_node(ir_t::NODE_BINARY_OP);
             op->value.op_val = static_cast<uint8_t>(ctx->tokens->types[static_cast<std::vector<unsigned>::size_type>(
                 ctx->state.pos - 1)]);
+            op->value_kind = value_i::OP;
             op->children.push_back(ctx->current);
 
             if (parse_factor(ctx) == bt::status_i::FAILURE)
@@ -718,6 +1016,7 @@ namespace yu::frontend
             auto *op = create_node(ir_t::NODE_BINARY_OP);
             op->value.op_val = static_cast<uint8_t>(ctx->tokens->types[static_cast<std::vector<unsigned>::size_type>(
                 ctx->state.pos - 1)]);
+            op->value_kind = value_i::OP;
             op->children.push_back(ctx->current);
 
             if (parse_unary(ctx) == bt::status_i::FAILURE)
@@ -745,6 +1044,7 @@ namespace yu::frontend
             auto *op = create_node(ir_t::NODE_UNARY_OP);
             op->value.op_val = static_cast<uint8_t>(ctx->tokens->types[static_cast<std::vector<unsigned>::size_type>(
                 ctx->state.pos - 1)]);
+            op->value_kind = value_i::OP;
 
             if (parse_unary(ctx) == bt::status_i::FAILURE)
             {
@@ -758,7 +1058,77 @@ namespace yu::frontend
             return bt::status_i::SUCCESS;
         }
 
-        return parse_primary(ctx);
+        return parse_postfix(ctx);
+    }
+
+    ALWAYS_INLINE HOT_FUNCTION
+    bt::status_i parse_postfix(parse_context *ctx)
+    {
+        const auto pos_backup = ctx->state.pos;
+
+        if (parse_primary(ctx) == bt::status_i::FAILURE)
+        {
+            return bt::status_i::FAILURE;
+        }
+
+        while (true)
+        {
+            // Member access: object.name
+            if (match_token(ctx, lang::token_i::DOT) == bt::status_i::SUCCESS)
+            {
+                auto *member = create_node(ir_t::NODE_MEMBER);
+                member->children.push_back(ctx->current);
+                if (match_token(ctx, lang::token_i::IDENTIFIER) == bt::status_i::FAILURE)
+                {
+                    destroy_node(member);
+                    ctx->current = nullptr;
+                    ctx->state.pos = pos_backup;
+                    return bt::status_i::FAILURE;
+                }
+
+                const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
+                member->value.str_val.text = new char[value.length()];
+                member->value.str_val.length = value.length();
+                member->value_kind = value_i::STRING;
+                memcpy(member->value.str_val.text, value.data(), value.length());
+                ctx->current = member;
+                continue;
+            }
+
+            // Call: callee(arguments...)
+            if (match_token(ctx, lang::token_i::LEFT_PAREN) == bt::status_i::SUCCESS)
+            {
+                auto *call = create_node(ir_t::NODE_CALL);
+                call->children.push_back(ctx->current);
+                if (match_token(ctx, lang::token_i::RIGHT_PAREN) == bt::status_i::FAILURE)
+                {
+                    do
+                    {
+                        if (parse_expression(ctx) == bt::status_i::FAILURE)
+                        {
+                            destroy_node(call);
+                            ctx->current = nullptr;
+                            ctx->state.pos = pos_backup;
+                            return bt::status_i::FAILURE;
+                        }
+                        call->children.push_back(ctx->current);
+                    }
+                    while (match_token(ctx, lang::token_i::COMMA) == bt::status_i::SUCCESS);
+
+                    if (match_token(ctx, lang::token_i::RIGHT_PAREN) == bt::status_i::FAILURE)
+                    {
+                        destroy_node(call);
+                        ctx->current = nullptr;
+                        ctx->state.pos = pos_backup;
+                        return bt::status_i::FAILURE;
+                    }
+                }
+                ctx->current = call;
+                continue;
+            }
+
+            return bt::status_i::SUCCESS;
+        }
     }
 
     ALWAYS_INLINE HOT_FUNCTION
@@ -772,6 +1142,7 @@ namespace yu::frontend
             auto *literal = create_node(ir_t::NODE_LITERAL);
             literal->value.bool_val = ctx->tokens->types[static_cast<std::vector<unsigned>::size_type>(
                                           ctx->state.pos - 1)] == lang::token_i::TRUE;
+            literal->value_kind = value_i::BOOL;
             ctx->current = literal;
             return bt::status_i::SUCCESS;
         }
@@ -785,13 +1156,14 @@ namespace yu::frontend
             auto *literal = create_node(ir_t::NODE_LITERAL);
 
             // Convert string to numeric value
-            std::string numStr(ctx->tokens->starts[start], static_cast<char>(length));
+            std::string numStr(ctx->src + start, length);
             if (length > 2 && numStr[static_cast<std::string::size_type>(0)] == '0')
             {
                 if (numStr[static_cast<std::string::size_type>(1)] == 'x' || numStr[static_cast<std::string::size_type>(
                         1)] == 'X')
                 {
                     literal->value.num_val = std::strtod(numStr.c_str(), nullptr);
+                    literal->value_kind = value_i::NUMBER;
                     ctx->current = literal;
                     return bt::status_i::SUCCESS;
                 }
@@ -799,7 +1171,8 @@ namespace yu::frontend
                         1)] == 'B')
                 {
                     // Binary number
-                    literal->value.num_val = std::strtod(numStr.c_str() + 2, nullptr);
+                    literal->value.num_val = static_cast<double>(std::strtoull(numStr.c_str() + 2, nullptr, 2));
+                    literal->value_kind = value_i::NUMBER;
                     ctx->current = literal;
                     return bt::status_i::SUCCESS;
                 }
@@ -807,6 +1180,7 @@ namespace yu::frontend
 
             // Regular number
             literal->value.num_val = std::strtod(numStr.c_str(), nullptr);
+            literal->value_kind = value_i::NUMBER;
             ctx->current = literal;
             return bt::status_i::SUCCESS;
         }
@@ -820,6 +1194,7 @@ namespace yu::frontend
             auto *literal = create_node(ir_t::NODE_LITERAL);
             literal->value.str_val.text = new char[length];
             literal->value.str_val.length = length;
+            literal->value_kind = value_i::STRING;
             const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
             memcpy(literal->value.str_val.text, value.data(), value.length());
             ctx->current = literal;
@@ -835,6 +1210,7 @@ namespace yu::frontend
             auto *identifier = create_node(ir_t::NODE_IDENTIFIER);
             identifier->value.str_val.text = new char[length];
             identifier->value.str_val.length = length;
+            identifier->value_kind = value_i::STRING;
             const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
             memcpy(identifier->value.str_val.text, value.data(), value.length());
             ctx->current = identifier;
@@ -843,10 +1219,14 @@ namespace yu::frontend
 
         if (match_token(ctx, lang::token_i::LEFT_PAREN) == bt::status_i::SUCCESS)
         {
-            if (parse_expression(ctx) == bt::status_i::SUCCESS &&
-                match_token(ctx, lang::token_i::RIGHT_PAREN) == bt::status_i::SUCCESS)
+            if (parse_expression(ctx) == bt::status_i::SUCCESS)
             {
-                return bt::status_i::SUCCESS;
+                if (match_token(ctx, lang::token_i::RIGHT_PAREN) == bt::status_i::SUCCESS)
+                {
+                    return bt::status_i::SUCCESS;
+                }
+                destroy_node(ctx->current);
+                ctx->current = nullptr;
             }
         }
 
@@ -855,7 +1235,7 @@ namespace yu::frontend
     }
 
     ALWAYS_INLINE HOT_FUNCTION
-    bt::status_i parse_variable(parse_context *ctx)
+    bt::status_i parse_parameter(parse_context *ctx)
     {
         const auto pos_backup = ctx->state.pos;
 
@@ -878,6 +1258,7 @@ namespace yu::frontend
         auto *name_node = create_node(ir_t::NODE_IDENTIFIER);
         name_node->value.str_val.text = new char[name_length];
         name_node->value.str_val.length = name_length;
+        name_node->value_kind = value_i::STRING;
         const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
         memcpy(name_node->value.str_val.text, value.data(), value.length());
         var_node->children.push_back(name_node);
@@ -906,9 +1287,21 @@ namespace yu::frontend
             var_node->children.push_back(ctx->current);
         }
 
+        ctx->current = var_node;
+        return bt::status_i::SUCCESS;
+    }
+
+    ALWAYS_INLINE HOT_FUNCTION
+    bt::status_i parse_variable(parse_context *ctx)
+    {
+        const auto pos_backup = ctx->state.pos;
+        if (parse_parameter(ctx) == bt::status_i::FAILURE)
+            return bt::status_i::FAILURE;
+
         if (match_token(ctx, lang::token_i::SEMICOLON) == bt::status_i::FAILURE)
         {
-            destroy_node(var_node);
+            destroy_node(ctx->current);
+            ctx->current = nullptr;
             ctx->state.pos = pos_backup;
             return bt::status_i::FAILURE;
         }
@@ -931,9 +1324,13 @@ namespace yu::frontend
             return bt::status_i::FAILURE;
         }
 
-        // Initializer
+        // Initializer, with or without its `var`
         if (match_token(ctx, lang::token_i::SEMICOLON) == bt::status_i::FAILURE)
         {
+            if (match_token(ctx, lang::token_i::VAR) == bt::status_i::FAILURE)
+            {
+                match_token(ctx, lang::token_i::CONST);
+            }
             if (parse_variable(ctx) == bt::status_i::FAILURE)
             {
                 destroy_node(for_node);
@@ -978,6 +1375,7 @@ namespace yu::frontend
         }
         for_node->children.push_back(ctx->current);
 
+        ctx->current = for_node;
         return bt::status_i::SUCCESS;
     }
 
@@ -1021,6 +1419,7 @@ namespace yu::frontend
         }
         while_node->children.push_back(ctx->current);
 
+        ctx->current = while_node;
         return bt::status_i::SUCCESS;
     }
 
@@ -1051,6 +1450,7 @@ namespace yu::frontend
             }
         }
 
+        ctx->current = return_node;
         return bt::status_i::SUCCESS;
     }
 
@@ -1071,7 +1471,8 @@ namespace yu::frontend
             lang::token_i::U64, lang::token_i::I64,
             lang::token_i::F32, lang::token_i::F64,
             lang::token_i::STRING, lang::token_i::BOOLEAN,
-            lang::token_i::VOID, lang::token_i::AUTO
+            lang::token_i::VOID, lang::token_i::AUTO,
+            lang::token_i::PTR
         };
 
         for (const auto &basic_type: basic_types)
@@ -1080,9 +1481,8 @@ namespace yu::frontend
             {
                 is_basic_type = true;
                 auto *basic_type_node = create_node(ir_t::NODE_IDENTIFIER);
-                basic_type_node->value.str_val.text = new char[1];
-                basic_type_node->value.str_val.length = 1;
-                basic_type_node->value.str_val.text[0] = static_cast<char>(basic_type);
+                basic_type_node->value.op_val = static_cast<uint8_t>(basic_type);
+                basic_type_node->value_kind = value_i::OP;
                 type_node->children.push_back(basic_type_node);
                 break;
             }
@@ -1105,6 +1505,7 @@ namespace yu::frontend
             auto *name_node = create_node(ir_t::NODE_IDENTIFIER);
             name_node->value.str_val.text = new char[name_length];
             name_node->value.str_val.length = name_length;
+            name_node->value_kind = value_i::STRING;
             const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
             memcpy(name_node->value.str_val.text, value.data(), value.length());
             type_node->children.push_back(name_node);
@@ -1123,6 +1524,7 @@ namespace yu::frontend
             type_node->children.push_back(ctx->current);
         }
 
+        ctx->current = type_node;
         return bt::status_i::SUCCESS;
     }
 
@@ -1146,6 +1548,7 @@ namespace yu::frontend
         }
         while (match_token(ctx, lang::token_i::COMMA) == bt::status_i::SUCCESS);
 
+        ctx->current = generic_list;
         return bt::status_i::SUCCESS;
     }
 
@@ -1168,6 +1571,7 @@ namespace yu::frontend
         auto *name_node = create_node(ir_t::NODE_IDENTIFIER);
         name_node->value.str_val.text = new char[name_length];
         name_node->value.str_val.length = name_length;
+        name_node->value_kind = value_i::STRING;
         const auto value = get_token_value(ctx->src, *ctx->tokens, ctx->state.pos - 1);
         memcpy(name_node->value.str_val.text, value.data(), value.length());
         ctx->current->children.push_back(name_node);
@@ -0,0 +1,1134 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/sema.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include "../../common/hash.hpp"
+
+namespace yu::frontend
+{
+    namespace
+    {
+        uint64_t mix(uint64_t key)
+        {
+            key ^= key >> 33;
+            key *= 0xFF51AFD7ED558CCDULL;
+            return key ^ (key >> 33);
+        }
+
+        uint64_t member_key(const uint32_t type, const uint32_t name)
+        {
+            return static_cast<uint64_t>(type) << 32 | name;
+        }
+
+        std::string_view text(const ir_node *node)
+        {
+            return { node->value.str_val.text, node->value.str_val.length };
+        }
+
+        bool is_name(const ir_node *node)
+        {
+            return node && node->type == ir_t::NODE_IDENTIFIER && node->value_kind == value_i::STRING;
+        }
+
+        /**
+         * @brief Where the name of a class or member sits, past its annotations and visibility.
+         */
+        size_t name_index(const ir_node *node)
+        {
+            size_t index = 0;
+            while (!is_name(node->children[index]))
+                ++index;
+            return index;
+        }
+
+        const char *op_text(const uint8_t op)
+        {
+            switch (static_cast<lang::token_i>(op))
+            {
+                case lang::token_i::PLUS: return "+";
+                case lang::token_i::MINUS: return "-";
+                case lang::token_i::STAR: return "*";
+                case lang::token_i::SLASH: return "/";
+                case lang::token_i::PERCENT: return "%";
+                case lang::token_i::LESS: return "<";
+                case lang::token_i::GREATER: return ">";
+                case lang::token_i::EQUAL: return "==";
+                case lang::token_i::BANG: return "!=";
+                case lang::token_i::AND: return "&";
+                case lang::token_i::OR: return "|";
+                default: return "?";
+            }
+        }
+
+        // Annotations with no meaning to the checker yet, accepted as written
+        constexpr std::string_view other_annotations[] = {
+            "deprecated", "nodiscard", "volatile", "lazy", "pure", "tailrec"
+        };
+
+        constexpr uint32_t MAX_ALIGNMENT = 4096;
+
+        /**
+         * @brief The builtin named by a basic type token, AUTO_TYPE for `auto`.
+         */
+        constexpr uint32_t AUTO_TYPE = interner::NONE;
+
+        uint32_t builtin_type(const uint8_t token)
+        {
+            switch (static_cast<lang::token_i>(token))
+            {
+                case lang::token_i::I8: return types::I8;
+                case lang::token_i::U8: return types::U8;
+                case lang::token_i::I16: return types::I16;
+                case lang::token_i::U16: return types::U16;
+                case lang::token_i::I32: return types::I32;
+                case lang::token_i::U32: return types::U32;
+                case lang::token_i::I64: return types::I64;
+                case lang::token_i::U64: return types::U64;
+                case lang::token_i::F32: return types::F32;
+                case lang::token_i::F64: return types::F64;
+                case lang::token_i::STRING: return types::STRING;
+                case lang::token_i::PTR: return types::PTR;
+                case lang::token_i::BOOLEAN: return types::BOOL;
+                case lang::token_i::VOID: return types::VOID;
+                default: return AUTO_TYPE;
+            }
+        }
+
+        void add_builtins(std::vector<type_info_t> &types)
+        {
+            const auto add = [&](const type_kind_i kind, const uint8_t bits, const bool is_signed)
+            {
+                type_info_t info{};
+                info.kind = kind;
+                info.bits = bits;
+                info.is_signed = is_signed;
+                types.push_back(info);
+            };
+            add(type_kind_i::ERROR, 0, false);
+            add(type_kind_i::VOID, 0, false);
+            add(type_kind_i::BOOL, 8, false);
+            add(type_kind_i::INT, 8, true);
+            add(type_kind_i::INT, 8, false);
+            add(type_kind_i::INT, 16, true);
+            add(type_kind_i::INT, 16, false);
+            add(type_kind_i::INT, 32, true);
+            add(type_kind_i::INT, 32, false);
+            add(type_kind_i::INT, 64, true);
+            add(type_kind_i::INT, 64, false);
+            add(type_kind_i::FLOAT, 32, true);
+            add(type_kind_i::FLOAT, 64, true);
+            add(type_kind_i::STRING, 0, false);
+            add(type_kind_i::POINTER, 64, false);
+            add(type_kind_i::LITERAL, 0, true);
+            add(type_kind_i::LITERAL, 0, true);
+        }
+
+        struct binding_t
+        {
+            uint32_t name;
+            uint32_t type;
+            uint32_t shadowed; // the binding this one hides, NONE if none
+        };
+
+        class checker_t
+        {
+        public:
+            explicit checker_t(semantic_model &model) : model(model) {}
+
+            void import_classes(const ir_node *import, const semantic_model *from);
+            void declare_class(ir_node *class_node);
+            void declare_members(ir_node *class_node);
+            void check_bodies(ir_node *class_node);
+
+        private:
+            semantic_model &model;
+            std::vector<binding_t> bindings;
+            std::vector<uint32_t> scope_stack; // binding count when each open scope was entered
+            flat_map scope_heads;              // name -> innermost binding
+            std::map<std::pair<const semantic_model *, uint32_t>, uint32_t> imported; // origin -> local type
+            uint32_t current_class{types::ERROR};
+            uint32_t return_type{types::VOID};
+            std::string context;
+
+            void error(const std::string &message)
+            {
+                model.errors.push_back(context.empty() ? message : context + ": " + message);
+            }
+
+            [[nodiscard]] bool is_numeric(const uint32_t type) const
+            {
+                const auto kind = model.types[type].kind;
+                return kind == type_kind_i::INT || kind == type_kind_i::FLOAT || kind == type_kind_i::LITERAL;
+            }
+
+            [[nodiscard]] bool is_integral(const uint32_t type) const
+            {
+                return model.types[type].kind == type_kind_i::INT || type == types::INT_LITERAL;
+            }
+
+            /**
+             * @brief Whether a numeric literal of type `literal` converts to `target`.
+             */
+            [[nodiscard]] bool accepts(const uint32_t target, const uint32_t literal) const
+            {
+                const auto kind = model.types[target].kind;
+                return literal == types::INT_LITERAL
+                           ? kind == type_kind_i::INT || kind == type_kind_i::FLOAT
+                           : kind == type_kind_i::FLOAT;
+            }
+
+            [[nodiscard]] bool assignable(const uint32_t from, const uint32_t to) const
+            {
+                if (from == to || from == types::ERROR || to == types::ERROR)
+                    return true;
+                return model.types[from].kind == type_kind_i::LITERAL && accepts(to, from);
+            }
+
+            /**
+             * @brief The type both operands convert to, or NONE.
+             */
+            [[nodiscard]] uint32_t common_type(const uint32_t a, const uint32_t b) const
+            {
+                if (a == b)
+                    return a;
+                const bool a_literal = model.types[a].kind == type_kind_i::LITERAL;
+                const bool b_literal = model.types[b].kind == type_kind_i::LITERAL;
+                if (a_literal && b_literal)
+                    return types::FLOAT_LITERAL;
+                if (a_literal && accepts(b, a))
+                    return b;
+                if (b_literal && accepts(a, b))
+                    return a;
+                return interner::NONE;
+            }
+
+            /**
+             * @brief The type of a member seen through an object of type `owner`. Type ids do not
+             * carry type arguments, so members typed by a class's own parameter are left unchecked
+             * outside that class.
+             */
+            [[nodiscard]] uint32_t member_type(const uint32_t type, const uint32_t owner) const
+            {
+                return model.types[type].kind == type_kind_i::GENERIC && owner != current_class ? types::ERROR : type;
+            }
+
+            /**
+             * @brief The type a variable takes from its initializer when it names none.
+             */
+            static uint32_t settle(const uint32_t type)
+            {
+                if (type == types::INT_LITERAL)
+                    return types::I32;
+                return type == types::FLOAT_LITERAL ? types::F64 : type;
+            }
+
+            void push_scope() { scope_stack.push_back(static_cast<uint32_t>(bindings.size())); }
+
+            void pop_scope()
+            {
+                const uint32_t mark = scope_stack.back();
+                scope_stack.pop_back();
+                while (bindings.size() > mark)
+                {
+                    scope_heads.set(bindings.back().name, bindings.back().shadowed);
+                    bindings.pop_back();
+                }
+            }
+
+            void declare(const std::string_view name, const uint32_t type)
+            {
+                const uint32_t id = model.names.intern(name);
+                const uint32_t head = scope_heads.find(id);
+                if (head != flat_map::NONE && head >= scope_stack.back())
+                {
+                    error("'" + std::string(name) + "' is already declared in this scope");
+                    return;
+                }
+                scope_heads.set(id, static_cast<uint32_t>(bindings.size()));
+                bindings.push_back({ id, type, head });
+            }
+
+            uint32_t copy_type(const semantic_model &from, uint32_t type);
+            void check_annotations(const ir_node *node, type_info_t *class_info, member_t *field);
+            uint32_t resolve_type(ir_node *type_node);
+            uint32_t lookup(ir_node *identifier);
+            const member_t *find_member(ir_node *member, uint32_t &owner);
+            uint32_t check_call(ir_node *call);
+            uint32_t check_expression(ir_node *node);
+            uint32_t check_binary(ir_node *node);
+            void expect_bool(ir_node *condition, const char *what);
+            void check_variable(ir_node *variable, bool is_parameter);
+            void check_statement(ir_node *node);
+        };
+
+        uint32_t checker_t::copy_type(const semantic_model &from, const uint32_t type) // NOLINT(*-no-recursion)
+        {
+            if (type < types::BUILTIN_COUNT)
+                return type;
+
+            const type_info_t &source = from.types[type];
+            if (source.kind == type_kind_i::GENERIC)
+            {
+                // Copied together with the class that declares it, which comes first
+                const auto found = imported.find({ &from, type });
+                return found == imported.end() ? types::ERROR : found->second;
+            }
+
+            const auto [it, inserted] = imported.try_emplace({ source.origin, source.origin_type }, 0);
+            if (!inserted)
+                return it->second;
+
+            const auto local = static_cast<uint32_t>(model.types.size());
+            it->second = local;
+            type_info_t info = source;
+            info.name = model.names.intern(from.names.view(source.name));
+            model.types.push_back(info);
+            for (uint32_t i = 1; i <= source.generic_count; ++i)
+            {
+                type_info_t parameter = from.types[type + i];
+                parameter.name = model.names.intern(from.names.view(parameter.name));
+                model.types.push_back(parameter);
+                imported[{ &from, type + i }] = local + i;
+            }
+            imported[{ &from, type }] = local;
+
+            // Member types may pull in further classes, so map them before appending any member
+            std::vector<member_t> members(from.members.begin() + source.first_member,
+                                          from.members.begin() + source.first_member + source.member_count);
+            std::vector<std::vector<uint32_t>> params(members.size());
+            for (size_t i = 0; i < members.size(); ++i)
+            {
+                members[i].name = model.names.intern(from.names.view(members[i].name));
+                members[i].type = copy_type(from, members[i].type);
+                for (uint32_t p = 0; p < members[i].param_count; ++p)
+                    params[i].push_back(copy_type(from, from.params[members[i].first_param + p]));
+            }
+
+            model.types[local].first_member = static_cast<uint32_t>(model.members.size());
+            for (size_t i = 0; i < members.size(); ++i)
+            {
+                members[i].first_param = static_cast<uint32_t>(model.params.size());
+                model.params.insert(model.params.end(), params[i].begin(), params[i].end());
+                model.member_index.set(member_key(local, members[i].name), static_cast<uint32_t>(model.members.size()));
+                model.members.push_back(members[i]);
+            }
+            return local;
+        }
+
+        void checker_t::import_classes(const ir_node *import, const semantic_model *from)
+        {
+            context = "import from '" + std::string(text(import)) + "'";
+            for (const auto *name_node : import->children)
+            {
+                const std::string_view name = text(name_node);
+                const uint32_t id = model.names.intern(name);
+                if (model.classes.find(id) != flat_map::NONE)
+                {
+                    error("duplicate class '" + std::string(name) + "'");
+                    continue;
+                }
+
+                // A failed import was reported on its own module
+                uint32_t type = types::ERROR;
+                if (from)
+                {
+                    const uint32_t source = from->find_class(name);
+                    if (source == interner::NONE || source == types::ERROR || from->types[source].origin != from)
+                    {
+                        error("module has no class '" + std::string(name) + "'");
+                        continue;
+                    }
+                    type = copy_type(*from, source);
+                }
+                model.classes.set(id, type);
+            }
+            context.clear();
+        }
+
+        /**
+         * @brief Validates the annotations in front of a class (`class_info` set), a field
+         * (`field` set) or a method (neither), recording the layout ones.
+         */
+        void checker_t::check_annotations(const ir_node *node, type_info_t *class_info, member_t *field)
+        {
+            for (const auto *annotation : node->children)
+            {
+                // They come first
+                if (annotation->type != ir_t::NODE_ANNOTATION)
+                    break;
+
+                const std::string name(text(annotation));
+                if (name == "alignas" || name == "aligned")
+                {
+                    const ir_node *argument = annotation->children.size() == 1 ? annotation->children[0] : nullptr;
+                    const double value = argument && argument->type == ir_t::NODE_LITERAL &&
+                                         argument->value_kind == value_i::NUMBER
+                                             ? argument->value.num_val
+                                             : 0;
+                    const auto bytes = static_cast<uint32_t>(value >= 1 && value <= MAX_ALIGNMENT ? value : 0);
+                    if (!class_info && !field)
+                        error("@" + name + " applies only to classes and fields");
+                    else if (bytes == 0 || bytes != value || (bytes & (bytes - 1)))
+                        error("@" + name + " needs one power-of-two argument up to " + std::to_string(MAX_ALIGNMENT));
+                    else
+                        (class_info ? class_info->alignment : field->alignment) = bytes;
+                }
+                else if (name == "packed" || name == "soa")
+                {
+                    if (!class_info)
+                        error("@" + name + " applies only to classes");
+                    else if (!annotation->children.empty())
+                        error("@" + name + " takes no arguments");
+                    else
+                        (name == "packed" ? class_info->packed : class_info->soa) = true;
+                }
+                else if (std::find(std::begin(other_annotations), std::end(other_annotations), name) ==
+                         std::end(other_annotations))
+                {
+                    error("unknown annotation '@" + name + "'");
+                }
+            }
+        }
+
+        void checker_t::declare_class(ir_node *class_node)
+        {
+            const size_t name_at = name_index(class_node);
+            const std::string_view name = text(class_node->children[name_at]);
+            const uint32_t id = model.names.intern(name);
+            if (model.classes.find(id) != flat_map::NONE)
+            {
+                error("duplicate class '" + std::string(name) + "'");
+                return;
+            }
+
+            const auto type = static_cast<uint32_t>(model.types.size());
+            type_info_t info{};
+            info.kind = type_kind_i::CLASS;
+            info.name = id;
+            info.origin = &model;
+            info.origin_type = type;
+            model.types.push_back(info);
+            model.classes.set(id, type);
+            class_node->resolved_type = type;
+
+            context = std::string(name);
+            check_annotations(class_node, &model.types[type], nullptr);
+
+            // class Name<T, U>: one NODE_TYPE per parameter under a NODE_TYPE list
+            const ir_node *parameters = class_node->children[name_at + 1];
+            if (parameters->type != ir_t::NODE_TYPE)
+            {
+                context.clear();
+                return;
+            }
+            for (auto *parameter : parameters->children)
+            {
+                const ir_node *head = parameter->children[0];
+                if (!is_name(head) || parameter->children.size() > 1)
+                {
+                    error("type parameters must be plain names");
+                    continue;
+                }
+                const uint32_t parameter_name = model.names.intern(text(head));
+                bool duplicate = false;
+                for (uint32_t i = 1; i <= model.types[type].generic_count; ++i)
+                    duplicate |= model.types[type + i].name == parameter_name;
+                if (duplicate)
+                {
+                    error("duplicate type parameter '" + std::string(text(head)) + "'");
+                    continue;
+                }
+
+                type_info_t generic{};
+                generic.kind = type_kind_i::GENERIC;
+                generic.name = parameter_name;
+                parameter->resolved_type = static_cast<uint32_t>(model.types.size());
+                model.types.push_back(generic);
+                ++model.types[type].generic_count;
+            }
+            context.clear();
+        }
+
+        uint32_t checker_t::resolve_type(ir_node *type_node) // NOLINT(*-no-recursion)
+        {
+            const ir_node *head = type_node->children[0];
+            uint32_t type = types::ERROR;
+            if (head->value_kind == value_i::OP)
+            {
+                type = builtin_type(head->value.op_val);
+            }
+            else
+            {
+                const std::string_view name = text(head);
+                const uint32_t id = model.names.find(name);
+                uint32_t found = interner::NONE;
+                if (id != interner::NONE)
+                {
+                    const type_info_t &owner = model.types[current_class];
+                    for (uint32_t i = 1; i <= owner.generic_count && found == interner::NONE; ++i)
+                    {
+                        if (model.types[current_class + i].name == id)
+                            found = current_class + i;
+                    }
+                    if (found == interner::NONE)
+                        found = model.classes.find(id);
+                }
+                if (found == interner::NONE)
+                {
+                    error("unknown type '" + std::string(name) + "'");
+                    return types::ERROR;
+                }
+                type = found;
+            }
+
+            const uint32_t expected = type == types::PTR ? 1 : type == AUTO_TYPE ? 0 : model.types[type].generic_count;
+            uint32_t given = 0;
+            if (type_node->children.size() > 1)
+            {
+                for (auto *argument : type_node->children[1]->children)
+                {
+                    const uint32_t argument_type = resolve_type(argument);
+                    if (argument_type == types::VOID || argument_type == AUTO_TYPE)
+                        error("'" + model.type_name(argument_type) + "' is not a type argument");
+                    ++given;
+                }
+            }
+
+            // Generic classes are checked by their declaration, so arguments only need to be well-formed
+            if (type != types::ERROR && given != expected && !(given == 0 && type == current_class))
+            {
+                error("'" + model.type_name(type) + "' takes " + std::to_string(expected) + " type argument" +
+                      (expected == 1 ? "" : "s") + ", got " + std::to_string(given));
+            }
+            type_node->resolved_type = type == AUTO_TYPE ? types::ERROR : type;
+            return type;
+        }
+
+        void checker_t::declare_members(ir_node *class_node)
+        {
+            const uint32_t type = class_node->resolved_type;
+            current_class = type;
+            context = model.type_name(type);
+            model.types[type].first_member = static_cast<uint32_t>(model.members.size());
+
+            for (auto *member : class_node->children.back()->children)
+            {
+                const auto &children = member->children;
+                const size_t name_at = name_index(member);
+                const std::string_view name = text(children[name_at]);
+
+                member_t info{};
+                info.name = model.names.intern(name);
+                const bool is_field = member->type == ir_t::NODE_FIELD;
+                check_annotations(member, nullptr, is_field ? &info : nullptr);
+                if (is_field)
+                {
+                    info.type = resolve_type(children[name_at + 1]);
+                    if (info.type == AUTO_TYPE || info.type == types::VOID)
+                    {
+                        error("field '" + std::string(name) + "' needs a concrete type");
+                        info.type = types::ERROR;
+                    }
+                }
+                else
+                {
+                    info.is_method = true;
+                    info.type = types::VOID;
+                    info.first_param = static_cast<uint32_t>(model.params.size());
+                    for (size_t i = name_at + 1; i + 1 < children.size(); ++i)
+                    {
+                        if (children[i]->type == ir_t::NODE_TYPE)
+                        {
+                            info.type = resolve_type(children[i]);
+                            if (info.type == AUTO_TYPE)
+                            {
+                                error("method '" + std::string(name) + "' needs a concrete return type");
+                                info.type = types::ERROR;
+                            }
+                            continue;
+                        }
+                        const ir_node *parameter = children[i];
+                        uint32_t parameter_type = types::ERROR;
+                        if (parameter->children.size() < 2 || parameter->children[1]->type != ir_t::NODE_TYPE)
+                            error("parameter '" + std::string(text(parameter->children[0])) + "' needs a type");
+                        else
+                            parameter_type = resolve_type(parameter->children[1]);
+                        if (parameter_type == AUTO_TYPE || parameter_type == types::VOID)
+                        {
+                            error("parameter '" + std::string(text(parameter->children[0])) +
+                                  "' needs a concrete type");
+                            parameter_type = types::ERROR;
+                        }
+                        model.params.push_back(parameter_type);
+                        ++info.param_count;
+                    }
+                }
+                member->resolved_type = info.type;
+
+                const uint64_t key = member_key(type, info.name);
+                if (model.member_index.find(key) != flat_map::NONE)
+                {
+                    error("duplicate member '" + std::string(name) + "'");
+                    continue;
+                }
+                model.member_index.set(key, static_cast<uint32_t>(model.members.size()));
+                model.members.push_back(info);
+                ++model.types[type].member_count;
+            }
+            context.clear();
+        }
+
+        uint32_t checker_t::lookup(ir_node *identifier)
+        {
+            // Locals and parameters, then `self`, then fields of the enclosing class
+            const std::string_view name = text(identifier);
+            const uint32_t id = model.names.find(name);
+            const uint32_t binding = id == interner::NONE ? flat_map::NONE : scope_heads.find(id);
+            if (binding != flat_map::NONE)
+                return bindings[binding].type;
+            if (name == "self")
+                return current_class;
+
+            const uint32_t member = id == interner::NONE ? flat_map::NONE
+                                                         : model.member_index.find(member_key(current_class, id));
+            if (member == flat_map::NONE)
+            {
+                error("unknown identifier '" + std::string(name) + "'");
+                return types::ERROR;
+            }
+            if (model.members[member].is_method)
+            {
+                error("method '" + std::string(name) + "' cannot be used as a value");
+                return types::ERROR;
+            }
+            return model.members[member].type;
+        }
+
+        const member_t *checker_t::find_member(ir_node *member, uint32_t &owner) // NOLINT(*-no-recursion)
+        {
+            owner = check_expression(member->children[0]);
+            if (owner == types::ERROR)
+                return nullptr;
+
+            const std::string_view name = text(member);
+            if (model.types[owner].kind == type_kind_i::CLASS)
+            {
+                const uint32_t id = model.names.find(name);
+                const uint32_t found = id == interner::NONE ? flat_map::NONE
+                                                            : model.member_index.find(member_key(owner, id));
+                if (found != flat_map::NONE)
+                    return &model.members[found];
+            }
+            error("'" + model.type_name(owner) + "' has no member '" + std::string(name) + "'");
+            return nullptr;
+        }
+
+        uint32_t checker_t::check_call(ir_node *call) // NOLINT(*-no-recursion)
+        {
+            ir_node *callee = call->children[0];
+            const member_t *method = nullptr;
+            uint32_t owner = current_class;
+            if (callee->type == ir_t::NODE_MEMBER)
+            {
+                method = find_member(callee, owner);
+            }
+            else if (callee->type == ir_t::NODE_IDENTIFIER)
+            {
+                // A method of the enclosing class, unless a local of that name hides it
+                const uint32_t id = model.names.find(text(callee));
+                if (id != interner::NONE && scope_heads.find(id) == flat_map::NONE)
+                {
+                    const uint32_t found = model.member_index.find(member_key(current_class, id));
+                    if (found != flat_map::NONE)
+                        method = &model.members[found];
+                }
+                if (!method)
+                    check_expression(callee);
+            }
+            else if (check_expression(callee) != types::ERROR)
+            {
+                error("expression cannot be called");
+            }
+
+            const std::string name = method ? std::string(model.names.view(method->name)) : std::string();
+            if (method && !method->is_method)
+            {
+                error("'" + name + "' is a field, not a method");
+                method = nullptr;
+            }
+
+            const size_t count = call->children.size() - 1;
+            if (method && count != method->param_count)
+            {
+                error("'" + name + "' takes " + std::to_string(method->param_count) + " argument" +
+                      (method->param_count == 1 ? "" : "s") + ", got " + std::to_string(count));
+                method = nullptr;
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                const uint32_t argument = check_expression(call->children[i + 1]);
+                if (!method)
+                    continue;
+                const uint32_t parameter = member_type(model.params[method->first_param + i], owner);
+                if (!assignable(argument, parameter))
+                    error("argument " + std::to_string(i + 1) + " of '" + name + "': cannot pass '" +
+                          model.type_name(argument) + "' as '" + model.type_name(parameter) + "'");
+            }
+
+            const uint32_t type = method ? member_type(method->type, owner) : types::ERROR;
+            callee->resolved_type = type;
+            return type;
+        }
+
+        uint32_t checker_t::check_binary(ir_node *node) // NOLINT(*-no-recursion)
+        {
+            const uint32_t left = check_expression(node->children[0]);
+            const uint32_t right = check_expression(node->children[1]);
+            if (left == types::ERROR || right == types::ERROR)
+                return types::ERROR;
+
+            const auto op = static_cast<lang::token_i>(node->value.op_val);
+            const uint32_t common = common_type(left, right);
+            uint32_t result = interner::NONE;
+            switch (op)
+            {
+                case lang::token_i::PLUS:
+                    if (common == types::STRING)
+                    {
+                        result = types::STRING;
+                        break;
+                    }
+                    [[fallthrough]];
+                case lang::token_i::MINUS:
+                case lang::token_i::STAR:
+                case lang::token_i::SLASH:
+                    if (common != interner::NONE && is_numeric(common))
+                        result = common;
+                    break;
+                case lang::token_i::PERCENT:
+                    if (common != interner::NONE && is_integral(common))
+                        result = common;
+                    break;
+                case lang::token_i::LESS:
+                case lang::token_i::GREATER:
+                    if (common != interner::NONE && is_numeric(common))
+                        result = types::BOOL;
+                    break;
+                case lang::token_i::EQUAL:
+                case lang::token_i::BANG:
+                    if (common != interner::NONE)
+                        result = types::BOOL;
+                    break;
+                case lang::token_i::AND:
+                case lang::token_i::OR:
+                    if (common == types::BOOL || (common != interner::NONE && is_integral(common)))
+                        result = common;
+                    break;
+                default:
+                    break;
+            }
+
+            if (result == interner::NONE)
+            {
+                error(std::string("operator '") + op_text(node->value.op_val) + "' cannot take '" +
+                      model.type_name(left) + "' and '" + model.type_name(right) + "'");
+                return types::ERROR;
+            }
+            return result;
+        }
+
+        uint32_t checker_t::check_expression(ir_node *node) // NOLINT(*-no-recursion)
+        {
+            uint32_t type = types::ERROR;
+            switch (node->type)
+            {
+                case ir_t::NODE_LITERAL:
+                    if (node->value_kind == value_i::BOOL)
+                        type = types::BOOL;
+                    else if (node->value_kind == value_i::STRING)
+                        type = types::STRING;
+                    else
+                        type = std::trunc(node->value.num_val) == node->value.num_val
+                                   ? types::INT_LITERAL
+                                   : types::FLOAT_LITERAL;
+                    break;
+                case ir_t::NODE_IDENTIFIER:
+                    type = lookup(node);
+                    break;
+                case ir_t::NODE_UNARY_OP:
+                {
+                    const uint32_t operand = check_expression(node->children[0]);
+                    const bool negate = static_cast<lang::token_i>(node->value.op_val) == lang::token_i::MINUS;
+                    if (operand == types::ERROR)
+                        break;
+                    if (negate ? is_numeric(operand) : operand == types::BOOL)
+                        type = operand;
+                    else
+                        error(std::string("operator '") + (negate ? "-" : "!") + "' cannot take '" +
+                              model.type_name(operand) + "'");
+                    break;
+                }
+                case ir_t::NODE_BINARY_OP:
+                    type = check_binary(node);
+                    break;
+                case ir_t::NODE_MEMBER:
+                {
+                    uint32_t owner;
+                    const member_t *member = find_member(node, owner);
+                    if (member && member->is_method)
+                        error("method '" + std::string(text(node)) + "' cannot be used as a value");
+                    else if (member)
+                        type = member_type(member->type, owner);
+                    break;
+                }
+                case ir_t::NODE_CALL:
+                    type = check_call(node);
+                    break;
+                case ir_t::NODE_ASSIGN:
+                {
+                    ir_node *target = node->children[0];
+                    const uint32_t value = check_expression(node->children[1]);
+                    if (target->type != ir_t::NODE_IDENTIFIER && target->type != ir_t::NODE_MEMBER)
+                    {
+                        check_expression(target);
+                        error("cannot assign to an expression");
+                        break;
+                    }
+                    type = check_expression(target);
+                    if (!assignable(value, type))
+                    {
+                        error("cannot assign '" + model.type_name(value) + "' to '" + std::string(text(target)) +
+                              "' of type '" + model.type_name(type) + "'");
+                    }
+                    break;
+                }
+                default:
+                    error("expected an expression");
+                    break;
+            }
+            node->resolved_type = type;
+            return type;
+        }
+
+        void checker_t::expect_bool(ir_node *condition, const char *what)
+        {
+            const uint32_t type = check_expression(condition);
+            if (type != types::BOOL && type != types::ERROR)
+                error(std::string(what) + " must be 'boolean', not '" + model.type_name(type) + "'");
+        }
+
+        void checker_t::check_variable(ir_node *variable, const bool is_parameter)
+        {
+            const auto &children = variable->children;
+            const std::string_view name = text(children[0]);
+            const bool has_type = children.size() > 1 && children[1]->type == ir_t::NODE_TYPE;
+            ir_node *init = children.size() > (has_type ? 2u : 1u) ? children.back() : nullptr;
+
+            uint32_t type = has_type ? resolve_type(children[1]) : AUTO_TYPE;
+            if (type == types::VOID)
+            {
+                error("variable '" + std::string(name) + "' cannot be 'void'");
+                type = types::ERROR;
+            }
+            if (init)
+            {
+                const uint32_t value = check_expression(init);
+                if (type == AUTO_TYPE)
+                    type = settle(value);
+                else if (!assignable(value, type))
+                    error("cannot initialize '" + std::string(name) + "' of type '" + model.type_name(type) +
+                          "' with '" + model.type_name(value) + "'");
+            }
+            else if (type == AUTO_TYPE)
+            {
+                // Parameters without a type were reported with the signature
+                if (!is_parameter)
+                    error("variable '" + std::string(name) + "' needs a type or an initializer");
+                type = types::ERROR;
+            }
+
+            variable->resolved_type = type;
+            declare(name, type);
+        }
+
+        void checker_t::check_statement(ir_node *node) // NOLINT(*-no-recursion)
+        {
+            switch (node->type)
+            {
+                case ir_t::NODE_BLOCK:
+                    push_scope();
+                    for (auto *statement : node->children)
+                        check_statement(statement);
+                    pop_scope();
+                    break;
+                case ir_t::NODE_VARIABLE:
+                    check_variable(node, false);
+                    break;
+                case ir_t::NODE_IF:
+                    expect_bool(node->children[0], "condition");
+                    for (size_t i = 1; i < node->children.size(); ++i)
+                    {
+                        push_scope();
+                        check_statement(node->children[i]);
+                        pop_scope();
+                    }
+                    break;
+                case ir_t::NODE_LOOP:
+                {
+                    // while: condition, body; for: [variable], [condition], [step], body
+                    push_scope();
+                    bool seen_condition = false;
+                    for (size_t i = 0; i + 1 < node->children.size(); ++i)
+                    {
+                        ir_node *part = node->children[i];
+                        if (part->type == ir_t::NODE_VARIABLE)
+                        {
+                            check_variable(part, false);
+                        }
+                        else if (!seen_condition && part->type != ir_t::NODE_ASSIGN)
+                        {
+                            expect_bool(part, "condition");
+                            seen_condition = true;
+                        }
+                        else
+                        {
+                            check_expression(part);
+                        }
+                    }
+                    check_statement(node->children.back());
+                    pop_scope();
+                    break;
+                }
+                case ir_t::NODE_RETURN:
+                {
+                    if (node->children.empty())
+                    {
+                        if (return_type != types::VOID && return_type != types::ERROR)
+                            error("missing return value of type '" + model.type_name(return_type) + "'");
+                        break;
+                    }
+                    const uint32_t value = check_expression(node->children[0]);
+                    if (return_type == types::VOID)
+                        error("method without a return type returns a value");
+                    else if (!assignable(value, return_type))
+                        error("cannot return '" + model.type_name(value) + "' from a method returning '" +
+                              model.type_name(return_type) + "'");
+                    break;
+                }
+                default:
+                    check_expression(node);
+                    break;
+            }
+        }
+
+        void checker_t::check_bodies(ir_node *class_node)
+        {
+            const uint32_t type = class_node->resolved_type;
+            const std::string class_name = model.type_name(type);
+            current_class = type;
+
+            for (auto *member : class_node->children.back()->children)
+            {
+                auto &children = member->children;
+                const size_t name_at = name_index(member);
+                context = class_name + "." + std::string(text(children[name_at]));
+
+                if (member->type == ir_t::NODE_FIELD)
+                {
+                    if (children.size() > name_at + 2)
+                    {
+                        const uint32_t value = check_expression(children.back());
+                        if (!assignable(value, member->resolved_type))
+                            error("cannot initialize a field of type '" + model.type_name(member->resolved_type) +
+                                  "' with '" + model.type_name(value) + "'");
+                    }
+                    continue;
+                }
+
+                // Parameters share the body's scope, so a local cannot hide one
+                return_type = member->resolved_type;
+                push_scope();
+                for (size_t i = name_at + 1; i + 1 < children.size(); ++i)
+                {
+                    if (children[i]->type == ir_t::NODE_VARIABLE)
+                        check_variable(children[i], true);
+                }
+                for (auto *statement : children.back()->children)
+                    check_statement(statement);
+                pop_scope();
+            }
+            context.clear();
+        }
+    }
+
+    size_t interner::probe(const std::string_view name, const uint32_t hash) const
+    {
+        const size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            const slot_t &slot = slots[i];
+            if (slot.id == NONE)
+                return i;
+            if (slot.hash == hash)
+            {
+                const uint32_t length = offsets[slot.id + 1] - offsets[slot.id];
+                if (length == name.size() && std::memcmp(text.data() + offsets[slot.id], name.data(), length) == 0)
+                    return i;
+            }
+        }
+    }
+
+    void interner::grow()
+    {
+        std::vector<slot_t> old(slots.empty() ? 64 : slots.size() * 2, slot_t{ 0, NONE });
+        old.swap(slots);
+        const size_t mask = slots.size() - 1;
+        for (const slot_t &slot : old)
+        {
+            if (slot.id == NONE)
+                continue;
+            size_t i = slot.hash & mask;
+            while (slots[i].id != NONE)
+                i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+    uint32_t interner::intern(const std::string_view name)
+    {
+        // Kept at most half full, so probes stay short
+        if ((size() + 1) * 2 > slots.size())
+            grow();
+
+        const auto hash = static_cast<uint32_t>(hash64(name.data(), name.size()));
+        slot_t &slot = slots[probe(name, hash)];
+        if (slot.id == NONE)
+        {
+            slot = { hash, size() };
+            text.insert(text.end(), name.begin(), name.end());
+            offsets.push_back(static_cast<uint32_t>(text.size()));
+        }
+        return slot.id;
+    }
+
+    uint32_t interner::find(const std::string_view name) const
+    {
+        if (slots.empty())
+            return NONE;
+        return slots[probe(name, static_cast<uint32_t>(hash64(name.data(), name.size())))].id;
+    }
+
+    std::string_view interner::view(const uint32_t id) const
+    {
+        return { text.data() + offsets[id], offsets[id + 1] - offsets[id] };
+    }
+
+    uint32_t flat_map::find(const uint64_t key) const
+    {
+        if (slots.empty())
+            return NONE;
+        const size_t mask = slots.size() - 1;
+        for (size_t i = mix(key) & mask;; i = (i + 1) & mask)
+        {
+            if (slots[i].key == key)
+                return slots[i].value;
+            if (slots[i].key == EMPTY)
+                return NONE;
+        }
+    }
+
+    void flat_map::set(const uint64_t key, const uint32_t value)
+    {
+        if ((used + 1) * 2 > slots.size())
+            grow();
+        const size_t mask = slots.size() - 1;
+        size_t i = mix(key) & mask;
+        while (slots[i].key != key && slots[i].key != EMPTY)
+            i = (i + 1) & mask;
+        used += slots[i].key == EMPTY;
+        slots[i] = { key, value };
+    }
+
+    void flat_map::grow()
+    {
+        std::vector<slot_t> old(slots.empty() ? 16 : slots.size() * 2, slot_t{ EMPTY, NONE });
+        old.swap(slots);
+        const size_t mask = slots.size() - 1;
+        for (const slot_t &slot : old)
+        {
+            if (slot.key == EMPTY)
+                continue;
+            size_t i = mix(slot.key) & mask;
+            while (slots[i].key != EMPTY)
+                i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+    uint32_t semantic_model::find_class(const std::string_view name) const
+    {
+        const uint32_t id = names.find(name);
+        return id == interner::NONE ? interner::NONE : classes.find(id);
+    }
+
+    const member_t *semantic_model::find_member(const uint32_t type, const std::string_view name) const
+    {
+        const uint32_t id = names.find(name);
+        if (id == interner::NONE)
+            return nullptr;
+        const uint32_t member = member_index.find(member_key(type, id));
+        return member == flat_map::NONE ? nullptr : &members[member];
+    }
+
+    std::string semantic_model::type_name(const uint32_t type) const
+    {
+        static constexpr const char *builtin_names[] = {
+            "<error>", "void", "boolean", "i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64", "f32", "f64",
+            "string", "Ptr", "integer literal", "float literal"
+        };
+        if (type < types::BUILTIN_COUNT)
+            return builtin_names[type];
+        if (type >= this->types.size())
+            return "auto";
+        return std::string(names.view(this->types[type].name));
+    }
+
+    bool analyze(ir_node *module, semantic_model &model, const std::vector<const semantic_model *> &imports)
+    {
+        model = semantic_model{};
+        add_builtins(model.types);
+        checker_t checker(model);
+
+        // Imports, then every class name, so members can name classes declared after them
+        size_t import_index = 0;
+        for (const auto *child : module->children)
+        {
+            if (child->type == ir_t::NODE_IMPORT)
+            {
+                checker.import_classes(child, import_index < imports.size() ? imports[import_index] : nullptr);
+                ++import_index;
+            }
+        }
+        for (auto *child : module->children)
+        {
+            if (child->type == ir_t::NODE_CLASS)
+                checker.declare_class(child);
+        }
+        for (auto *child : module->children)
+        {
+            if (child->type == ir_t::NODE_CLASS && child->resolved_type != types::ERROR)
+                checker.declare_members(child);
+        }
+        for (auto *child : module->children)
+        {
+            if (child->type == ir_t::NODE_CLASS && child->resolved_type != types::ERROR)
+                checker.check_bodies(child);
+        }
+        return model.errors.empty();
+    }
+}
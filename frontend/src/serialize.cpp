@@ -0,0 +1,217 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/serialize.h"
+
+#include <cstring>
+#include <vector>
+
+namespace yu::frontend
+{
+    namespace
+    {
+        struct flat_tree_t
+        {
+            std::vector<uint8_t> types;
+            std::vector<value_i> kinds;
+            std::vector<uint32_t> ends;
+            std::vector<uint64_t> values;
+            std::vector<uint32_t> string_offsets{0};
+            std::vector<char> strings;
+        };
+
+        uint64_t pack_value(const ir_node &node, flat_tree_t &tree)
+        {
+            switch (node.value_kind)
+            {
+                case value_i::STRING:
+                {
+                    const auto &text = node.value.str_val;
+                    tree.strings.insert(tree.strings.end(), text.text, text.text + text.length);
+                    tree.string_offsets.push_back(static_cast<uint32_t>(tree.strings.size()));
+                    return tree.string_offsets.size() - 2;
+                }
+                case value_i::NUMBER:
+                {
+                    uint64_t bits;
+                    std::memcpy(&bits, &node.value.num_val, sizeof(bits));
+                    return bits;
+                }
+                case value_i::BOOL:
+                    return node.value.bool_val;
+                case value_i::OP:
+                    return node.value.op_val;
+                default:
+                    return 0;
+            }
+        }
+
+        void flatten(const ir_node *node, flat_tree_t &tree) // NOLINT(*-no-recursion)
+        {
+            const size_t index = tree.types.size();
+            tree.types.push_back(node ? static_cast<uint8_t>(node->type) : NULL_NODE);
+            tree.kinds.push_back(node ? node->value_kind : value_i::NONE);
+            tree.ends.push_back(0);
+            tree.values.push_back(node ? pack_value(*node, tree) : 0);
+
+            if (node)
+            {
+                for (const auto *child : node->children)
+                    flatten(child, tree);
+            }
+            tree.ends[index] = static_cast<uint32_t>(tree.types.size());
+        }
+
+        ir_node *rebuild(const ast_view_t &view, const size_t index) // NOLINT(*-no-recursion)
+        {
+            if (view.types[index] == NULL_NODE)
+                return nullptr;
+
+            auto *node = new ir_node();
+            node->type = static_cast<ir_t>(view.types[index]);
+            node->value_kind = view.kinds[index];
+            switch (node->value_kind)
+            {
+                case value_i::STRING:
+                {
+                    const std::string_view text = view.string(index);
+                    node->value.str_val.text = new char[text.size()];
+                    node->value.str_val.length = text.size();
+                    if (!text.empty())
+                        std::memcpy(node->value.str_val.text, text.data(), text.size());
+                    break;
+                }
+                case value_i::NUMBER:
+                    node->value.num_val = view.number(index);
+                    break;
+                case value_i::BOOL:
+                    node->value.bool_val = view.values[index] != 0;
+                    break;
+                case value_i::OP:
+                    node->value.op_val = static_cast<uint8_t>(view.values[index]);
+                    break;
+                default:
+                    break;
+            }
+
+            for (size_t child = index + 1; child < view.ends[index]; child = view.ends[child])
+                node->children.push_back(rebuild(view, child));
+            return node;
+        }
+    }
+
+    std::string_view ast_view_t::string(const size_t node) const
+    {
+        const uint64_t index = values[node];
+        return { strings + string_offsets[index], string_offsets[index + 1] - string_offsets[index] };
+    }
+
+    double ast_view_t::number(const size_t node) const
+    {
+        double value;
+        std::memcpy(&value, &values[node], sizeof(value));
+        return value;
+    }
+
+    void add_source_info(binary::writer &out, const source_info_t &info)
+    {
+        out.add(section::SOURCE, &info, sizeof(info), sizeof(info));
+    }
+
+    void add_tokens(binary::writer &out, const Lexer &lexer)
+    {
+        out.add_array(section::TOKEN_STARTS, lexer.tokens.starts);
+        out.add_array(section::TOKEN_LENGTHS, lexer.tokens.lengths);
+        out.add_array(section::TOKEN_TYPES, lexer.tokens.types);
+        out.add_array(section::TOKEN_FLAGS, lexer.tokens.flags);
+        out.add_array(section::LINE_STARTS, lexer.line_starts);
+    }
+
+    void add_ast(binary::writer &out, const ir_node *root)
+    {
+        flat_tree_t tree;
+        if (root)
+            flatten(root, tree);
+
+        out.add_array(section::AST_TYPES, tree.types);
+        out.add_array(section::AST_KINDS, tree.kinds);
+        out.add_array(section::AST_ENDS, tree.ends);
+        out.add_array(section::AST_VALUES, tree.values);
+        out.add_array(section::AST_STRING_OFFSETS, tree.string_offsets);
+        out.add_array(section::AST_STRINGS, tree.strings);
+    }
+
+    bool read_source_info(const binary::reader &in, source_info_t &info)
+    {
+        size_t count;
+        const auto *stored = in.array<source_info_t>(section::SOURCE, count);
+        if (!stored || count != 1)
+            return false;
+        info = *stored;
+        return true;
+    }
+
+    bool read_tokens(const binary::reader &in, token_view_t &view)
+    {
+        size_t starts, lengths, types, flags;
+        view.starts = in.array<uint32_t>(section::TOKEN_STARTS, starts);
+        view.lengths = in.array<uint16_t>(section::TOKEN_LENGTHS, lengths);
+        view.types = in.array<lang::token_i>(section::TOKEN_TYPES, types);
+        view.flags = in.array<uint8_t>(section::TOKEN_FLAGS, flags);
+        view.line_starts = in.array<uint32_t>(section::LINE_STARTS, view.line_count);
+        view.size = starts;
+
+        // Null only when a section is missing or holds another element type; empty ones still point somewhere
+        return view.starts && view.lengths && view.types && view.flags && view.line_starts &&
+               lengths == starts && types == starts && flags == starts;
+    }
+
+    bool read_ast(const binary::reader &in, ast_view_t &view)
+    {
+        size_t kinds, ends, values, offsets;
+        view.types = in.array<uint8_t>(section::AST_TYPES, view.size);
+        view.kinds = in.array<value_i>(section::AST_KINDS, kinds);
+        view.ends = in.array<uint32_t>(section::AST_ENDS, ends);
+        view.values = in.array<uint64_t>(section::AST_VALUES, values);
+        view.string_offsets = in.array<uint32_t>(section::AST_STRING_OFFSETS, offsets);
+        size_t string_bytes;
+        view.strings = in.array<char>(section::AST_STRINGS, string_bytes);
+
+        if (!view.types || !view.kinds || !view.ends || !view.values || !view.string_offsets || !view.strings ||
+            kinds != view.size || ends != view.size || values != view.size || offsets == 0)
+            return false;
+        view.string_count = offsets - 1;
+
+        for (size_t i = 0; i < offsets; ++i)
+        {
+            if (view.string_offsets[i] > string_bytes || (i && view.string_offsets[i] < view.string_offsets[i - 1]))
+                return false;
+        }
+
+        // One root spanning every node; each subtree ends inside the one enclosing it
+        if (view.size && view.ends[0] != view.size)
+            return false;
+        std::vector<uint32_t> open;
+        for (size_t i = 0; i < view.size; ++i)
+        {
+            while (!open.empty() && open.back() <= i)
+                open.pop_back();
+            const uint32_t limit = open.empty() ? static_cast<uint32_t>(view.size) : open.back();
+            if (view.ends[i] <= i || view.ends[i] > limit)
+                return false;
+            if (view.types[i] == NULL_NODE && view.ends[i] != i + 1)
+                return false;
+            if (view.kinds[i] > value_i::OP)
+                return false;
+            if (view.kinds[i] == value_i::STRING && view.values[i] >= view.string_count)
+                return false;
+            open.push_back(view.ends[i]);
+        }
+        return true;
+    }
+
+    ir_node *build_tree(const ast_view_t &view)
+    {
+        return view.size ? rebuild(view, 0) : nullptr;
+    }
+}
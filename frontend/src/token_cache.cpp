@@ -0,0 +1,97 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/token_cache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include "../../common/hash.hpp"
+#include "../include/serialize.h"
+
+namespace yu::frontend
+{
+    namespace
+    {
+        std::string entry_path(const std::string &directory, const uint64_t hash)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "%016llx.ytok", static_cast<unsigned long long>(hash));
+            return (std::filesystem::path(directory) / name).string();
+        }
+
+        template<typename T>
+        void copy_section(std::vector<T> &out, const T *data, const size_t count)
+        {
+            out.assign(data, data + count);
+        }
+
+        /**
+         * @brief Guards the parser against entries that match in size but not in content:
+         * every token must lie inside the source and end with END_OF_FILE, line starts must ascend.
+        */
+        bool tokens_fit(const Lexer &lexer)
+        {
+            const auto &tokens = lexer.tokens;
+            if (tokens.size() == 0 || tokens.types.back() != lang::token_i::END_OF_FILE)
+                return false;
+            for (size_t i = 0; i < tokens.size(); ++i)
+            {
+                if (static_cast<uint64_t>(tokens.starts[i]) + tokens.lengths[i] > lexer.src_length)
+                    return false;
+            }
+
+            if (lexer.line_starts.empty() || lexer.line_starts.front() != 0)
+                return false;
+            for (size_t i = 1; i < lexer.line_starts.size(); ++i)
+            {
+                if (lexer.line_starts[i] <= lexer.line_starts[i - 1] || lexer.line_starts[i] > lexer.src_length)
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    uint64_t source_hash(const std::string_view src)
+    {
+        return hash64(src.data(), src.size());
+    }
+
+    bool load_cached_tokens(const std::string &directory, const std::string_view src, const uint64_t hash,
+                            Lexer &lexer)
+    {
+        binary::reader entry;
+        if (!entry.open(entry_path(directory, hash)))
+            return false;
+
+        source_info_t info{};
+        token_view_t tokens{};
+        if (!read_source_info(entry, info) || info.hash != hash || info.size != src.size() ||
+            info.lexer_version != LEXER_VERSION || !read_tokens(entry, tokens))
+            return false;
+
+        lexer = Lexer{};
+        lexer.src = src.data();
+        lexer.src_length = static_cast<uint32_t>(src.size());
+        copy_section(lexer.tokens.starts, tokens.starts, tokens.size);
+        copy_section(lexer.tokens.lengths, tokens.lengths, tokens.size);
+        copy_section(lexer.tokens.types, tokens.types, tokens.size);
+        copy_section(lexer.tokens.flags, tokens.flags, tokens.size);
+        copy_section(lexer.line_starts, tokens.line_starts, tokens.line_count);
+
+        if (!tokens_fit(lexer))
+        {
+            lexer = Lexer{};
+            return false;
+        }
+        lexer.current_pos = lexer.tokens.starts.back();
+        return true;
+    }
+
+    bool store_cached_tokens(const std::string &directory, const uint64_t hash, const Lexer &lexer)
+    {
+        binary::writer entry;
+        add_source_info(entry, { hash, lexer.src_length, LEXER_VERSION });
+        add_tokens(entry, lexer);
+        return entry.write(entry_path(directory, hash));
+    }
+}
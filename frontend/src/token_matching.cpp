@@ -1,14 +1,60 @@
 // This file is part of the Yu programming language and is licensed under MIT License;
 // See LICENSE.txt for details
 
+#include <algorithm>
+#include <atomic>
 #include "../include/parser.h"
 
 namespace yu::frontend
 {
+#if defined(YUMINA_ARCH_X64) || defined(YUMINA_ARCH_ARM64)
+    namespace
+    {
+        // Tail lanes are padded with a value that differs from `current`, so they never match
+        template<size_t WIDTH>
+        ALWAYS_INLINE void load_tail(uint8_t (&temp)[WIDTH], const lang::token_i current,
+                                     const lang::token_i* types, const size_t remaining)
+        {
+            memset(temp, static_cast<uint8_t>(~static_cast<uint8_t>(current)), WIDTH);
+            memcpy(temp, types, remaining);
+        }
+    }
+#endif
+
 #if defined(YUMINA_ARCH_X64)
-        bool token_compare(lang::token_i current, const lang::token_i* types, size_t count)
+    namespace
+    {
+        using token_compare_t = bool (*)(lang::token_i current, const lang::token_i* types, size_t count);
+
+        bool token_compare_sse2(const lang::token_i current, const lang::token_i* types, const size_t count)
         {
-            const __m256i current_vec = _mm256_set1_epi8(static_cast<uint8_t>(current));
+            const __m128i current_vec = _mm_set1_epi8(static_cast<char>(current));
+            for (size_t i = 0; i < count; i += 16)
+            {
+                const size_t remaining = std::min(size_t(16), count - i);
+                __m128i compare_vec;
+
+                if (remaining == 16)
+                {
+                    compare_vec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(types + i));
+                }
+                else
+                {
+                    alignas(16) uint8_t temp[16];
+                    load_tail(temp, current, types + i, remaining);
+                    compare_vec = _mm_load_si128(reinterpret_cast<const __m128i*>(temp));
+                }
+
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(current_vec, compare_vec)) != 0)
+                    return true;
+            }
+            return false;
+        }
+
+        TARGET_AVX2
+        bool token_compare_avx2(const lang::token_i current, const lang::token_i* types, const size_t count)
+        {
+            const __m256i current_vec = _mm256_set1_epi8(static_cast<char>(current));
             for (size_t i = 0; i < count; i += 32)
             {
                 const size_t remaining = std::min(size_t(32), count - i);
@@ -20,20 +66,35 @@ namespace yu::frontend
                 }
                 else
                 {
-                    alignas(32) uint8_t temp[32] = {0};
-                    memcpy(temp, types + i, remaining);
-                    compare_vec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(temp));
+                    alignas(32) uint8_t temp[32];
+                    load_tail(temp, current, types + i, remaining);
+                    compare_vec = _mm256_load_si256(reinterpret_cast<const __m256i*>(temp));
                 }
 
-                const __m256i result = _mm256_cmpeq_epi8(current_vec, compare_vec);
-                const uint32_t mask = _mm256_movemask_epi8(result);
-
-                if (mask != 0)
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(current_vec, compare_vec)) != 0)
                     return true;
             }
             return false;
         }
 
+        bool token_compare_resolve(lang::token_i current, const lang::token_i* types, size_t count);
+
+        // Starts at the resolver, which swaps in the widest kernel the running CPU supports
+        std::atomic<token_compare_t> token_compare_impl{token_compare_resolve};
+
+        bool token_compare_resolve(const lang::token_i current, const lang::token_i* types, const size_t count)
+        {
+            const token_compare_t impl = cpu_has_avx2() ? token_compare_avx2 : token_compare_sse2;
+            token_compare_impl.store(impl, std::memory_order_relaxed);
+            return impl(current, types, count);
+        }
+    }
+
+    bool token_compare(const lang::token_i current, const lang::token_i* types, const size_t count)
+    {
+        return token_compare_impl.load(std::memory_order_relaxed)(current, types, count);
+    }
+
 #elif defined(YUMINA_ARCH_ARM64)
     bool token_compare(lang::token_i current, const lang::token_i *types, const size_t count)
     {
@@ -49,8 +110,8 @@ namespace yu::frontend
             }
             else
             {
-                alignas(16) uint8_t temp[16] = {};
-                memcpy(temp, types + i, remaining);
+                alignas(16) uint8_t temp[16];
+                load_tail(temp, current, types + i, remaining);
                 compare_vec = vld1q_u8(temp);
             }
 
@@ -65,6 +126,16 @@ namespace yu::frontend
     }
 #endif
 
+    namespace
+    {
+        // Keeps the furthest position matched, which a failed parse reports as the error
+        ALWAYS_INLINE void advance(parse_context *ctx)
+        {
+            ctx->state.pos++;
+            ctx->furthest = std::max<uint32_t>(ctx->furthest, ctx->state.pos);
+        }
+    }
+
     bt::status_i match_token(parse_context *ctx, const lang::token_i type)
     {
         if (ctx->state.pos >= ctx->tokens->size())
@@ -74,7 +145,7 @@ namespace yu::frontend
 
         if (ctx->tokens->types[static_cast<std::vector<lang::token_i>::size_type>(ctx->state.pos)] == type)
         {
-            ctx->state.pos++;
+            advance(ctx);
             return bt::status_i::SUCCESS;
         }
         return bt::status_i::FAILURE;
@@ -90,7 +161,7 @@ namespace yu::frontend
 #if defined(YUMINA_ARCH_X64) || defined(YUMINA_ARCH_ARM64)
         if (token_compare(current, types, count))
         {
-            ctx->state.pos++;
+            advance(ctx);
             return bt::status_i::SUCCESS;
         }
 #else
@@ -98,7 +169,7 @@ namespace yu::frontend
             {
                 if (current == types[i])
                 {
-                    ctx->state.pos++;
+                    advance(ctx);
                     return bt::status_i::SUCCESS;
                 }
             }
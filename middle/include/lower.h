@@ -0,0 +1,28 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_LOWER_H
+#define YU_LOWER_H
+
+#include "ssa.h"
+
+namespace yu::middle
+{
+    /**
+     * @brief Builds SSA for every method of the classes a checked module declares, reading
+     * the types analyze() left on the tree. Locals become SSA values directly while the
+     * statements are walked (Braun et al., "Simple and Efficient Construction of Static Single
+     * Assignment Form"): a block is sealed once all its predecessors are known, and reads in
+     * unsealed blocks get operandless phis that are completed at sealing. Trivial phis and
+     * unreachable blocks are removed when the function is laid out into its flat arrays.
+     *
+     * Methods that use a value typed by another class's type parameter have no concrete
+     * types to lower and are listed in module_ir::skipped instead.
+     * @param module A NODE_MODULE that analyze() accepted without errors.
+     * @param model The model analyze() filled in for it.
+     * @param ir Reset, then filled in.
+     */
+    void lower_module(const frontend::ir_node *module, const frontend::semantic_model &model, module_ir &ir);
+}
+
+#endif
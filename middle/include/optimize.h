@@ -0,0 +1,51 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_OPTIMIZE_H
+#define YU_OPTIMIZE_H
+
+#include "ssa.h"
+
+namespace yu::middle
+{
+    /**
+     * @brief What the optimizer changed, summed over the functions it ran on.
+     */
+    struct optimize_stats_t
+    {
+        uint32_t functions{0};
+        uint32_t folded{0};         // values that became constants
+        uint32_t simplified{0};     // values replaced by an operand, as in x + 0 or !!x
+        uint32_t branches{0};       // conditional branches whose condition is known
+        uint32_t removed_blocks{0}; // unreachable, or merged into their only predecessor
+        uint32_t removed_instrs{0};
+    };
+
+    /**
+     * @brief Runs the scalar passes over one function and lays it out again:
+     *
+     * - Sparse conditional constant propagation (Wegman and Zadeck, "Constant Propagation with
+     *   Conditional Branches") over SSA edges and executable CFG edges, so a value is only
+     *   merged in from paths that can run. Integers wrap to their width; division by zero and
+     *   strings are left for run time.
+     * - Algebraic identities that forward a value to an operand (x * 1, x | false, -(-x)), and
+     *   ones that give a constant whatever the operand (x * 0, x - x for integers).
+     * - Dead code elimination from the instructions with effects: stores, calls, terminators,
+     *   and integer division by anything not known to be non-zero.
+     * - Branches on constants become jumps, unreachable blocks are dropped, and a block is
+     *   merged into its only predecessor when that predecessor jumps to it.
+     *
+     * Every step visits each instruction and edge a bounded number of times.
+     * @param module The module the function belongs to, for types and string constants.
+     * @param function A function that verify() accepts; it still does afterwards.
+     * @param stats Added to.
+     */
+    void optimize_function(const module_ir &module, function_t &function, optimize_stats_t &stats);
+
+    /**
+     * @brief optimize_function() on every function of the module.
+     */
+    void optimize_module(module_ir &ir, optimize_stats_t &stats);
+}
+
+#endif
@@ -0,0 +1,120 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_SSA_H
+#define YU_SSA_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../../frontend/include/sema.h"
+
+namespace yu::middle
+{
+    enum class op_i : uint8_t
+    {
+        CONST,       // imm: integer value, double bits for floats, 0/1 for booleans, string index
+        UNDEF,       // a variable read before any write on some path
+        PARAM,       // imm: parameter index, 0 being `self`
+        PHI,         // operands: one value per predecessor, in block_t pred order
+        ADD,         // also concatenates strings
+        SUB,
+        MUL,
+        DIV,
+        REM,
+        AND,         // logical on booleans, bitwise on integers
+        OR,
+        EQ,
+        NE,
+        LT,
+        GT,
+        NEG,
+        NOT,
+        LOAD_FIELD,  // operands: object; imm: member
+        STORE_FIELD, // operands: object, value; imm: member
+        CALL,        // operands: receiver, arguments; imm: member
+        JUMP,        // imm: target block
+        BRANCH,      // operands: condition; imm: true block | false block << 32
+        RETURN       // operands: the value, if the method returns one
+    };
+
+    /**
+     * @brief One instruction. Its index in function_t::instrs is the id of the value it
+     * defines, and the operands are such ids.
+     */
+    struct instr_t
+    {
+        op_i op;
+        uint32_t type;          // semantic_model type id of the value, types::VOID for none
+        uint32_t first_operand; // range of function_t::operands
+        uint32_t operand_count;
+        uint64_t imm;
+    };
+
+    struct block_t
+    {
+        uint32_t first;      // range of function_t::instrs: phis first, one terminator last
+        uint32_t count;
+        uint32_t first_pred; // range of function_t::preds
+        uint32_t pred_count;
+    };
+
+    /**
+     * @brief A method in SSA form. Blocks and their instructions are stored in order in flat
+     * arrays, so a pass walks memory front to back; block 0 is the entry.
+     */
+    struct function_t
+    {
+        uint32_t owner;  // class type
+        uint32_t member; // index into semantic_model::members
+        std::vector<instr_t> instrs;
+        std::vector<uint32_t> operands;
+        std::vector<block_t> blocks;
+        std::vector<uint32_t> preds;
+
+        [[nodiscard]] const uint32_t *operands_of(const instr_t &instr) const
+        {
+            return operands.data() + instr.first_operand;
+        }
+
+        /**
+         * @brief The successors of a block, read off its terminator.
+         * @return How many of `out` were set, at most two.
+         */
+        uint32_t successors(uint32_t block, uint32_t out[2]) const;
+    };
+
+    struct module_ir
+    {
+        const frontend::semantic_model *model{nullptr};
+        std::vector<function_t> functions;
+        std::vector<std::string> strings;  // string constants, quoted as written
+        std::vector<std::string> skipped;  // methods left out, and why
+    };
+
+    inline bool is_terminator(const op_i op)
+    {
+        return op == op_i::JUMP || op == op_i::BRANCH || op == op_i::RETURN;
+    }
+
+    /**
+     * @brief Checks the structural rules every pass relies on: each block ends in its only
+     * terminator, phis lead their block with one operand per predecessor, predecessor lists
+     * match the terminators, every operand is defined in a block that dominates its use, and
+     * operands have the types their instruction expects.
+     * @return One message per broken rule, empty for a valid function.
+     */
+    std::vector<std::string> verify(const module_ir &module, const function_t &function);
+
+    /**
+     * @brief The function as text, one instruction per line, for tests and -emit-ir.
+     */
+    std::string dump(const module_ir &module, const function_t &function);
+
+    /**
+     * @brief The name a dump gives the function, "Class.method".
+     */
+    std::string function_name(const module_ir &module, const function_t &function);
+}
+
+#endif
@@ -0,0 +1,738 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/lower.h"
+
+#include <cstring>
+
+namespace yu::middle
+{
+    namespace
+    {
+        using frontend::ir_node;
+        using frontend::ir_t;
+        using frontend::member_t;
+        using frontend::type_kind_i;
+        using frontend::value_i;
+        namespace types = frontend::types;
+
+        constexpr uint32_t NONE = UINT32_MAX;
+
+        std::string_view text(const ir_node *node)
+        {
+            return { node->value.str_val.text, node->value.str_val.length };
+        }
+
+        /**
+         * @brief Where the name of a member sits, past its annotations and visibility.
+         */
+        size_t name_index(const ir_node *node)
+        {
+            size_t index = 0;
+            while (node->children[index]->type != ir_t::NODE_IDENTIFIER ||
+                   node->children[index]->value_kind != value_i::STRING)
+                ++index;
+            return index;
+        }
+
+        struct build_block_t
+        {
+            std::vector<uint32_t> instrs; // in the order they were added; laid out properly at the end
+            std::vector<uint32_t> preds;
+            std::vector<std::pair<uint32_t, uint32_t>> incomplete; // (variable, phi) completed at sealing
+            uint32_t terminator{NONE};
+            bool sealed{false};
+        };
+
+        class builder_t
+        {
+        public:
+            builder_t(const frontend::semantic_model &model, module_ir &ir) : model(model), ir(ir) {}
+
+            /**
+             * @brief Lowers one method into `out`.
+             * @return False, with `failure` set, if the method cannot be lowered.
+             */
+            bool lower_method(uint32_t owner, const ir_node *method, function_t &out);
+
+            std::string failure;
+
+        private:
+            const frontend::semantic_model &model;
+            module_ir &ir;
+
+            std::vector<instr_t> instrs;
+            std::vector<uint32_t> operands;
+            std::vector<build_block_t> blocks;
+            std::vector<uint32_t> block_of;    // by instruction
+            frontend::flat_map current_def;    // block << 32 | variable -> value
+            std::vector<uint32_t> variable_types;
+            std::vector<std::pair<uint32_t, uint32_t>> scope; // (name, variable), innermost last
+            std::vector<size_t> scope_marks;
+            uint32_t current{0};
+            uint32_t owner{0};
+            uint32_t self{0};
+            uint32_t return_type{types::VOID};
+
+            void fail(const std::string &reason)
+            {
+                if (failure.empty())
+                    failure = reason;
+            }
+
+            [[nodiscard]] bool is_literal(const uint32_t type) const
+            {
+                return type == types::INT_LITERAL || type == types::FLOAT_LITERAL;
+            }
+
+            /**
+             * @brief The concrete type of an expression: literals take `expected` when it is a
+             * type they convert to, and otherwise the type a variable would give them.
+             */
+            uint32_t value_type(const ir_node *node, const uint32_t expected)
+            {
+                const uint32_t type = node->resolved_type;
+                if (type == types::ERROR)
+                    fail("uses a value typed by another class's type parameter");
+                if (!is_literal(type))
+                    return type;
+                const auto kind = expected == NONE ? type_kind_i::ERROR : model.types[expected].kind;
+                if (kind == type_kind_i::FLOAT || (kind == type_kind_i::INT && type == types::INT_LITERAL))
+                    return expected;
+                return type == types::INT_LITERAL ? types::I32 : types::F64;
+            }
+
+            uint32_t emit(const op_i op, const uint32_t type, const std::initializer_list<uint32_t> args = {},
+                          const uint64_t imm = 0)
+            {
+                return emit_in(current, op, type, args.begin(), static_cast<uint32_t>(args.size()), imm);
+            }
+
+            uint32_t emit_in(const uint32_t block, const op_i op, const uint32_t type, const uint32_t *args,
+                             const uint32_t count, const uint64_t imm)
+            {
+                const auto id = static_cast<uint32_t>(instrs.size());
+                instrs.push_back({ op, type, static_cast<uint32_t>(operands.size()), count, imm });
+                operands.insert(operands.end(), args, args + count);
+                block_of.push_back(block);
+                blocks[block].instrs.push_back(id);
+                if (is_terminator(op))
+                    blocks[block].terminator = id;
+                return id;
+            }
+
+            uint32_t new_block()
+            {
+                blocks.emplace_back();
+                return static_cast<uint32_t>(blocks.size() - 1);
+            }
+
+            void jump(const uint32_t target)
+            {
+                emit(op_i::JUMP, types::VOID, {}, target);
+                blocks[target].preds.push_back(current);
+            }
+
+            void branch(const uint32_t condition, const uint32_t if_true, const uint32_t if_false)
+            {
+                emit(op_i::BRANCH, types::VOID, { condition }, if_true | static_cast<uint64_t>(if_false) << 32);
+                blocks[if_true].preds.push_back(current);
+                blocks[if_false].preds.push_back(current);
+            }
+
+            /**
+             * @brief Ends the current block; anything that follows lands in a block nothing
+             * jumps to, which is dropped at the end.
+             */
+            void start_dead_block()
+            {
+                current = new_block();
+                blocks[current].sealed = true;
+            }
+
+            void write_variable(const uint32_t variable, const uint32_t block, const uint32_t value)
+            {
+                current_def.set(static_cast<uint64_t>(block) << 32 | variable, value);
+            }
+
+            uint32_t read_variable(const uint32_t variable, const uint32_t block) // NOLINT(*-no-recursion)
+            {
+                const uint32_t value = current_def.find(static_cast<uint64_t>(block) << 32 | variable);
+                return value != frontend::flat_map::NONE ? value : read_variable_recursive(variable, block);
+            }
+
+            uint32_t read_variable_recursive(const uint32_t variable, const uint32_t block) // NOLINT(*-no-recursion)
+            {
+                const uint32_t type = variable_types[variable];
+                uint32_t value;
+                if (!blocks[block].sealed)
+                {
+                    value = emit_in(block, op_i::PHI, type, nullptr, 0, 0);
+                    blocks[block].incomplete.emplace_back(variable, value);
+                }
+                else if (blocks[block].preds.size() == 1)
+                {
+                    value = read_variable(variable, blocks[block].preds[0]);
+                }
+                else if (blocks[block].preds.empty())
+                {
+                    value = emit_in(block, op_i::UNDEF, type, nullptr, 0, 0);
+                }
+                else
+                {
+                    // Written before its operands are read, so a loop back to this block ends here
+                    value = emit_in(block, op_i::PHI, type, nullptr, 0, 0);
+                    write_variable(variable, block, value);
+                    add_phi_operands(variable, value);
+                }
+                write_variable(variable, block, value);
+                return value;
+            }
+
+            void add_phi_operands(const uint32_t variable, const uint32_t phi) // NOLINT(*-no-recursion)
+            {
+                // Reading may add instructions and operands, so gather first and append in one piece
+                std::vector<uint32_t> values;
+                for (const uint32_t pred : blocks[block_of[phi]].preds)
+                    values.push_back(read_variable(variable, pred));
+                instrs[phi].first_operand = static_cast<uint32_t>(operands.size());
+                instrs[phi].operand_count = static_cast<uint32_t>(values.size());
+                operands.insert(operands.end(), values.begin(), values.end());
+            }
+
+            void seal(const uint32_t block) // NOLINT(*-no-recursion)
+            {
+                for (const auto &[variable, phi] : blocks[block].incomplete)
+                    add_phi_operands(variable, phi);
+                blocks[block].incomplete.clear();
+                blocks[block].sealed = true;
+            }
+
+            uint32_t declare(const std::string_view name, const uint32_t type)
+            {
+                const auto variable = static_cast<uint32_t>(variable_types.size());
+                variable_types.push_back(type);
+                scope.emplace_back(model.names.find(name), variable);
+                return variable;
+            }
+
+            [[nodiscard]] uint32_t find_local(const std::string_view name) const
+            {
+                const uint32_t id = model.names.find(name);
+                for (auto it = scope.rbegin(); it != scope.rend(); ++it)
+                {
+                    if (it->first == id)
+                        return it->second;
+                }
+                return NONE;
+            }
+
+            void push_scope() { scope_marks.push_back(scope.size()); }
+
+            void pop_scope()
+            {
+                scope.resize(scope_marks.back());
+                scope_marks.pop_back();
+            }
+
+            /**
+             * @brief The index of member `name` of class `type`, or NONE.
+             */
+            uint32_t member_index(const uint32_t type, const std::string_view name)
+            {
+                const member_t *member = model.types[type].kind == type_kind_i::CLASS ? model.find_member(type, name)
+                                                                                        : nullptr;
+                if (!member)
+                {
+                    fail("no member '" + std::string(name) + "' on '" + model.type_name(type) + "'");
+                    return NONE;
+                }
+                return static_cast<uint32_t>(member - model.members.data());
+            }
+
+            uint32_t lower_expression(const ir_node *node, uint32_t expected);
+            uint32_t lower_binary(const ir_node *node, uint32_t expected);
+            uint32_t lower_call(const ir_node *node);
+            uint32_t lower_assign(const ir_node *node);
+            void lower_variable(const ir_node *node);
+            void lower_statement(const ir_node *node);
+            void finish(function_t &out);
+        };
+
+        uint32_t builder_t::lower_expression(const ir_node *node, const uint32_t expected) // NOLINT(*-no-recursion)
+        {
+            if (!failure.empty())
+                return emit(op_i::UNDEF, types::ERROR);
+
+            switch (node->type)
+            {
+                case ir_t::NODE_LITERAL:
+                {
+                    if (node->value_kind == value_i::BOOL)
+                        return emit(op_i::CONST, types::BOOL, {}, node->value.bool_val);
+                    if (node->value_kind == value_i::STRING)
+                    {
+                        ir.strings.emplace_back(text(node));
+                        return emit(op_i::CONST, types::STRING, {}, ir.strings.size() - 1);
+                    }
+                    const uint32_t type = value_type(node, expected);
+                    uint64_t bits;
+                    if (model.types[type].kind == type_kind_i::FLOAT)
+                    {
+                        const double value = type == types::F32 ? static_cast<float>(node->value.num_val)
+                                                                : node->value.num_val;
+                        std::memcpy(&bits, &value, sizeof(bits));
+                    }
+                    else
+                    {
+                        bits = static_cast<uint64_t>(static_cast<int64_t>(node->value.num_val));
+                    }
+                    return emit(op_i::CONST, type, {}, bits);
+                }
+                case ir_t::NODE_IDENTIFIER:
+                {
+                    const std::string_view name = text(node);
+                    if (const uint32_t variable = find_local(name); variable != NONE)
+                        return read_variable(variable, current);
+                    if (name == "self")
+                        return self;
+                    const uint32_t member = member_index(owner, name);
+                    if (member == NONE)
+                        return emit(op_i::UNDEF, types::ERROR);
+                    return emit(op_i::LOAD_FIELD, model.members[member].type, { self }, member);
+                }
+                case ir_t::NODE_UNARY_OP:
+                {
+                    const uint32_t type = value_type(node, expected);
+                    const uint32_t operand = lower_expression(node->children[0], type);
+                    const bool negate = static_cast<lang::token_i>(node->value.op_val) == lang::token_i::MINUS;
+                    return emit(negate ? op_i::NEG : op_i::NOT, type, { operand });
+                }
+                case ir_t::NODE_BINARY_OP:
+                    return lower_binary(node, expected);
+                case ir_t::NODE_MEMBER:
+                {
+                    const uint32_t object = lower_expression(node->children[0], NONE);
+                    value_type(node, NONE);
+                    const uint32_t member = member_index(instrs[object].type, text(node));
+                    if (member == NONE)
+                        return emit(op_i::UNDEF, types::ERROR);
+                    return emit(op_i::LOAD_FIELD, model.members[member].type, { object }, member);
+                }
+                case ir_t::NODE_CALL:
+                    return lower_call(node);
+                case ir_t::NODE_ASSIGN:
+                    return lower_assign(node);
+                default:
+                    fail("unexpected node in an expression");
+                    return emit(op_i::UNDEF, types::ERROR);
+            }
+        }
+
+        uint32_t builder_t::lower_binary(const ir_node *node, const uint32_t expected) // NOLINT(*-no-recursion)
+        {
+            const auto token = static_cast<lang::token_i>(node->value.op_val);
+            const ir_node *left = node->children[0];
+            const ir_node *right = node->children[1];
+
+            op_i op;
+            bool compare = false;
+            switch (token)
+            {
+                case lang::token_i::PLUS: op = op_i::ADD; break;
+                case lang::token_i::MINUS: op = op_i::SUB; break;
+                case lang::token_i::STAR: op = op_i::MUL; break;
+                case lang::token_i::SLASH: op = op_i::DIV; break;
+                case lang::token_i::PERCENT: op = op_i::REM; break;
+                case lang::token_i::AND: op = op_i::AND; break;
+                case lang::token_i::OR: op = op_i::OR; break;
+                case lang::token_i::EQUAL: op = op_i::EQ; compare = true; break;
+                case lang::token_i::BANG: op = op_i::NE; compare = true; break;
+                case lang::token_i::LESS: op = op_i::LT; compare = true; break;
+                case lang::token_i::GREATER: op = op_i::GT; compare = true; break;
+                default:
+                    fail("unexpected binary operator");
+                    return emit(op_i::UNDEF, types::ERROR);
+            }
+
+            // Comparisons take the type of their concrete side, arithmetic that of its result
+            uint32_t operand_type;
+            const uint32_t type = compare ? types::BOOL : value_type(node, expected);
+            if (!compare)
+                operand_type = type;
+            else if (!is_literal(left->resolved_type))
+                operand_type = value_type(left, NONE);
+            else if (!is_literal(right->resolved_type))
+                operand_type = value_type(right, NONE);
+            else
+                operand_type = left->resolved_type == right->resolved_type ? value_type(left, NONE) : types::F64;
+
+            const uint32_t a = lower_expression(left, operand_type);
+            const uint32_t b = lower_expression(right, operand_type);
+            return emit(op, type, { a, b });
+        }
+
+        uint32_t builder_t::lower_call(const ir_node *node) // NOLINT(*-no-recursion)
+        {
+            const ir_node *callee = node->children[0];
+            const uint32_t receiver = callee->type == ir_t::NODE_MEMBER
+                                          ? lower_expression(callee->children[0], NONE)
+                                          : self;
+            const uint32_t member = member_index(instrs[receiver].type, text(callee));
+            if (member == NONE)
+                return emit(op_i::UNDEF, types::ERROR);
+
+            const member_t &method = model.members[member];
+            std::vector<uint32_t> args{ receiver };
+            for (size_t i = 1; i < node->children.size(); ++i)
+            {
+                const uint32_t parameter = model.params[method.first_param + i - 1];
+                if (model.types[parameter].kind == type_kind_i::GENERIC && instrs[receiver].type != owner)
+                    fail("uses a value typed by another class's type parameter");
+                args.push_back(lower_expression(node->children[i], parameter));
+            }
+            value_type(node, NONE);
+            return emit_in(current, op_i::CALL, method.type, args.data(), static_cast<uint32_t>(args.size()), member);
+        }
+
+        uint32_t builder_t::lower_assign(const ir_node *node) // NOLINT(*-no-recursion)
+        {
+            const ir_node *target = node->children[0];
+            if (target->type == ir_t::NODE_IDENTIFIER)
+            {
+                const std::string_view name = text(target);
+                if (const uint32_t variable = find_local(name); variable != NONE)
+                {
+                    const uint32_t value = lower_expression(node->children[1], variable_types[variable]);
+                    write_variable(variable, current, value);
+                    return value;
+                }
+                if (name == "self")
+                {
+                    fail("assigns to 'self'");
+                    return emit(op_i::UNDEF, types::ERROR);
+                }
+            }
+
+            // A field, of `self` when named alone
+            const uint32_t object = target->type == ir_t::NODE_MEMBER ? lower_expression(target->children[0], NONE)
+                                                                       : self;
+            const uint32_t member = member_index(instrs[object].type, text(target));
+            if (member == NONE)
+                return emit(op_i::UNDEF, types::ERROR);
+            value_type(target, NONE);
+            const uint32_t value = lower_expression(node->children[1], model.members[member].type);
+            emit(op_i::STORE_FIELD, types::VOID, { object, value }, member);
+            return value;
+        }
+
+        void builder_t::lower_variable(const ir_node *node)
+        {
+            const auto &children = node->children;
+            const bool has_type = children.size() > 1 && children[1]->type == ir_t::NODE_TYPE;
+            const ir_node *init = children.size() > (has_type ? 2u : 1u) ? children.back() : nullptr;
+
+            // Declared after the initializer, which still sees any variable of the same name outside
+            const uint32_t type = node->resolved_type;
+            const uint32_t value = init ? lower_expression(init, type) : emit(op_i::UNDEF, type);
+            write_variable(declare(text(children[0]), type), current, value);
+        }
+
+        void builder_t::lower_statement(const ir_node *node) // NOLINT(*-no-recursion)
+        {
+            switch (node->type)
+            {
+                case ir_t::NODE_BLOCK:
+                    push_scope();
+                    for (const auto *statement : node->children)
+                        lower_statement(statement);
+                    pop_scope();
+                    break;
+                case ir_t::NODE_VARIABLE:
+                    lower_variable(node);
+                    break;
+                case ir_t::NODE_IF:
+                {
+                    const uint32_t condition = lower_expression(node->children[0], types::BOOL);
+                    const bool has_else = node->children.size() > 2;
+                    const uint32_t then_block = new_block();
+                    const uint32_t else_block = has_else ? new_block() : NONE;
+                    const uint32_t join = new_block();
+                    branch(condition, then_block, has_else ? else_block : join);
+
+                    for (size_t i = 1; i < node->children.size(); ++i)
+                    {
+                        current = i == 1 ? then_block : else_block;
+                        seal(current);
+                        push_scope();
+                        lower_statement(node->children[i]);
+                        pop_scope();
+                        jump(join);
+                    }
+                    seal(join);
+                    current = join;
+                    break;
+                }
+                case ir_t::NODE_LOOP:
+                {
+                    // while: condition, body; for: [variable], [condition], [step], body
+                    push_scope();
+                    const ir_node *condition = nullptr;
+                    const ir_node *step = nullptr;
+                    for (size_t i = 0; i + 1 < node->children.size(); ++i)
+                    {
+                        const ir_node *part = node->children[i];
+                        if (part->type == ir_t::NODE_VARIABLE)
+                            lower_variable(part);
+                        else if (!condition && part->type != ir_t::NODE_ASSIGN)
+                            condition = part;
+                        else
+                            step = part;
+                    }
+
+                    // The header stays open until the back edge is known
+                    const uint32_t header = new_block();
+                    const uint32_t body = new_block();
+                    const uint32_t exit = new_block();
+                    jump(header);
+                    current = header;
+                    if (condition)
+                        branch(lower_expression(condition, types::BOOL), body, exit);
+                    else
+                        jump(body);
+                    seal(body);
+
+                    current = body;
+                    lower_statement(node->children.back());
+                    if (step)
+                        lower_expression(step, NONE);
+                    jump(header);
+                    seal(header);
+                    seal(exit);
+                    current = exit;
+                    pop_scope();
+                    break;
+                }
+                case ir_t::NODE_RETURN:
+                    if (node->children.empty())
+                        emit(op_i::RETURN, types::VOID);
+                    else
+                        emit(op_i::RETURN, types::VOID, { lower_expression(node->children[0], return_type) });
+                    start_dead_block();
+                    break;
+                default:
+                    lower_expression(node, NONE);
+                    break;
+            }
+        }
+
+        bool builder_t::lower_method(const uint32_t owner_type, const ir_node *method, function_t &out)
+        {
+            instrs.clear();
+            operands.clear();
+            blocks.clear();
+            block_of.clear();
+            current_def = frontend::flat_map{};
+            variable_types.clear();
+            scope.clear();
+            scope_marks.clear();
+            failure.clear();
+
+            const auto &children = method->children;
+            const size_t name_at = name_index(method);
+            const uint32_t member = member_index(owner_type, text(children[name_at]));
+            if (member == NONE)
+                return false;
+            owner = owner_type;
+            return_type = model.members[member].type;
+            out = function_t{};
+            out.owner = owner_type;
+            out.member = member;
+
+            current = new_block();
+            blocks[current].sealed = true;
+            self = emit(op_i::PARAM, owner, {}, 0);
+            push_scope();
+            uint32_t index = 0;
+            for (size_t i = name_at + 1; i + 1 < children.size(); ++i)
+            {
+                if (children[i]->type != ir_t::NODE_VARIABLE)
+                    continue;
+                const uint32_t type = children[i]->resolved_type;
+                const uint32_t value = emit(op_i::PARAM, type, {}, ++index);
+                write_variable(declare(text(children[i]->children[0]), type), current, value);
+            }
+
+            for (const auto *statement : children.back()->children)
+                lower_statement(statement);
+            pop_scope();
+
+            // Falling off the end returns nothing, or an undefined value the checker let through
+            if (return_type == types::VOID)
+                emit(op_i::RETURN, types::VOID);
+            else
+                emit(op_i::RETURN, types::VOID, { emit(op_i::UNDEF, return_type) });
+
+            if (!failure.empty())
+                return false;
+            finish(out);
+            return true;
+        }
+
+        void builder_t::finish(function_t &out)
+        {
+            // Blocks reachable from the entry, in creation order
+            std::vector<uint32_t> new_block_id(blocks.size(), NONE);
+            std::vector<uint32_t> worklist{ 0 };
+            new_block_id[0] = 0;
+            while (!worklist.empty())
+            {
+                const build_block_t &block = blocks[worklist.back()];
+                worklist.pop_back();
+                const instr_t &last = instrs[block.terminator];
+                const uint32_t targets[] = { static_cast<uint32_t>(last.imm), static_cast<uint32_t>(last.imm >> 32) };
+                const uint32_t count = last.op == op_i::JUMP ? 1 : last.op == op_i::BRANCH ? 2 : 0;
+                for (uint32_t t = 0; t < count; ++t)
+                {
+                    if (new_block_id[targets[t]] == NONE)
+                    {
+                        new_block_id[targets[t]] = 0;
+                        worklist.push_back(targets[t]);
+                    }
+                }
+            }
+            uint32_t reachable_count = 0;
+            for (auto &id : new_block_id)
+            {
+                if (id != NONE)
+                    id = reachable_count++;
+            }
+
+            // Phis whose operands, from reachable predecessors, are one value besides themselves
+            std::vector<uint32_t> replacement(instrs.size(), NONE);
+            const auto resolve = [&](uint32_t value)
+            {
+                while (replacement[value] != NONE)
+                    value = replacement[value];
+                return value;
+            };
+            for (bool changed = true; changed;)
+            {
+                changed = false;
+                for (uint32_t i = 0; i < instrs.size(); ++i)
+                {
+                    if (instrs[i].op != op_i::PHI || replacement[i] != NONE || new_block_id[block_of[i]] == NONE)
+                        continue;
+                    const auto &preds = blocks[block_of[i]].preds;
+                    uint32_t same = NONE;
+                    bool trivial = true;
+                    for (uint32_t o = 0; o < instrs[i].operand_count && trivial; ++o)
+                    {
+                        if (new_block_id[preds[o]] == NONE)
+                            continue;
+                        const uint32_t value = resolve(operands[instrs[i].first_operand + o]);
+                        if (value == same || value == i)
+                            continue;
+                        trivial = same == NONE;
+                        same = value;
+                    }
+                    if (trivial && same != NONE)
+                    {
+                        replacement[i] = same;
+                        changed = true;
+                    }
+                }
+            }
+
+            // Lay blocks out in order: phis, then the other instructions, the terminator last
+            std::vector<uint32_t> new_id(instrs.size(), NONE);
+            std::vector<uint32_t> order;
+            order.reserve(instrs.size());
+            for (uint32_t b = 0; b < blocks.size(); ++b)
+            {
+                if (new_block_id[b] == NONE)
+                    continue;
+                const auto &list = blocks[b].instrs;
+                for (const uint32_t i : list)
+                {
+                    if (instrs[i].op == op_i::PHI && replacement[i] == NONE)
+                        order.push_back(i);
+                }
+                for (const uint32_t i : list)
+                {
+                    if (instrs[i].op != op_i::PHI && i != blocks[b].terminator)
+                        order.push_back(i);
+                }
+                order.push_back(blocks[b].terminator);
+            }
+            for (uint32_t i = 0; i < order.size(); ++i)
+                new_id[order[i]] = i;
+
+            out.instrs.reserve(order.size());
+            out.operands.reserve(operands.size());
+            out.blocks.reserve(reachable_count);
+            for (const uint32_t i : order)
+            {
+                const uint32_t b = block_of[i];
+                const build_block_t &block = blocks[b];
+                if (out.blocks.size() <= new_block_id[b])
+                {
+                    out.blocks.push_back({ static_cast<uint32_t>(out.instrs.size()), 0,
+                                           static_cast<uint32_t>(out.preds.size()), 0 });
+                    for (const uint32_t pred : block.preds)
+                    {
+                        if (new_block_id[pred] != NONE)
+                            out.preds.push_back(new_block_id[pred]);
+                    }
+                    out.blocks.back().pred_count = static_cast<uint32_t>(out.preds.size()) - out.blocks.back().first_pred;
+                }
+                ++out.blocks.back().count;
+
+                instr_t instr = instrs[i];
+                instr.first_operand = static_cast<uint32_t>(out.operands.size());
+                instr.operand_count = 0;
+                for (uint32_t o = 0; o < instrs[i].operand_count; ++o)
+                {
+                    if (instr.op == op_i::PHI && new_block_id[block.preds[o]] == NONE)
+                        continue;
+                    out.operands.push_back(new_id[resolve(operands[instrs[i].first_operand + o])]);
+                    ++instr.operand_count;
+                }
+                if (instr.op == op_i::JUMP)
+                    instr.imm = new_block_id[instr.imm];
+                else if (instr.op == op_i::BRANCH)
+                    instr.imm = new_block_id[static_cast<uint32_t>(instr.imm)] |
+                                static_cast<uint64_t>(new_block_id[instr.imm >> 32]) << 32;
+                out.instrs.push_back(instr);
+            }
+        }
+    }
+
+    void lower_module(const frontend::ir_node *module, const frontend::semantic_model &model, module_ir &ir)
+    {
+        ir = module_ir{};
+        ir.model = &model;
+        builder_t builder(model, ir);
+        for (const auto *node : module->children)
+        {
+            if (node->type != ir_t::NODE_CLASS || node->resolved_type == types::ERROR)
+                continue;
+            for (const auto *member : node->children.back()->children)
+            {
+                if (member->type != ir_t::NODE_METHOD)
+                    continue;
+                function_t function;
+                if (builder.lower_method(node->resolved_type, member, function))
+                {
+                    ir.functions.push_back(std::move(function));
+                }
+                else
+                {
+                    ir.skipped.push_back(model.type_name(node->resolved_type) + "." +
+                                         std::string(text(member->children[name_index(member)])) + ": " +
+                                         builder.failure);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,824 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/optimize.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace yu::middle
+{
+    namespace
+    {
+        using frontend::type_kind_i;
+        namespace types = frontend::types;
+
+        constexpr uint32_t NONE = UINT32_MAX;
+
+        enum class lattice_i : uint8_t
+        {
+            UNKNOWN,  // no path that defines the value has been seen to run yet
+            CONSTANT, // one value on every path that runs
+            VARYING
+        };
+
+        struct cell_t
+        {
+            lattice_i state{lattice_i::UNKNOWN};
+            uint64_t bits{0}; // as CONST's imm; integers are kept wrapped to their width
+
+            bool operator==(const cell_t &other) const { return state == other.state && bits == other.bits; }
+            bool operator!=(const cell_t &other) const { return !(*this == other); }
+        };
+
+        constexpr cell_t VARYING{ lattice_i::VARYING, 0 };
+
+        uint64_t double_bits(const double value)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        double bits_double(const uint64_t bits)
+        {
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        class optimizer_t
+        {
+        public:
+            optimizer_t(const module_ir &module, optimize_stats_t &stats) : model(*module.model), stats(stats) {}
+
+            /**
+             * @brief Optimizes `target` in place; the work arrays are kept for the next function.
+             */
+            void run(function_t &target);
+
+        private:
+            const frontend::semantic_model &model;
+            function_t *function{nullptr};
+            optimize_stats_t &stats;
+
+            std::vector<uint32_t> block_of;   // by instruction
+            std::vector<uint32_t> first_user; // users of value v are users[first_user[v]..first_user[v + 1]]
+            std::vector<uint32_t> users;
+            std::vector<cell_t> cells;
+            std::vector<uint8_t> reachable; // by block
+            std::vector<uint8_t> edge_live; // by slot of function_t::preds
+            std::vector<uint32_t> block_work;
+            std::vector<uint32_t> value_work;
+            std::vector<uint32_t> replacement; // a value forwarded to another
+            std::vector<uint8_t> live;
+            std::vector<uint32_t> worklist;
+            // Laying out again
+            std::vector<uint32_t> live_preds;
+            std::vector<uint8_t> merged;
+            std::vector<uint32_t> new_block_id;
+            std::vector<uint32_t> new_id;
+            std::vector<uint32_t> order;
+            std::vector<uint32_t> heads;      // by new block: the first old block of its chain
+            std::vector<uint32_t> block_ends; // by new block: one past its last entry of `order`
+            function_t spare;                 // the arrays of the function before, filled in next
+
+            [[nodiscard]] type_kind_i kind(const uint32_t type) const { return model.types[type].kind; }
+
+            [[nodiscard]] uint64_t wrap(const uint32_t type, uint64_t bits) const
+            {
+                const frontend::type_info_t &info = model.types[type];
+                if (info.bits >= 64)
+                    return bits;
+                const uint64_t mask = (uint64_t{ 1 } << info.bits) - 1;
+                bits &= mask;
+                if (info.is_signed && bits >> (info.bits - 1) & 1)
+                    bits |= ~mask;
+                return bits;
+            }
+
+            [[nodiscard]] bool is_constant(const uint32_t value, const uint64_t bits) const
+            {
+                return cells[value].state == lattice_i::CONSTANT && cells[value].bits == bits;
+            }
+
+            uint32_t resolve(uint32_t value)
+            {
+                uint32_t target = value;
+                while (replacement[target] != NONE)
+                    target = replacement[target];
+                // Point the whole chain at the end, so long chains of x + 0 are walked once
+                while (replacement[value] != NONE)
+                    value = std::exchange(replacement[value], target);
+                return target;
+            }
+
+            void index();
+            void solve();
+            bool settle_unknown_branches();
+            void mark_edge(uint32_t from, uint32_t to);
+            void evaluate(uint32_t instr);
+            cell_t compute(uint32_t instr);
+            cell_t compute_binary(const instr_t &in, uint32_t a, uint32_t b);
+            bool fold(op_i op, uint32_t type, uint64_t x, uint64_t y, uint64_t &out) const;
+            bool absorb(op_i op, uint32_t type, uint32_t a, uint32_t b, uint64_t &out) const;
+            uint32_t identity(uint32_t instr);
+            void forward();
+            void mark_live();
+            void rebuild();
+
+            [[nodiscard]] bool folded_branch(const instr_t &in) const
+            {
+                return in.op == op_i::BRANCH && cells[function->operands_of(in)[0]].state == lattice_i::CONSTANT;
+            }
+
+            /**
+             * @brief Where a block's terminator leads once branches on constants are jumps,
+             * or NONE if it does not end in a jump.
+             */
+            [[nodiscard]] uint32_t jump_target(const uint32_t block) const
+            {
+                const block_t &b = function->blocks[block];
+                const instr_t &last = function->instrs[b.first + b.count - 1];
+                if (last.op == op_i::JUMP)
+                    return static_cast<uint32_t>(last.imm);
+                if (!folded_branch(last))
+                    return NONE;
+                return static_cast<uint32_t>(cells[function->operands_of(last)[0]].bits ? last.imm : last.imm >> 32);
+            }
+        };
+
+        void optimizer_t::index()
+        {
+            const auto count = static_cast<uint32_t>(function->instrs.size());
+            block_of.resize(count);
+            for (uint32_t b = 0; b < function->blocks.size(); ++b)
+            {
+                const block_t &block = function->blocks[b];
+                std::fill_n(block_of.begin() + block.first, block.count, b);
+            }
+
+            // Count, sum to the end of each range, then fill backwards down to its start
+            first_user.assign(count + 1, 0);
+            for (const instr_t &in : function->instrs)
+            {
+                for (uint32_t o = 0; o < in.operand_count; ++o)
+                    ++first_user[function->operands_of(in)[o]];
+            }
+            for (uint32_t v = 1; v <= count; ++v)
+                first_user[v] += first_user[v - 1];
+            users.resize(first_user[count]);
+            for (uint32_t i = count; i-- > 0;)
+            {
+                const instr_t &in = function->instrs[i];
+                for (uint32_t o = 0; o < in.operand_count; ++o)
+                    users[--first_user[function->operands_of(in)[o]]] = i;
+            }
+
+            cells.assign(count, cell_t{});
+            reachable.assign(function->blocks.size(), 0);
+            edge_live.assign(function->preds.size(), 0);
+            replacement.assign(count, NONE);
+            live.assign(count, 0);
+        }
+
+        void optimizer_t::mark_edge(const uint32_t from, const uint32_t to)
+        {
+            const block_t &block = function->blocks[to];
+            bool added = false;
+            for (uint32_t p = block.first_pred; p < block.first_pred + block.pred_count; ++p)
+            {
+                if (function->preds[p] == from && !edge_live[p])
+                    edge_live[p] = added = true;
+            }
+            if (!added)
+                return;
+            if (!reachable[to])
+            {
+                reachable[to] = 1;
+                block_work.push_back(to);
+                return;
+            }
+            // A new way in changes only what the phis merge
+            for (uint32_t i = block.first; i < block.first + block.count && function->instrs[i].op == op_i::PHI; ++i)
+                evaluate(i);
+        }
+
+        void optimizer_t::evaluate(const uint32_t instr)
+        {
+            const instr_t &in = function->instrs[instr];
+            switch (in.op)
+            {
+                case op_i::JUMP:
+                    mark_edge(block_of[instr], static_cast<uint32_t>(in.imm));
+                    return;
+                case op_i::BRANCH:
+                {
+                    const cell_t &condition = cells[function->operands_of(in)[0]];
+                    if (condition.state == lattice_i::UNKNOWN)
+                        return;
+                    if (condition.state == lattice_i::VARYING || condition.bits)
+                        mark_edge(block_of[instr], static_cast<uint32_t>(in.imm));
+                    if (condition.state == lattice_i::VARYING || !condition.bits)
+                        mark_edge(block_of[instr], static_cast<uint32_t>(in.imm >> 32));
+                    return;
+                }
+                case op_i::RETURN:
+                case op_i::STORE_FIELD:
+                    return;
+                default:
+                    break;
+            }
+
+            if (cells[instr].state == lattice_i::VARYING)
+                return;
+            const cell_t next = compute(instr);
+            if (next == cells[instr])
+                return;
+            cells[instr] = next;
+            value_work.push_back(instr);
+        }
+
+        cell_t optimizer_t::compute(const uint32_t instr)
+        {
+            const instr_t &in = function->instrs[instr];
+            const uint32_t *operands = function->operands_of(in);
+            switch (in.op)
+            {
+                case op_i::CONST:
+                    if (kind(in.type) == type_kind_i::INT)
+                        return { lattice_i::CONSTANT, wrap(in.type, in.imm) };
+                    return { in.type == types::STRING ? lattice_i::VARYING : lattice_i::CONSTANT, in.imm };
+                case op_i::PHI:
+                {
+                    const block_t &block = function->blocks[block_of[instr]];
+                    cell_t merged;
+                    for (uint32_t o = 0; o < in.operand_count; ++o)
+                    {
+                        const cell_t &incoming = cells[operands[o]];
+                        if (!edge_live[block.first_pred + o] || incoming.state == lattice_i::UNKNOWN)
+                            continue;
+                        if (incoming.state == lattice_i::VARYING ||
+                            (merged.state == lattice_i::CONSTANT && merged.bits != incoming.bits))
+                            return VARYING;
+                        merged = incoming;
+                    }
+                    return merged;
+                }
+                case op_i::NEG:
+                case op_i::NOT:
+                {
+                    const cell_t &operand = cells[operands[0]];
+                    if (operand.state != lattice_i::CONSTANT)
+                        return operand.state == lattice_i::UNKNOWN ? cell_t{} : VARYING;
+                    if (in.op == op_i::NOT)
+                        return { lattice_i::CONSTANT, operand.bits ^ 1 };
+                    if (kind(in.type) == type_kind_i::INT)
+                        return { lattice_i::CONSTANT, wrap(in.type, 0 - operand.bits) };
+                    return { lattice_i::CONSTANT, double_bits(-bits_double(operand.bits)) };
+                }
+                case op_i::ADD:
+                case op_i::SUB:
+                case op_i::MUL:
+                case op_i::DIV:
+                case op_i::REM:
+                case op_i::AND:
+                case op_i::OR:
+                case op_i::EQ:
+                case op_i::NE:
+                case op_i::LT:
+                case op_i::GT:
+                    return compute_binary(in, operands[0], operands[1]);
+                default:
+                    // Parameters, fields, calls and undefined values are whatever they are at run time
+                    return VARYING;
+            }
+        }
+
+        cell_t optimizer_t::compute_binary(const instr_t &in, const uint32_t a, const uint32_t b)
+        {
+            const uint32_t type = function->instrs[a].type;
+            uint64_t bits;
+            if (absorb(in.op, type, a, b, bits))
+                return { lattice_i::CONSTANT, bits };
+
+            const cell_t &x = cells[a];
+            const cell_t &y = cells[b];
+            if (x.state == lattice_i::UNKNOWN || y.state == lattice_i::UNKNOWN)
+                return {};
+            if (x.state == lattice_i::VARYING || y.state == lattice_i::VARYING)
+                return VARYING;
+            return fold(in.op, type, x.bits, y.bits, bits) ? cell_t{ lattice_i::CONSTANT, bits } : VARYING;
+        }
+
+        bool optimizer_t::fold(const op_i op, const uint32_t type, const uint64_t x, const uint64_t y,
+                               uint64_t &out) const
+        {
+            if (type == types::BOOL)
+            {
+                switch (op)
+                {
+                    case op_i::AND: out = x & y; return true;
+                    case op_i::OR: out = x | y; return true;
+                    case op_i::EQ: out = x == y; return true;
+                    case op_i::NE: out = x != y; return true;
+                    default: return false;
+                }
+            }
+
+            if (kind(type) == type_kind_i::INT)
+            {
+                const bool is_signed = model.types[type].is_signed;
+                const auto sx = static_cast<int64_t>(x);
+                const auto sy = static_cast<int64_t>(y);
+                switch (op)
+                {
+                    case op_i::ADD: out = wrap(type, x + y); return true;
+                    case op_i::SUB: out = wrap(type, x - y); return true;
+                    case op_i::MUL: out = wrap(type, x * y); return true;
+                    case op_i::AND: out = x & y; return true;
+                    case op_i::OR: out = x | y; return true;
+                    case op_i::EQ: out = x == y; return true;
+                    case op_i::NE: out = x != y; return true;
+                    case op_i::LT: out = is_signed ? sx < sy : x < y; return true;
+                    case op_i::GT: out = is_signed ? sx > sy : x > y; return true;
+                    case op_i::DIV:
+                    case op_i::REM:
+                        if (y == 0)
+                            return false;
+                        if (is_signed && sy == -1)
+                        {
+                            // The lowest value has no negation, and dividing it by -1 traps like
+                            // dividing by zero, so it stays for the division to run
+                            const uint32_t width = std::min<uint32_t>(model.types[type].bits, 64);
+                            if (x == wrap(type, uint64_t{ 1 } << (width - 1)))
+                                return false;
+                            out = op == op_i::DIV ? wrap(type, 0 - x) : 0;
+                        }
+                        else if (is_signed)
+                            out = wrap(type, static_cast<uint64_t>(op == op_i::DIV ? sx / sy : sx % sy));
+                        else
+                            out = op == op_i::DIV ? x / y : x % y;
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            if (kind(type) == type_kind_i::FLOAT)
+            {
+                // f32 constants hold a double that is exactly a float, and f32 math rounds to float
+                const double dx = bits_double(x);
+                const double dy = bits_double(y);
+                const bool single = type == types::F32;
+                const auto round = [&](const double value) { return single ? static_cast<float>(value) : value; };
+                switch (op)
+                {
+                    case op_i::ADD: out = double_bits(round(dx + dy)); return true;
+                    case op_i::SUB: out = double_bits(round(dx - dy)); return true;
+                    case op_i::MUL: out = double_bits(round(dx * dy)); return true;
+                    case op_i::DIV:
+                        if (dy == 0)
+                            return false;
+                        out = double_bits(round(dx / dy));
+                        return true;
+                    case op_i::EQ: out = dx == dy; return true;
+                    case op_i::NE: out = dx != dy; return true;
+                    case op_i::LT: out = dx < dy; return true;
+                    case op_i::GT: out = dx > dy; return true;
+                    default: return false;
+                }
+            }
+
+            // Strings are compared and joined at run time
+            return false;
+        }
+
+        bool optimizer_t::absorb(const op_i op, const uint32_t type, const uint32_t a, const uint32_t b,
+                                 uint64_t &out) const
+        {
+            const bool integer = kind(type) == type_kind_i::INT;
+            const bool boolean = type == types::BOOL;
+            if (!integer && !boolean)
+                return false;
+
+            // Floats are left out of both: x - x and x == x do not hold for NaN
+            if (a == b)
+            {
+                switch (op)
+                {
+                    case op_i::SUB: out = 0; return integer;
+                    case op_i::EQ: out = 1; return true;
+                    case op_i::NE:
+                    case op_i::LT:
+                    case op_i::GT: out = 0; return true;
+                    default: break;
+                }
+            }
+
+            const uint64_t all_ones = integer ? wrap(type, ~uint64_t{ 0 }) : 1;
+            for (const uint32_t side : { a, b })
+            {
+                if ((op == op_i::MUL && integer && is_constant(side, 0)) || (op == op_i::AND && is_constant(side, 0)) ||
+                    (op == op_i::OR && is_constant(side, all_ones)))
+                {
+                    out = cells[side].bits;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void optimizer_t::solve()
+        {
+            while (!block_work.empty() || !value_work.empty())
+            {
+                if (!block_work.empty())
+                {
+                    const block_t &block = function->blocks[block_work.back()];
+                    block_work.pop_back();
+                    for (uint32_t i = block.first; i < block.first + block.count; ++i)
+                        evaluate(i);
+                    continue;
+                }
+                const uint32_t value = value_work.back();
+                value_work.pop_back();
+                for (uint32_t u = first_user[value]; u < first_user[value + 1]; ++u)
+                {
+                    if (reachable[block_of[users[u]]])
+                        evaluate(users[u]);
+                }
+            }
+        }
+
+        bool optimizer_t::settle_unknown_branches()
+        {
+            // A condition nothing defines on any running path may go either way
+            bool changed = false;
+            for (uint32_t b = 0; b < function->blocks.size(); ++b)
+            {
+                if (!reachable[b])
+                    continue;
+                const block_t &block = function->blocks[b];
+                const instr_t &last = function->instrs[block.first + block.count - 1];
+                if (last.op != op_i::BRANCH)
+                    continue;
+                const uint32_t condition = function->operands_of(last)[0];
+                if (cells[condition].state != lattice_i::UNKNOWN)
+                    continue;
+                cells[condition] = VARYING;
+                value_work.push_back(condition);
+                changed = true;
+            }
+            return changed;
+        }
+
+        uint32_t optimizer_t::identity(const uint32_t instr)
+        {
+            const instr_t &in = function->instrs[instr];
+            const uint32_t *operands = function->operands_of(in);
+            if (in.op == op_i::NEG || in.op == op_i::NOT)
+            {
+                const uint32_t inner = resolve(operands[0]);
+                const instr_t &operand = function->instrs[inner];
+                return operand.op == in.op && cells[inner].state != lattice_i::CONSTANT
+                           ? resolve(function->operands_of(operand)[0])
+                           : NONE;
+            }
+            if (in.operand_count != 2 || in.op < op_i::ADD || in.op > op_i::GT)
+                return NONE;
+
+            const uint32_t a = resolve(operands[0]);
+            const uint32_t b = resolve(operands[1]);
+            const uint32_t type = function->instrs[a].type;
+            // x op unit is x, and unit op x is x when the operator commutes
+            const auto unit = [&](const uint64_t bits, const bool commutes)
+            {
+                if (is_constant(b, bits))
+                    return a;
+                return commutes && is_constant(a, bits) ? b : NONE;
+            };
+
+            if (type == types::BOOL)
+            {
+                switch (in.op)
+                {
+                    case op_i::AND:
+                    case op_i::EQ: return unit(1, true);
+                    case op_i::OR:
+                    case op_i::NE: return unit(0, true);
+                    default: return NONE;
+                }
+            }
+            if (kind(type) == type_kind_i::INT)
+            {
+                switch (in.op)
+                {
+                    case op_i::ADD:
+                    case op_i::OR: return unit(0, true);
+                    case op_i::SUB: return unit(0, false);
+                    case op_i::MUL: return unit(1, true);
+                    case op_i::DIV: return unit(1, false);
+                    case op_i::AND: return unit(wrap(type, ~uint64_t{ 0 }), true);
+                    default: return NONE;
+                }
+            }
+            if (kind(type) == type_kind_i::FLOAT)
+            {
+                // x + 0.0 is not x when x is -0.0, but x - 0.0 is
+                switch (in.op)
+                {
+                    case op_i::SUB: return unit(double_bits(0.0), false);
+                    case op_i::MUL: return unit(double_bits(1.0), true);
+                    case op_i::DIV: return unit(double_bits(1.0), false);
+                    default: return NONE;
+                }
+            }
+            return NONE;
+        }
+
+        void optimizer_t::forward()
+        {
+            std::vector<uint32_t> &phis = worklist;
+            phis.clear();
+            for (uint32_t i = 0; i < function->instrs.size(); ++i)
+            {
+                if (!reachable[block_of[i]] || cells[i].state == lattice_i::CONSTANT)
+                    continue;
+                if (function->instrs[i].op == op_i::PHI)
+                {
+                    phis.push_back(i);
+                }
+                else if (const uint32_t same = identity(i); same != NONE)
+                {
+                    replacement[i] = same;
+                    ++stats.simplified;
+                }
+            }
+
+            // A phi that merges one value, besides itself, over the edges that run is that value;
+            // replacing it can make the phis that use it trivial in turn
+            while (!phis.empty())
+            {
+                const uint32_t phi = phis.back();
+                phis.pop_back();
+                if (replacement[phi] != NONE)
+                    continue;
+                const instr_t &in = function->instrs[phi];
+                const block_t &block = function->blocks[block_of[phi]];
+                uint32_t same = NONE;
+                bool trivial = true;
+                for (uint32_t o = 0; o < in.operand_count && trivial; ++o)
+                {
+                    if (!edge_live[block.first_pred + o])
+                        continue;
+                    const uint32_t value = resolve(function->operands_of(in)[o]);
+                    if (value == same || value == phi)
+                        continue;
+                    trivial = same == NONE;
+                    same = value;
+                }
+                if (!trivial || same == NONE)
+                    continue;
+                replacement[phi] = same;
+                for (uint32_t u = first_user[phi]; u < first_user[phi + 1]; ++u)
+                {
+                    const uint32_t user = users[u];
+                    if (function->instrs[user].op == op_i::PHI && user != phi && reachable[block_of[user]] &&
+                        cells[user].state != lattice_i::CONSTANT)
+                        phis.push_back(user);
+                }
+            }
+        }
+
+        void optimizer_t::mark_live()
+        {
+            std::vector<uint32_t> &work = worklist;
+            work.clear();
+            for (uint32_t i = 0; i < function->instrs.size(); ++i)
+            {
+                const instr_t &in = function->instrs[i];
+                if (!reachable[block_of[i]] || replacement[i] != NONE)
+                    continue;
+                bool root;
+                switch (in.op)
+                {
+                    case op_i::PARAM:
+                    case op_i::STORE_FIELD:
+                    case op_i::CALL:
+                    case op_i::JUMP:
+                    case op_i::BRANCH:
+                    case op_i::RETURN:
+                        root = true;
+                        break;
+                    case op_i::DIV:
+                    case op_i::REM:
+                        // Integer division by zero or of the lowest value by -1 traps, and folding
+                        // proved the operands do neither
+                        root = kind(in.type) == type_kind_i::INT && cells[i].state != lattice_i::CONSTANT;
+                        break;
+                    default:
+                        root = false;
+                        break;
+                }
+                if (root)
+                {
+                    live[i] = 1;
+                    work.push_back(i);
+                }
+            }
+
+            while (!work.empty())
+            {
+                const uint32_t i = work.back();
+                work.pop_back();
+                const instr_t &in = function->instrs[i];
+                // Constants are emitted without operands, and a branch on one as a jump
+                if (cells[i].state == lattice_i::CONSTANT || folded_branch(in))
+                    continue;
+                const block_t &block = function->blocks[block_of[i]];
+                for (uint32_t o = 0; o < in.operand_count; ++o)
+                {
+                    if (in.op == op_i::PHI && !edge_live[block.first_pred + o])
+                        continue;
+                    const uint32_t value = resolve(function->operands_of(in)[o]);
+                    if (!live[value])
+                    {
+                        live[value] = 1;
+                        work.push_back(value);
+                    }
+                }
+            }
+        }
+
+        void optimizer_t::rebuild()
+        {
+            const auto block_count = static_cast<uint32_t>(function->blocks.size());
+
+            // A block is merged into its only predecessor when that predecessor jumps to it
+            live_preds.assign(block_count, 0);
+            for (uint32_t b = 0; b < block_count; ++b)
+            {
+                const block_t &block = function->blocks[b];
+                for (uint32_t p = block.first_pred; p < block.first_pred + block.pred_count; ++p)
+                    live_preds[b] += edge_live[p];
+            }
+            merged.assign(block_count, 0);
+            for (uint32_t b = 0; b < block_count; ++b)
+            {
+                const uint32_t target = reachable[b] ? jump_target(b) : NONE;
+                if (target != NONE && target != 0 && target != b && live_preds[target] == 1)
+                    merged[target] = 1;
+            }
+
+            // Each chain of merged blocks becomes one block: the head's phis, the rest in order,
+            // and the terminator of the last block
+            new_block_id.assign(block_count, NONE);
+            order.clear();
+            heads.clear();
+            block_ends.clear();
+            const auto emitted = [&](const uint32_t i) { return live[i] && replacement[i] == NONE; };
+            for (uint32_t head = 0; head < block_count; ++head)
+            {
+                if (!reachable[head] || merged[head])
+                    continue;
+                const auto id = static_cast<uint32_t>(heads.size());
+                const block_t &first = function->blocks[head];
+                for (uint32_t i = first.first; i < first.first + first.count; ++i)
+                {
+                    if (function->instrs[i].op == op_i::PHI && emitted(i) && cells[i].state != lattice_i::CONSTANT)
+                        order.push_back(i);
+                }
+                uint32_t b = head;
+                while (true)
+                {
+                    new_block_id[b] = id;
+                    const block_t &block = function->blocks[b];
+                    const uint32_t last = block.first + block.count - 1;
+                    for (uint32_t i = block.first; i < last; ++i)
+                    {
+                        const bool phi = function->instrs[i].op == op_i::PHI;
+                        if (emitted(i) && (!phi || cells[i].state == lattice_i::CONSTANT))
+                            order.push_back(i);
+                    }
+                    const uint32_t target = jump_target(b);
+                    if (target == NONE || !merged[target])
+                    {
+                        order.push_back(last);
+                        break;
+                    }
+                    b = target;
+                }
+                heads.push_back(head);
+                block_ends.push_back(static_cast<uint32_t>(order.size()));
+            }
+
+            new_id.assign(function->instrs.size(), NONE);
+            for (uint32_t i = 0; i < order.size(); ++i)
+                new_id[order[i]] = i;
+
+            function_t &out = spare;
+            out.owner = function->owner;
+            out.member = function->member;
+            out.instrs.clear();
+            out.operands.clear();
+            out.blocks.clear();
+            out.preds.clear();
+            for (uint32_t position = 0; position < order.size(); ++position)
+            {
+                if (out.blocks.empty() || position == block_ends[out.blocks.size() - 1])
+                {
+                    // The head's predecessors over the edges that run, in slot order like its phis
+                    const auto id = static_cast<uint32_t>(out.blocks.size());
+                    const block_t &head = function->blocks[heads[id]];
+                    out.blocks.push_back({ position, block_ends[id] - position, static_cast<uint32_t>(out.preds.size()), 0 });
+                    for (uint32_t p = head.first_pred; p < head.first_pred + head.pred_count; ++p)
+                    {
+                        if (edge_live[p])
+                            out.preds.push_back(new_block_id[function->preds[p]]);
+                    }
+                    out.blocks.back().pred_count = static_cast<uint32_t>(out.preds.size()) - out.blocks.back().first_pred;
+                }
+
+                const uint32_t i = order[position];
+                const uint32_t b = block_of[i];
+
+                const instr_t &in = function->instrs[i];
+                instr_t instr = in;
+                instr.first_operand = static_cast<uint32_t>(out.operands.size());
+                instr.operand_count = 0;
+                if (cells[i].state == lattice_i::CONSTANT && in.op != op_i::CONST)
+                {
+                    instr.op = op_i::CONST;
+                    instr.imm = cells[i].bits;
+                    out.instrs.push_back(instr);
+                    continue;
+                }
+                if (folded_branch(in))
+                {
+                    instr.op = op_i::JUMP;
+                    instr.imm = new_block_id[jump_target(b)];
+                    out.instrs.push_back(instr);
+                    continue;
+                }
+
+                const block_t &block = function->blocks[b];
+                for (uint32_t o = 0; o < in.operand_count; ++o)
+                {
+                    if (in.op == op_i::PHI && !edge_live[block.first_pred + o])
+                        continue;
+                    out.operands.push_back(new_id[resolve(function->operands_of(in)[o])]);
+                    ++instr.operand_count;
+                }
+                if (in.op == op_i::JUMP)
+                    instr.imm = new_block_id[in.imm];
+                else if (in.op == op_i::BRANCH)
+                    instr.imm = new_block_id[static_cast<uint32_t>(in.imm)] |
+                                static_cast<uint64_t>(new_block_id[in.imm >> 32]) << 32;
+                out.instrs.push_back(instr);
+            }
+
+            stats.removed_blocks += block_count - static_cast<uint32_t>(out.blocks.size());
+            stats.removed_instrs += static_cast<uint32_t>(function->instrs.size() - out.instrs.size());
+            std::swap(*function, spare);
+        }
+
+        void optimizer_t::run(function_t &target)
+        {
+            function = &target;
+            index();
+            reachable[0] = 1;
+            block_work.push_back(0);
+            do
+                solve();
+            while (settle_unknown_branches());
+
+            for (uint32_t i = 0; i < function->instrs.size(); ++i)
+            {
+                if (!reachable[block_of[i]])
+                    continue;
+                const instr_t &in = function->instrs[i];
+                stats.folded += in.op != op_i::CONST && cells[i].state == lattice_i::CONSTANT;
+                stats.branches += folded_branch(in);
+            }
+
+            forward();
+            mark_live();
+            rebuild();
+            ++stats.functions;
+        }
+    }
+
+    void optimize_function(const module_ir &module, function_t &function, optimize_stats_t &stats)
+    {
+        optimizer_t(module, stats).run(function);
+    }
+
+    void optimize_module(module_ir &ir, optimize_stats_t &stats)
+    {
+        optimizer_t optimizer(ir, stats);
+        for (auto &function : ir.functions)
+            optimizer.run(function);
+    }
+}
@@ -0,0 +1,553 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/ssa.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace yu::middle
+{
+    namespace
+    {
+        using frontend::type_kind_i;
+        namespace types = frontend::types;
+
+        constexpr uint32_t NONE = UINT32_MAX;
+
+        const char *op_name(const op_i op)
+        {
+            static constexpr const char *names[] = {
+                "const", "undef", "param", "phi", "add", "sub", "mul", "div", "rem", "and", "or", "eq", "ne",
+                "lt", "gt", "neg", "not", "load_field", "store_field", "call", "jump", "branch", "return"
+            };
+            return names[static_cast<uint8_t>(op)];
+        }
+
+        /**
+         * @brief Blocks in reverse postorder from the entry, and the immediate dominator of each
+         * (Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"). Unreachable blocks
+         * keep NONE.
+         */
+        struct dominators_t
+        {
+            std::vector<uint32_t> rpo_index;
+            std::vector<uint32_t> idom;
+
+            explicit dominators_t(const function_t &function)
+                : rpo_index(function.blocks.size(), NONE), idom(function.blocks.size(), NONE)
+            {
+                // Iterative DFS; a block is finished once all its successors were pushed
+                std::vector<uint32_t> postorder;
+                std::vector<uint8_t> seen(function.blocks.size(), 0);
+                std::vector<std::pair<uint32_t, uint32_t>> stack{ { 0, 0 } };
+                seen[0] = 1;
+                while (!stack.empty())
+                {
+                    auto &[block, next] = stack.back();
+                    uint32_t successors[2];
+                    const uint32_t count = function.successors(block, successors);
+                    if (next < count)
+                    {
+                        const uint32_t successor = successors[next++];
+                        if (successor < seen.size() && !seen[successor])
+                        {
+                            seen[successor] = 1;
+                            stack.emplace_back(successor, 0);
+                        }
+                        continue;
+                    }
+                    postorder.push_back(block);
+                    stack.pop_back();
+                }
+
+                std::vector<uint32_t> rpo(postorder.rbegin(), postorder.rend());
+                for (uint32_t i = 0; i < rpo.size(); ++i)
+                    rpo_index[rpo[i]] = i;
+
+                idom[0] = 0;
+                for (bool changed = true; changed;)
+                {
+                    changed = false;
+                    for (size_t i = 1; i < rpo.size(); ++i)
+                    {
+                        const block_t &block = function.blocks[rpo[i]];
+                        uint32_t new_idom = NONE;
+                        for (uint32_t p = 0; p < block.pred_count; ++p)
+                        {
+                            const uint32_t pred = function.preds[block.first_pred + p];
+                            if (pred >= idom.size() || idom[pred] == NONE)
+                                continue;
+                            new_idom = new_idom == NONE ? pred : intersect(pred, new_idom);
+                        }
+                        if (new_idom != idom[rpo[i]])
+                        {
+                            idom[rpo[i]] = new_idom;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+
+            [[nodiscard]] uint32_t intersect(uint32_t a, uint32_t b) const
+            {
+                while (a != b)
+                {
+                    while (rpo_index[a] > rpo_index[b])
+                        a = idom[a];
+                    while (rpo_index[b] > rpo_index[a])
+                        b = idom[b];
+                }
+                return a;
+            }
+
+            [[nodiscard]] bool dominates(const uint32_t a, uint32_t b) const
+            {
+                if (rpo_index[a] == NONE || rpo_index[b] == NONE)
+                    return false;
+                while (b != a && b != 0)
+                    b = idom[b];
+                return b == a;
+            }
+        };
+
+        /**
+         * @brief Collects verifier messages, each naming the instruction or block it is about.
+         */
+        struct verifier_t
+        {
+            const module_ir &module;
+            const function_t &function;
+            const frontend::semantic_model &model;
+            std::vector<std::string> errors;
+
+            void fail(const std::string &message) { errors.push_back(message); }
+
+            void fail_at(const uint32_t instr, const std::string &message)
+            {
+                fail("%" + std::to_string(instr) + " (" + op_name(function.instrs[instr].op) + "): " + message);
+            }
+
+            [[nodiscard]] type_kind_i kind(const uint32_t type) const
+            {
+                return type < model.types.size() ? model.types[type].kind : type_kind_i::ERROR;
+            }
+
+            [[nodiscard]] bool is_numeric(const uint32_t type) const
+            {
+                return kind(type) == type_kind_i::INT || kind(type) == type_kind_i::FLOAT;
+            }
+
+            /**
+             * @brief Checks that `instr` has `count` operands, all of type `type` (NONE for any).
+             */
+            bool expect_operands(const uint32_t instr, const uint32_t count, const uint32_t type)
+            {
+                const instr_t &in = function.instrs[instr];
+                if (in.operand_count != count)
+                {
+                    fail_at(instr, "expected " + std::to_string(count) + " operands, got " +
+                                   std::to_string(in.operand_count));
+                    return false;
+                }
+                for (uint32_t i = 0; i < count && type != NONE; ++i)
+                {
+                    const uint32_t operand = function.operands_of(in)[i];
+                    if (function.instrs[operand].type != type)
+                    {
+                        fail_at(instr, "operand %" + std::to_string(operand) + " is '" +
+                                       model.type_name(function.instrs[operand].type) + "', expected '" +
+                                       model.type_name(type) + "'");
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            const frontend::member_t *expect_member(const uint32_t instr, const bool method)
+            {
+                const instr_t &in = function.instrs[instr];
+                if (in.imm >= model.members.size() || model.members[in.imm].is_method != method)
+                {
+                    fail_at(instr, std::string("imm is not a ") + (method ? "method" : "field"));
+                    return nullptr;
+                }
+                return &model.members[in.imm];
+            }
+
+            void check_types(const uint32_t instr, const block_t &entry)
+            {
+                const instr_t &in = function.instrs[instr];
+                const uint32_t *operands = function.operands_of(in);
+                const frontend::member_t &method = model.members[function.member];
+                switch (in.op)
+                {
+                    case op_i::CONST:
+                    case op_i::UNDEF:
+                        expect_operands(instr, 0, NONE);
+                        if (in.op == op_i::CONST && in.type == types::STRING && in.imm >= module.strings.size())
+                            fail_at(instr, "no such string constant");
+                        break;
+                    case op_i::PARAM:
+                    {
+                        expect_operands(instr, 0, NONE);
+                        if (instr >= entry.first + entry.count)
+                            fail_at(instr, "parameters belong to the entry block");
+                        if (in.imm > method.param_count)
+                        {
+                            fail_at(instr, "no such parameter");
+                            break;
+                        }
+                        const uint32_t type = in.imm ? model.params[method.first_param + in.imm - 1] : function.owner;
+                        if (in.type != type)
+                            fail_at(instr, "parameter type is '" + model.type_name(type) + "'");
+                        break;
+                    }
+                    case op_i::PHI:
+                        expect_operands(instr, in.operand_count, in.type);
+                        break;
+                    case op_i::ADD:
+                        if (!is_numeric(in.type) && in.type != types::STRING)
+                            fail_at(instr, "cannot add '" + model.type_name(in.type) + "'");
+                        expect_operands(instr, 2, in.type);
+                        break;
+                    case op_i::SUB:
+                    case op_i::MUL:
+                    case op_i::DIV:
+                        if (!is_numeric(in.type))
+                            fail_at(instr, "needs a numeric type");
+                        expect_operands(instr, 2, in.type);
+                        break;
+                    case op_i::REM:
+                        if (kind(in.type) != type_kind_i::INT)
+                            fail_at(instr, "needs an integer type");
+                        expect_operands(instr, 2, in.type);
+                        break;
+                    case op_i::AND:
+                    case op_i::OR:
+                        if (in.type != types::BOOL && kind(in.type) != type_kind_i::INT)
+                            fail_at(instr, "needs a boolean or integer type");
+                        expect_operands(instr, 2, in.type);
+                        break;
+                    case op_i::EQ:
+                    case op_i::NE:
+                    case op_i::LT:
+                    case op_i::GT:
+                        if (in.type != types::BOOL)
+                            fail_at(instr, "comparisons are 'boolean'");
+                        if (expect_operands(instr, 2, NONE))
+                        {
+                            const uint32_t type = function.instrs[operands[0]].type;
+                            expect_operands(instr, 2, type);
+                            if ((in.op == op_i::LT || in.op == op_i::GT) && !is_numeric(type))
+                                fail_at(instr, "needs numeric operands");
+                        }
+                        break;
+                    case op_i::NEG:
+                        if (!is_numeric(in.type))
+                            fail_at(instr, "needs a numeric type");
+                        expect_operands(instr, 1, in.type);
+                        break;
+                    case op_i::NOT:
+                        if (in.type != types::BOOL)
+                            fail_at(instr, "needs a boolean");
+                        expect_operands(instr, 1, types::BOOL);
+                        break;
+                    case op_i::LOAD_FIELD:
+                    case op_i::STORE_FIELD:
+                    {
+                        const bool load = in.op == op_i::LOAD_FIELD;
+                        const frontend::member_t *field = expect_member(instr, false);
+                        if (!field || !expect_operands(instr, load ? 1 : 2, NONE))
+                            break;
+                        check_receiver(instr, operands[0]);
+                        if (load && in.type != field->type)
+                            fail_at(instr, "field type is '" + model.type_name(field->type) + "'");
+                        if (!load && (in.type != types::VOID || function.instrs[operands[1]].type != field->type))
+                            fail_at(instr, "stores '" + model.type_name(field->type) + "' and defines nothing");
+                        break;
+                    }
+                    case op_i::CALL:
+                    {
+                        const frontend::member_t *callee = expect_member(instr, true);
+                        if (!callee || !expect_operands(instr, callee->param_count + 1, NONE))
+                            break;
+                        check_receiver(instr, operands[0]);
+                        for (uint32_t i = 0; i < callee->param_count; ++i)
+                        {
+                            if (function.instrs[operands[i + 1]].type != model.params[callee->first_param + i])
+                                fail_at(instr, "argument " + std::to_string(i + 1) + " has the wrong type");
+                        }
+                        if (in.type != callee->type)
+                            fail_at(instr, "returns '" + model.type_name(callee->type) + "'");
+                        break;
+                    }
+                    case op_i::JUMP:
+                        expect_operands(instr, 0, NONE);
+                        break;
+                    case op_i::BRANCH:
+                        expect_operands(instr, 1, types::BOOL);
+                        break;
+                    case op_i::RETURN:
+                        if (method.type == types::VOID)
+                            expect_operands(instr, 0, NONE);
+                        else
+                            expect_operands(instr, 1, method.type);
+                        break;
+                }
+            }
+
+            /**
+             * @brief The object of a field access or call must be of the class declaring the member.
+             */
+            void check_receiver(const uint32_t instr, const uint32_t object)
+            {
+                const uint32_t member = static_cast<uint32_t>(function.instrs[instr].imm);
+                const uint32_t type = function.instrs[object].type;
+                const bool owns = kind(type) == type_kind_i::CLASS && member >= model.types[type].first_member &&
+                                  member < model.types[type].first_member + model.types[type].member_count;
+                if (!owns)
+                    fail_at(instr, "'" + model.type_name(type) + "' has no such member");
+            }
+        };
+    }
+
+    uint32_t function_t::successors(const uint32_t block, uint32_t out[2]) const
+    {
+        const block_t &b = blocks[block];
+        if (!b.count)
+            return 0;
+        const instr_t &last = instrs[b.first + b.count - 1];
+        if (last.op == op_i::JUMP)
+        {
+            out[0] = static_cast<uint32_t>(last.imm);
+            return 1;
+        }
+        if (last.op == op_i::BRANCH)
+        {
+            out[0] = static_cast<uint32_t>(last.imm);
+            out[1] = static_cast<uint32_t>(last.imm >> 32);
+            return 2;
+        }
+        return 0;
+    }
+
+    std::vector<std::string> verify(const module_ir &module, const function_t &function)
+    {
+        verifier_t verifier{ module, function, *module.model, {} };
+        const auto &blocks = function.blocks;
+        const auto &instrs = function.instrs;
+        if (blocks.empty())
+        {
+            verifier.fail("function has no blocks");
+            return verifier.errors;
+        }
+
+        // Blocks tile the instruction array, each ending in its only terminator, phis first
+        std::vector<uint32_t> block_of(instrs.size(), NONE);
+        uint32_t next = 0;
+        for (uint32_t b = 0; b < blocks.size(); ++b)
+        {
+            const block_t &block = blocks[b];
+            const std::string name = "b" + std::to_string(b);
+            if (block.first != next || block.count == 0 || block.first + block.count > instrs.size())
+            {
+                verifier.fail(name + ": instructions do not follow the previous block");
+                return verifier.errors;
+            }
+            next = block.first + block.count;
+            if (block.first_pred + block.pred_count > function.preds.size())
+            {
+                verifier.fail(name + ": predecessors out of range");
+                return verifier.errors;
+            }
+
+            bool leading = true;
+            for (uint32_t i = block.first; i < next; ++i)
+            {
+                block_of[i] = b;
+                const op_i op = instrs[i].op;
+                if (op == op_i::PHI && !leading)
+                    verifier.fail_at(i, "phi after other instructions");
+                if (op == op_i::PHI && instrs[i].operand_count != block.pred_count)
+                    verifier.fail_at(i, "needs one operand per predecessor");
+                leading &= op == op_i::PHI;
+                if (is_terminator(op) != (i == next - 1))
+                    verifier.fail(name + ": must end in exactly one terminator");
+            }
+
+            uint32_t successors[2];
+            for (uint32_t s = 0, count = function.successors(b, successors); s < count; ++s)
+            {
+                if (successors[s] >= blocks.size() || successors[s] == 0)
+                    verifier.fail(name + ": jumps to b" + std::to_string(successors[s]));
+            }
+        }
+        if (next != instrs.size())
+            verifier.fail("instructions after the last block");
+        if (blocks[0].pred_count)
+            verifier.fail("b0: the entry block has predecessors");
+        if (!verifier.errors.empty())
+            return verifier.errors;
+
+        // Predecessor lists hold exactly the edges the terminators make
+        std::vector<std::vector<uint32_t>> expected(blocks.size());
+        for (uint32_t b = 0; b < blocks.size(); ++b)
+        {
+            uint32_t successors[2];
+            for (uint32_t s = 0, count = function.successors(b, successors); s < count; ++s)
+                expected[successors[s]].push_back(b);
+        }
+        for (uint32_t b = 0; b < blocks.size(); ++b)
+        {
+            const auto *first = function.preds.data() + blocks[b].first_pred;
+            std::vector<uint32_t> actual(first, first + blocks[b].pred_count);
+            std::sort(actual.begin(), actual.end());
+            if (actual != expected[b])
+                verifier.fail("b" + std::to_string(b) + ": predecessors do not match the terminators");
+        }
+
+        const dominators_t dominators(function);
+        for (uint32_t b = 0; b < blocks.size(); ++b)
+        {
+            if (dominators.rpo_index[b] == NONE)
+                verifier.fail("b" + std::to_string(b) + ": unreachable");
+        }
+        if (!verifier.errors.empty())
+            return verifier.errors;
+
+        // Definitions dominate uses; a phi operand only needs to reach the end of its predecessor
+        for (uint32_t i = 0; i < instrs.size(); ++i)
+        {
+            const instr_t &instr = instrs[i];
+            const block_t &block = blocks[block_of[i]];
+            bool defined = true;
+            for (uint32_t o = 0; o < instr.operand_count; ++o)
+            {
+                const uint32_t operand = function.operands_of(instr)[o];
+                if (operand >= instrs.size() || instrs[operand].type == types::VOID)
+                {
+                    verifier.fail_at(i, "operand " + std::to_string(o) + " is not a value");
+                    defined = false;
+                    continue;
+                }
+                const bool dominates = instr.op == op_i::PHI
+                                           ? dominators.dominates(block_of[operand],
+                                                                  function.preds[block.first_pred + o])
+                                           : block_of[operand] == block_of[i]
+                                                 ? operand < i
+                                                 : dominators.dominates(block_of[operand], block_of[i]);
+                if (!dominates)
+                {
+                    verifier.fail_at(i, "operand %" + std::to_string(operand) + " does not dominate its use");
+                    defined = false;
+                }
+            }
+            if (defined)
+                verifier.check_types(i, blocks[0]);
+        }
+        return verifier.errors;
+    }
+
+    std::string function_name(const module_ir &module, const function_t &function)
+    {
+        const auto &model = *module.model;
+        return model.type_name(function.owner) + "." + std::string(model.names.view(model.members[function.member].name));
+    }
+
+    std::string dump(const module_ir &module, const function_t &function)
+    {
+        const auto &model = *module.model;
+        const frontend::member_t &method = model.members[function.member];
+        std::string out = "function " + function_name(module, function) + "(" + model.type_name(function.owner);
+        for (uint32_t i = 0; i < method.param_count; ++i)
+            out += ", " + model.type_name(model.params[method.first_param + i]);
+        out += ") -> " + model.type_name(method.type) + "\n";
+
+        char number[64];
+        const auto value = [](const uint32_t id) { return "%" + std::to_string(id); };
+        const auto member_name = [&](const uint64_t member) { return std::string(model.names.view(model.members[member].name)); };
+        for (uint32_t b = 0; b < function.blocks.size(); ++b)
+        {
+            const block_t &block = function.blocks[b];
+            out += "b" + std::to_string(b) + ":";
+            for (uint32_t p = 0; p < block.pred_count; ++p)
+                out += (p ? ", b" : " ; preds b") + std::to_string(function.preds[block.first_pred + p]);
+            out += "\n";
+
+            for (uint32_t i = block.first; i < block.first + block.count; ++i)
+            {
+                const instr_t &instr = function.instrs[i];
+                const uint32_t *operands = function.operands_of(instr);
+                out += "  ";
+                if (instr.type != frontend::types::VOID)
+                    out += value(i) + " = ";
+                out += op_name(instr.op);
+
+                switch (instr.op)
+                {
+                    case op_i::CONST:
+                        if (instr.type == types::STRING)
+                        {
+                            out += " " + module.strings[instr.imm];
+                        }
+                        else if (instr.type == types::BOOL)
+                        {
+                            out += instr.imm ? " true" : " false";
+                        }
+                        else if (model.types[instr.type].kind == type_kind_i::FLOAT)
+                        {
+                            double d;
+                            std::memcpy(&d, &instr.imm, sizeof(d));
+                            std::snprintf(number, sizeof(number), " %.17g", d);
+                            out += number;
+                        }
+                        else
+                        {
+                            std::snprintf(number, sizeof(number), model.types[instr.type].is_signed ? " %" PRId64 : " %" PRIu64,
+                                          instr.imm);
+                            out += number;
+                        }
+                        break;
+                    case op_i::PARAM:
+                        out += " " + std::to_string(instr.imm);
+                        break;
+                    case op_i::PHI:
+                        for (uint32_t o = 0; o < instr.operand_count; ++o)
+                            out += (o ? ", [" : " [") + value(operands[o]) + ", b" +
+                                   std::to_string(function.preds[block.first_pred + o]) + "]";
+                        break;
+                    case op_i::LOAD_FIELD:
+                    case op_i::STORE_FIELD:
+                        out += " " + value(operands[0]) + "." + member_name(instr.imm);
+                        if (instr.op == op_i::STORE_FIELD)
+                            out += ", " + value(operands[1]);
+                        break;
+                    case op_i::CALL:
+                        out += " " + value(operands[0]) + "." + member_name(instr.imm) + "(";
+                        for (uint32_t o = 1; o < instr.operand_count; ++o)
+                            out += (o > 1 ? ", " : "") + value(operands[o]);
+                        out += ")";
+                        break;
+                    case op_i::JUMP:
+                        out += " b" + std::to_string(static_cast<uint32_t>(instr.imm));
+                        break;
+                    case op_i::BRANCH:
+                        out += " " + value(operands[0]) + ", b" + std::to_string(static_cast<uint32_t>(instr.imm)) +
+                               ", b" + std::to_string(static_cast<uint32_t>(instr.imm >> 32));
+                        break;
+                    default:
+                        for (uint32_t o = 0; o < instr.operand_count; ++o)
+                            out += (o ? ", " : " ") + value(operands[o]);
+                        break;
+                }
+                if (instr.type != frontend::types::VOID)
+                    out += " : " + model.type_name(instr.type);
+                out += "\n";
+            }
+        }
+        return out;
+    }
+}
@@ -0,0 +1,528 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include "../../common/allocator.h"
+
+namespace alloc = yumina::detail::yumina::detail::internal;
+
+namespace
+{
+    // The quarantine and guard pages change which blocks are reused, by design
+#ifdef YUMINA_ALLOC_DEBUG
+    constexpr bool DEBUG_HEAP = true;
+#else
+    constexpr bool DEBUG_HEAP = false;
+#endif
+
+    yumina::detail::alloc_stats snapshot()
+    {
+        yumina::detail::alloc_stats stats{};
+        alloc::get_stats(stats);
+        return stats;
+    }
+
+    size_t mapped_bytes()
+    {
+        return snapshot().mapped_bytes;
+    }
+
+    bool filled_with(const void *ptr, const size_t size, const uint8_t value)
+    {
+        const auto *bytes = static_cast<const uint8_t *>(ptr);
+        return std::all_of(bytes, bytes + size, [&](const uint8_t byte) { return byte == value; });
+    }
+
+    /**
+     * @brief Runs `body` on a thread of its own, so it starts with empty caches and pools.
+     */
+    template<typename F>
+    void on_new_thread(F &&body)
+    {
+        std::thread(std::forward<F>(body)).join();
+    }
+
+    /**
+     * @brief Allocates and frees `count` small blocks on a thread of its own.
+     */
+    void churn_thread(const size_t count)
+    {
+        std::thread([count]
+        {
+            std::vector<void *> blocks(count);
+            for (auto &block : blocks)
+                block = alloc::allocate(48);
+            for (auto *block : blocks)
+                alloc::deallocate(block);
+        }).join();
+    }
+}
+
+TEST(Allocator, NewThreadReusesExitedThreadRegion)
+{
+    if (alloc::numa_nodes() > 1)
+        GTEST_SKIP() << "the next thread may run on another node";
+
+    churn_thread(2000);
+
+    // The exited thread's region sits in the node reserve, so the first block needs no mapping
+    size_t before = 0;
+    size_t after = 0;
+    std::thread([&]
+    {
+        before = mapped_bytes();
+        void *block = alloc::allocate(48);
+        after = mapped_bytes();
+        alloc::deallocate(block);
+    }).join();
+    EXPECT_EQ(after, before);
+}
+
+TEST(Allocator, ShortLivedThreadsDoNotGrowTheHeap)
+{
+    if (alloc::numa_nodes() > 1)
+        GTEST_SKIP() << "threads may take turns on different nodes";
+
+    churn_thread(2000);
+    const size_t settled = mapped_bytes();
+    for (int i = 0; i < 64; ++i)
+        churn_thread(2000);
+    EXPECT_LE(mapped_bytes(), settled + yumina::detail::REGION_SIZE);
+}
+
+TEST(Allocator, AllocationsAfterThreadTeardownDoNotLeak)
+{
+    if (alloc::numa_nodes() > 1)
+        GTEST_SKIP() << "threads may take turns on different nodes";
+
+    // Constructed before the thread's first allocation arms the allocator's exit hook, so it is
+    // destroyed after the hook has torn the heap down
+    struct late_user
+    {
+        ~late_user()
+        {
+            for (const size_t size : { size_t{48}, size_t{3000}, size_t{2 * 1024 * 1024} })
+            {
+                auto *block = static_cast<uint8_t *>(alloc::allocate(size));
+                EXPECT_NE(block, nullptr) << size;
+                if (block)
+                    std::memset(block, 0x3C, size);
+                alloc::deallocate(block);
+            }
+        }
+    };
+
+    const auto run = []
+    {
+        std::thread([]
+        {
+            thread_local late_user user;
+            (void) user;
+            alloc::deallocate(alloc::allocate(48));
+        }).join();
+    };
+
+    run();
+    const size_t settled = mapped_bytes();
+    for (int i = 0; i < 64; ++i)
+        run();
+    // A debug heap holds freed large blocks in its quarantine
+    const size_t quarantined = DEBUG_HEAP ? yumina::detail::QUARANTINE_BYTES : 0;
+    EXPECT_LE(mapped_bytes(), settled + yumina::detail::REGION_SIZE + quarantined);
+}
+
+TEST(Allocator, BlocksOutliveTheirThread)
+{
+    // Freed here after their pools' owner exited; the pools stay until the last one is back
+    std::vector<void *> blocks(500);
+    std::thread([&]
+    {
+        for (auto &block : blocks)
+            block = alloc::allocate(32);
+    }).join();
+
+    churn_thread(2000);
+    for (auto *block : blocks)
+    {
+        std::memset(block, 0x5A, 32);
+        alloc::deallocate(block);
+    }
+    churn_thread(2000);
+}
+
+TEST(Allocator, StatsKeepExitedThreadCounts)
+{
+    const auto total = [](const uint64_t *counts)
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i <= yumina::detail::SIZE_CLASSES; ++i)
+            sum += counts[i];
+        return sum;
+    };
+
+    // An exited thread leaves the registry, and its counters move to the retired totals.
+    // std::thread allocates too when the global allocator is ours, so only the worker's own
+    // blocks are counted exactly
+    const auto before = snapshot();
+    yumina::detail::alloc_stats start{};
+    yumina::detail::alloc_stats inside{};
+    std::thread([&]
+    {
+        void *blocks[100];
+        start = snapshot();
+        for (auto &block : blocks)
+            block = alloc::allocate(48);
+        for (auto *block : blocks)
+            alloc::deallocate(block);
+        inside = snapshot();
+    }).join();
+    const auto after = snapshot();
+    EXPECT_EQ(total(inside.allocs) - total(start.allocs), 100u);
+    EXPECT_EQ(total(inside.frees) - total(start.frees), 100u);
+    EXPECT_GE(total(after.allocs), total(inside.allocs));
+    EXPECT_GE(total(after.frees), total(inside.frees));
+    EXPECT_EQ(after.threads, before.threads);
+}
+
+TEST(Allocator, TraceReadsNeverTear)
+{
+    // Each writer allocates one size, so an entry whose size and class disagree was torn
+    alloc::set_trace_sampling(1);
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> writers;
+    for (const size_t size : { size_t{24}, size_t{200}, size_t{3000} })
+    {
+        writers.emplace_back([size, &stop]
+        {
+            while (!stop.load(std::memory_order_relaxed))
+                alloc::deallocate(alloc::allocate(size));
+        });
+    }
+
+    std::vector<yumina::detail::trace_entry> entries(256);
+    size_t seen = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (seen < 100000 && std::chrono::steady_clock::now() < deadline)
+    {
+        const size_t count = alloc::get_trace(entries.data(), entries.size());
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto &entry = entries[i];
+            // Tiny class 2, pool class 9 and medium class 13
+            const uint8_t expected = entry.size == 24 ? 2 : entry.size == 200 ? 9 : 13;
+            if (entry.size == 24 || entry.size == 200 || entry.size == 3000)
+            {
+                EXPECT_EQ(entry.size_class, expected) << entry.size;
+                ++seen;
+            }
+        }
+    }
+    stop.store(true, std::memory_order_relaxed);
+    for (auto &writer : writers)
+        writer.join();
+    alloc::set_trace_sampling(0);
+    EXPECT_GT(seen, 0u);
+}
+
+TEST(Allocator, ReallocatesInPlace)
+{
+    if (DEBUG_HEAP)
+        GTEST_SKIP() << "debug mode does not hand freed blocks straight back";
+
+    on_new_thread([]
+    {
+        // The first refill takes slots 0-15 of a fresh pool and hands out the lowest first, so
+        // the 16th block is followed by free slots it can grow over
+        std::vector<void *> blocks(16);
+        for (auto &block : blocks)
+            block = alloc::allocate(24);
+        std::memset(blocks.back(), 0x11, 24);
+        EXPECT_EQ(alloc::reallocate(blocks.back(), 150), blocks.back());
+        EXPECT_TRUE(filled_with(blocks.back(), 24, 0x11));
+
+        // Shrinking within the slot span never moves
+        EXPECT_EQ(alloc::reallocate(blocks.back(), 10), blocks.back());
+        for (auto *block : blocks)
+            alloc::deallocate(block);
+    });
+
+    // Mapped blocks shrink by unmapping their tail and grow with mremap where available
+    auto *large = static_cast<uint8_t *>(alloc::allocate(1024 * 1024));
+    ASSERT_NE(large, nullptr);
+    std::memset(large, 0x22, 1024 * 1024);
+    auto *grown = static_cast<uint8_t *>(alloc::reallocate(large, 8 * 1024 * 1024));
+    ASSERT_NE(grown, nullptr);
+    EXPECT_TRUE(filled_with(grown, 1024 * 1024, 0x22));
+    grown[8 * 1024 * 1024 - 1] = 0x33;
+    EXPECT_EQ(alloc::reallocate(grown, 512 * 1024), grown);
+    EXPECT_TRUE(filled_with(grown, 512 * 1024, 0x22));
+    alloc::deallocate(grown);
+}
+
+TEST(Allocator, SizedAndAlignedFrees)
+{
+    if (DEBUG_HEAP)
+        GTEST_SKIP() << "debug mode does not hand freed blocks straight back";
+
+    on_new_thread([]
+    {
+        // A sized free goes to the class cache; the same class hands the block straight back
+        void *block = alloc::allocate(48);
+        const auto before = snapshot();
+        alloc::deallocate_sized(block, 48);
+        void *again = alloc::allocate(48);
+        EXPECT_EQ(again, block);
+
+        // A size from another class is caught by the header and the block still goes home
+        alloc::deallocate_sized(again, 600);
+        EXPECT_EQ(alloc::allocate(48), block);
+        alloc::deallocate_sized(block, 48);
+
+        uint64_t frees = 0;
+        for (size_t i = 0; i <= yumina::detail::SIZE_CLASSES; ++i)
+            frees += snapshot().frees[i] - before.frees[i];
+        EXPECT_EQ(frees, 3u);
+    });
+
+    for (const size_t alignment : { 16u, 128u, 4096u, 65536u, 2u * 1024 * 1024 })
+    {
+        void *block = alloc::allocate_aligned(1000, alignment);
+        ASSERT_NE(block, nullptr) << alignment;
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(block) % alignment, 0u) << alignment;
+        std::memset(block, 0x44, 1000);
+        alloc::deallocate(block);
+    }
+    EXPECT_EQ(alloc::allocate_aligned(64, 3 * 64), nullptr);
+}
+
+TEST(Allocator, SizedFreeLeavesHeapProfile)
+{
+    on_new_thread([]
+    {
+        // The thread's first allocation only arms the sampler; with one sample per byte the
+        // next block is sampled
+        alloc::set_heap_profile(1);
+        alloc::deallocate(alloc::allocate(48));
+        const char *previous = alloc::set_alloc_phase("sized-free");
+        void *block = alloc::allocate(48);
+        alloc::set_alloc_phase(previous);
+        alloc::set_heap_profile(0);
+
+        const auto live_view = []
+        {
+            std::string text;
+            if (FILE *out = std::tmpfile())
+            {
+                alloc::dump_heap_profile(out, yumina::detail::profile_view::live);
+                std::rewind(out);
+                for (int c; (c = std::fgetc(out)) != EOF;)
+                    text += static_cast<char>(c);
+                std::fclose(out);
+            }
+            return text;
+        };
+
+        // Profiling is off by the time the block goes, but it still has to leave the live view
+        EXPECT_NE(live_view().find("sized-free"), std::string::npos);
+        alloc::deallocate_sized(block, 48);
+        EXPECT_EQ(live_view().find("sized-free"), std::string::npos);
+    });
+}
+
+TEST(Allocator, RefillsAndFlushesInBatches)
+{
+    if (DEBUG_HEAP)
+        GTEST_SKIP() << "debug mode does not hand freed blocks straight back";
+
+    on_new_thread([]
+    {
+        // The thread's first allocation sets up its heap, which may allocate on its own
+        alloc::deallocate(alloc::allocate(200));
+
+        // One miss fills half the class cache; the next 15 blocks are hits
+        std::vector<void *> blocks(64);
+        const auto start = snapshot();
+        for (size_t i = 0; i < 16; ++i)
+            blocks[i] = alloc::allocate(56);
+        const auto now = snapshot();
+        EXPECT_EQ(now.cache_misses - start.cache_misses, 1u);
+        EXPECT_EQ(now.cache_hits - start.cache_hits, 15u);
+
+        for (size_t i = 16; i < blocks.size(); ++i)
+            blocks[i] = alloc::allocate(56);
+        for (size_t i = 0; i < blocks.size(); ++i)
+            std::memset(blocks[i], static_cast<int>(i), 56);
+        std::vector sorted(blocks);
+        std::sort(sorted.begin(), sorted.end());
+        EXPECT_EQ(std::adjacent_find(sorted.begin(), sorted.end()), sorted.end());
+
+        // Frees past a full cache hand its older half back to the pools, which lets an emptied
+        // pool go; allocating the same number again needs no more pools than before
+        const uint64_t pools = snapshot().pools;
+        for (auto *block : blocks)
+            alloc::deallocate(block);
+        EXPECT_LT(snapshot().pools, pools);
+        for (auto &block : blocks)
+            block = alloc::allocate(56);
+        EXPECT_LE(snapshot().pools, pools);
+        for (auto *block : blocks)
+            alloc::deallocate(block);
+    });
+}
+
+TEST(Allocator, MediumBlocksSharePools)
+{
+    on_new_thread([]
+    {
+        // Blocks up to 1 MiB come from pools and never map pages of their own
+        const auto before = snapshot();
+        std::vector<std::pair<uint8_t *, size_t>> blocks;
+        for (size_t size = 1025; size <= 1024 * 1024; size = size * 2 + 1)
+        {
+            for (size_t i = 0; i < 8; ++i)
+            {
+                auto *block = static_cast<uint8_t *>(alloc::allocate(size));
+                ASSERT_NE(block, nullptr) << size;
+                std::memset(block, static_cast<int>(blocks.size()), size);
+                blocks.emplace_back(block, size);
+            }
+        }
+        const auto now = snapshot();
+        EXPECT_EQ(now.large_misses, before.large_misses);
+        EXPECT_EQ(now.allocs[yumina::detail::SIZE_CLASSES], before.allocs[yumina::detail::SIZE_CLASSES]);
+        for (size_t i = 0; i < blocks.size(); ++i)
+            EXPECT_TRUE(filled_with(blocks[i].first, blocks[i].second, static_cast<uint8_t>(i))) << i;
+
+        // Every other block goes back from another thread
+        std::thread([&blocks]
+        {
+            for (size_t i = 0; i < blocks.size(); i += 2)
+                alloc::deallocate(blocks[i].first);
+        }).join();
+        for (size_t i = 1; i < blocks.size(); i += 2)
+            alloc::deallocate(blocks[i].first);
+    });
+}
+
+TEST(Allocator, LargeCacheSplitsBestFitAndTrimsOldest)
+{
+    if (DEBUG_HEAP)
+        GTEST_SKIP() << "debug mode does not hand freed blocks straight back";
+
+    if (alloc::numa_nodes() > 1)
+        GTEST_SKIP() << "cached blocks are only reused on the node that freed them";
+
+    on_new_thread([]
+    {
+        constexpr size_t MIB = 1024 * 1024;
+
+        // A cached 4 MiB mapping is split for two smaller requests
+        auto *big = static_cast<uint8_t *>(alloc::allocate(4 * MIB));
+        alloc::deallocate(big);
+        const auto before = snapshot();
+        auto *first = static_cast<uint8_t *>(alloc::allocate(3 * MIB / 2));
+        auto *second = static_cast<uint8_t *>(alloc::allocate(3 * MIB / 2));
+        EXPECT_EQ(snapshot().large_hits - before.large_hits, 2u);
+        EXPECT_EQ(first, big);
+        EXPECT_GT(second, big);
+        EXPECT_LT(second, big + 4 * MIB);
+        alloc::deallocate(first);
+        alloc::deallocate(second);
+
+        // Five 15 MiB blocks exceed the 64 MiB cache, so the one freed first is unmapped and a
+        // new request gets the one freed last
+        std::vector<void *> blocks(5);
+        for (auto &block : blocks)
+            block = alloc::allocate(15 * MIB);
+        const size_t mapped = mapped_bytes();
+        for (auto *block : blocks)
+            alloc::deallocate(block);
+        EXPECT_GE(mapped - mapped_bytes(), 15 * MIB);
+        EXPECT_LT(mapped - mapped_bytes(), 2 * 15 * MIB);
+        void *reused = alloc::allocate(15 * MIB);
+        EXPECT_EQ(reused, blocks.back());
+        alloc::deallocate(reused);
+    });
+}
+
+TEST(Allocator, LargeCacheMergesOnlyPiecesOfOneMapping)
+{
+    if (DEBUG_HEAP)
+        GTEST_SKIP() << "debug mode does not hand freed blocks straight back";
+
+    if (alloc::numa_nodes() > 1)
+        GTEST_SKIP() << "cached blocks are only reused on the node that freed them";
+
+    on_new_thread([]
+    {
+        constexpr size_t MIB = 1024 * 1024;
+
+        // The pieces of a split mapping merge back into one entry
+        auto *big = static_cast<uint8_t *>(alloc::allocate(4 * MIB));
+        alloc::deallocate(big);
+        void *first = alloc::allocate(3 * MIB / 2);
+        void *second = alloc::allocate(3 * MIB / 2);
+        alloc::deallocate(first);
+        alloc::deallocate(second);
+        void *whole = alloc::allocate(4 * MIB);
+        EXPECT_EQ(whole, big);
+        alloc::deallocate(whole);
+
+        // Separate mappings never do, even when they happen to touch
+        void *left = alloc::allocate(5 * MIB);
+        void *right = alloc::allocate(5 * MIB);
+        alloc::deallocate(left);
+        alloc::deallocate(right);
+        const uint64_t misses = snapshot().large_misses;
+        void *joined = alloc::allocate(9 * MIB);
+        EXPECT_EQ(snapshot().large_misses - misses, 1u);
+        alloc::deallocate(joined);
+    });
+}
+
+TEST(Allocator, DebugReportsLargeDoubleFreeAcrossThreads)
+{
+    if (!DEBUG_HEAP)
+        GTEST_SKIP() << "only debug mode checks frees";
+
+    // The first free protects the block's pages; the second, from another thread, must find it
+    // in the quarantine instead of faulting on its header
+    GTEST_FLAG_SET(death_test_style, "threadsafe");
+    EXPECT_DEATH(
+        {
+            void *block = alloc::allocate(2 * 1024 * 1024);
+            on_new_thread([block] { alloc::deallocate(block); });
+            on_new_thread([block] { alloc::deallocate(block); });
+        },
+        "double free");
+}
+
+TEST(Allocator, CallocClearsRecycledBlocks)
+{
+    on_new_thread([]
+    {
+        for (const size_t size : { size_t{48}, size_t{900}, size_t{300 * 1024}, size_t{2 * 1024 * 1024} })
+        {
+            void *block = alloc::allocate(size);
+            std::memset(block, 0xAB, size);
+            alloc::deallocate(block);
+
+            // Comes back from the thread cache or the large cache, still holding the old bytes
+            void *zeroed = alloc::callocate(1, size);
+            if (!DEBUG_HEAP)
+                EXPECT_EQ(zeroed, block) << size;
+            EXPECT_TRUE(filled_with(zeroed, size, 0)) << size;
+            alloc::deallocate(zeroed);
+        }
+    });
+    EXPECT_EQ(alloc::callocate(SIZE_MAX / 2, 4), nullptr);
+}
@@ -0,0 +1,259 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <string>
+#include <gtest/gtest.h>
+#include "../include/layout.h"
+#include "source_test.h"
+
+using namespace yu::frontend;
+
+class LayoutTest : public SourceTest
+{
+protected:
+    /**
+     * @brief Parses and analyzes `code` into `model`, then lays it out.
+     */
+    bool lay_out(const std::string &code, semantic_model &model, module_layout &layout,
+                 const std::vector<const semantic_model *> &imports = {})
+    {
+        if (!check(code, model, imports))
+            return false;
+        for (const auto &error : model.errors)
+            ADD_FAILURE() << error;
+        return compute_layouts(model, layout);
+    }
+
+    static const class_layout_t *find(const semantic_model &model, const module_layout &layout,
+                                      const std::string &name)
+    {
+        for (const auto &class_layout : layout.classes)
+        {
+            if (model.type_name(class_layout.type) == name)
+                return &class_layout;
+        }
+        return nullptr;
+    }
+};
+
+TEST_F(LayoutTest, NaturalAlignmentAndCacheLines)
+{
+    semantic_model model;
+    module_layout layout;
+    ASSERT_TRUE(lay_out(R"(
+        class Particle
+        {
+            var alive: boolean;
+            var id: u64;
+            var mass: f32;
+            var name: string;
+            var kind: u16;
+            var target: Ptr<Particle>;
+            var flags: u8;
+            function update() { }
+            var velocity: f64;
+            var tag: i8;
+            var history: string;
+        }
+    )", model, layout));
+
+    const class_layout_t *particle = find(model, layout, "Particle");
+    ASSERT_NE(particle, nullptr);
+    ASSERT_TRUE(particle->incomplete.empty());
+    ASSERT_EQ(particle->fields.size(), 10u);
+
+    // alive@0, 7 padding, id@8, mass@16, 4 padding, name@24, kind@40, 6 padding, target@48,
+    // flags@56, 7 padding, velocity@64, tag@72, 7 padding, history@80, size 96
+    const uint32_t offsets[] = { 0, 8, 16, 24, 40, 48, 56, 64, 72, 80 };
+    for (size_t i = 0; i < particle->fields.size(); ++i)
+        EXPECT_EQ(particle->fields[i].offset, offsets[i]) << i;
+    EXPECT_EQ(particle->fields[2].size, 4u);
+    EXPECT_EQ(particle->fields[3].padding, 4u);
+    EXPECT_EQ(particle->size, 96u);
+    EXPECT_EQ(particle->align, 8u);
+    EXPECT_EQ(particle->padding, 31u);
+    EXPECT_EQ(particle->tail_padding, 0u);
+
+    const std::string report = format_layout(model, *particle);
+    EXPECT_NE(report.find("class Particle: 96 bytes, align 8, 31 bytes padding (32.3%), 2 cache lines"),
+              std::string::npos) << report;
+    EXPECT_NE(report.find("cache line 0: bytes 0-63, 40 of 64 used by fields"), std::string::npos) << report;
+    EXPECT_NE(report.find("cache line 1: bytes 64-95, 25 of 32 used by fields"), std::string::npos) << report;
+    EXPECT_EQ(report.find("splits cache lines"), std::string::npos) << report;
+}
+
+TEST_F(LayoutTest, PackedAndAlignedClasses)
+{
+    semantic_model model;
+    module_layout layout;
+    ASSERT_TRUE(lay_out(R"(
+        @packed
+        class Header
+        {
+            var tag: u8;
+            var length: u32;
+            @alignas(4) var crc: u16;
+        }
+        @aligned(64)
+        class Counter
+        {
+            var hits: u64;
+        }
+        class Slots
+        {
+            var head: Header;
+            var pad: u8;
+            @alignas(32) var hot: Counter;
+            var name: string;
+            var spill: u32;
+        }
+    )", model, layout));
+
+    // Header: tag@0, length@1, crc@8 after 3 bytes of padding, 10 bytes rounded to 12
+    const class_layout_t *header = find(model, layout, "Header");
+    ASSERT_NE(header, nullptr);
+    EXPECT_EQ(header->fields[1].offset, 1u);
+    EXPECT_EQ(header->fields[2].offset, 8u);
+    EXPECT_EQ(header->align, 4u);
+    EXPECT_EQ(header->size, 12u);
+    EXPECT_EQ(header->tail_padding, 2u);
+
+    const class_layout_t *counter = find(model, layout, "Counter");
+    ASSERT_NE(counter, nullptr);
+    EXPECT_EQ(counter->size, 64u);
+    EXPECT_EQ(counter->align, 64u);
+    EXPECT_EQ(counter->padding, 56u);
+
+    // The class alignment of Counter wins over the smaller @alignas on the field
+    const class_layout_t *slots = find(model, layout, "Slots");
+    ASSERT_NE(slots, nullptr);
+    EXPECT_EQ(slots->fields[1].offset, 12u);
+    EXPECT_EQ(slots->fields[2].offset, 64u);
+    EXPECT_EQ(slots->fields[2].padding, 51u);
+    EXPECT_EQ(slots->fields[3].offset, 128u);
+    EXPECT_EQ(slots->size, 192u);
+    EXPECT_EQ(slots->align, 64u);
+
+    semantic_model split_model;
+    module_layout split_layout;
+    ASSERT_TRUE(lay_out(R"(
+        @packed
+        class Wire
+        {
+            var a: u8;
+            var b: string;
+            var c: u64;
+            var d: string;
+            var e: string;
+            var f: u64;
+        }
+    )", split_model, split_layout));
+    const std::string report = format_layout(split_model, split_layout.classes[0]);
+    EXPECT_NE(report.find("'f' splits cache lines 0-1"), std::string::npos) << report;
+    EXPECT_NE(report.find("class Wire: 65 bytes, align 1, 0 bytes padding (0.0%), 2 cache lines"),
+              std::string::npos) << report;
+}
+
+TEST_F(LayoutTest, SplitsSoaClassesIntoColumns)
+{
+    semantic_model model;
+    module_layout layout;
+    ASSERT_TRUE(lay_out(R"(
+        class Vector3 { var x: f32; var y: f32; var z: f32; }
+        @soa
+        class Particle
+        {
+            var position: Vector3;
+            var mass: f32;
+            var alive: boolean;
+            var name: string;
+        }
+    )", model, layout));
+
+    EXPECT_TRUE(find(model, layout, "Vector3")->columns.empty());
+    const class_layout_t *particle = find(model, layout, "Particle");
+    ASSERT_NE(particle, nullptr);
+    EXPECT_EQ(particle->size, 40u);
+
+    // Fields of class type are flattened, each column remembering where it sat in the element
+    ASSERT_EQ(particle->columns.size(), 6u);
+    EXPECT_EQ(particle->columns[1].path, "position.y");
+    EXPECT_EQ(particle->columns[1].offset, 4u);
+    EXPECT_EQ(particle->columns[1].type, types::F32);
+    EXPECT_EQ(particle->columns[4].path, "alive");
+    EXPECT_EQ(particle->columns[4].size, 1u);
+    EXPECT_EQ(particle->columns[5].offset, 24u);
+
+    // 1024 masses 40 bytes apart touch every line of the array; as a column they fill 64
+    const std::string report = format_layout(model, *particle);
+    EXPECT_NE(report.find("@soa: 6 columns"), std::string::npos) << report;
+    EXPECT_NE(report.find("    mass                         4   640    64\n"), std::string::npos) << report;
+    EXPECT_NE(report.find("    alive                        1   640    16\n"), std::string::npos) << report;
+}
+
+TEST_F(LayoutTest, ReportsMissingLayoutsAndAnnotationErrors)
+{
+    semantic_model base;
+    module_layout base_layout;
+    ASSERT_TRUE(lay_out("class Point { var x: f32; var y: f32; }\nclass Box<T> { var item: T; }", base, base_layout));
+    ASSERT_EQ(base_layout.classes.size(), 2u);
+    EXPECT_EQ(base_layout.classes[1].incomplete, "generic class");
+
+    semantic_model model;
+    module_layout layout;
+    EXPECT_FALSE(lay_out(R"(
+        import { Point, Box } from "base";
+        class Shape { var origin: Point; var box: Box<i32>; }
+        class Path { var start: Point; var ring: Ring; }
+        class Ring { var path: Path; }
+        class Line { var a: Point; var b: Point; }
+    )", model, layout, { &base }));
+
+    // Imported classes are laid out where they are used, but only reported by their module
+    ASSERT_EQ(layout.classes.size(), 4u);
+    EXPECT_EQ(find(model, layout, "Shape")->incomplete, "field 'box': 'Box' has no layout");
+    EXPECT_EQ(find(model, layout, "Path")->incomplete, "field 'ring': 'Ring' has no layout");
+    EXPECT_EQ(find(model, layout, "Ring")->incomplete, "contains itself by value");
+    EXPECT_EQ(find(model, layout, "Line")->size, 16u);
+    ASSERT_EQ(layout.errors.size(), 1u);
+    EXPECT_EQ(layout.errors[0], "Ring: field 'path' of type 'Path' contains 'Ring' by value");
+
+    // Misplaced and malformed annotations are checker errors
+    semantic_model broken;
+    const std::string code = R"(
+        @alignas(3)
+        class A
+        {
+            @packed var a: i32;
+            @alignas(8192) var b: i32;
+            @aligned var c: i32;
+            @alignas(16) function f() { }
+            @soa var d: i32;
+            @inline var e: i32;
+            @deprecated @nodiscard function g() -> i32 { return 1; }
+        }
+        @packed(1)
+        class B { }
+    )";
+    sources.push_back(std::make_unique<std::string>(code));
+    lexers.push_back(std::make_unique<Lexer>(create_lexer(*sources.back())));
+    const auto *tokens = tokenize(*lexers.back());
+    uint32_t body_pos;
+    ir_node *module = parse_imports(sources.back()->c_str(), tokens, body_pos);
+    ASSERT_TRUE(parse_module_body(sources.back()->c_str(), tokens, body_pos, module));
+    trees.push_back(module);
+    EXPECT_FALSE(analyze(module, broken));
+
+    // Classes are declared before their members, so B comes second
+    const std::vector<std::string> expected = {
+        "A: @alignas needs one power-of-two argument up to 4096",
+        "B: @packed takes no arguments",
+        "A: @packed applies only to classes",
+        "A: @alignas needs one power-of-two argument up to 4096",
+        "A: @aligned needs one power-of-two argument up to 4096",
+        "A: @alignas applies only to classes and fields",
+        "A: @soa applies only to classes",
+        "A: unknown annotation '@inline'",
+    };
+    EXPECT_EQ(broken.errors, expected);
+}
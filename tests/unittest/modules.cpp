@@ -0,0 +1,187 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <gtest/gtest.h>
+#include "../include/lexer.h"
+#include "../include/modules.h"
+
+using namespace yu;
+using namespace yu::frontend;
+
+class ModuleTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        directory = testing::TempDir() + "yu-module-test";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory + "/lib");
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    void write(const std::string &name, const std::string &source) const
+    {
+        std::ofstream(directory + "/" + name) << source;
+    }
+
+    [[nodiscard]] const module_t *find(const module_graph &graph, const std::string &name) const
+    {
+        const auto path = std::filesystem::weakly_canonical(directory + "/" + name).string();
+        for (const auto &module : graph.modules)
+        {
+            if (module->path == path)
+                return module.get();
+        }
+        return nullptr;
+    }
+
+    std::string directory;
+};
+
+TEST(ModuleParserTest, ImportsThenClasses)
+{
+    const std::string code = R"(
+        import { Vector3, dot } from "math/vector";
+        import { io } from "system";
+
+        class Main
+        {
+            var a: i32 = 1;
+        };
+        class Other
+        {
+        }
+    )";
+    auto lexer = create_lexer(code);
+    const auto *tokens = tokenize(lexer);
+
+    uint32_t body_pos;
+    ir_node *module = parse_imports(code.c_str(), tokens, body_pos);
+    ASSERT_NE(module, nullptr);
+    EXPECT_EQ(module->type, ir_t::NODE_MODULE);
+    ASSERT_EQ(module->children.size(), 2u);
+    EXPECT_EQ(tokens->types[body_pos], lang::token_i::CLASS);
+
+    const ir_node *first = module->children[0];
+    EXPECT_EQ(first->type, ir_t::NODE_IMPORT);
+    EXPECT_EQ(std::string_view(first->value.str_val.text, first->value.str_val.length), "math/vector");
+    ASSERT_EQ(first->children.size(), 2u);
+    EXPECT_EQ(std::string_view(first->children[1]->value.str_val.text, first->children[1]->value.str_val.length),
+              "dot");
+
+    ASSERT_TRUE(parse_module_body(code.c_str(), tokens, body_pos, module));
+    ASSERT_EQ(module->children.size(), 4u);
+    EXPECT_EQ(module->children[2]->type, ir_t::NODE_CLASS);
+    EXPECT_EQ(module->children[3]->type, ir_t::NODE_CLASS);
+    destroy_node(module);
+
+    const std::string broken = "import { a } \"missing-from\";\nclass A {}";
+    auto broken_lexer = create_lexer(broken);
+    EXPECT_EQ(parse_imports(broken.c_str(), tokenize(broken_lexer), body_pos), nullptr);
+}
+
+TEST_F(ModuleTest, LoadsEachModuleOnceInDependencyOrder)
+{
+    // main -> a -> c, main -> b -> c, b -> lib/util -> c
+    write("main.yu", "import { A } from \"a\";\nimport { B } from \"./b.yu\";\nclass Main {}\n");
+    write("a.yu", "import { C } from \"c\";\nclass A {}\n");
+    write("b.yu", "import { C } from \"c\";\nimport { Util } from \"util\";\nclass B {}\n");
+    write("c.yu", "class C {}\n");
+    write("lib/util.yu", "import { C } from \"../c\";\nclass Util {}\n");
+
+    std::mutex mutex;
+    std::map<std::string, int> loads;
+    module_options options;
+    options.search_paths = { directory + "/lib" };
+    options.load = [&](module_t &module)
+    {
+        {
+            std::lock_guard lock(mutex);
+            ++loads[module.path];
+        }
+        std::ifstream file(module.path);
+        module.source.assign(std::istreambuf_iterator<char>(file), {});
+        module.lexer = create_lexer(module.source);
+        tokenize(module.lexer);
+        return true;
+    };
+
+    work_pool pool(4);
+    module_graph graph;
+    ASSERT_TRUE(load_modules({ directory + "/main.yu", directory + "/c.yu" }, options, pool, graph));
+    ASSERT_EQ(graph.modules.size(), 5u);
+    ASSERT_EQ(loads.size(), 5u);
+    for (const auto &[path, count] : loads)
+        EXPECT_EQ(count, 1) << path;
+
+    ASSERT_EQ(graph.roots.size(), 2u);
+    EXPECT_EQ(graph.modules[graph.roots[0]].get(), find(graph, "main.yu"));
+    EXPECT_EQ(find(graph, "c.yu")->importers.size(), 3u);
+    EXPECT_EQ(find(graph, "b.yu")->imports.size(), 2u);
+
+    std::vector<size_t> position(graph.modules.size());
+    ASSERT_EQ(graph.order.size(), graph.modules.size());
+    for (size_t i = 0; i < graph.order.size(); ++i)
+        position[graph.order[i]] = i;
+    for (uint32_t id = 0; id < graph.modules.size(); ++id)
+    {
+        for (const uint32_t import : graph.modules[id]->imports)
+            EXPECT_LT(position[import], position[id]);
+    }
+
+    // Every task must see all of its imports finished
+    std::vector<std::atomic<bool>> finished(graph.modules.size());
+    std::atomic<int> runs{0};
+    schedule_topological(graph, pool, [&](module_t &module)
+    {
+        for (const uint32_t import : module.imports)
+            EXPECT_TRUE(finished[import].load());
+        EXPECT_TRUE(parse_module_body(module.source.c_str(), &module.lexer.tokens, module.body_pos, module.tree));
+        for (uint32_t id = 0; id < graph.modules.size(); ++id)
+        {
+            if (graph.modules[id].get() == &module)
+                finished[id].store(true);
+        }
+        runs.fetch_add(1);
+    });
+    EXPECT_EQ(runs.load(), 5);
+    EXPECT_EQ(find(graph, "b.yu")->tree->children.size(), 3u);
+}
+
+TEST_F(ModuleTest, ReportsCyclesAndMissingModules)
+{
+    write("x.yu", "import { Y } from \"y\";\nclass X {}\n");
+    write("y.yu", "import { X } from \"x\";\nclass Y {}\n");
+    write("z.yu", "import { X } from \"x\";\nclass Z {}\n");
+    write("w.yu", "class W {}\nimport { Q } from \"q\";\n");
+    write("v.yu", "\nimport { Q } from \"nowhere\";\nclass V {}\n");
+
+    work_pool pool(2);
+    module_graph graph;
+    EXPECT_FALSE(load_modules({ directory + "/z.yu", directory + "/v.yu", directory + "/w.yu" }, {}, pool, graph));
+    ASSERT_EQ(graph.modules.size(), 5u);
+
+    EXPECT_NE(find(graph, "x.yu")->error.find("import cycle"), std::string::npos);
+    EXPECT_EQ(find(graph, "x.yu")->error, find(graph, "y.yu")->error);
+    EXPECT_EQ(find(graph, "z.yu")->error, "imports a module on an import cycle");
+    EXPECT_EQ(find(graph, "v.yu")->error, "cannot find module 'nowhere'");
+    EXPECT_EQ(find(graph, "v.yu")->line, 2u);
+
+    // Imports after the first class are not part of the import list
+    EXPECT_TRUE(find(graph, "w.yu")->error.empty());
+    EXPECT_EQ(graph.order.size(), 2u);
+
+    std::atomic<int> runs{0};
+    schedule_topological(graph, pool, [&](module_t &) { runs.fetch_add(1); });
+    EXPECT_EQ(runs.load(), 2);
+}
@@ -0,0 +1,182 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <string>
+#include <gtest/gtest.h>
+#include "../../middle/include/optimize.h"
+#include "source_test.h"
+
+using namespace yu::frontend;
+using namespace yu::middle;
+
+class OptimizeTest : public IrSourceTest
+{
+protected:
+    /**
+     * @brief Parses, checks, lowers and optimizes `code`; every function must verify before
+     * and after.
+     */
+    void optimize(const std::string &code, semantic_model &model, module_ir &ir, optimize_stats_t &stats)
+    {
+        ir_node *module = check(code, model);
+        ASSERT_NE(module, nullptr);
+        ASSERT_TRUE(model.errors.empty()) << model.errors[0];
+        lower_module(module, model, ir);
+        for (auto &function : ir.functions)
+        {
+            ASSERT_TRUE(verify(ir, function).empty()) << dump(ir, function);
+            optimize_function(ir, function, stats);
+            for (const auto &error : verify(ir, function))
+                ADD_FAILURE() << function_name(ir, function) << ": " << error << "\n" << dump(ir, function);
+        }
+    }
+};
+
+TEST_F(OptimizeTest, FoldsConstantsAndRemovesDeadValues)
+{
+    semantic_model model;
+    module_ir ir;
+    optimize_stats_t stats;
+    optimize(R"(
+        class Math
+        {
+            var scale: i32;
+            function calc(a: i32) -> i32
+            {
+                var unused = a * 3 + scale;
+                return 1 + 2 * 3 - a * 0;
+            }
+            function narrow() -> i8 { var x: i8 = 100; return x + x; }
+            function underflow() -> u8 { var x: u8 = 0; return x - 1; }
+            function divide(a: i32) -> i32 { var zero = 0; var dead = 6 / a; return a / zero + 7 / 2; }
+            function overflow() -> i32
+            {
+                var low = 0 - 2147483647 - 1;
+                var dead = low % (0 - 1);
+                return low / (0 - 1) + (0 - 9) / (0 - 1) + (0 - 9) % (0 - 1);
+            }
+        }
+    )", model, ir, stats);
+    ASSERT_EQ(ir.functions.size(), 5u);
+
+    // The unused load goes too: loading a field has no effect
+    const std::string expected = R"(function Math.calc(Math, i32) -> i32
+b0:
+  %0 = param 0 : Math
+  %1 = param 1 : i32
+  %2 = const 7 : i32
+  return %2
+)";
+    EXPECT_EQ(dump(ir, find(ir, "Math.calc")), expected);
+
+    // Integers wrap to their width
+    EXPECT_NE(dump(ir, find(ir, "Math.narrow")).find("const -56 : i8"), std::string::npos);
+    EXPECT_NE(dump(ir, find(ir, "Math.underflow")).find("const 255 : u8"), std::string::npos);
+
+    // Dividing by zero is left to run time, and so is dividing by a parameter
+    const function_t &divide = find(ir, "Math.divide");
+    EXPECT_EQ(count(divide, op_i::DIV), 2u);
+    EXPECT_NE(dump(ir, divide).find("const 3 : i32"), std::string::npos);
+
+    // The lowest i32 divided by -1 traps too; other values divided by -1 fold
+    const function_t &overflow = find(ir, "Math.overflow");
+    EXPECT_EQ(count(overflow, op_i::DIV), 1u);
+    EXPECT_EQ(count(overflow, op_i::REM), 1u);
+    EXPECT_NE(dump(ir, overflow).find("const 9 : i32"), std::string::npos) << dump(ir, overflow);
+
+    EXPECT_EQ(stats.functions, 5u);
+    EXPECT_EQ(stats.branches, 0u);
+}
+
+TEST_F(OptimizeTest, DecidesBranchesAndMergesBlocks)
+{
+    semantic_model model;
+    module_ir ir;
+    optimize_stats_t stats;
+    optimize(R"(
+        class Flow
+        {
+            function pick(flag: boolean) -> i32
+            {
+                var x = 1;
+                if (x < 2) { x = 10; } else { x = 20; }
+                if (flag) { x = x + 1; }
+                return x;
+            }
+            function find(key: string) -> boolean
+            {
+                while (true) { if (key == "x") { return true; } }
+            }
+            function steady(n: i32) -> i32
+            {
+                var k = 5;
+                for (var i: i32 = 0; i < n; i = i + 1) { k = k * 1 + 0; }
+                return k;
+            }
+        }
+    )", model, ir, stats);
+
+    // Only the branch on `flag` is left; x is 10 before it and 11 on one side
+    const function_t &pick = find(ir, "Flow.pick");
+    EXPECT_EQ(pick.blocks.size(), 3u);
+    EXPECT_EQ(count(pick, op_i::BRANCH), 1u);
+    EXPECT_EQ(count(pick, op_i::ADD), 0u);
+    const std::string text = dump(ir, pick);
+    EXPECT_NE(text.find("phi [%"), std::string::npos) << text;
+    EXPECT_NE(text.find("const 11 : i32"), std::string::npos) << text;
+
+    // `while (true)` never exits, so the undefined value returned after it is gone
+    const function_t &found = find(ir, "Flow.find");
+    EXPECT_EQ(count(found, op_i::RETURN), 1u);
+    EXPECT_EQ(count(found, op_i::UNDEF), 0u);
+
+    // k is 5 on entry and on every trip around the loop
+    const function_t &steady = find(ir, "Flow.steady");
+    EXPECT_EQ(count(steady, op_i::PHI), 1u);
+    EXPECT_EQ(count(steady, op_i::MUL), 0u);
+    EXPECT_NE(dump(ir, steady).find("const 5 : i32"), std::string::npos);
+
+    EXPECT_EQ(stats.branches, 2u);
+    EXPECT_GT(stats.removed_blocks, 0u);
+}
+
+TEST_F(OptimizeTest, SimplifiesAlgebraWithoutChangingFloats)
+{
+    semantic_model model;
+    module_ir ir;
+    optimize_stats_t stats;
+    optimize(R"(
+        class Algebra
+        {
+            function same(a: i32, b: boolean) -> boolean
+            {
+                var x = (a + 0) * 1;
+                return (x - x == 0) & (b & true) | false;
+            }
+            function twice(a: i64, b: boolean) -> boolean { var n = -(-a); return !!b == (n > 0); }
+            function exact(f: f64) -> f64 { return (f - 0.0) * 1.0 / 1.0; }
+            function zero_sign(f: f64) -> f64 { return f + 0.0; }
+            function nan(f: f64) -> boolean { return f == f; }
+        }
+    )", model, ir, stats);
+
+    const std::string expected = R"(function Algebra.same(Algebra, i32, boolean) -> boolean
+b0:
+  %0 = param 0 : Algebra
+  %1 = param 1 : i32
+  %2 = param 2 : boolean
+  return %2
+)";
+    EXPECT_EQ(dump(ir, find(ir, "Algebra.same")), expected);
+
+    const function_t &twice = find(ir, "Algebra.twice");
+    EXPECT_EQ(count(twice, op_i::NEG), 0u);
+    EXPECT_EQ(count(twice, op_i::NOT), 0u);
+    EXPECT_NE(dump(ir, twice).find("eq %2, %"), std::string::npos);
+
+    EXPECT_NE(dump(ir, find(ir, "Algebra.exact")).find("return %1"), std::string::npos);
+
+    // -0.0 + 0.0 is 0.0, and NaN is not equal to itself
+    EXPECT_EQ(count(find(ir, "Algebra.zero_sign"), op_i::ADD), 1u);
+    EXPECT_EQ(count(find(ir, "Algebra.nan"), op_i::EQ), 1u);
+}
@@ -88,3 +88,48 @@ TEST_F(ParserTest, MethodCalls)
     )";
     EXPECT_NE(try_parse(code.data()), nullptr);
 }
+
+TEST_F(ParserTest, ReportsWhereModuleBodyFails)
+{
+    // The recovered error inside the method, and the `}` where a field's `;` was expected
+    const std::pair<const char *, uint32_t> cases[] = {
+        { "class A\n{\n    function f() -> i32\n    {\n        return 1 +;\n    }\n}\n", 5 },
+        { "class B\n{\n    var b: i32 = 1\n}\n", 4 },
+    };
+    for (const auto &[code, line] : cases)
+    {
+        auto lexer = yu::frontend::create_lexer(code);
+        const auto *tokens = tokenize(lexer);
+        uint32_t body_pos;
+        yu::frontend::ir_node *module = yu::frontend::parse_imports(code, tokens, body_pos);
+        ASSERT_NE(module, nullptr);
+
+        uint32_t error_pos = 0;
+        EXPECT_FALSE(yu::frontend::parse_module_body(code, tokens, body_pos, module, &error_pos));
+        ASSERT_LT(error_pos, tokens->size());
+        const yu::lang::token_t at{ tokens->starts[error_pos], tokens->lengths[error_pos], tokens->types[error_pos],
+                                    tokens->flags[error_pos] };
+        EXPECT_EQ(yu::frontend::get_line_col(lexer, at).first, line) << code;
+        yu::frontend::destroy_node(module);
+    }
+}
+
+// token_compare must agree with a plain scan for every list length, including partial vector
+// tails; TRUE has the value 0, which zero-padded tail lanes used to match
+TEST(TokenCompare, MatchesScalarScan)
+{
+    using yu::lang::token_i;
+    std::vector<token_i> types;
+    for (size_t count = 0; count <= 70; ++count)
+    {
+        for (const token_i current : { token_i::TRUE, token_i::IDENTIFIER })
+        {
+            bool expected = false;
+            for (const token_i type : types)
+                expected |= type == current;
+            EXPECT_EQ(yu::frontend::token_compare(current, types.data(), types.size()), expected)
+                << "count " << count;
+        }
+        types.push_back(count == 50 ? token_i::IDENTIFIER : token_i::FALSE);
+    }
+}
@@ -0,0 +1,94 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <cstdint>
+#include <new>
+#include <vector>
+#include <gtest/gtest.h>
+#include "../../common/region.hpp"
+
+using yumina::region;
+using yumina::region_allocator;
+
+TEST(Region, BumpsAlignedBlocks)
+{
+    region arena;
+    auto *a = static_cast<uint8_t *>(arena.allocate(3, 1));
+    auto *b = static_cast<uint8_t *>(arena.allocate(8, 64));
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 64, 0u);
+    EXPECT_GE(b, a + 3);
+    EXPECT_EQ(arena.bytes_reserved(), region::MIN_CHUNK);
+
+    // Larger than a chunk: gets one of its own
+    auto *big = static_cast<uint8_t *>(arena.allocate(region::MAX_CHUNK));
+    ASSERT_NE(big, nullptr);
+    big[region::MAX_CHUNK - 1] = 1;
+    EXPECT_GT(arena.bytes_reserved(), region::MIN_CHUNK + region::MAX_CHUNK);
+}
+
+TEST(Region, RejectsSizesThatWrap)
+{
+    region arena;
+    auto *first = static_cast<uint8_t *>(arena.allocate(16));
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(arena.allocate(SIZE_MAX - 100), nullptr);
+    EXPECT_EQ(arena.allocate(SIZE_MAX), nullptr);
+
+    // The failed requests left the cursor alone
+    auto *next = static_cast<uint8_t *>(arena.allocate(16));
+    EXPECT_GE(next, first + 16);
+}
+
+TEST(Region, RewindsToMark)
+{
+    region arena;
+    arena.allocate(100);
+    const auto m = arena.mark();
+    const size_t reserved = arena.bytes_reserved();
+
+    auto *inside = arena.allocate(100);
+    for (int i = 0; i < 8; ++i)
+        arena.allocate(region::MIN_CHUNK);
+    EXPECT_GT(arena.bytes_reserved(), reserved);
+
+    // Chunks opened after the mark are gone and the next block lands where `inside` did
+    arena.rewind(m);
+    EXPECT_EQ(arena.bytes_reserved(), reserved);
+    EXPECT_EQ(arena.allocate(100), inside);
+}
+
+TEST(Region, ResetKeepsNewestChunk)
+{
+    region arena;
+    for (int i = 0; i < 4; ++i)
+        arena.allocate(region::MIN_CHUNK);
+    const size_t reserved = arena.bytes_reserved();
+
+    arena.reset();
+    EXPECT_LT(arena.bytes_reserved(), reserved);
+    EXPECT_GE(arena.bytes_reserved(), region::MIN_CHUNK);
+    const size_t kept = arena.bytes_reserved();
+
+    // Fits in the kept chunk, so nothing new is reserved
+    arena.allocate(1024);
+    EXPECT_EQ(arena.bytes_reserved(), kept);
+
+    region empty;
+    empty.reset();
+    EXPECT_EQ(empty.bytes_reserved(), 0u);
+}
+
+TEST(Region, BacksStandardContainers)
+{
+    region arena;
+    std::vector<int, region_allocator<int>> values{region_allocator<int>(arena)};
+    for (int i = 0; i < 10000; ++i)
+        values.push_back(i);
+    EXPECT_EQ(values[9999], 9999);
+
+    region_allocator<uint64_t> words(arena);
+    EXPECT_THROW(words.allocate(SIZE_MAX / 4), std::bad_alloc);
+    EXPECT_TRUE(words == region_allocator<int>(arena));
+}
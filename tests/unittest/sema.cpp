@@ -0,0 +1,223 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <string>
+#include <gtest/gtest.h>
+#include "source_test.h"
+
+using namespace yu::frontend;
+
+class SemaTest : public SourceTest
+{
+protected:
+    static bool has_error(const semantic_model &model, const std::string &message)
+    {
+        return std::find(model.errors.begin(), model.errors.end(), message) != model.errors.end();
+    }
+};
+
+TEST(SemaTableTest, InternerAndFlatMap)
+{
+    interner names;
+    EXPECT_EQ(names.find("a"), interner::NONE);
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < 1000; ++i)
+        ids.push_back(names.intern("name" + std::to_string(i)));
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(ids[i], static_cast<uint32_t>(i));
+        EXPECT_EQ(names.intern("name" + std::to_string(i)), ids[i]);
+        EXPECT_EQ(names.view(ids[i]), "name" + std::to_string(i));
+    }
+    EXPECT_EQ(names.size(), 1000u);
+    EXPECT_EQ(names.find("name1000"), interner::NONE);
+
+    flat_map map;
+    EXPECT_EQ(map.find(7), flat_map::NONE);
+    for (uint64_t key = 0; key < 500; ++key)
+        map.set(key << 32 | key, static_cast<uint32_t>(key * 3));
+    map.set(5ull << 32 | 5, flat_map::NONE);
+    for (uint64_t key = 0; key < 500; ++key)
+        EXPECT_EQ(map.find(key << 32 | key), key == 5 ? flat_map::NONE : key * 3);
+    EXPECT_EQ(map.find(1), flat_map::NONE);
+}
+
+TEST_F(SemaTest, ResolvesNamesAndTypes)
+{
+    semantic_model model;
+    const ir_node *module = check(R"(
+        class Vector<T>
+        {
+            public var x: T;
+            var count: i32 = 0;
+            var next: Node;
+            public function scale(factor: f64, times: i32) -> f64
+            {
+                var total = factor * 2;
+                var i: i32 = 0;
+                while (i < times) { total = total + factor; i = i + 1; }
+                for (var j: u8 = 0; j < 10; j = j + 1) { var total: boolean = true; }
+                if (count == 0 & !(total > 1.5)) { return total; }
+                return -total;
+            }
+            function name() -> string { return "vector" + "3"; }
+        }
+        class Node
+        {
+            var value: Vector<i64>;
+        }
+    )", model);
+    for (const auto &error : model.errors)
+        ADD_FAILURE() << error;
+
+    const uint32_t vector = model.find_class("Vector");
+    ASSERT_NE(vector, interner::NONE);
+    EXPECT_EQ(model.types[vector].kind, type_kind_i::CLASS);
+    EXPECT_EQ(model.types[vector].generic_count, 1u);
+    EXPECT_EQ(model.types[vector].member_count, 5u);
+    EXPECT_EQ(model.types[vector + 1].kind, type_kind_i::GENERIC);
+
+    const member_t *x = model.find_member(vector, "x");
+    ASSERT_NE(x, nullptr);
+    EXPECT_EQ(x->type, vector + 1);
+    EXPECT_EQ(model.find_member(vector, "next")->type, model.find_class("Node"));
+
+    const member_t *scale = model.find_member(vector, "scale");
+    ASSERT_NE(scale, nullptr);
+    EXPECT_TRUE(scale->is_method);
+    EXPECT_EQ(scale->type, types::F64);
+    ASSERT_EQ(scale->param_count, 2u);
+    EXPECT_EQ(model.params[scale->first_param + 1], types::I32);
+    EXPECT_EQ(model.find_member(vector, "missing"), nullptr);
+
+    // `var total = factor * 2;` takes the type of the product
+    const ir_node *body = module->children[0]->children.back()->children[3]->children.back();
+    const ir_node *total = body->children[0];
+    EXPECT_EQ(total->resolved_type, types::F64);
+    EXPECT_EQ(total->children[1]->resolved_type, types::F64);
+    EXPECT_EQ(total->children[1]->children[1]->resolved_type, types::INT_LITERAL);
+}
+
+TEST_F(SemaTest, ReportsErrorsWithoutCascading)
+{
+    semantic_model model;
+    check(R"(
+        class A
+        {
+            var a: i32 = "text";
+            var a: i32;
+            var b: Missing;
+            var c: A<i32>;
+            function f(p: i32) -> i32
+            {
+                var p: i32 = 1;
+                var s: string = p;
+                var u = unknown + 1 + 2;
+                var n;
+                if (p) { }
+                s = s - s;
+                b = 1;
+                return;
+            }
+            function g() { return 1; }
+        }
+        class A { }
+    )", model);
+
+    EXPECT_TRUE(has_error(model, "duplicate class 'A'"));
+    EXPECT_TRUE(has_error(model, "A.a: cannot initialize a field of type 'i32' with 'string'"));
+    EXPECT_TRUE(has_error(model, "A: duplicate member 'a'"));
+    EXPECT_TRUE(has_error(model, "A: unknown type 'Missing'"));
+    EXPECT_TRUE(has_error(model, "A: 'A' takes 0 type arguments, got 1"));
+    EXPECT_TRUE(has_error(model, "A.f: 'p' is already declared in this scope"));
+    EXPECT_TRUE(has_error(model, "A.f: cannot initialize 's' of type 'string' with 'i32'"));
+    EXPECT_TRUE(has_error(model, "A.f: unknown identifier 'unknown'"));
+    EXPECT_TRUE(has_error(model, "A.f: variable 'n' needs a type or an initializer"));
+    EXPECT_TRUE(has_error(model, "A.f: condition must be 'boolean', not 'i32'"));
+    EXPECT_TRUE(has_error(model, "A.f: operator '-' cannot take 'string' and 'string'"));
+    EXPECT_TRUE(has_error(model, "A.f: missing return value of type 'i32'"));
+    EXPECT_TRUE(has_error(model, "A.g: method without a return type returns a value"));
+
+    // `b` has the error type, so assigning to it and using `u` report nothing more
+    EXPECT_EQ(model.errors.size(), 13u);
+}
+
+TEST_F(SemaTest, ChecksAgainstImportedModels)
+{
+    semantic_model base;
+    check(R"(
+        class Point { var x: f32; var y: f32; }
+        class Line<T> { var head: Point; var tail: Point; var tag: T; }
+    )", base);
+    ASSERT_TRUE(base.errors.empty());
+
+    semantic_model shapes;
+    check(R"(
+        import { Point, Line } from "base";
+        class Shape
+        {
+            var line: Line<string>;
+            var origin: Point;
+            function area(p: Point) -> f32 { var o: Point = origin; return 1.5; }
+        }
+    )", shapes, { &base });
+    for (const auto &error : shapes.errors)
+        ADD_FAILURE() << error;
+
+    // Imported classes keep their identity through copies, and their members come along
+    const uint32_t point = shapes.find_class("Point");
+    ASSERT_NE(point, interner::NONE);
+    EXPECT_EQ(shapes.types[point].origin, &base);
+    EXPECT_EQ(shapes.find_member(shapes.find_class("Line"), "head")->type, point);
+    EXPECT_EQ(shapes.find_member(point, "y")->type, types::F32);
+
+    semantic_model broken;
+    check(R"(
+        import { Point, Circle } from "base";
+        import { Shape } from "shapes";
+        class Point { }
+        class User { var s: Shape; var p: Point; }
+    )", broken, { &base, nullptr });
+    EXPECT_TRUE(has_error(broken, "import from 'base': module has no class 'Circle'"));
+    EXPECT_TRUE(has_error(broken, "duplicate class 'Point'"));
+    EXPECT_EQ(broken.errors.size(), 2u);
+}
+
+TEST_F(SemaTest, ChecksMemberAccessAndCalls)
+{
+    semantic_model model;
+    check(R"(
+        class Box<T>
+        {
+            var item: T;
+            var size: i32;
+            function get() -> T { return self.item; }
+            function grow(by: i32, note: string) -> i32 { size = size + by; return self.size; }
+        }
+        class User
+        {
+            var box: Box<string>;
+            function run() -> i32
+            {
+                var t = box.get();
+                box.size = 3;
+                helper();
+                box.grow(1, "x");
+                box.grow("x", 1);
+                box.grow(1);
+                box.missing;
+                box.size();
+                return box.grow(2, "y") + box.size;
+            }
+            function helper() { }
+        }
+    )", model);
+
+    EXPECT_TRUE(has_error(model, "User.run: argument 1 of 'grow': cannot pass 'string' as 'i32'"));
+    EXPECT_TRUE(has_error(model, "User.run: argument 2 of 'grow': cannot pass 'integer literal' as 'string'"));
+    EXPECT_TRUE(has_error(model, "User.run: 'grow' takes 2 arguments, got 1"));
+    EXPECT_TRUE(has_error(model, "User.run: 'Box' has no member 'missing'"));
+    EXPECT_TRUE(has_error(model, "User.run: 'size' is a field, not a method"));
+    EXPECT_EQ(model.errors.size(), 5u);
+}
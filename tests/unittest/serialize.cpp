@@ -0,0 +1,207 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <gtest/gtest.h>
+#include "../include/lexer.h"
+#include "../include/parser.h"
+#include "../include/serialize.h"
+
+using namespace yu;
+using namespace yu::frontend;
+
+namespace
+{
+    ir_node *make_node(const ir_t type)
+    {
+        auto *node = new ir_node();
+        node->type = type;
+        return node;
+    }
+
+    ir_node *make_identifier(const std::string &text)
+    {
+        auto *node = make_node(ir_t::NODE_IDENTIFIER);
+        node->value_kind = value_i::STRING;
+        node->value.str_val.text = new char[text.size()];
+        node->value.str_val.length = text.size();
+        std::memcpy(node->value.str_val.text, text.data(), text.size());
+        return node;
+    }
+
+    // class Point { x = 1.5 + true; <null>; "" }
+    ir_node *sample_tree()
+    {
+        auto *root = make_node(ir_t::NODE_CLASS);
+        root->children.push_back(make_identifier("Point"));
+
+        auto *op = make_node(ir_t::NODE_BINARY_OP);
+        op->value_kind = value_i::OP;
+        op->value.op_val = static_cast<uint8_t>(lang::token_i::PLUS);
+        auto *number = make_node(ir_t::NODE_LITERAL);
+        number->value_kind = value_i::NUMBER;
+        number->value.num_val = 1.5;
+        auto *flag = make_node(ir_t::NODE_LITERAL);
+        flag->value_kind = value_i::BOOL;
+        flag->value.bool_val = true;
+        op->children = { number, flag };
+
+        auto *field = make_node(ir_t::NODE_FIELD);
+        field->children = { make_identifier("x"), op };
+        root->children.push_back(field);
+        root->children.push_back(nullptr);
+        root->children.push_back(make_identifier(""));
+        return root;
+    }
+
+    void expect_same_tree(const ir_node *expected, const ir_node *actual) // NOLINT(*-no-recursion)
+    {
+        ASSERT_EQ(expected == nullptr, actual == nullptr);
+        if (!expected)
+            return;
+        EXPECT_EQ(expected->type, actual->type);
+        ASSERT_EQ(expected->value_kind, actual->value_kind);
+        switch (expected->value_kind)
+        {
+            case value_i::STRING:
+                EXPECT_EQ(std::string_view(expected->value.str_val.text, expected->value.str_val.length),
+                          std::string_view(actual->value.str_val.text, actual->value.str_val.length));
+                break;
+            case value_i::NUMBER:
+                EXPECT_EQ(expected->value.num_val, actual->value.num_val);
+                break;
+            case value_i::BOOL:
+                EXPECT_EQ(expected->value.bool_val, actual->value.bool_val);
+                break;
+            case value_i::OP:
+                EXPECT_EQ(expected->value.op_val, actual->value.op_val);
+                break;
+            default:
+                break;
+        }
+        ASSERT_EQ(expected->children.size(), actual->children.size());
+        for (size_t i = 0; i < expected->children.size(); ++i)
+            expect_same_tree(expected->children[i], actual->children[i]);
+    }
+
+    /**
+     * @brief A container image copied to section-aligned storage, as open_memory requires.
+     */
+    struct aligned_image
+    {
+        explicit aligned_image(const std::vector<unsigned char> &image)
+            : storage(new unsigned char[image.size() + binary::SECTION_ALIGNMENT]), size(image.size())
+        {
+            const auto address = reinterpret_cast<uintptr_t>(storage.get());
+            data = storage.get() + (binary::SECTION_ALIGNMENT - address % binary::SECTION_ALIGNMENT) %
+                   binary::SECTION_ALIGNMENT;
+            std::memcpy(data, image.data(), image.size());
+        }
+
+        std::unique_ptr<unsigned char[]> storage;
+        unsigned char *data;
+        size_t size;
+    };
+}
+
+TEST(Serialize, TreeRoundTrip)
+{
+    ir_node *tree = sample_tree();
+    binary::writer out;
+    add_ast(out, tree);
+    const aligned_image image(out.image());
+
+    binary::reader in;
+    ASSERT_TRUE(in.open_memory(image.data, image.size)) << in.error();
+    ast_view_t view{};
+    ASSERT_TRUE(read_ast(in, view));
+
+    // Pre-order: class, "Point", field, "x", op, 1.5, true, null, ""
+    ASSERT_EQ(view.size, 9u);
+    EXPECT_EQ(view.string(1), "Point");
+    EXPECT_EQ(view.ends[2], 7u);
+    EXPECT_EQ(view.number(5), 1.5);
+    EXPECT_EQ(view.types[7], NULL_NODE);
+    EXPECT_EQ(view.string(8), "");
+
+    ir_node *rebuilt = build_tree(view);
+    expect_same_tree(tree, rebuilt);
+    destroy_node(rebuilt);
+    destroy_node(tree);
+}
+
+TEST(Serialize, TokensMapInPlace)
+{
+    const std::string source = "class Main\n{\n    var a: i32 = 42;\n}\n";
+    Lexer lexer = create_lexer(source);
+    tokenize(lexer);
+
+    binary::writer out;
+    add_source_info(out, { 7, source.size(), LEXER_VERSION });
+    add_tokens(out, lexer);
+    const std::string path = testing::TempDir() + "yu-serialize-test.ybin";
+    ASSERT_TRUE(out.write(path));
+
+    binary::reader in;
+    ASSERT_TRUE(in.open(path)) << in.error();
+    source_info_t info{};
+    ASSERT_TRUE(read_source_info(in, info));
+    EXPECT_EQ(info.hash, 7u);
+    EXPECT_EQ(info.size, source.size());
+    EXPECT_EQ(info.lexer_version, LEXER_VERSION);
+
+    token_view_t view{};
+    ASSERT_TRUE(read_tokens(in, view));
+    ASSERT_EQ(view.size, lexer.tokens.size());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(view.starts) % binary::SECTION_ALIGNMENT, 0u);
+    for (size_t i = 0; i < view.size; ++i)
+    {
+        EXPECT_EQ(view.starts[i], lexer.tokens.starts[i]);
+        EXPECT_EQ(view.lengths[i], lexer.tokens.lengths[i]);
+        EXPECT_EQ(view.types[i], lexer.tokens.types[i]);
+        EXPECT_EQ(view.flags[i], lexer.tokens.flags[i]);
+    }
+    ASSERT_EQ(view.line_count, lexer.line_starts.size());
+    std::filesystem::remove(path);
+}
+
+TEST(Serialize, RejectsDamagedContainers)
+{
+    ir_node *tree = sample_tree();
+    binary::writer out;
+    add_ast(out, tree);
+    destroy_node(tree);
+    const std::vector<unsigned char> image = out.image();
+
+    binary::reader in;
+    {
+        auto damaged = image;
+        damaged.back() ^= 1; // last byte of the string payload
+        const aligned_image copy(damaged);
+        EXPECT_FALSE(in.open_memory(copy.data, copy.size));
+        EXPECT_STREQ(in.error(), "section checksum mismatch");
+        EXPECT_TRUE(in.open_memory(copy.data, copy.size, false));
+    }
+    {
+        auto damaged = image;
+        damaged[offsetof(binary::file_header_t, version_major)] = binary::VERSION_MAJOR + 1;
+        const aligned_image copy(damaged);
+        EXPECT_FALSE(in.open_memory(copy.data, copy.size));
+        EXPECT_STREQ(in.error(), "unsupported container version");
+    }
+    {
+        auto damaged = image;
+        damaged[sizeof(binary::file_header_t) + offsetof(binary::section_entry_t, size)] ^= 0x40;
+        const aligned_image copy(damaged);
+        EXPECT_FALSE(in.open_memory(copy.data, copy.size));
+        EXPECT_STREQ(in.error(), "header checksum mismatch");
+    }
+    {
+        const aligned_image copy(std::vector<unsigned char>(image.begin(), image.end() - 1));
+        EXPECT_FALSE(in.open_memory(copy.data, copy.size));
+    }
+}
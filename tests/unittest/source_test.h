@@ -0,0 +1,87 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#ifndef YU_TEST_SOURCE_TEST_H
+#define YU_TEST_SOURCE_TEST_H
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "../include/lexer.h"
+#include "../include/sema.h"
+#include "../../middle/include/lower.h"
+
+/**
+ * @brief Fixture for suites that run source text through the frontend.
+ * Sources, lexers and trees stay alive until the test ends, so resolved types and lowered
+ * functions can still point into them.
+ */
+class SourceTest : public testing::Test
+{
+protected:
+    void TearDown() override
+    {
+        for (auto *tree : trees)
+            yu::frontend::destroy_node(tree);
+    }
+
+    /**
+     * @brief Parses `code` as a module and analyzes it into `model`.
+     * @return The module, or null (with a failure recorded) if it did not parse.
+     */
+    yu::frontend::ir_node *check(const std::string &code, yu::frontend::semantic_model &model,
+                                 const std::vector<const yu::frontend::semantic_model *> &imports = {})
+    {
+        sources.push_back(std::make_unique<std::string>(code));
+        lexers.push_back(std::make_unique<yu::frontend::Lexer>(yu::frontend::create_lexer(*sources.back())));
+        const auto *tokens = yu::frontend::tokenize(*lexers.back());
+
+        uint32_t body_pos;
+        yu::frontend::ir_node *module = yu::frontend::parse_imports(sources.back()->c_str(), tokens, body_pos);
+        if (!module)
+        {
+            ADD_FAILURE() << "imports did not parse";
+            return nullptr;
+        }
+        trees.push_back(module);
+        if (!yu::frontend::parse_module_body(sources.back()->c_str(), tokens, body_pos, module))
+        {
+            ADD_FAILURE() << "module body did not parse";
+            return nullptr;
+        }
+        yu::frontend::analyze(module, model, imports);
+        return module;
+    }
+
+    std::vector<std::unique_ptr<std::string>> sources;
+    std::vector<std::unique_ptr<yu::frontend::Lexer>> lexers;
+    std::vector<yu::frontend::ir_node *> trees;
+};
+
+/**
+ * @brief SourceTest plus lookups over lowered functions, for the middle-end suites.
+ */
+class IrSourceTest : public SourceTest
+{
+protected:
+    static const yu::middle::function_t &find(const yu::middle::module_ir &ir, const std::string &name)
+    {
+        const auto it = std::find_if(ir.functions.begin(), ir.functions.end(),
+                                     [&](const yu::middle::function_t &function)
+                                     {
+                                         return yu::middle::function_name(ir, function) == name;
+                                     });
+        EXPECT_NE(it, ir.functions.end()) << name;
+        return *it;
+    }
+
+    static size_t count(const yu::middle::function_t &function, const yu::middle::op_i op)
+    {
+        return std::count_if(function.instrs.begin(), function.instrs.end(),
+                             [&](const yu::middle::instr_t &instr) { return instr.op == op; });
+    }
+};
+
+#endif
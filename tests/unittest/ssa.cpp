@@ -0,0 +1,218 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <string>
+#include <gtest/gtest.h>
+#include "source_test.h"
+
+using namespace yu::frontend;
+using namespace yu::middle;
+
+class SsaTest : public IrSourceTest
+{
+protected:
+    /**
+     * @brief Parses, checks and lowers `code`; every lowered function must verify.
+     */
+    void lower(const std::string &code, semantic_model &model, module_ir &ir)
+    {
+        ir_node *module = check(code, model);
+        ASSERT_NE(module, nullptr);
+        ASSERT_TRUE(model.errors.empty()) << model.errors[0];
+        lower_module(module, model, ir);
+        for (const auto &function : ir.functions)
+        {
+            for (const auto &error : verify(ir, function))
+                ADD_FAILURE() << function_name(ir, function) << ": " << error << "\n" << dump(ir, function);
+        }
+    }
+};
+
+TEST_F(SsaTest, MergesBranchesWithPhis)
+{
+    semantic_model model;
+    module_ir ir;
+    lower(R"(
+        class Account
+        {
+            var balance: i64;
+            function apply(amount: i64, strict: boolean) -> i64
+            {
+                var next = balance + amount;
+                if (strict & next < 0) { next = 0; } else { balance = next; }
+                return next * 2;
+            }
+        }
+    )", model, ir);
+    ASSERT_EQ(ir.functions.size(), 1u);
+
+    const function_t &apply = ir.functions[0];
+    EXPECT_EQ(apply.blocks.size(), 4u);
+    EXPECT_EQ(count(apply, op_i::PHI), 1u);
+    EXPECT_EQ(count(apply, op_i::PARAM), 3u);
+
+    // The literals take the type of the other operand
+    const std::string expected = R"(function Account.apply(Account, i64, boolean) -> i64
+b0:
+  %0 = param 0 : Account
+  %1 = param 1 : i64
+  %2 = param 2 : boolean
+  %3 = load_field %0.balance : i64
+  %4 = add %3, %1 : i64
+  %5 = const 0 : i64
+  %6 = lt %4, %5 : boolean
+  %7 = and %2, %6 : boolean
+  branch %7, b1, b2
+b1: ; preds b0
+  %9 = const 0 : i64
+  jump b3
+b2: ; preds b0
+  store_field %0.balance, %4
+  jump b3
+b3: ; preds b1, b2
+  %13 = phi [%9, b1], [%4, b2] : i64
+  %14 = const 2 : i64
+  %15 = mul %13, %14 : i64
+  return %15
+)";
+    EXPECT_EQ(dump(ir, apply), expected);
+}
+
+TEST_F(SsaTest, BuildsLoopsAndDropsDeadCode)
+{
+    semantic_model model;
+    module_ir ir;
+    lower(R"(
+        class Stats
+        {
+            var limit: i32;
+            function sum(n: i32) -> f64
+            {
+                var total: f64 = 0;
+                var scale = 1.5;
+                for (var i: i32 = 0; i < n; i = i + 1)
+                {
+                    var j = 0;
+                    while (j < limit) { total = total + scale; j = j + 1; }
+                }
+                return total;
+                total = 5;
+            }
+            function find(key: string) -> boolean
+            {
+                while (true) { if (key == "x") { return true; } }
+            }
+            function touch() { limit = limit + 1; log(limit); }
+            function log(value: i32) { }
+        }
+    )", model, ir);
+    ASSERT_EQ(ir.functions.size(), 4u);
+
+    // i and total change in the outer loop, j and total in the inner one; scale never does
+    const function_t &sum = find(ir, "Stats.sum");
+    EXPECT_EQ(count(sum, op_i::PHI), 4u);
+    EXPECT_EQ(count(sum, op_i::RETURN), 1u);
+    EXPECT_EQ(count(sum, op_i::UNDEF), 0u);
+    const std::string text = dump(ir, sum);
+    EXPECT_EQ(text.find("const 5"), std::string::npos) << text;
+
+    // Conditions are not folded yet, so the way out of `while (true)` is still there
+    const function_t &found = find(ir, "Stats.find");
+    EXPECT_EQ(count(found, op_i::RETURN), 2u);
+    EXPECT_EQ(count(found, op_i::UNDEF), 1u);
+
+    const function_t &touch = find(ir, "Stats.touch");
+    EXPECT_EQ(count(touch, op_i::LOAD_FIELD), 2u);
+    EXPECT_EQ(count(touch, op_i::STORE_FIELD), 1u);
+    EXPECT_NE(dump(ir, touch).find("call %0.log(%"), std::string::npos);
+}
+
+TEST_F(SsaTest, SkipsMethodsWithoutConcreteTypes)
+{
+    semantic_model model;
+    module_ir ir;
+    lower(R"(
+        class Box<T>
+        {
+            var item: T;
+            function get() -> T { return item; }
+            function set(value: T) { item = value; }
+        }
+        class User
+        {
+            var box: Box<string>;
+            function read() -> i32 { var t = box.get(); return 1; }
+            function fallthrough(flag: boolean) -> i32 { if (flag) { return 1; } }
+        }
+    )", model, ir);
+
+    // Inside Box, T is a type of its own; seen from User it has none
+    EXPECT_EQ(ir.functions.size(), 3u);
+    ASSERT_EQ(ir.skipped.size(), 1u);
+    EXPECT_EQ(ir.skipped[0], "User.read: uses a value typed by another class's type parameter");
+
+    // Falling off the end of a method with a return type returns an undefined value
+    const function_t &fallthrough = find(ir, "User.fallthrough");
+    EXPECT_EQ(count(fallthrough, op_i::UNDEF), 1u);
+    EXPECT_EQ(count(fallthrough, op_i::RETURN), 2u);
+}
+
+TEST_F(SsaTest, VerifierRejectsBrokenFunctions)
+{
+    semantic_model model;
+    module_ir ir;
+    lower(R"(
+        class Loop
+        {
+            function run(n: i32) -> i32
+            {
+                var i = 0;
+                while (i < n) { i = i + 1; }
+                return i;
+            }
+        }
+    )", model, ir);
+    ASSERT_EQ(ir.functions.size(), 1u);
+    const function_t &good = ir.functions[0];
+    ASSERT_TRUE(verify(ir, good).empty());
+
+    const auto errors_of = [&](const auto &mutate)
+    {
+        function_t broken = good;
+        mutate(broken);
+        const auto errors = verify(ir, broken);
+        std::string all;
+        for (const auto &error : errors)
+            all += error + "\n";
+        return all;
+    };
+    const auto index_of = [&](const op_i op)
+    {
+        return static_cast<uint32_t>(std::find_if(good.instrs.begin(), good.instrs.end(),
+                                                  [&](const instr_t &instr) { return instr.op == op; }) -
+                                     good.instrs.begin());
+    };
+
+    // The return uses the loop phi; pointing it at the increment in the body breaks dominance
+    const uint32_t add = index_of(op_i::ADD);
+    const uint32_t ret = index_of(op_i::RETURN);
+    EXPECT_NE(errors_of([&](function_t &f) { f.operands[f.instrs[ret].first_operand] = add; })
+                  .find("does not dominate its use"), std::string::npos);
+
+    // Branching on an integer
+    const uint32_t branch = index_of(op_i::BRANCH);
+    EXPECT_NE(errors_of([&](function_t &f) { f.operands[f.instrs[branch].first_operand] = 1; })
+                  .find("is 'i32', expected 'boolean'"), std::string::npos);
+
+    // A terminator in the middle of a block, and a phi missing an operand
+    EXPECT_NE(errors_of([&](function_t &f) { f.instrs[1].op = op_i::RETURN; })
+                  .find("must end in exactly one terminator"), std::string::npos);
+    const uint32_t phi = index_of(op_i::PHI);
+    EXPECT_NE(errors_of([&](function_t &f) { --f.instrs[phi].operand_count; })
+                  .find("needs one operand per predecessor"), std::string::npos);
+
+    // A predecessor without an edge
+    EXPECT_NE(errors_of([&](function_t &f) { ++f.preds[f.blocks[1].first_pred]; })
+                  .find("predecessors do not match the terminators"), std::string::npos);
+}
@@ -0,0 +1,93 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <gtest/gtest.h>
+#include "../../common/hash.hpp"
+#include "../include/lexer.h"
+#include "../include/serialize.h"
+#include "../include/token_cache.h"
+
+using namespace yu::frontend;
+
+class TokenCacheTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        directory = testing::TempDir() + "yu-token-cache-test";
+        std::filesystem::remove_all(directory);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::string directory;
+};
+
+TEST(Hash, MatchesXxh64)
+{
+    EXPECT_EQ(yu::hash64("", 0), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(yu::hash64("abc", 3), 0x44BC2CF5AD770999ULL);
+
+    const std::string long_input = "0123456789abcdef0123456789abcdef0123456789";
+    EXPECT_EQ(yu::hash64(long_input.data(), long_input.size()), 0xA76190C3ACF08A1CULL);
+    EXPECT_EQ(yu::hash64(long_input.data(), long_input.size(), 7), 0x9CDB6129259B938EULL);
+}
+
+TEST_F(TokenCacheTest, RoundTrip)
+{
+    const std::string source = "class Main\n{\n    var a: i32 = 42; // comment\n    var s = \"x\";\n}\n";
+    Lexer lexed = create_lexer(source);
+    tokenize(lexed);
+
+    const uint64_t hash = source_hash(source);
+    Lexer cached;
+    EXPECT_FALSE(load_cached_tokens(directory, source, hash, cached));
+    ASSERT_TRUE(store_cached_tokens(directory, hash, lexed));
+    ASSERT_TRUE(load_cached_tokens(directory, source, hash, cached));
+
+    EXPECT_EQ(cached.src, source.data());
+    EXPECT_EQ(cached.src_length, source.size());
+    EXPECT_EQ(cached.tokens.starts, lexed.tokens.starts);
+    EXPECT_EQ(cached.tokens.lengths, lexed.tokens.lengths);
+    EXPECT_EQ(cached.tokens.types, lexed.tokens.types);
+    EXPECT_EQ(cached.tokens.flags, lexed.tokens.flags);
+    EXPECT_EQ(cached.line_starts, lexed.line_starts);
+}
+
+TEST_F(TokenCacheTest, RejectsStaleAndDamagedEntries)
+{
+    const std::string source = "var a = 1;\n";
+    Lexer lexed = create_lexer(source);
+    tokenize(lexed);
+    const uint64_t hash = source_hash(source);
+    ASSERT_TRUE(store_cached_tokens(directory, hash, lexed));
+
+    // Same hash slot, different source length
+    Lexer cached;
+    EXPECT_FALSE(load_cached_tokens(directory, "var a = 12;\n", hash, cached));
+
+    // Entry written by another lexer version
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+    {
+        yu::binary::writer older;
+        add_source_info(older, { hash, source.size(), LEXER_VERSION + 1 });
+        add_tokens(older, lexed);
+        ASSERT_TRUE(older.write(entry.path().string()));
+    }
+    EXPECT_FALSE(load_cached_tokens(directory, source, hash, cached));
+    ASSERT_TRUE(store_cached_tokens(directory, hash, lexed));
+    ASSERT_TRUE(load_cached_tokens(directory, source, hash, cached));
+    cached = Lexer{};
+
+    // Truncated entry
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+        std::filesystem::resize_file(entry.path(), std::filesystem::file_size(entry.path()) - 1);
+    EXPECT_FALSE(load_cached_tokens(directory, source, hash, cached));
+    EXPECT_EQ(cached.tokens.size(), 0u);
+}
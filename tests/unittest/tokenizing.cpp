@@ -753,3 +753,24 @@ TEST_F(LexerTest, Array)
     EXPECT_EQ(tokens->types[i++], token_i::END_OF_FILE);
     EXPECT_EQ(i, tokens->size());
 }
+
+TEST_F(LexerTest, LineColumn)
+{
+    constexpr std::string_view source = "var a = 1;\n  /* two\n lines */ var  bc = 2;\n\nfoo";
+    lexer = create_lexer(source);
+    const auto tokens = tokenize(lexer);
+
+    auto position = [&](const size_t index)
+    {
+        return get_line_col(lexer, { tokens->starts[index], tokens->lengths[index],
+                                     tokens->types[index], tokens->flags[index] });
+    };
+
+    EXPECT_EQ(position(0), std::make_pair(1u, 1u));  // var
+    EXPECT_EQ(position(3), std::make_pair(1u, 9u));  // 1
+    EXPECT_EQ(position(5), std::make_pair(3u, 11u)); // var after the comment
+    EXPECT_EQ(position(6), std::make_pair(3u, 16u)); // bc
+    EXPECT_EQ(position(10), std::make_pair(5u, 1u)); // foo
+    for (size_t i = 0; i + 1 < tokens->size(); ++i)
+        EXPECT_EQ(tokens->flags[i], 0) << "token " << i;
+}
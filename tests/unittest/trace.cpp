@@ -0,0 +1,64 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <gtest/gtest.h>
+#include "../../common/trace.h"
+
+using namespace yu::trace;
+
+TEST(Trace, RecordsNestedSpans)
+{
+    enable(false);
+    {
+        span outer("outer", "file.yu");
+        outer.bytes = 100;
+        {
+            span inner("inner");
+            inner.tokens = 7;
+            inner.stop();
+            inner.nodes = 3;
+        }
+    }
+
+    const auto spans = records();
+    ASSERT_EQ(spans.size(), 2u);
+
+    // Completion order: the inner span finishes first
+    EXPECT_STREQ(spans[0].name, "inner");
+    EXPECT_EQ(spans[0].depth, 1u);
+    EXPECT_EQ(spans[0].tokens, 7u);
+    EXPECT_EQ(spans[0].nodes, 3u);
+    EXPECT_TRUE(spans[0].detail.empty());
+
+    EXPECT_STREQ(spans[1].name, "outer");
+    EXPECT_EQ(spans[1].depth, 0u);
+    EXPECT_EQ(spans[1].bytes, 100u);
+    EXPECT_EQ(spans[1].detail, "file.yu");
+    EXPECT_EQ(spans[0].thread, spans[1].thread);
+    EXPECT_LE(spans[1].start_ns, spans[0].start_ns);
+    EXPECT_GE(spans[1].start_ns + spans[1].duration_ns, spans[0].start_ns + spans[0].duration_ns);
+}
+
+TEST(Trace, WritesChromeTrace)
+{
+    enable(false);
+    {
+        span quoted("parse", "dir\\\"odd\".yu");
+    }
+
+    const std::string path = testing::TempDir() + "yu-trace-test.json";
+    ASSERT_TRUE(write_chrome_trace(path));
+
+    std::ifstream file(path);
+    const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"parse\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"detail\":\"dir\\\\\\\"odd\\\".yu\""), std::string::npos);
+    // Allocated bytes are left out rather than reported as zero when they are not counted
+    EXPECT_EQ(json.find("\"alloc_bytes\"") != std::string::npos, records()[0].has_alloc);
+    std::remove(path.c_str());
+}